@@ -31,11 +31,45 @@
 
 #include <algorithm>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <iterator>
 #include <memory>
+#include <stdexcept>
 #include <type_traits>
 #include <utility>
 
+//members that modify their object can only be constexpr from C++14 on
+#if __cplusplus >= 201402L
+#define ARRAY2D_CONSTEXPR14 constexpr
+#else
+#define ARRAY2D_CONSTEXPR14
+#endif
+
+//Defining ARRAY2D_CHECKED as 1 makes array2d check the coordinates passed to
+//index(), operator(), row_begin() and column_begin(), and gives it
+//array2d_checked_iterators, which check that they stay in range, belong to
+//the grid they are compared with and haven't been invalidated. A failed check
+//calls ARRAY2D_CHECK_FAILED, which prints the problem and aborts unless it is
+//defined otherwise. Left at 0, none of this is compiled.
+#ifndef ARRAY2D_CHECKED
+#define ARRAY2D_CHECKED 0
+#endif
+
+#if ARRAY2D_CHECKED
+#include <cstdio>
+#include <cstdlib>
+
+#ifndef ARRAY2D_CHECK_FAILED
+#define ARRAY2D_CHECK_FAILED(what) \
+    (std::fprintf(stderr, "array2d: %s\n", what), std::abort())
+#endif
+
+#define ARRAY2D_CHECK(cond, what) ((cond) ? (void)0 : (void)(ARRAY2D_CHECK_FAILED(what)))
+#else
+#define ARRAY2D_CHECK(cond, what) ((void)0)
+#endif
+
 namespace array2d
 {
 
@@ -51,55 +85,60 @@ struct array2d_iterator
   
     pointer _m_pos;
     
-    array2d_iterator() : _m_pos(nullptr) { }
-    array2d_iterator(pointer pos) : _m_pos(pos) { }
+    constexpr array2d_iterator() : _m_pos(nullptr) { }
+    constexpr array2d_iterator(pointer pos) : _m_pos(pos) { }
 
     //allow non-const to const conversion
     template <typename P, typename R>
-    array2d_iterator(const array2d_iterator<T, P, R>& o,
-                     typename std::enable_if<
-                         std::is_convertible<P, pointer>::value
-                     >::type* = nullptr)
+    constexpr array2d_iterator(const array2d_iterator<T, P, R>& o,
+                               typename std::enable_if<
+                                   std::is_convertible<P, pointer>::value
+                               >::type* = nullptr)
         : _m_pos(o._m_pos)
     { }
 
-    reference operator*() const { return *_m_pos; }
-    pointer operator->() const { return _m_pos; }
+    constexpr reference operator*() const { return *_m_pos; }
+    constexpr pointer operator->() const { return _m_pos; }
 
-    array2d_iterator& operator++() { ++_m_pos; return *this; }
-    array2d_iterator operator++(int) { return array2d_iterator(_m_pos++); }
+    ARRAY2D_CONSTEXPR14 array2d_iterator& operator++() { ++_m_pos; return *this; }
+    ARRAY2D_CONSTEXPR14 array2d_iterator operator++(int)
+    { return array2d_iterator(_m_pos++); }
 
-    array2d_iterator& operator--() { --_m_pos; return *this; }
-    array2d_iterator operator--(int) { return array2d_iterator(_m_pos--); }
+    ARRAY2D_CONSTEXPR14 array2d_iterator& operator--() { --_m_pos; return *this; }
+    ARRAY2D_CONSTEXPR14 array2d_iterator operator--(int)
+    { return array2d_iterator(_m_pos--); }
 
-    array2d_iterator& operator+=(difference_type n)
+    ARRAY2D_CONSTEXPR14 array2d_iterator& operator+=(difference_type n)
     { _m_pos += n; return *this; }
 
-    array2d_iterator& operator-=(difference_type n)
+    ARRAY2D_CONSTEXPR14 array2d_iterator& operator-=(difference_type n)
     { _m_pos -= n; return *this; }
 
-    array2d_iterator operator+(difference_type n) const
+    constexpr array2d_iterator operator+(difference_type n) const
     { return array2d_iterator(_m_pos + n); }
 
-    array2d_iterator operator-(difference_type n) const
+    constexpr array2d_iterator operator-(difference_type n) const
     { return array2d_iterator(_m_pos - n); }
 
-    reference operator[](difference_type n) const
+    constexpr difference_type operator-(const array2d_iterator& o) const
+    { return _m_pos - o._m_pos; }
+
+    constexpr reference operator[](difference_type n) const
     { return *(_m_pos + n); }
 
-    bool operator==(const array2d_iterator& o) const
+    constexpr bool operator==(const array2d_iterator& o) const
     { return _m_pos == o._m_pos; }
-    bool operator!=(const array2d_iterator& o) const
+    constexpr bool operator!=(const array2d_iterator& o) const
     { return _m_pos != o._m_pos; }
     
-    bool operator<(const array2d_iterator& o) const
+    constexpr bool operator<(const array2d_iterator& o) const
     { return _m_pos < o._m_pos; }
-    bool operator>(const array2d_iterator& o) const
+    constexpr bool operator>(const array2d_iterator& o) const
     { return _m_pos > o._m_pos; }
 
-    bool operator<=(const array2d_iterator& o) const
+    constexpr bool operator<=(const array2d_iterator& o) const
     { return !(_m_pos > o._m_pos); }
-    bool operator>=(const array2d_iterator& o) const
+    constexpr bool operator>=(const array2d_iterator& o) const
     { return !(_m_pos < o._m_pos); }
 };
 
@@ -114,99 +153,239 @@ struct array2d_column_iterator
     typedef Reference                           reference;
 
     pointer _m_pos;
-    std::size_t _m_width;
+    std::size_t _m_pitch;
 
-    array2d_column_iterator() : _m_pos(nullptr), _m_width(-1) { }
-    array2d_column_iterator(pointer pos, std::size_t width)
-        : _m_pos(pos), _m_width(width) { }
+    constexpr array2d_column_iterator() : _m_pos(nullptr), _m_pitch(-1) { }
+    constexpr array2d_column_iterator(pointer pos, std::size_t pitch)
+        : _m_pos(pos), _m_pitch(pitch) { }
 
     //allow non-const to const conversion
     template <typename P, typename R>
-    array2d_column_iterator(const array2d_column_iterator<T, P, R>& o,
-                            const typename std::enable_if<
-                                std::is_convertible<P, pointer>::value
-                            >::type* = nullptr)
-        : _m_pos(o._m_pos), _m_width(o._m_width)
+    constexpr array2d_column_iterator(const array2d_column_iterator<T, P, R>& o,
+                                      const typename std::enable_if<
+                                          std::is_convertible<P, pointer>::value
+                                      >::type* = nullptr)
+        : _m_pos(o._m_pos), _m_pitch(o._m_pitch)
     { }
 
-    reference operator*() const { return *_m_pos; }
-    pointer operator->() const { return _m_pos; }
+    constexpr reference operator*() const { return *_m_pos; }
+    constexpr pointer operator->() const { return _m_pos; }
 
-    array2d_column_iterator& operator++() { _m_pos += _m_width; return *this; }
-    array2d_column_iterator operator++(int)
+    ARRAY2D_CONSTEXPR14 array2d_column_iterator& operator++()
+    { _m_pos += _m_pitch; return *this; }
+    ARRAY2D_CONSTEXPR14 array2d_column_iterator operator++(int)
     {
         array2d_column_iterator tmp(*this);
-        _m_pos += _m_width;
+        _m_pos += _m_pitch;
         return tmp;
     }
 
-    array2d_column_iterator& operator--() { _m_pos -= _m_width; return *this; }
-    array2d_column_iterator operator--(int)
+    ARRAY2D_CONSTEXPR14 array2d_column_iterator& operator--()
+    { _m_pos -= _m_pitch; return *this; }
+    ARRAY2D_CONSTEXPR14 array2d_column_iterator operator--(int)
     {
         array2d_column_iterator tmp(*this);
-        _m_pos -= _m_width;
+        _m_pos -= _m_pitch;
         return tmp;
     }
 
-    array2d_column_iterator& operator+=(difference_type n)
+    ARRAY2D_CONSTEXPR14 array2d_column_iterator& operator+=(difference_type n)
     {
-        _m_pos += (n * _m_width);
+        _m_pos += (n * _m_pitch);
         return *this;
     }
 
-    array2d_column_iterator& operator-=(difference_type n)
+    ARRAY2D_CONSTEXPR14 array2d_column_iterator& operator-=(difference_type n)
     {
-        _m_pos -= (n * _m_width);
+        _m_pos -= (n * _m_pitch);
         return *this;
     }
 
-    array2d_column_iterator operator+(difference_type n) const 
-    { return array2d_column_iterator(_m_pos + n * _m_width, _m_width); }
+    constexpr array2d_column_iterator operator+(difference_type n) const 
+    { return array2d_column_iterator(_m_pos + n * _m_pitch, _m_pitch); }
 
-    array2d_column_iterator operator-(difference_type n) const
-    { return array2d_column_iterator(_m_pos - n * _m_width, _m_width); }
+    constexpr array2d_column_iterator operator-(difference_type n) const
+    { return array2d_column_iterator(_m_pos - n * _m_pitch, _m_pitch); }
 
-    reference operator[](difference_type n) const
-    { return *(_m_pos + n * _m_width); }
+    constexpr difference_type operator-(const array2d_column_iterator& o) const
+    { return (_m_pos - o._m_pos) / static_cast<difference_type>(_m_pitch); }
+
+    constexpr reference operator[](difference_type n) const
+    { return *(_m_pos + n * _m_pitch); }
 
-    bool operator==(const array2d_column_iterator& o) const
+    constexpr bool operator==(const array2d_column_iterator& o) const
     { return _m_pos == o._m_pos; }
-    bool operator!=(const array2d_column_iterator& o) const
+    constexpr bool operator!=(const array2d_column_iterator& o) const
     { return _m_pos != o._m_pos; }
 
-    bool operator<(const array2d_column_iterator& o) const
+    constexpr bool operator<(const array2d_column_iterator& o) const
     { return _m_pos < o._m_pos; }
-    bool operator>(const array2d_column_iterator& o) const
+    constexpr bool operator>(const array2d_column_iterator& o) const
     { return _m_pos > o._m_pos; }
 
-    bool operator<=(const array2d_column_iterator& o) const
+    constexpr bool operator<=(const array2d_column_iterator& o) const
     { return !(_m_pos > o._m_pos); }
 
-    bool operator>=(const array2d_column_iterator& o) const
+    constexpr bool operator>=(const array2d_column_iterator& o) const
+    { return !(_m_pos < o._m_pos); }
+};
+
+
+//iterates over every element of a grid whose rows are padded out to a pitch,
+//skipping the padding at the end of each row
+template <typename T, typename Pointer, typename Reference>
+struct array2d_pitched_iterator
+{
+    typedef std::ptrdiff_t                      difference_type;
+    typedef std::random_access_iterator_tag     iterator_category;
+    typedef T                                   value_type;
+    typedef Pointer                             pointer;
+    typedef Reference                           reference;
+
+    pointer _m_pos;
+    pointer _m_row_end;
+    std::size_t _m_width;
+    std::size_t _m_pitch;
+
+    array2d_pitched_iterator()
+        : _m_pos(nullptr), _m_row_end(nullptr), _m_width(0), _m_pitch(0) { }
+    array2d_pitched_iterator(pointer pos, pointer row_end,
+                             std::size_t width, std::size_t pitch)
+        : _m_pos(pos), _m_row_end(row_end), _m_width(width), _m_pitch(pitch) { }
+
+    //allow non-const to const conversion
+    template <typename P, typename R>
+    array2d_pitched_iterator(const array2d_pitched_iterator<T, P, R>& o,
+                             typename std::enable_if<
+                                 std::is_convertible<P, pointer>::value
+                             >::type* = nullptr)
+        : _m_pos(o._m_pos), _m_row_end(o._m_row_end),
+          _m_width(o._m_width), _m_pitch(o._m_pitch)
+    { }
+
+    reference operator*() const { return *_m_pos; }
+    pointer operator->() const { return _m_pos; }
+
+    array2d_pitched_iterator& operator++()
+    {
+        if (++_m_pos == _m_row_end)
+        {
+            _m_pos += _m_pitch - _m_width;
+            _m_row_end += _m_pitch;
+        }
+        return *this;
+    }
+    array2d_pitched_iterator operator++(int)
+    {
+        array2d_pitched_iterator tmp(*this);
+        ++*this;
+        return tmp;
+    }
+
+    array2d_pitched_iterator& operator--()
+    {
+        if (_m_pos == _m_row_end - _m_width)
+        {
+            _m_pos -= _m_pitch - _m_width;
+            _m_row_end -= _m_pitch;
+        }
+        --_m_pos;
+        return *this;
+    }
+    array2d_pitched_iterator operator--(int)
+    {
+        array2d_pitched_iterator tmp(*this);
+        --*this;
+        return tmp;
+    }
+
+    array2d_pitched_iterator& operator+=(difference_type n)
+    {
+        if (n == 0)
+            return *this;
+
+        const difference_type width = _m_width;
+        pointer row = _m_row_end - width;
+        difference_type col = (_m_pos - row) + n;
+        difference_type rows = col / width;
+        col %= width;
+        if (col < 0)
+        {
+            col += width;
+            --rows;
+        }
+        row += rows * static_cast<difference_type>(_m_pitch);
+        _m_pos = row + col;
+        _m_row_end = row + width;
+        return *this;
+    }
+
+    array2d_pitched_iterator& operator-=(difference_type n)
+    { return *this += -n; }
+
+    array2d_pitched_iterator operator+(difference_type n) const
+    {
+        array2d_pitched_iterator tmp(*this);
+        return tmp += n;
+    }
+
+    array2d_pitched_iterator operator-(difference_type n) const
+    {
+        array2d_pitched_iterator tmp(*this);
+        return tmp += -n;
+    }
+
+    difference_type operator-(const array2d_pitched_iterator& o) const
+    {
+        if (_m_row_end == o._m_row_end)
+            return _m_pos - o._m_pos;
+
+        const difference_type rows = (_m_row_end - o._m_row_end) /
+                                     static_cast<difference_type>(_m_pitch);
+        return rows * static_cast<difference_type>(_m_width) +
+               ((_m_pos - _m_row_end) - (o._m_pos - o._m_row_end));
+    }
+
+    reference operator[](difference_type n) const
+    { return *(*this + n); }
+
+    bool operator==(const array2d_pitched_iterator& o) const
+    { return _m_pos == o._m_pos; }
+    bool operator!=(const array2d_pitched_iterator& o) const
+    { return _m_pos != o._m_pos; }
+
+    bool operator<(const array2d_pitched_iterator& o) const
+    { return _m_pos < o._m_pos; }
+    bool operator>(const array2d_pitched_iterator& o) const
+    { return _m_pos > o._m_pos; }
+
+    bool operator<=(const array2d_pitched_iterator& o) const
+    { return !(_m_pos > o._m_pos); }
+    bool operator>=(const array2d_pitched_iterator& o) const
     { return !(_m_pos < o._m_pos); }
 };
 
 
 #define ARRAY2D_ITER_COMPARE_OP(op, iter)                               \
     template <typename T>                                               \
-    inline bool operator op(const iter<T, T*, T&>& a,                   \
-                            const iter<T, const T*, const T&>& b)       \
+    constexpr bool operator op(const iter<T, T*, T&>& a,                \
+                               const iter<T, const T*, const T&>& b)    \
     { return a._m_pos op b._m_pos; }                                    \
                                                                         \
     template <typename T>                                               \
-    inline bool operator op(const iter<T, const T*, const T&>& a,       \
-                            const iter<T, T*, T&>& b)                   \
+    constexpr bool operator op(const iter<T, const T*, const T&>& a,    \
+                               const iter<T, T*, T&>& b)                \
     { return a._m_pos op b._m_pos; }
 
 #define ARRAY2D_ITER_COMPARE_OP_GTE_LTE(op1, op2, iter)                 \
     template <typename T>                                               \
-    inline bool operator op1(const iter<T, T*, T&>& a,                  \
-                             const iter<T, const T*, const T&>& b)      \
+    constexpr bool operator op1(const iter<T, T*, T&>& a,               \
+                                const iter<T, const T*, const T&>& b)   \
     { return !(a._m_pos op2 b._m_pos); }                                \
                                                                         \
     template <typename T>                                               \
-    inline bool operator op1(const iter<T, const T*, const T&>& a,      \
-                             const iter<T, T*, T&>& b)                  \
+    constexpr bool operator op1(const iter<T, const T*, const T&>& a,   \
+                                const iter<T, T*, T&>& b)               \
     { return !(a._m_pos op2 b._m_pos); }
   
 
@@ -220,6 +399,7 @@ struct array2d_column_iterator
 
 ARRAY2D_ITER_COMPARE(array2d_iterator)
 ARRAY2D_ITER_COMPARE(array2d_column_iterator)
+ARRAY2D_ITER_COMPARE(array2d_pitched_iterator)
 
 #undef ARRAY2D_ITER_COMPARE
 #undef ARRAY2D_ITER_COMPARE_OP_GTE_LTE
@@ -237,95 +417,99 @@ struct static_array2d_column_iterator
 
     pointer _m_pos;
 
-    static_array2d_column_iterator() : _m_pos(nullptr) { }
-    static_array2d_column_iterator(pointer pos) : _m_pos(pos) { }
+    constexpr static_array2d_column_iterator() : _m_pos(nullptr) { }
+    constexpr static_array2d_column_iterator(pointer pos) : _m_pos(pos) { }
 
     //allow non-const to const conversion
     template <typename P, typename R>
-    static_array2d_column_iterator(const static_array2d_column_iterator<T, P, R, Width>& o,
-                                   typename std::enable_if<
-                                       std::is_convertible<P, pointer>::value
-                                   >::type* = nullptr)
+    constexpr static_array2d_column_iterator(
+        const static_array2d_column_iterator<T, P, R, Width>& o,
+        typename std::enable_if<std::is_convertible<P, pointer>::value>::type* = nullptr)
         : _m_pos(o._m_pos)
     { }
 
-    reference operator*() const { return *_m_pos; }
-    pointer operator->() const { return _m_pos; }
+    constexpr reference operator*() const { return *_m_pos; }
+    constexpr pointer operator->() const { return _m_pos; }
 
-    static_array2d_column_iterator& operator++() { _m_pos += Width; return *this; }
-    static_array2d_column_iterator& operator++(int)
+    ARRAY2D_CONSTEXPR14 static_array2d_column_iterator& operator++()
+    { _m_pos += Width; return *this; }
+    ARRAY2D_CONSTEXPR14 static_array2d_column_iterator operator++(int)
     {
         static_array2d_column_iterator tmp(*this);
         _m_pos += Width;
         return tmp;
     }
 
-    static_array2d_column_iterator& operator--() { _m_pos -= Width; return *this; }
-    static_array2d_column_iterator operator--(int)
+    ARRAY2D_CONSTEXPR14 static_array2d_column_iterator& operator--()
+    { _m_pos -= Width; return *this; }
+    ARRAY2D_CONSTEXPR14 static_array2d_column_iterator operator--(int)
     {
         static_array2d_column_iterator tmp(*this);
         _m_pos -= Width;
         return tmp;
     }
 
-    static_array2d_column_iterator& operator+=(difference_type n)
+    ARRAY2D_CONSTEXPR14 static_array2d_column_iterator& operator+=(difference_type n)
     {
         _m_pos += (n * Width);
         return *this;
     }
 
-    static_array2d_column_iterator& operator-=(difference_type n)
+    ARRAY2D_CONSTEXPR14 static_array2d_column_iterator& operator-=(difference_type n)
     {
         _m_pos -= (n * Width);
         return *this;
     }
 
-    static_array2d_column_iterator operator+(difference_type n)
+    constexpr static_array2d_column_iterator operator+(difference_type n) const
     { return static_array2d_column_iterator(_m_pos + n * Width); }
 
-    static_array2d_column_iterator operator-(difference_type n)
+    constexpr static_array2d_column_iterator operator-(difference_type n) const
     { return static_array2d_column_iterator(_m_pos - n * Width); }
 
-    reference operator[](difference_type n)
+    constexpr difference_type operator-(const static_array2d_column_iterator& o) const
+    { return (_m_pos - o._m_pos) / static_cast<difference_type>(Width); }
+
+    constexpr reference operator[](difference_type n) const
     { return *(_m_pos + n * Width); }
 
-    bool operator==(const static_array2d_column_iterator& o) const
+    constexpr bool operator==(const static_array2d_column_iterator& o) const
     { return _m_pos == o._m_pos; }
-    bool operator!=(const static_array2d_column_iterator& o) const
+    constexpr bool operator!=(const static_array2d_column_iterator& o) const
     { return _m_pos != o._m_pos; }
 
-    bool operator<(const static_array2d_column_iterator& o) const
+    constexpr bool operator<(const static_array2d_column_iterator& o) const
     { return _m_pos < o._m_pos; }
-    bool operator>(const static_array2d_column_iterator& o) const
+    constexpr bool operator>(const static_array2d_column_iterator& o) const
     { return _m_pos > o._m_pos; }
 
-    bool operator<=(const static_array2d_column_iterator& o) const
+    constexpr bool operator<=(const static_array2d_column_iterator& o) const
     { return !(_m_pos > o._m_pos); }
 
-    bool operator>=(const static_array2d_column_iterator& o) const
+    constexpr bool operator>=(const static_array2d_column_iterator& o) const
     { return !(_m_pos < o._m_pos); }
 };
 
 #define ARRAY2D_ITER_COMPARE_OP(op, iter)                               \
     template <typename T, std::size_t W>                                \
-    inline bool operator op(const iter<T, T*, T&, W>& a,                \
-                            const iter<T, const T*, const T&, W>& b)    \
+    constexpr bool operator op(const iter<T, T*, T&, W>& a,             \
+                               const iter<T, const T*, const T&, W>& b) \
     { return a._m_pos op b._m_pos; }                                    \
                                                                         \
     template <typename T, std::size_t W>                                \
-    inline bool operator op(const iter<T, const T*, const T&, W>& a,    \
-                            const iter<T, T*, T&, W>& b)                \
+    constexpr bool operator op(const iter<T, const T*, const T&, W>& a, \
+                               const iter<T, T*, T&, W>& b)             \
     { return a._m_pos op b._m_pos; }
 
 #define ARRAY2D_ITER_COMPARE_OP_GTE_LTE(op1, op2, iter)                 \
     template <typename T, std::size_t W>                                \
-    inline bool operator op1(const iter<T, T*, T&, W>& a,               \
-                             const iter<T, const T*, const T&, W>& b)   \
+    constexpr bool operator op1(const iter<T, T*, T&, W>& a,            \
+                                const iter<T, const T*, const T&, W>& b)\
     { return !(a._m_pos op2 b._m_pos); }                                \
                                                                         \
     template <typename T, std::size_t W>                                \
-    inline bool operator op1(const iter<T, const T*, const T&, W>& a,   \
-                             const iter<T, T*, T&, W>& b)               \
+    constexpr bool operator op1(const iter<T, const T*, const T&, W>& a,\
+                                const iter<T, T*, T&, W>& b)            \
     { return !(a._m_pos op2 b._m_pos); }
 
 ARRAY2D_ITER_COMPARE_OP(==, static_array2d_column_iterator)
@@ -339,276 +523,2447 @@ ARRAY2D_ITER_COMPARE_OP_GTE_LTE(>=, <, static_array2d_column_iterator)
 #undef ARRAY2D_ITER_COMPARE_OP_GTE_LTE
 
 
-template <typename Iter,
-          bool Trivial = std::is_trivially_destructible<typename Iter::value_type>::value
-          >
-struct emplacer
-{
-    typedef typename Iter::pointer    pointer;
-    typedef typename Iter::value_type value_type;
+//builds an iterator over elements a fixed distance apart, whether that
+//distance is known at compile time or not
+template <typename Iter, typename Pointer>
+constexpr Iter make_strided_iterator(Pointer pos, std::size_t pitch,
+                                     typename std::enable_if<
+                                         std::is_constructible<Iter, Pointer, std::size_t>::value
+                                     >::type* = nullptr)
+{ return Iter(pos, pitch); }
 
-    template <typename... Args>
-    static inline Iter emplace(pointer pos, Args&&... args)
-    {
-        new (pos) value_type(std::forward<Args>(args)...);
-        return Iter(pos);
-    }
-};
+template <typename Iter, typename Pointer>
+constexpr Iter make_strided_iterator(Pointer pos, std::size_t,
+                                     typename std::enable_if<
+                                         !std::is_constructible<Iter, Pointer, std::size_t>::value
+                                     >::type* = nullptr)
+{ return Iter(pos); }
 
-template <typename Iter>
-struct emplacer<Iter, false>
-{
-    typedef typename Iter::pointer    pointer;
-    typedef typename Iter::value_type value_type;
 
-    template <typename... Args>
-    static inline Iter emplace(pointer pos, Args&&... args)
-    {
-        pos->~value_type();
-        new (pos) value_type(std::forward<Args>(args)...);
-        return Iter(pos);
-    }
+//which way an array2d_layout_iterator moves
+enum array2d_iteration
+{
+    iterate_row,    //across a row
+    iterate_column, //down a column
+    iterate_grid    //over every element, row by row
 };
 
-
-template <typename T>
-class array2d
+//iterates over a grid whose layout is not strided, by keeping the coordinates
+//of the current element and asking the layout where it is stored
+template <typename T, typename Pointer, typename Reference,
+          typename Layout, array2d_iteration Iteration>
+struct array2d_layout_iterator
 {
-  public:
-    typedef T                   value_type;
-    typedef T*                  pointer;
-    typedef const T*            const_pointer;
-    typedef T&                  reference;
-    typedef const T&            const_reference;
-    typedef std::size_t         size_type;
-    typedef std::ptrdiff_t      difference_type;
-
-    typedef array2d_iterator<T, T*, T&>             iterator;
-    typedef array2d_iterator<T, const T*, const T&> const_iterator;
+    typedef std::ptrdiff_t                      difference_type;
+    typedef std::random_access_iterator_tag     iterator_category;
+    typedef T                                   value_type;
+    typedef Pointer                             pointer;
+    typedef Reference                           reference;
 
-    //iterates down a column
-    typedef array2d_column_iterator<T, T*, T&>             column_iterator;
-    typedef array2d_column_iterator<T, const T*, const T&> const_column_iterator;
+    pointer _m_data;
+    std::size_t _m_pitch;
+    std::size_t _m_width;
+    std::size_t _m_x;
+    std::size_t _m_y;
 
-    //iterates across a row
-    typedef iterator            row_iterator;
-    typedef const_iterator      const_row_iterator;
-    
-  private:        
-    size_type m_width;
-    size_type m_height;
-    T* m_data;
-    
-  public:
-    array2d() = delete;
+    array2d_layout_iterator()
+        : _m_data(nullptr), _m_pitch(0), _m_width(0), _m_x(0), _m_y(0) { }
+    array2d_layout_iterator(pointer data, std::size_t pitch, std::size_t width,
+                            std::size_t x, std::size_t y)
+        : _m_data(data), _m_pitch(pitch), _m_width(width), _m_x(x), _m_y(y) { }
 
-    array2d(size_type width,
-            size_type height)
-        : m_width(width), 
-          m_height(height),
-          m_data(new T[m_width * m_height]) 
+    //allow non-const to const conversion
+    template <typename P, typename R>
+    array2d_layout_iterator(const array2d_layout_iterator<T, P, R, Layout, Iteration>& o,
+                            typename std::enable_if<
+                                std::is_convertible<P, pointer>::value
+                            >::type* = nullptr)
+        : _m_data(o._m_data), _m_pitch(o._m_pitch), _m_width(o._m_width),
+          _m_x(o._m_x), _m_y(o._m_y)
     { }
 
-    ~array2d() { delete[] m_data; }
-
-    array2d(array2d&& o)
-        : m_width(o.m_width), 
-          m_height(o.m_height),
-          m_data(o.m_data)
-    { o.m_data = nullptr; }
+    reference operator*() const
+    { return _m_data[Layout::offset(_m_x, _m_y, _m_pitch)]; }
+    pointer operator->() const
+    { return _m_data + Layout::offset(_m_x, _m_y, _m_pitch); }
 
-    array2d(const array2d& o)
-        : m_width(o.m_width),
-          m_height(o.m_height),
-          m_data(reinterpret_cast<T*>(new char[o.m_width * o.m_height * sizeof(T)]))
+    array2d_layout_iterator& operator++()
     {
-        std::uninitialized_copy_n(o.m_data, m_width * m_height, m_data);
+        if (Iteration == iterate_row)
+            ++_m_x;
+        else if (Iteration == iterate_column)
+            ++_m_y;
+        else if (++_m_x == _m_width)
+        {
+            _m_x = 0;
+            ++_m_y;
+        }
+        return *this;
     }
-    
-    array2d& operator=(const array2d& o)
+    array2d_layout_iterator operator++(int)
     {
-        m_data = reinterpret_cast<T*>(new char[o.m_width * o.m_height * sizeof(T)]);
-        std::uninitialized_copy_n(o.m_data, m_width * m_height, m_data);
-        m_width = o.m_width;
-        m_height = o.m_height;
+        array2d_layout_iterator tmp(*this);
+        ++*this;
+        return tmp;
+    }
 
+    array2d_layout_iterator& operator--()
+    {
+        if (Iteration == iterate_row)
+            --_m_x;
+        else if (Iteration == iterate_column)
+            --_m_y;
+        else if (_m_x-- == 0)
+        {
+            _m_x = _m_width - 1;
+            --_m_y;
+        }
         return *this;
     }
-
-    array2d& operator=(array2d&& o)
+    array2d_layout_iterator operator--(int)
     {
-        m_data = o.m_data;
-        o.m_data = nullptr;
-        m_width = o.m_width;
-        m_height = o.m_height;
+        array2d_layout_iterator tmp(*this);
+        --*this;
+        return tmp;
+    }
 
+    array2d_layout_iterator& operator+=(difference_type n)
+    {
+        if (Iteration == iterate_row)
+            _m_x += n;
+        else if (Iteration == iterate_column)
+            _m_y += n;
+        else if (n != 0)
+        {
+            const std::size_t i = _m_y * _m_width + _m_x + n;
+            _m_y = i / _m_width;
+            _m_x = i % _m_width;
+        }
         return *this;
     }
 
-    size_type width() const { return m_width; }
-    size_type height() const { return m_height; }
-
-    iterator begin() { return iterator(m_data); }
-    const_iterator begin() const { return const_iterator(m_data); }
-
-    iterator end() { return iterator(m_data +  m_width * m_height); }
-    const_iterator end() const { return const_iterator(m_data + m_width * m_height); }
-
-    row_iterator row_begin(size_type y) { return row_iterator(m_data + y * m_width); }
-    const_row_iterator row_begin(size_type y) const
-    { return const_row_iterator(m_data + y * m_width); }
-
-    row_iterator row_end(size_type y)
-    { return row_iterator(m_data + y * m_width + m_width); }
-    const_row_iterator row_end(size_type y) const
-    { return const_row_iterator(m_data + y * m_width + m_width); }
-    
-    column_iterator column_begin(size_type x)
-    { return column_iterator(m_data + x, m_width); }
-    const_column_iterator column_begin(size_type x) const
-    { return const_column_iterator(m_data + x, m_width); }
-
-    column_iterator column_end(size_type x)
-    { return column_iterator(m_data + m_height * m_width + x, m_width); }
-    const_column_iterator column_end(size_type x) const
-    { return const_column_iterator(m_data + m_height * m_width + x, m_width); }
-    
-    reference index(size_type x, size_type y)
-    { return m_data[y * m_width + x]; }
-    const_reference index(size_type x, size_type y) const 
-    { return m_data[y * m_width + x]; }
-
-    reference operator()(size_type x, size_type y)
-    { return m_data[y * m_width + x]; }
-    const_reference operator()(size_type x, size_type y) const 
-    { return m_data[y * m_width + x]; }
+    array2d_layout_iterator& operator-=(difference_type n)
+    { return *this += -n; }
 
-    template <typename... Args>
-    iterator emplace(size_type x, size_type y, Args&&... args)
+    array2d_layout_iterator operator+(difference_type n) const
     {
-        typedef emplacer<iterator> emplacer;
-        pointer pos = m_data + y * m_width + x;
-        return emplacer::emplace(pos, std::forward<Args>(args)...);
+        array2d_layout_iterator tmp(*this);
+        return tmp += n;
     }
-                 
-    template <typename... Args>
-    iterator emplace(iterator pos, Args&&... args)
+
+    array2d_layout_iterator operator-(difference_type n) const
     {
-        typedef emplacer<iterator> emplacer;
-        return emplacer::emplace(pos._m_pos, std::forward<Args>(args)...);
+        array2d_layout_iterator tmp(*this);
+        return tmp += -n;
     }
 
-    template <typename... Args>
-    column_iterator emplace(column_iterator pos, Args&&... args)
+    template <typename P, typename R>
+    difference_type
+    operator-(const array2d_layout_iterator<T, P, R, Layout, Iteration>& o) const
     {
-        typedef emplacer<column_iterator> emplacer;
-        return emplacer::emplace(pos._m_pos, std::forward<Args>(args)...);
+        const difference_type dx = static_cast<difference_type>(_m_x - o._m_x);
+        const difference_type dy = static_cast<difference_type>(_m_y - o._m_y);
+        if (Iteration == iterate_row)
+            return dx;
+        if (Iteration == iterate_column)
+            return dy;
+        return dy * static_cast<difference_type>(_m_width) + dx;
     }
+
+    reference operator[](difference_type n) const
+    { return *(*this + n); }
+
+    //every iteration visits elements in order of increasing (y, x)
+    template <typename P, typename R>
+    bool operator==(const array2d_layout_iterator<T, P, R, Layout, Iteration>& o) const
+    { return _m_x == o._m_x && _m_y == o._m_y; }
+    template <typename P, typename R>
+    bool operator!=(const array2d_layout_iterator<T, P, R, Layout, Iteration>& o) const
+    { return !(*this == o); }
+
+    template <typename P, typename R>
+    bool operator<(const array2d_layout_iterator<T, P, R, Layout, Iteration>& o) const
+    { return _m_y < o._m_y || (_m_y == o._m_y && _m_x < o._m_x); }
+    template <typename P, typename R>
+    bool operator>(const array2d_layout_iterator<T, P, R, Layout, Iteration>& o) const
+    { return o < *this; }
+
+    template <typename P, typename R>
+    bool operator<=(const array2d_layout_iterator<T, P, R, Layout, Iteration>& o) const
+    { return !(o < *this); }
+    template <typename P, typename R>
+    bool operator>=(const array2d_layout_iterator<T, P, R, Layout, Iteration>& o) const
+    { return !(*this < o); }
 };
 
 
-template <typename T, std::size_t Width, std::size_t Height>
-class static_array2d
+//iterates over a grid that can't give out pointers to its elements, by
+//keeping the coordinates of the current element and calling the grid's
+//index(x, y) on each access
+template <typename T, typename Grid, array2d_iteration Iteration>
+struct array2d_index_iterator
 {
-  public:
-    typedef T                   value_type;
-    typedef T*                  pointer;
-    typedef const T*            const_pointer;
-    typedef T&                  reference;
-    typedef const T&            const_reference;
-    typedef std::size_t         size_type;
-    typedef std::ptrdiff_t      difference_type;
-
-    typedef array2d_iterator<T, T*, T&>             iterator;
-    typedef array2d_iterator<T, const T*, const T&> const_iterator;
+    typedef std::ptrdiff_t                      difference_type;
+    typedef std::random_access_iterator_tag     iterator_category;
+    typedef typename std::remove_const<T>::type value_type;
+    typedef T*                                  pointer;
+    typedef T&                                  reference;
 
-    //iterates down a column
-    typedef static_array2d_column_iterator<T, T*, T&, Width>             column_iterator;
-    typedef static_array2d_column_iterator<T, const T*, const T&, Width> const_column_iterator;
+    Grid* _m_grid;
+    std::size_t _m_width;
+    std::size_t _m_x;
+    std::size_t _m_y;
 
-    //iterates across a row
-    typedef iterator            row_iterator;
-    typedef const_iterator      const_row_iterator;
+    array2d_index_iterator() : _m_grid(nullptr), _m_width(0), _m_x(0), _m_y(0) { }
+    array2d_index_iterator(Grid* grid, std::size_t width, std::size_t x, std::size_t y)
+        : _m_grid(grid), _m_width(width), _m_x(x), _m_y(y) { }
 
-  public:
-    static constexpr size_type width = Width;
-    static constexpr size_type height = Height;
-    static constexpr size_type size = Width * Height * sizeof(T);
+    //allow non-const to const conversion
+    template <typename U, typename G>
+    array2d_index_iterator(const array2d_index_iterator<U, G, Iteration>& o,
+                         typename std::enable_if<
+                             std::is_convertible<G*, Grid*>::value
+                         >::type* = nullptr)
+        : _m_grid(o._m_grid), _m_width(o._m_width), _m_x(o._m_x), _m_y(o._m_y)
+    { }
 
-  private:
-    T m_data[size];
+    reference operator*() const { return _m_grid->index(_m_x, _m_y); }
+    pointer operator->() const { return &_m_grid->index(_m_x, _m_y); }
 
-  public:
-    static_array2d() { }
-    ~static_array2d() { }
+    array2d_index_iterator& operator++()
+    {
+        if (Iteration == iterate_row)
+            ++_m_x;
+        else if (Iteration == iterate_column)
+            ++_m_y;
+        else if (++_m_x == _m_width)
+        {
+            _m_x = 0;
+            ++_m_y;
+        }
+        return *this;
+    }
+    array2d_index_iterator operator++(int)
+    {
+        array2d_index_iterator tmp(*this);
+        ++*this;
+        return tmp;
+    }
 
-    static_array2d(const static_array2d& o)
+    array2d_index_iterator& operator--()
+    {
+        if (Iteration == iterate_row)
+            --_m_x;
+        else if (Iteration == iterate_column)
+            --_m_y;
+        else if (_m_x-- == 0)
+        {
+            _m_x = _m_width - 1;
+            --_m_y;
+        }
+        return *this;
+    }
+    array2d_index_iterator operator--(int)
     {
-        std::copy(o.begin(), o.end(), begin());
+        array2d_index_iterator tmp(*this);
+        --*this;
+        return tmp;
     }
 
-    static_array2d& operator=(const static_array2d& o)
+    array2d_index_iterator& operator+=(difference_type n)
     {
-        std::copy(o.begin(), o.end(), begin());
+        if (Iteration == iterate_row)
+            _m_x += n;
+        else if (Iteration == iterate_column)
+            _m_y += n;
+        else if (n != 0)
+        {
+            const std::size_t i = _m_y * _m_width + _m_x + n;
+            _m_y = i / _m_width;
+            _m_x = i % _m_width;
+        }
         return *this;
     }
 
-    iterator begin() { return iterator(m_data); }
-    const_iterator begin() const { return const_iterator(m_data); }
+    array2d_index_iterator& operator-=(difference_type n)
+    { return *this += -n; }
 
-    iterator end() { return iterator(m_data +  Width * Height); }
-    const_iterator end() const { return const_iterator(m_data + Width * Height); }
+    array2d_index_iterator operator+(difference_type n) const
+    {
+        array2d_index_iterator tmp(*this);
+        return tmp += n;
+    }
 
-    row_iterator row_begin(size_type y) { return row_iterator(m_data + y * Width); }
-    const_row_iterator row_begin(size_type y) const
-    { return const_row_iterator(m_data + y * Width); }
+    array2d_index_iterator operator-(difference_type n) const
+    {
+        array2d_index_iterator tmp(*this);
+        return tmp += -n;
+    }
 
-    row_iterator row_end(size_type y) { return row_iterator(m_data + y * Width + Width); }
-    const_row_iterator row_end(size_type y) const
-    { return const_row_iterator(m_data + y * Width + Width); }
-    
-    column_iterator column_begin(size_type x)
-    { return column_iterator(m_data + x); }
-    const_column_iterator column_begin(size_type x) const
-    { return const_column_iterator(m_data + x); }
+    template <typename U, typename G>
+    difference_type operator-(const array2d_index_iterator<U, G, Iteration>& o) const
+    {
+        const difference_type dx = static_cast<difference_type>(_m_x - o._m_x);
+        const difference_type dy = static_cast<difference_type>(_m_y - o._m_y);
+        if (Iteration == iterate_row)
+            return dx;
+        if (Iteration == iterate_column)
+            return dy;
+        return dy * static_cast<difference_type>(_m_width) + dx;
+    }
 
-    column_iterator column_end(size_type x)
-    { return column_iterator(m_data + Height * Width + x); }
-    const_column_iterator column_end(size_type x) const
-    { return const_column_iterator(m_data + Height * Width + x); }
+    reference operator[](difference_type n) const
+    { return *(*this + n); }
+
+    template <typename U, typename G>
+    bool operator==(const array2d_index_iterator<U, G, Iteration>& o) const
+    { return _m_x == o._m_x && _m_y == o._m_y; }
+    template <typename U, typename G>
+    bool operator!=(const array2d_index_iterator<U, G, Iteration>& o) const
+    { return !(*this == o); }
+
+    template <typename U, typename G>
+    bool operator<(const array2d_index_iterator<U, G, Iteration>& o) const
+    { return _m_y < o._m_y || (_m_y == o._m_y && _m_x < o._m_x); }
+    template <typename U, typename G>
+    bool operator>(const array2d_index_iterator<U, G, Iteration>& o) const
+    { return o < *this; }
+
+    template <typename U, typename G>
+    bool operator<=(const array2d_index_iterator<U, G, Iteration>& o) const
+    { return !(o < *this); }
+    template <typename U, typename G>
+    bool operator>=(const array2d_index_iterator<U, G, Iteration>& o) const
+    { return !(*this < o); }
+};
 
-    reference index(size_type x, size_type y)
-    { return m_data[y * Width + x]; }
-    const_reference index(size_type x, size_type y) const
-    { return m_data[y * Width + x]; }
+#if ARRAY2D_CHECKED
+//Wraps one of a grid's iterators with the range it may move over, the grid's
+//generation counter and the generation it was made in. The grid bumps the
+//counter whenever it reallocates, is resized, moved, assigned or destroyed,
+//so using an iterator from before then fails its check, as do comparing or
+//subtracting iterators over different grids, rows or columns and stepping
+//outside the range.
+template <typename Iter>
+struct array2d_checked_iterator
+{
+    typedef typename std::iterator_traits<Iter>::difference_type   difference_type;
+    typedef typename std::iterator_traits<Iter>::iterator_category iterator_category;
+    typedef typename std::iterator_traits<Iter>::value_type        value_type;
+    typedef typename std::iterator_traits<Iter>::pointer           pointer;
+    typedef typename std::iterator_traits<Iter>::reference         reference;
+
+    Iter _m_it;
+    Iter _m_first;
+    Iter _m_last;
+    const std::size_t* _m_owner;
+    std::size_t _m_generation;
+
+    array2d_checked_iterator()
+        : _m_it(), _m_first(), _m_last(), _m_owner(nullptr), _m_generation(0) { }
+    array2d_checked_iterator(Iter it, Iter first, Iter last, const std::size_t* owner)
+        : _m_it(it), _m_first(first), _m_last(last), _m_owner(owner),
+          _m_generation(*owner)
+    {
+        ARRAY2D_CHECK(first <= it && it <= last, "iterator made outside its range");
+    }
 
-    reference operator()(size_type x, size_type y)
-    { return m_data[y * Width + x]; }
-    const_reference operator()(size_type x, size_type y) const
-    { return m_data[y * Width + x]; }
+    //allow non-const to const conversion
+    template <typename I>
+    array2d_checked_iterator(const array2d_checked_iterator<I>& o,
+                             typename std::enable_if<
+                                 std::is_convertible<I, Iter>::value
+                             >::type* = nullptr)
+        : _m_it(o._m_it), _m_first(o._m_first), _m_last(o._m_last),
+          _m_owner(o._m_owner), _m_generation(o._m_generation)
+    { }
 
-    template <typename... Args>
-    iterator emplace(size_type x, size_type y, Args&&... args)
+    //the unchecked iterator
+    Iter base() const { return _m_it; }
+
+    reference operator*() const
     {
-        typedef emplacer<iterator> emplacer;
-        pointer pos = m_data + y * Width + x;
-        return emplacer::emplace(pos, std::forward<Args>(args)...);
+        check_valid();
+        ARRAY2D_CHECK(_m_first <= _m_it && _m_it < _m_last,
+                      "dereferenced an iterator outside its range");
+        return *_m_it;
     }
-                 
-    template <typename... Args>
-    iterator emplace(iterator pos, Args&&... args)
+    pointer operator->() const { return std::addressof(**this); }
+
+    array2d_checked_iterator& operator++() { return *this += 1; }
+    array2d_checked_iterator operator++(int)
     {
-        typedef emplacer<iterator> emplacer;
-        return emplacer::emplace(pos._m_pos, std::forward<Args>(args)...);
+        array2d_checked_iterator tmp(*this);
+        *this += 1;
+        return tmp;
     }
 
-    template <typename... Args>
-    column_iterator emplace(column_iterator pos, Args&&... args)
+    array2d_checked_iterator& operator--() { return *this += -1; }
+    array2d_checked_iterator operator--(int)
     {
-        typedef emplacer<column_iterator> emplacer;
-        return emplacer::emplace(pos._m_pos, std::forward<Args>(args)...);
+        array2d_checked_iterator tmp(*this);
+        *this += -1;
+        return tmp;
     }
-};
+
+    array2d_checked_iterator& operator+=(difference_type n)
+    {
+        check_valid();
+        ARRAY2D_CHECK(n <= _m_last - _m_it && n >= _m_first - _m_it,
+                      "moved an iterator outside its range");
+        _m_it += n;
+        return *this;
+    }
+
+    array2d_checked_iterator& operator-=(difference_type n) { return *this += -n; }
+
+    array2d_checked_iterator operator+(difference_type n) const
+    {
+        array2d_checked_iterator tmp(*this);
+        return tmp += n;
+    }
+
+    array2d_checked_iterator operator-(difference_type n) const
+    {
+        array2d_checked_iterator tmp(*this);
+        return tmp += -n;
+    }
+
+    template <typename I>
+    difference_type operator-(const array2d_checked_iterator<I>& o) const
+    {
+        check_compatible(o);
+        return _m_it - o._m_it;
+    }
+
+    reference operator[](difference_type n) const { return *(*this + n); }
+
+    template <typename I>
+    bool operator==(const array2d_checked_iterator<I>& o) const
+    {
+        check_compatible(o);
+        return _m_it == o._m_it;
+    }
+    template <typename I>
+    bool operator!=(const array2d_checked_iterator<I>& o) const { return !(*this == o); }
+
+    template <typename I>
+    bool operator<(const array2d_checked_iterator<I>& o) const
+    {
+        check_compatible(o);
+        return _m_it < o._m_it;
+    }
+    template <typename I>
+    bool operator>(const array2d_checked_iterator<I>& o) const { return o < *this; }
+
+    template <typename I>
+    bool operator<=(const array2d_checked_iterator<I>& o) const { return !(o < *this); }
+    template <typename I>
+    bool operator>=(const array2d_checked_iterator<I>& o) const { return !(*this < o); }
+
+    void check_valid() const
+    {
+        ARRAY2D_CHECK(_m_owner, "used an iterator that doesn't belong to a grid");
+        ARRAY2D_CHECK(*_m_owner == _m_generation,
+                      "used an iterator after its grid was reallocated, resized, "
+                      "moved or assigned");
+    }
+
+    //default constructed iterators are only equal to each other
+    template <typename I>
+    void check_compatible(const array2d_checked_iterator<I>& o) const
+    {
+        ARRAY2D_CHECK(_m_owner == o._m_owner, "compared iterators of different grids");
+        if (_m_owner)
+        {
+            check_valid();
+            o.check_valid();
+            ARRAY2D_CHECK(_m_first == o._m_first,
+                          "compared iterators of different rows or columns");
+        }
+    }
+};
+
+template <typename Iter>
+struct array2d_checked
+{
+    typedef array2d_checked_iterator<Iter> type;
+};
+#else
+template <typename Iter>
+struct array2d_checked
+{
+    typedef Iter type;
+};
+#endif
+
+//Storage layouts. A layout maps (x, y) to an offset from the start of the
+//storage given the grid's pitch, which is whatever single number the layout
+//needs to do so, and provides the iterators used to walk rows and columns.
+//Strided layouts store runs of minor_extent contiguous elements pitch elements
+//apart, so they can also be described by an array2d_view.
+
+//elements of a row are contiguous and rows are pitch elements apart
+struct column_major;
+struct row_major
+{
+    typedef column_major transposed;
+
+    static constexpr bool strided = true;
+
+    template <typename T, typename Pointer, typename Reference>
+    struct iterators
+    {
+        typedef array2d_iterator<T, Pointer, Reference>         row_iterator;
+        typedef array2d_column_iterator<T, Pointer, Reference>  column_iterator;
+        typedef array2d_pitched_iterator<T, Pointer, Reference> iterator;
+    };
+
+    //iterators for a pitch fixed at compile time
+    template <typename T, typename Pointer, typename Reference, std::size_t Pitch>
+    struct static_iterators
+    {
+        typedef array2d_iterator<T, Pointer, Reference>                       row_iterator;
+        typedef static_array2d_column_iterator<T, Pointer, Reference, Pitch> column_iterator;
+    };
+
+    static constexpr std::size_t offset(std::size_t x, std::size_t y, std::size_t pitch)
+    { return y * pitch + x; }
+
+    static constexpr std::size_t minor_extent(std::size_t width, std::size_t)
+    { return width; }
+    static constexpr std::size_t major_extent(std::size_t, std::size_t height)
+    { return height; }
+
+    //the smallest pitch that is a multiple of multiple
+    static constexpr std::size_t pitch(std::size_t width, std::size_t, std::size_t multiple)
+    { return (width + multiple - 1) / multiple * multiple; }
+
+    static constexpr std::size_t storage_size(std::size_t, std::size_t height,
+                                              std::size_t pitch)
+    { return height * pitch; }
+
+    template <typename Iter, typename Pointer>
+    static constexpr Iter row_iterator(Pointer data, std::size_t pitch, std::size_t x,
+                                       std::size_t y)
+    { return make_strided_iterator<Iter>(data + offset(x, y, pitch), pitch); }
+
+    template <typename Iter, typename Pointer>
+    static constexpr Iter column_iterator(Pointer data, std::size_t pitch, std::size_t x,
+                                          std::size_t y)
+    { return make_strided_iterator<Iter>(data + offset(x, y, pitch), pitch); }
+
+    template <typename Iter, typename Pointer>
+    static Iter iterator(Pointer data, std::size_t pitch, std::size_t width,
+                         std::size_t, std::size_t x, std::size_t y)
+    {
+        Pointer row = data + y * pitch;
+        return Iter(row + x, row + width, width, pitch);
+    }
+
+    template <typename Iter, typename Pointer>
+    static Iter iterator_end(Pointer data, std::size_t pitch, std::size_t width,
+                             std::size_t height)
+    { return iterator<Iter>(data, pitch, width, height, 0, height); }
+
+    //each row is a tile
+    static constexpr std::size_t tile_width(std::size_t width, std::size_t, std::size_t)
+    { return width; }
+    static constexpr std::size_t tile_height(std::size_t, std::size_t, std::size_t)
+    { return 1; }
+
+    static constexpr std::size_t tile_offset(std::size_t x, std::size_t, std::size_t,
+                                             std::size_t)
+    { return x; }
+};
+
+//elements of a column are contiguous and columns are pitch elements apart
+struct column_major
+{
+    typedef row_major transposed;
+
+    static constexpr bool strided = true;
+
+    template <typename T, typename Pointer, typename Reference>
+    struct iterators
+    {
+        typedef array2d_column_iterator<T, Pointer, Reference>  row_iterator;
+        typedef array2d_iterator<T, Pointer, Reference>         column_iterator;
+        typedef array2d_pitched_iterator<T, Pointer, Reference> iterator;
+    };
+
+    template <typename T, typename Pointer, typename Reference, std::size_t Pitch>
+    struct static_iterators
+    {
+        typedef static_array2d_column_iterator<T, Pointer, Reference, Pitch> row_iterator;
+        typedef array2d_iterator<T, Pointer, Reference>                       column_iterator;
+    };
+
+    static constexpr std::size_t offset(std::size_t x, std::size_t y, std::size_t pitch)
+    { return x * pitch + y; }
+
+    static constexpr std::size_t minor_extent(std::size_t, std::size_t height)
+    { return height; }
+    static constexpr std::size_t major_extent(std::size_t width, std::size_t)
+    { return width; }
+
+    static constexpr std::size_t pitch(std::size_t, std::size_t height, std::size_t multiple)
+    { return (height + multiple - 1) / multiple * multiple; }
+
+    static constexpr std::size_t storage_size(std::size_t width, std::size_t,
+                                              std::size_t pitch)
+    { return width * pitch; }
+
+    template <typename Iter, typename Pointer>
+    static constexpr Iter row_iterator(Pointer data, std::size_t pitch, std::size_t x,
+                                       std::size_t y)
+    { return make_strided_iterator<Iter>(data + offset(x, y, pitch), pitch); }
+
+    template <typename Iter, typename Pointer>
+    static constexpr Iter column_iterator(Pointer data, std::size_t pitch, std::size_t x,
+                                          std::size_t y)
+    { return make_strided_iterator<Iter>(data + offset(x, y, pitch), pitch); }
+
+    template <typename Iter, typename Pointer>
+    static Iter iterator(Pointer data, std::size_t pitch, std::size_t,
+                         std::size_t height, std::size_t x, std::size_t y)
+    {
+        Pointer column = data + x * pitch;
+        return Iter(column + y, column + height, height, pitch);
+    }
+
+    template <typename Iter, typename Pointer>
+    static Iter iterator_end(Pointer data, std::size_t pitch, std::size_t width,
+                             std::size_t height)
+    { return iterator<Iter>(data, pitch, width, height, width, 0); }
+
+    //each column is a tile
+    static constexpr std::size_t tile_width(std::size_t, std::size_t, std::size_t)
+    { return 1; }
+    static constexpr std::size_t tile_height(std::size_t, std::size_t height, std::size_t)
+    { return height; }
+
+    static constexpr std::size_t tile_offset(std::size_t, std::size_t y, std::size_t,
+                                             std::size_t)
+    { return y; }
+};
+
+//common parts of layouts that are not strided, all of whose iterators are
+//array2d_layout_iterators
+template <typename Layout>
+struct array2d_coordinate_layout
+{
+    static constexpr bool strided = false;
+
+    template <typename T, typename Pointer, typename Reference>
+    struct iterators
+    {
+        typedef array2d_layout_iterator<T, Pointer, Reference, Layout, iterate_row>
+            row_iterator;
+        typedef array2d_layout_iterator<T, Pointer, Reference, Layout, iterate_column>
+            column_iterator;
+        typedef array2d_layout_iterator<T, Pointer, Reference, Layout, iterate_grid>
+            iterator;
+    };
+
+    template <typename T, typename Pointer, typename Reference, std::size_t>
+    struct static_iterators : iterators<T, Pointer, Reference> { };
+
+    template <typename Iter, typename Pointer>
+    static Iter row_iterator(Pointer data, std::size_t pitch, std::size_t x, std::size_t y)
+    { return Iter(data, pitch, 0, x, y); }
+
+    template <typename Iter, typename Pointer>
+    static Iter column_iterator(Pointer data, std::size_t pitch, std::size_t x, std::size_t y)
+    { return Iter(data, pitch, 0, x, y); }
+
+    template <typename Iter, typename Pointer>
+    static Iter iterator(Pointer data, std::size_t pitch, std::size_t width,
+                         std::size_t, std::size_t x, std::size_t y)
+    { return Iter(data, pitch, width, x, y); }
+
+    template <typename Iter, typename Pointer>
+    static Iter iterator_end(Pointer data, std::size_t pitch, std::size_t width,
+                             std::size_t height)
+    { return Iter(data, pitch, width, 0, width == 0 ? 0 : height); }
+};
+
+//the grid is split into TileWidth by TileHeight tiles stored one after another
+//in row order, each of which is stored row by row. The pitch is the number of
+//elements in a row of tiles. Tiles on the right and bottom edges are padded.
+template <std::size_t TileWidth, std::size_t TileHeight = TileWidth>
+struct tiled : array2d_coordinate_layout<tiled<TileWidth, TileHeight> >
+{
+    static_assert(TileWidth != 0 && (TileWidth & (TileWidth - 1)) == 0 &&
+                  TileHeight != 0 && (TileHeight & (TileHeight - 1)) == 0,
+                  "tile dimensions must be powers of two");
+
+    static constexpr std::size_t offset(std::size_t x, std::size_t y, std::size_t pitch)
+    {
+        return (y / TileHeight) * pitch + (x / TileWidth) * (TileWidth * TileHeight) +
+               (y % TileHeight) * TileWidth + (x % TileWidth);
+    }
+
+    static constexpr std::size_t pitch(std::size_t width, std::size_t, std::size_t)
+    { return (width + TileWidth - 1) / TileWidth * (TileWidth * TileHeight); }
+
+    static constexpr std::size_t storage_size(std::size_t, std::size_t height,
+                                              std::size_t pitch)
+    { return (height + TileHeight - 1) / TileHeight * pitch; }
+
+    static constexpr std::size_t tile_width(std::size_t, std::size_t, std::size_t)
+    { return TileWidth; }
+    static constexpr std::size_t tile_height(std::size_t, std::size_t, std::size_t)
+    { return TileHeight; }
+
+    static constexpr std::size_t tile_offset(std::size_t x, std::size_t y, std::size_t,
+                                             std::size_t)
+    { return y * TileWidth + x; }
+};
+
+
+constexpr std::uint64_t array2d_morton_step(std::uint64_t v, unsigned shift,
+                                            std::uint64_t mask)
+{ return (v | (v << shift)) & mask; }
+
+//spreads the low 32 bits of v out to the even bits of the result
+constexpr std::uint64_t array2d_morton_spread(std::uint64_t v)
+{
+    return array2d_morton_step(
+           array2d_morton_step(
+           array2d_morton_step(
+           array2d_morton_step(
+           array2d_morton_step(v & 0xFFFFFFFFull,
+                               16, 0x0000FFFF0000FFFFull),
+                               8,  0x00FF00FF00FF00FFull),
+                               4,  0x0F0F0F0F0F0F0F0Full),
+                               2,  0x3333333333333333ull),
+                               1,  0x5555555555555555ull);
+}
+
+constexpr std::size_t array2d_next_pow2(std::size_t v, std::size_t p = 1)
+{ return p >= v ? p : array2d_next_pow2(v, p * 2); }
+
+//Z-order. Both dimensions are rounded up to powers of two, giving one or more
+//square blocks whose side is the pitch, laid out one after another. Within a
+//block the bits of x and y are interleaved. Up to four times as many elements
+//as width * height may be stored.
+struct morton : array2d_coordinate_layout<morton>
+{
+    static constexpr std::size_t offset(std::size_t x, std::size_t y, std::size_t pitch)
+    {
+        return (x / pitch + y / pitch) * (pitch * pitch) +
+               static_cast<std::size_t>(
+                   array2d_morton_spread(x & (pitch - 1)) |
+                   (array2d_morton_spread(y & (pitch - 1)) << 1));
+    }
+
+    static constexpr std::size_t pitch(std::size_t width, std::size_t height, std::size_t)
+    {
+        return array2d_next_pow2(width) < array2d_next_pow2(height) ?
+               array2d_next_pow2(width) : array2d_next_pow2(height);
+    }
+
+    static constexpr std::size_t storage_size(std::size_t width, std::size_t height,
+                                              std::size_t)
+    {
+        return width == 0 || height == 0 ? 0 :
+               array2d_next_pow2(width) * array2d_next_pow2(height);
+    }
+
+    //each block is a tile
+    static constexpr std::size_t tile_width(std::size_t, std::size_t, std::size_t pitch)
+    { return pitch; }
+    static constexpr std::size_t tile_height(std::size_t, std::size_t, std::size_t pitch)
+    { return pitch; }
+
+    static constexpr std::size_t tile_offset(std::size_t x, std::size_t y, std::size_t,
+                                             std::size_t)
+    {
+        return static_cast<std::size_t>(array2d_morton_spread(x) |
+                                        (array2d_morton_spread(y) << 1));
+    }
+};
+
+
+//a block of elements that are contiguous in memory, as laid out by Layout
+template <typename T, typename Layout>
+class array2d_tile
+{
+  public:
+    typedef typename std::remove_const<T>::type value_type;
+    typedef T*                  pointer;
+    typedef T&                  reference;
+    typedef std::size_t         size_type;
+
+  private:
+    T* m_data;
+    size_type m_x;
+    size_type m_y;
+    size_type m_width;
+    size_type m_height;
+    size_type m_tile_width;
+    size_type m_tile_height;
+
+  public:
+    array2d_tile(T* data, size_type x, size_type y, size_type width, size_type height,
+                 size_type tile_width, size_type tile_height)
+        : m_data(data), m_x(x), m_y(y), m_width(width), m_height(height),
+          m_tile_width(tile_width), m_tile_height(tile_height)
+    { }
+
+    //position of the tile's top left element in the grid
+    size_type x() const { return m_x; }
+    size_type y() const { return m_y; }
+
+    //the part of the tile that lies inside the grid
+    size_type width() const { return m_width; }
+    size_type height() const { return m_height; }
+
+    size_type tile_width() const { return m_tile_width; }
+    size_type tile_height() const { return m_tile_height; }
+
+    //the contiguous block, which includes padding for tiles on the edge of the grid
+    pointer data() const { return m_data; }
+    size_type size() const { return m_tile_width * m_tile_height; }
+    pointer begin() const { return m_data; }
+    pointer end() const { return m_data + size(); }
+
+    //(x, y) relative to the top left of the tile
+    reference operator()(size_type x, size_type y) const
+    { return m_data[Layout::tile_offset(x, y, m_tile_width, m_tile_height)]; }
+};
+
+//iterates over the tiles of a grid in row order
+template <typename T, typename Layout>
+struct array2d_tile_iterator
+{
+    typedef std::ptrdiff_t                      difference_type;
+    typedef std::random_access_iterator_tag     iterator_category;
+    typedef array2d_tile<T, Layout>             value_type;
+    typedef void                                pointer;
+    typedef value_type                          reference;
+
+    T* _m_data;
+    std::size_t _m_pitch;
+    std::size_t _m_width;
+    std::size_t _m_height;
+    std::size_t _m_index;
+
+    array2d_tile_iterator()
+        : _m_data(nullptr), _m_pitch(0), _m_width(0), _m_height(0), _m_index(0) { }
+    array2d_tile_iterator(T* data, std::size_t pitch, std::size_t width,
+                          std::size_t height, std::size_t index)
+        : _m_data(data), _m_pitch(pitch), _m_width(width), _m_height(height),
+          _m_index(index) { }
+
+    //allow non-const to const conversion
+    template <typename U>
+    array2d_tile_iterator(const array2d_tile_iterator<U, Layout>& o,
+                          typename std::enable_if<
+                              std::is_convertible<U*, T*>::value
+                          >::type* = nullptr)
+        : _m_data(o._m_data), _m_pitch(o._m_pitch), _m_width(o._m_width),
+          _m_height(o._m_height), _m_index(o._m_index)
+    { }
+
+    std::size_t tiles_across() const
+    {
+        const std::size_t tw = Layout::tile_width(_m_width, _m_height, _m_pitch);
+        return tw == 0 ? 0 : (_m_width + tw - 1) / tw;
+    }
+
+    reference operator*() const { return (*this)[0]; }
+
+    reference operator[](difference_type n) const
+    {
+        const std::size_t tw = Layout::tile_width(_m_width, _m_height, _m_pitch);
+        const std::size_t th = Layout::tile_height(_m_width, _m_height, _m_pitch);
+        const std::size_t across = tiles_across();
+        const std::size_t i = _m_index + n;
+        const std::size_t x = (i % across) * tw;
+        const std::size_t y = (i / across) * th;
+        return value_type(_m_data + Layout::offset(x, y, _m_pitch), x, y,
+                          std::min(tw, _m_width - x), std::min(th, _m_height - y),
+                          tw, th);
+    }
+
+    array2d_tile_iterator& operator++() { ++_m_index; return *this; }
+    array2d_tile_iterator operator++(int)
+    {
+        array2d_tile_iterator tmp(*this);
+        ++_m_index;
+        return tmp;
+    }
+
+    array2d_tile_iterator& operator--() { --_m_index; return *this; }
+    array2d_tile_iterator operator--(int)
+    {
+        array2d_tile_iterator tmp(*this);
+        --_m_index;
+        return tmp;
+    }
+
+    array2d_tile_iterator& operator+=(difference_type n) { _m_index += n; return *this; }
+    array2d_tile_iterator& operator-=(difference_type n) { _m_index -= n; return *this; }
+
+    array2d_tile_iterator operator+(difference_type n) const
+    { return array2d_tile_iterator(_m_data, _m_pitch, _m_width, _m_height, _m_index + n); }
+
+    array2d_tile_iterator operator-(difference_type n) const
+    { return array2d_tile_iterator(_m_data, _m_pitch, _m_width, _m_height, _m_index - n); }
+
+    template <typename U>
+    difference_type operator-(const array2d_tile_iterator<U, Layout>& o) const
+    { return static_cast<difference_type>(_m_index - o._m_index); }
+
+    template <typename U>
+    bool operator==(const array2d_tile_iterator<U, Layout>& o) const
+    { return _m_index == o._m_index; }
+    template <typename U>
+    bool operator!=(const array2d_tile_iterator<U, Layout>& o) const
+    { return _m_index != o._m_index; }
+
+    template <typename U>
+    bool operator<(const array2d_tile_iterator<U, Layout>& o) const
+    { return _m_index < o._m_index; }
+    template <typename U>
+    bool operator>(const array2d_tile_iterator<U, Layout>& o) const
+    { return _m_index > o._m_index; }
+
+    template <typename U>
+    bool operator<=(const array2d_tile_iterator<U, Layout>& o) const
+    { return _m_index <= o._m_index; }
+    template <typename U>
+    bool operator>=(const array2d_tile_iterator<U, Layout>& o) const
+    { return _m_index >= o._m_index; }
+};
+
+//number of tiles in a grid
+template <typename Layout>
+inline std::size_t array2d_tile_count(std::size_t width, std::size_t height,
+                                      std::size_t pitch)
+{
+    const std::size_t tw = Layout::tile_width(width, height, pitch);
+    const std::size_t th = Layout::tile_height(width, height, pitch);
+    if (tw == 0 || th == 0)
+        return 0;
+    return ((width + tw - 1) / tw) * ((height + th - 1) / th);
+}
+
+
+template <typename Iter,
+          bool Trivial = std::is_trivially_destructible<typename Iter::value_type>::value
+          >
+struct emplacer
+{
+    typedef typename Iter::value_type value_type;
+
+    template <typename... Args>
+    static inline Iter emplace(Iter pos, Args&&... args)
+    {
+        new (std::addressof(*pos)) value_type(std::forward<Args>(args)...);
+        return pos;
+    }
+};
+
+template <typename Iter>
+struct emplacer<Iter, false>
+{
+    typedef typename Iter::value_type value_type;
+
+    template <typename... Args>
+    static inline Iter emplace(Iter pos, Args&&... args)
+    {
+        value_type* p = std::addressof(*pos);
+        p->~value_type();
+        new (p) value_type(std::forward<Args>(args)...);
+        return pos;
+    }
+};
+
+
+//construction policy tags
+struct uninitialized_t { };
+struct value_initialized_t { };
+
+//leave the elements of a trivial type uninitialized
+constexpr uninitialized_t uninitialized{};
+
+//value-initialize every element, i.e. zero for arithmetic types
+constexpr value_initialized_t value_initialized{};
+
+
+constexpr std::size_t array2d_gcd(std::size_t a, std::size_t b)
+{
+    return b == 0 ? a : array2d_gcd(b, a % b);
+}
+
+//a list of indices, with array2d_make_indices<N>::type being 0 to N - 1
+template <std::size_t... I>
+struct array2d_indices
+{
+    typedef array2d_indices type;
+};
+
+template <typename A, typename B>
+struct array2d_join_indices;
+
+template <std::size_t... A, std::size_t... B>
+struct array2d_join_indices<array2d_indices<A...>, array2d_indices<B...> >
+    : array2d_indices<A..., (sizeof...(A) + B)...>
+{ };
+
+//built by halves so that the depth of instantiation is log N
+template <std::size_t N>
+struct array2d_make_indices
+    : array2d_join_indices<typename array2d_make_indices<N / 2>::type,
+                           typename array2d_make_indices<N - N / 2>::type>
+{ };
+
+template <> struct array2d_make_indices<0> : array2d_indices<> { };
+template <> struct array2d_make_indices<1> : array2d_indices<0> { };
+
+//an elementwise expression over grids, see array2d_expr.hpp
+template <typename E>
+struct array2d_expression;
+
+
+template <typename T,
+          typename Allocator = std::allocator<T>,
+          std::size_t RowAlign = alignof(T),
+          typename Layout = row_major>
+class array2d
+{
+    static_assert(RowAlign != 0 && (RowAlign & (RowAlign - 1)) == 0,
+                  "array2d row alignment must be a power of two");
+    static_assert(RowAlign >= alignof(T),
+                  "array2d row alignment must be at least alignof(T)");
+
+    //the pitch of every row is rounded up to a multiple of this many elements,
+    //which is the fewest elements that span a whole number of RowAlign blocks
+    static constexpr std::size_t pitch_multiple =
+        RowAlign / array2d_gcd(RowAlign, sizeof(T));
+
+    //whether rows (or columns) may be padded, in which case iterating over the
+    //entire grid must skip the padding at the end of each one
+    static constexpr bool padded = pitch_multiple > 1;
+
+    //whether the entire grid can be walked with a pointer
+    static constexpr bool contiguous = Layout::strided && !padded;
+
+    typedef typename Layout::template iterators<T, T*, T&>             layout_iterators;
+    typedef typename Layout::template iterators<T, const T*, const T&> const_layout_iterators;
+
+  public:
+    typedef T                   value_type;
+    typedef Allocator           allocator_type;
+    typedef T*                  pointer;
+    typedef const T*            const_pointer;
+    typedef T&                  reference;
+    typedef const T&            const_reference;
+    typedef std::size_t         size_type;
+    typedef std::ptrdiff_t      difference_type;
+
+    typedef Layout              layout_type;
+
+    //the iterators without ARRAY2D_CHECKED's checks, which are the same types
+    //as the ones below when it is off
+    typedef typename std::conditional<
+        contiguous,
+        array2d_iterator<T, T*, T&>,
+        typename layout_iterators::iterator
+    >::type unchecked_iterator;
+    typedef typename std::conditional<
+        contiguous,
+        array2d_iterator<T, const T*, const T&>,
+        typename const_layout_iterators::iterator
+    >::type unchecked_const_iterator;
+    typedef typename layout_iterators::column_iterator       unchecked_column_iterator;
+    typedef typename const_layout_iterators::column_iterator unchecked_const_column_iterator;
+    typedef typename layout_iterators::row_iterator          unchecked_row_iterator;
+    typedef typename const_layout_iterators::row_iterator    unchecked_const_row_iterator;
+
+    typedef typename array2d_checked<unchecked_iterator>::type       iterator;
+    typedef typename array2d_checked<unchecked_const_iterator>::type const_iterator;
+
+    //iterates down a column
+    typedef typename array2d_checked<unchecked_column_iterator>::type column_iterator;
+    typedef typename array2d_checked<unchecked_const_column_iterator>::type
+        const_column_iterator;
+
+    //iterates across a row
+    typedef typename array2d_checked<unchecked_row_iterator>::type row_iterator;
+    typedef typename array2d_checked<unchecked_const_row_iterator>::type
+        const_row_iterator;
+
+    //iterates over the blocks of contiguous elements
+    typedef array2d_tile_iterator<T, Layout>       tile_iterator;
+    typedef array2d_tile_iterator<const T, Layout> const_tile_iterator;
+
+    static constexpr size_type row_alignment = RowAlign;
+
+  private:
+    typedef std::allocator_traits<Allocator> alloc_traits;
+    typedef typename alloc_traits::template rebind_alloc<unsigned char> byte_allocator;
+    typedef std::allocator_traits<byte_allocator> byte_alloc_traits;
+
+    static constexpr size_type storage_align =
+        RowAlign > alignof(T) ? RowAlign : alignof(T);
+
+    size_type m_width;
+    size_type m_height;
+    size_type m_pitch;
+    T* m_data;
+    unsigned char* m_storage;
+    size_type m_storage_size;
+    Allocator m_alloc;
+#if ARRAY2D_CHECKED
+    //bumped whenever iterators are invalidated
+    std::size_t m_generation = 0;
+#endif
+
+  public:
+    array2d() = delete;
+
+    array2d(size_type width,
+            size_type height,
+            const Allocator& alloc = Allocator())
+        : m_width(width), 
+          m_height(height),
+          m_pitch(pitch_for(width, height)),
+          m_data(nullptr),
+          m_storage(nullptr),
+          m_storage_size(0),
+          m_alloc(alloc)
+    {
+        allocate();
+        construct_default();
+    }
+
+    array2d(size_type width,
+            size_type height,
+            uninitialized_t,
+            const Allocator& alloc = Allocator())
+        : m_width(width),
+          m_height(height),
+          m_pitch(pitch_for(width, height)),
+          m_data(nullptr),
+          m_storage(nullptr),
+          m_storage_size(0),
+          m_alloc(alloc)
+    {
+        static_assert(std::is_trivial<T>::value,
+                      "only trivial types can be left uninitialized");
+        allocate();
+    }
+
+    array2d(size_type width,
+            size_type height,
+            value_initialized_t,
+            const Allocator& alloc = Allocator())
+        : array2d(width, height, T(), alloc)
+    { }
+
+    //every element is a copy of value
+    array2d(size_type width,
+            size_type height,
+            const T& value,
+            const Allocator& alloc = Allocator())
+        : m_width(width),
+          m_height(height),
+          m_pitch(pitch_for(width, height)),
+          m_data(nullptr),
+          m_storage(nullptr),
+          m_storage_size(0),
+          m_alloc(alloc)
+    {
+        allocate();
+        construct_fill(value);
+    }
+
+    //element (x, y) is constructed from gen(x, y)
+    template <typename Generator,
+              typename = typename std::enable_if<
+                  !std::is_convertible<Generator, T>::value &&
+                  !std::is_convertible<Generator, Allocator>::value &&
+                  std::is_convertible<
+                      decltype(std::declval<Generator&>()(std::size_t(), std::size_t())),
+                      T
+                  >::value
+              >::type>
+    array2d(size_type width,
+            size_type height,
+            Generator gen,
+            const Allocator& alloc = Allocator())
+        : m_width(width),
+          m_height(height),
+          m_pitch(pitch_for(width, height)),
+          m_data(nullptr),
+          m_storage(nullptr),
+          m_storage_size(0),
+          m_alloc(alloc)
+    {
+        allocate();
+        construct_generate(gen);
+    }
+
+    //evaluates an elementwise expression, see array2d_expr.hpp
+    template <typename E>
+    array2d(const array2d_expression<E>& e, const Allocator& alloc = Allocator())
+        : array2d(e.self().width(), e.self().height(), alloc)
+    {
+        evaluate(*this, e);
+    }
+
+    ~array2d()
+    {
+        invalidate();
+        destroy();
+        deallocate();
+    }
+
+    array2d(array2d&& o) noexcept
+        : m_width(o.m_width), 
+          m_height(o.m_height),
+          m_pitch(o.m_pitch),
+          m_data(o.m_data),
+          m_storage(o.m_storage),
+          m_storage_size(o.m_storage_size),
+          m_alloc(std::move(o.m_alloc))
+    {
+        o.m_data = nullptr;
+        o.m_storage = nullptr;
+        o.m_storage_size = 0;
+        o.m_width = 0;
+        o.m_height = 0;
+        o.m_pitch = 0;
+        o.invalidate();
+    }
+
+    array2d(const array2d& o)
+        : m_width(o.m_width),
+          m_height(o.m_height),
+          m_pitch(o.m_pitch),
+          m_data(nullptr),
+          m_storage(nullptr),
+          m_storage_size(0),
+          m_alloc(alloc_traits::select_on_container_copy_construction(o.m_alloc))
+    {
+        allocate();
+        construct_copy(o.m_data);
+    }
+    
+    //Reuses the allocation when it is large enough, unless the allocator
+    //propagates on copy assignment and differs from o's. Elements are copied
+    //with memcpy when T is trivially copyable.
+    array2d& operator=(const array2d& o)
+    {
+        if (this == &o)
+            return *this;
+
+        if (alloc_traits::propagate_on_container_copy_assignment::value &&
+            !(m_alloc == o.m_alloc))
+        {
+            array2d tmp(o);
+            swap_storage(tmp);
+        }
+        else
+        {
+            copy_from(o);
+        }
+        return *this;
+    }
+
+    //the old allocation is released here, o is left empty
+    array2d& operator=(array2d&& o) noexcept
+    {
+        if (this != &o)
+        {
+            array2d tmp(std::move(o));
+            swap_storage(tmp);
+        }
+        return *this;
+    }
+
+    //Elements are computed in place when the dimensions match. An axis an
+    //expression is broadcast along, which it reports as 0, takes the grid's
+    //size. evaluate() goes through a temporary when an operand shares this
+    //grid's storage other than at the same positions, such as a transposed
+    //view of it.
+    template <typename E>
+    array2d& operator=(const array2d_expression<E>& e)
+    {
+        const size_type width = e.self().width() != 0 ? e.self().width() : m_width;
+        const size_type height = e.self().height() != 0 ? e.self().height() : m_height;
+        if (width == m_width && height == m_height)
+        {
+            evaluate(*this, e);
+        }
+        else
+        {
+            array2d tmp(width, height, m_alloc);
+            evaluate(tmp, e);
+            swap_storage(tmp);
+        }
+        return *this;
+    }
+
+    size_type width() const { return m_width; }
+    size_type height() const { return m_height; }
+
+    //for row_major, the distance in elements between the start of consecutive
+    //rows. Other layouts define their own pitch.
+    size_type pitch() const { return m_pitch; }
+
+    //number of elements the current allocation can hold, including row padding
+    size_type capacity() const
+    {
+        if (!m_storage)
+            return 0;
+        return (m_storage + m_storage_size -
+                reinterpret_cast<unsigned char*>(m_data)) / sizeof(T);
+    }
+
+    //Changes the dimensions of the grid. Elements in the region covered by both
+    //the old and new dimensions keep their values, any others are default
+    //initialized. The existing allocation is reused when it is large enough.
+    void resize(size_type width, size_type height)
+    {
+        if (width == m_width && height == m_height)
+            return;
+
+        if (!relayout(width, height, std::integral_constant<bool, Layout::strided>()))
+        {
+            array2d tmp(width, height, m_alloc);
+            const size_type w = std::min(width, m_width);
+            const size_type h = std::min(height, m_height);
+            for (size_type y = 0; y < h; ++y)
+                std::move(row_begin(y), row_begin(y) + w, tmp.row_begin(y));
+            swap_storage(tmp);
+        }
+    }
+
+    //Reinterprets the grid with new dimensions, keeping the elements in
+    //iterator order. Throws std::invalid_argument unless width * height equals
+    //this->width() * this->height(). This never moves an element unless the
+    //grid can't be walked by a pointer.
+    void reshape(size_type width, size_type height)
+    {
+        if (width * height != m_width * m_height)
+            throw std::invalid_argument("reshape doesn't keep the element count");
+
+        if (contiguous)
+        {
+            m_width = width;
+            m_height = height;
+            m_pitch = pitch_for(width, height);
+            invalidate();
+            return;
+        }
+
+        array2d tmp(width, height, m_alloc);
+        std::move(begin(), end(), tmp.begin());
+        swap_storage(tmp);
+    }
+
+    //Makes room for a width by height grid, so that resizing up to it or
+    //growing row by row or column by column doesn't reallocate. Only strided
+    //layouts are resized in place, for others this does nothing.
+    void reserve(size_type width, size_type height)
+    {
+        if (!Layout::strided)
+            return;
+
+        const size_type count = Layout::storage_size(width, height,
+                                                     pitch_for(width, height));
+        if (count > capacity())
+            reallocate(count);
+    }
+
+    //Appends a row, copied from the width elements starting at first, or
+    //filled with value. The capacity grows geometrically, so a row_major grid
+    //appends in amortized O(width).
+    template <typename InputIt,
+              typename = typename std::enable_if<
+                  !std::is_convertible<InputIt, T>::value
+              >::type>
+    void push_row(InputIt first)
+    { insert_row(m_height, first); }
+
+    void push_row(const T& value = T())
+    { insert_row(m_height, value); }
+
+    //removes the last row, which must exist
+    void pop_row() { resize(m_width, m_height - 1); }
+
+    //Inserts a row before row y, copied from the width elements starting at
+    //first or filled with value. Rows from y on move down by one.
+    template <typename InputIt,
+              typename = typename std::enable_if<
+                  !std::is_convertible<InputIt, T>::value
+              >::type>
+    void insert_row(size_type y, InputIt first)
+    {
+        open_row(y);
+        std::copy_n(first, m_width, row_begin(y));
+    }
+
+    void insert_row(size_type y, const T& value)
+    {
+        open_row(y);
+        std::fill(row_begin(y), row_end(y), value);
+    }
+
+    //Inserts a column before column x, copied from the height elements
+    //starting at first or filled with value. Columns from x on move right by
+    //one.
+    template <typename InputIt,
+              typename = typename std::enable_if<
+                  !std::is_convertible<InputIt, T>::value
+              >::type>
+    void insert_column(size_type x, InputIt first)
+    {
+        open_column(x);
+        std::copy_n(first, m_height, column_begin(x));
+    }
+
+    void insert_column(size_type x, const T& value)
+    {
+        open_column(x);
+        std::fill(column_begin(x), column_end(x), value);
+    }
+
+    //removes row y, the rows after it move up by one
+    void erase_row(size_type y)
+    {
+        shift_rows(y + 1, m_height, y, std::is_same<Layout, column_major>());
+        resize(m_width, m_height - 1);
+    }
+
+    //removes column x, the columns after it move left by one
+    void erase_column(size_type x)
+    {
+        shift_columns(x + 1, m_width, x, std::is_same<Layout, column_major>());
+        resize(m_width - 1, m_height);
+    }
+
+    //Replaces the grid with width by height copies of value, reusing the
+    //allocation when it is large enough.
+    void assign(size_type width, size_type height, const T& value)
+    {
+        discard_resize(width, height);
+        std::fill(m_data, m_data + storage_count(), value);
+    }
+
+    //Makes the grid a copy of src, which may be any grid, reusing the
+    //allocation when it is large enough. An array2d of the same element type
+    //and layout is copied with memcpy when T is trivially copyable, a run at
+    //a time if the pitches differ. src must not overlap the grid unless it is
+    //the grid itself.
+    template <typename Grid>
+    void copy_from(const Grid& src)
+    {
+        if (static_cast<const void*>(&src) == static_cast<const void*>(this))
+            return;
+
+        discard_resize(array2d_width(src), array2d_height(src));
+        copy_elements(src);
+    }
+
+    //exchanges the elements, dimensions and allocators, without copying
+    void swap(array2d& o) noexcept { swap_storage(o); }
+
+    pointer data() { return m_data; }
+    const_pointer data() const { return m_data; }
+
+    allocator_type get_allocator() const { return m_alloc; }
+
+    iterator begin() { return grid_iterator<unchecked_iterator>(m_data, 0, 0); }
+    const_iterator begin() const
+    { return grid_iterator<unchecked_const_iterator>(m_data, 0, 0); }
+
+    iterator end() { return grid_end<unchecked_iterator>(m_data); }
+    const_iterator end() const { return grid_end<unchecked_const_iterator>(m_data); }
+
+    row_iterator row_begin(size_type y)
+    { return row_iterator_at<unchecked_row_iterator>(m_data, 0, y); }
+    const_row_iterator row_begin(size_type y) const
+    { return row_iterator_at<unchecked_const_row_iterator>(m_data, 0, y); }
+
+    row_iterator row_end(size_type y)
+    { return row_iterator_at<unchecked_row_iterator>(m_data, m_width, y); }
+    const_row_iterator row_end(size_type y) const
+    { return row_iterator_at<unchecked_const_row_iterator>(m_data, m_width, y); }
+    
+    column_iterator column_begin(size_type x)
+    { return column_iterator_at<unchecked_column_iterator>(m_data, x, 0); }
+    const_column_iterator column_begin(size_type x) const
+    { return column_iterator_at<unchecked_const_column_iterator>(m_data, x, 0); }
+
+    column_iterator column_end(size_type x)
+    { return column_iterator_at<unchecked_column_iterator>(m_data, x, m_height); }
+    const_column_iterator column_end(size_type x) const
+    { return column_iterator_at<unchecked_const_column_iterator>(m_data, x, m_height); }
+
+    tile_iterator tile_begin()
+    { return tile_iterator(m_data, m_pitch, m_width, m_height, 0); }
+    const_tile_iterator tile_begin() const
+    { return const_tile_iterator(m_data, m_pitch, m_width, m_height, 0); }
+
+    tile_iterator tile_end()
+    { return tile_iterator(m_data, m_pitch, m_width, m_height, tile_count()); }
+    const_tile_iterator tile_end() const
+    { return const_tile_iterator(m_data, m_pitch, m_width, m_height, tile_count()); }
+
+    size_type tile_count() const
+    { return array2d_tile_count<Layout>(m_width, m_height, m_pitch); }
+    
+    reference index(size_type x, size_type y)
+    { return m_data[checked_offset(x, y)]; }
+    const_reference index(size_type x, size_type y) const 
+    { return m_data[checked_offset(x, y)]; }
+
+    reference operator()(size_type x, size_type y)
+    { return m_data[checked_offset(x, y)]; }
+    const_reference operator()(size_type x, size_type y) const 
+    { return m_data[checked_offset(x, y)]; }
+
+    //throws std::out_of_range if (x, y) is outside the grid
+    reference at(size_type x, size_type y)
+    { return m_data[bounded_offset(x, y)]; }
+    const_reference at(size_type x, size_type y) const
+    { return m_data[bounded_offset(x, y)]; }
+
+    template <typename... Args>
+    iterator emplace(size_type x, size_type y, Args&&... args)
+    {
+        typedef emplacer<iterator> emplacer;
+        return emplacer::emplace(grid_iterator<unchecked_iterator>(m_data, x, y),
+                                 std::forward<Args>(args)...);
+    }
+
+    //pos may be an iterator, row_iterator or column_iterator
+    template <typename Iter, typename... Args>
+    typename std::enable_if<
+        std::is_same<Iter, iterator>::value ||
+        std::is_same<Iter, row_iterator>::value ||
+        std::is_same<Iter, column_iterator>::value,
+        Iter
+    >::type emplace(Iter pos, Args&&... args)
+    {
+        typedef emplacer<Iter> emplacer;
+        return emplacer::emplace(pos, std::forward<Args>(args)...);
+    }
+
+  private:
+    static size_type pitch_for(size_type width, size_type height)
+    { return Layout::pitch(width, height, pitch_multiple); }
+
+    template <typename Iter, typename Ptr>
+    Iter make_iterator(Ptr data, size_type x, size_type y, std::true_type) const
+    { return Iter(data + Layout::offset(x, y, m_pitch)); }
+
+    template <typename Iter, typename Ptr>
+    Iter make_iterator(Ptr data, size_type x, size_type y, std::false_type) const
+    { return Layout::template iterator<Iter>(data, m_pitch, m_width, m_height, x, y); }
+
+    template <typename Iter, typename Ptr>
+    Iter make_iterator(Ptr data, size_type x, size_type y) const
+    {
+        return make_iterator<Iter>(data, x, y,
+                                   std::integral_constant<bool, contiguous>());
+    }
+
+    template <typename Iter, typename Ptr>
+    Iter make_end(Ptr data, std::true_type) const
+    { return Iter(data + storage_count()); }
+
+    template <typename Iter, typename Ptr>
+    Iter make_end(Ptr data, std::false_type) const
+    { return Layout::template iterator_end<Iter>(data, m_pitch, m_width, m_height); }
+
+    template <typename Iter, typename Ptr>
+    Iter make_end(Ptr data) const
+    { return make_end<Iter>(data, std::integral_constant<bool, contiguous>()); }
+
+    //Wraps an iterator that may move over [first, last) in its checked form.
+    //Without ARRAY2D_CHECKED it is returned as is, and the bounds, which are
+    //never used, are optimized away.
+#if ARRAY2D_CHECKED
+    template <typename Iter>
+    array2d_checked_iterator<Iter> checked(Iter it, Iter first, Iter last) const
+    { return array2d_checked_iterator<Iter>(it, first, last, &m_generation); }
+#else
+    template <typename Iter>
+    static Iter checked(Iter it, Iter, Iter) { return it; }
+#endif
+
+    void invalidate()
+    {
+#if ARRAY2D_CHECKED
+        ++m_generation;
+#endif
+    }
+
+    template <typename Iter, typename Ptr>
+    typename array2d_checked<Iter>::type
+    grid_iterator(Ptr data, size_type x, size_type y) const
+    {
+        return checked(make_iterator<Iter>(data, x, y), make_iterator<Iter>(data, 0, 0),
+                       make_end<Iter>(data));
+    }
+
+    template <typename Iter, typename Ptr>
+    typename array2d_checked<Iter>::type grid_end(Ptr data) const
+    {
+        const Iter end = make_end<Iter>(data);
+        return checked(end, make_iterator<Iter>(data, 0, 0), end);
+    }
+
+    template <typename Iter, typename Ptr>
+    typename array2d_checked<Iter>::type
+    row_iterator_at(Ptr data, size_type x, size_type y) const
+    {
+        ARRAY2D_CHECK(y < m_height, "row out of range");
+        return checked(Layout::template row_iterator<Iter>(data, m_pitch, x, y),
+                       Layout::template row_iterator<Iter>(data, m_pitch, 0, y),
+                       Layout::template row_iterator<Iter>(data, m_pitch, m_width, y));
+    }
+
+    template <typename Iter, typename Ptr>
+    typename array2d_checked<Iter>::type
+    column_iterator_at(Ptr data, size_type x, size_type y) const
+    {
+        ARRAY2D_CHECK(x < m_width, "column out of range");
+        return checked(Layout::template column_iterator<Iter>(data, m_pitch, x, y),
+                       Layout::template column_iterator<Iter>(data, m_pitch, x, 0),
+                       Layout::template column_iterator<Iter>(data, m_pitch, x, m_height));
+    }
+
+    size_type checked_offset(size_type x, size_type y) const
+    {
+        ARRAY2D_CHECK(x < m_width && y < m_height, "coordinates out of range");
+        return Layout::offset(x, y, m_pitch);
+    }
+
+    size_type bounded_offset(size_type x, size_type y) const
+    {
+        if (x >= m_width || y >= m_height)
+            throw std::out_of_range("array2d::at");
+        return Layout::offset(x, y, m_pitch);
+    }
+
+    //Gives the grid new dimensions without keeping any element, reusing the
+    //allocation when it is large enough. If constructing the new elements
+    //throws, the grid is left empty.
+    void discard_resize(size_type width, size_type height)
+    {
+        if (width == m_width && height == m_height)
+            return;
+
+        const size_type pitch = pitch_for(width, height);
+        const size_type count = Layout::storage_size(width, height, pitch);
+        if (count > capacity())
+        {
+            array2d tmp(width, height, m_alloc);
+            swap_storage(tmp);
+            return;
+        }
+
+        destroy();
+        m_width = 0;
+        m_height = 0;
+        m_pitch = pitch_for(0, 0);
+        invalidate();
+        construct_default(0, count);
+        m_width = width;
+        m_height = height;
+        m_pitch = pitch;
+    }
+
+    template <typename Grid>
+    void copy_elements(const Grid& src)
+    {
+        for (size_type y = 0; y < m_height; ++y)
+            std::copy(src.row_begin(y), src.row_end(y), row_begin(y));
+    }
+
+    template <typename A, std::size_t R>
+    void copy_elements(const array2d<T, A, R, Layout>& src)
+    {
+        copy_elements(src, std::integral_constant<bool, std::is_trivially_copyable<T>::value>());
+    }
+
+    template <typename A, std::size_t R>
+    void copy_elements(const array2d<T, A, R, Layout>& src, std::false_type)
+    {
+        for (size_type y = 0; y < m_height; ++y)
+            std::copy(src.row_begin(y), src.row_end(y), row_begin(y));
+    }
+
+    //padding is copied too when the pitches match, since it is live
+    //elements either way and one memcpy beats one per run
+    template <typename A, std::size_t R>
+    void copy_elements(const array2d<T, A, R, Layout>& src, std::true_type)
+    {
+        if (storage_count() == 0)
+            return;
+
+        if (src.pitch() == m_pitch)
+            std::memcpy(m_data, src.data(), storage_count() * sizeof(T));
+        else
+            copy_runs(src, std::integral_constant<bool, Layout::strided>());
+    }
+
+    //copies the runs of a strided layout one memcpy each
+    template <typename A, std::size_t R>
+    void copy_runs(const array2d<T, A, R, Layout>& src, std::true_type)
+    {
+        const size_type run = Layout::minor_extent(m_width, m_height);
+        const size_type runs = Layout::major_extent(m_width, m_height);
+        for (size_type r = 0; r < runs; ++r)
+            std::memcpy(m_data + r * m_pitch, src.data() + r * src.pitch(), run * sizeof(T));
+    }
+
+    template <typename A, std::size_t R>
+    void copy_runs(const array2d<T, A, R, Layout>& src, std::false_type)
+    { copy_elements(src, std::false_type()); }
+
+    //padding elements are constructed along with the rest of the grid, so the
+    //storage is always entirely live objects
+    size_type storage_count() const
+    { return Layout::storage_size(m_width, m_height, m_pitch); }
+
+    void allocate()
+    {
+        const size_type count = storage_count();
+        if (count == 0)
+            return;
+
+        m_data = allocate(count, m_storage, m_storage_size);
+    }
+
+    //returns room for count elements, aligned to storage_align, within a new
+    //block of storage_size bytes
+    T* allocate(size_type count, unsigned char*& storage, size_type& storage_size)
+    {
+        byte_allocator bytes(m_alloc);
+        storage_size = count * sizeof(T) + storage_align - 1;
+        storage = byte_alloc_traits::allocate(bytes, storage_size);
+
+        void* p = storage;
+        std::size_t space = storage_size;
+        return static_cast<T*>(std::align(storage_align, count * sizeof(T), p, space));
+    }
+
+    //Moves the elements into a new allocation with room for count of them.
+    //They are copied instead if moving could throw, so that on failure the
+    //grid is unchanged.
+    void reallocate(size_type count)
+    {
+        typedef typename std::conditional<
+            std::is_nothrow_move_constructible<T>::value ||
+            !std::is_copy_constructible<T>::value,
+            std::move_iterator<T*>,
+            T*
+        >::type source;
+
+        unsigned char* storage;
+        size_type storage_size;
+        T* data = allocate(count, storage, storage_size);
+        try
+        {
+            std::uninitialized_copy(source(m_data), source(m_data + storage_count()),
+                                    data);
+        }
+        catch (...)
+        {
+            byte_allocator bytes(m_alloc);
+            byte_alloc_traits::deallocate(bytes, storage, storage_size);
+            throw;
+        }
+
+        destroy();
+        deallocate();
+        m_data = data;
+        m_storage = storage;
+        m_storage_size = storage_size;
+        invalidate();
+    }
+
+    //Makes sure a width by height grid fits in the allocation, at least
+    //doubling it if not, so that growing one row or column at a time takes
+    //amortized constant reallocations.
+    void grow(size_type width, size_type height)
+    {
+        if (!Layout::strided)
+            return;
+
+        const size_type count = Layout::storage_size(width, height,
+                                                     pitch_for(width, height));
+        if (count > capacity())
+            reallocate(std::max(count, 2 * capacity()));
+    }
+
+    //adds a row at y, holding whatever was moved out of the way
+    void open_row(size_type y)
+    {
+        grow(m_width, m_height + 1);
+        resize(m_width, m_height + 1);
+        shift_rows(y, m_height - 1, y + 1, std::is_same<Layout, column_major>());
+    }
+
+    //adds a column at x, holding whatever was moved out of the way
+    void open_column(size_type x)
+    {
+        grow(m_width + 1, m_height);
+        resize(m_width + 1, m_height);
+        shift_columns(x, m_width - 1, x + 1, std::is_same<Layout, column_major>());
+    }
+
+    //Moves rows [first, last) to start at row to. The elements of a row are
+    //contiguous in most layouts, so whole rows are moved, but column_major
+    //moves a piece of each column instead.
+    void shift_rows(size_type first, size_type last, size_type to, std::false_type)
+    {
+        if (to < first)
+        {
+            for (size_type y = first; y < last; ++y, ++to)
+                std::move(row_begin(y), row_end(y), row_begin(to));
+        }
+        else
+        {
+            for (size_type y = last, d = to + (last - first); y-- > first;)
+                std::move(row_begin(y), row_end(y), row_begin(--d));
+        }
+    }
+
+    void shift_rows(size_type first, size_type last, size_type to, std::true_type)
+    {
+        for (size_type x = 0; x < m_width; ++x)
+            shift_line(column_begin(x), first, last, to);
+    }
+
+    //moves columns [first, last) to start at column to
+    void shift_columns(size_type first, size_type last, size_type to, std::false_type)
+    {
+        for (size_type y = 0; y < m_height; ++y)
+            shift_line(row_begin(y), first, last, to);
+    }
+
+    void shift_columns(size_type first, size_type last, size_type to, std::true_type)
+    {
+        if (to < first)
+        {
+            for (size_type x = first; x < last; ++x, ++to)
+                std::move(column_begin(x), column_end(x), column_begin(to));
+        }
+        else
+        {
+            for (size_type x = last, d = to + (last - first); x-- > first;)
+                std::move(column_begin(x), column_end(x), column_begin(--d));
+        }
+    }
+
+    //moves the elements [first, last) of a line to start at to
+    template <typename Iter>
+    static void shift_line(Iter line, size_type first, size_type last, size_type to)
+    {
+        if (to < first)
+            std::move(line + first, line + last, line + to);
+        else
+            std::move_backward(line + first, line + last, line + to + (last - first));
+    }
+
+    void deallocate()
+    {
+        if (m_storage)
+        {
+            byte_allocator bytes(m_alloc);
+            byte_alloc_traits::deallocate(bytes, m_storage, m_storage_size);
+        }
+        m_storage = nullptr;
+        m_storage_size = 0;
+        m_data = nullptr;
+    }
+
+    void construct_default()
+    {
+        try
+        {
+            construct_default(0, storage_count());
+        }
+        catch (...)
+        {
+            deallocate();
+            throw;
+        }
+    }
+
+    //on failure the elements constructed so far are destroyed again
+    void construct_default(size_type first, size_type last)
+    {
+        if (std::is_trivially_default_constructible<T>::value)
+            return;
+
+        size_type i = first;
+        try
+        {
+            for (; i < last; ++i)
+                ::new (static_cast<void*>(m_data + i)) T;
+        }
+        catch (...)
+        {
+            destroy(first, i);
+            throw;
+        }
+    }
+
+    void construct_fill(const T& value)
+    {
+        try
+        {
+            std::uninitialized_fill_n(m_data, storage_count(), value);
+        }
+        catch (...)
+        {
+            deallocate();
+            throw;
+        }
+    }
+
+    template <typename Generator>
+    void construct_generate(Generator& gen)
+    {
+        construct_generate(gen, std::is_same<Layout, row_major>());
+    }
+
+    //layouts other than row_major are default constructed first and then
+    //assigned to, since which elements are padding depends on the layout
+    template <typename Generator>
+    void construct_generate(Generator& gen, std::false_type)
+    {
+        construct_default();
+        try
+        {
+            for (size_type y = 0; y < m_height; ++y)
+            {
+                for (size_type x = 0; x < m_width; ++x)
+                    index(x, y) = gen(x, y);
+            }
+        }
+        catch (...)
+        {
+            destroy();
+            deallocate();
+            throw;
+        }
+    }
+
+    template <typename Generator>
+    void construct_generate(Generator& gen, std::true_type)
+    {
+        size_type i = 0;
+        try
+        {
+            for (size_type y = 0; y < m_height; ++y)
+            {
+                for (size_type x = 0; x < m_width; ++x, ++i)
+                    ::new (static_cast<void*>(m_data + i)) T(gen(x, y));
+                for (; i < (y + 1) * m_pitch; ++i)
+                    ::new (static_cast<void*>(m_data + i)) T;
+            }
+        }
+        catch (...)
+        {
+            destroy(0, i);
+            deallocate();
+            throw;
+        }
+    }
+
+    //only strided layouts can be rearranged in place
+    bool relayout(size_type, size_type, std::false_type) { return false; }
+
+    //moves the elements in place into the layout for width by height, if the
+    //current allocation is large enough to hold it
+    bool relayout(size_type width, size_type height, std::true_type)
+    {
+        const size_type pitch = pitch_for(width, height);
+        const size_type old_count = storage_count();
+        const size_type new_count = Layout::storage_size(width, height, pitch);
+        if (new_count > capacity())
+            return false;
+        const size_type w = std::min(width, m_width);
+        const size_type h = std::min(height, m_height);
+
+        //the preserved part of each run (a row for row_major) and how many of
+        //them there are
+        const size_type run = Layout::minor_extent(w, h);
+        const size_type runs = Layout::major_extent(w, h);
+
+        if (new_count > old_count)
+            construct_default(old_count, new_count);
+
+        //the first run never moves, runs after it move towards the front when
+        //the pitch shrinks and towards the back when it grows
+        if (pitch < m_pitch)
+        {
+            for (size_type r = 1; r < runs; ++r)
+                std::move(m_data + r * m_pitch, m_data + r * m_pitch + run,
+                          m_data + r * pitch);
+        }
+        else if (pitch > m_pitch)
+        {
+            for (size_type r = runs; r-- > 1;)
+                std::move_backward(m_data + r * m_pitch, m_data + r * m_pitch + run,
+                                   m_data + r * pitch + run);
+        }
+
+        //elements outside the preserved region may have been moved from
+        if (!std::is_trivially_default_constructible<T>::value)
+        {
+            for (size_type y = 0; y < height; ++y)
+            {
+                for (size_type x = (y < h ? w : 0); x < width; ++x)
+                    m_data[Layout::offset(x, y, pitch)] = T();
+            }
+        }
+
+        if (new_count < old_count)
+            destroy(new_count, old_count);
+
+        m_width = width;
+        m_height = height;
+        m_pitch = pitch;
+        invalidate();
+        return true;
+    }
+
+    void construct_copy(const T* src)
+    {
+        try
+        {
+            std::uninitialized_copy_n(src, storage_count(), m_data);
+        }
+        catch (...)
+        {
+            deallocate();
+            throw;
+        }
+    }
+
+    void destroy(size_type first, size_type last)
+    {
+        if (!std::is_trivially_destructible<T>::value)
+        {
+            for (size_type i = first; i < last; ++i)
+                m_data[i].~T();
+        }
+    }
+
+    void destroy() { destroy(0, storage_count()); }
+
+    void swap_storage(array2d& o)
+    {
+        using std::swap;
+        swap(m_width, o.m_width);
+        swap(m_height, o.m_height);
+        swap(m_pitch, o.m_pitch);
+        swap(m_data, o.m_data);
+        swap(m_storage, o.m_storage);
+        swap(m_storage_size, o.m_storage_size);
+        swap(m_alloc, o.m_alloc);
+        invalidate();
+        o.invalidate();
+    }
+};
+
+
+//A grid whose dimensions are fixed at compile time, holding exactly the
+//elements its layout needs. It is an aggregate, so it can be brace
+//initialized in the layout's order, and it is trivially copyable and a
+//literal type whenever T is. Const access is constexpr, and so is everything
+//that modifies it from C++14 on.
+template <typename T, std::size_t Width, std::size_t Height, typename Layout = row_major>
+class static_array2d
+{
+  public:
+    typedef T                   value_type;
+    typedef Layout              layout_type;
+    typedef T*                  pointer;
+    typedef const T*            const_pointer;
+    typedef T&                  reference;
+    typedef const T&            const_reference;
+    typedef std::size_t         size_type;
+    typedef std::ptrdiff_t      difference_type;
+
+  public:
+    static constexpr size_type width = Width;
+    static constexpr size_type height = Height;
+
+    //in bytes, not elements
+    static constexpr size_type size = Width * Height * sizeof(T);
+
+    //see Layout, for row_major this is Width
+    static constexpr size_type pitch = Layout::pitch(Width, Height, 1);
+
+  private:
+    static constexpr size_type storage_size = Layout::storage_size(Width, Height, pitch);
+
+    typedef typename Layout::template static_iterators<T, T*, T&, pitch> layout_iterators;
+    typedef typename Layout::template
+        static_iterators<T, const T*, const T&, pitch> const_layout_iterators;
+
+  public:
+    //strided layouts are never padded, so are walked with a pointer
+    typedef typename std::conditional<
+        Layout::strided,
+        array2d_iterator<T, T*, T&>,
+        typename Layout::template iterators<T, T*, T&>::iterator
+    >::type iterator;
+    typedef typename std::conditional<
+        Layout::strided,
+        array2d_iterator<T, const T*, const T&>,
+        typename Layout::template iterators<T, const T*, const T&>::iterator
+    >::type const_iterator;
+
+    //iterates down a column
+    typedef typename layout_iterators::column_iterator       column_iterator;
+    typedef typename const_layout_iterators::column_iterator const_column_iterator;
+
+    //iterates across a row
+    typedef typename layout_iterators::row_iterator          row_iterator;
+    typedef typename const_layout_iterators::row_iterator    const_row_iterator;
+
+    //iterates over the blocks of contiguous elements
+    typedef array2d_tile_iterator<T, Layout>       tile_iterator;
+    typedef array2d_tile_iterator<const T, Layout> const_tile_iterator;
+
+    //public only so that static_array2d is an aggregate, use data()
+    T _m_data[storage_size];
+
+    //evaluates an elementwise expression, see array2d_expr.hpp
+    template <typename E>
+    static_array2d& operator=(const array2d_expression<E>& e)
+    {
+        evaluate(*this, e);
+        return *this;
+    }
+
+    ARRAY2D_CONSTEXPR14 pointer data() { return _m_data; }
+    constexpr const_pointer data() const { return _m_data; }
+
+    ARRAY2D_CONSTEXPR14 void fill(const T& value)
+    {
+        for (size_type i = 0; i < storage_size; ++i)
+            _m_data[i] = value;
+    }
+
+    ARRAY2D_CONSTEXPR14 iterator begin() { return make_iterator<iterator>(_m_data, 0, 0); }
+    constexpr const_iterator begin() const
+    { return make_iterator<const_iterator>(_m_data, 0, 0); }
+
+    ARRAY2D_CONSTEXPR14 iterator end() { return make_end<iterator>(_m_data); }
+    constexpr const_iterator end() const { return make_end<const_iterator>(_m_data); }
+
+    ARRAY2D_CONSTEXPR14 row_iterator row_begin(size_type y)
+    { return Layout::template row_iterator<row_iterator>(_m_data, pitch, 0, y); }
+    constexpr const_row_iterator row_begin(size_type y) const
+    { return Layout::template row_iterator<const_row_iterator>(_m_data, pitch, 0, y); }
+
+    ARRAY2D_CONSTEXPR14 row_iterator row_end(size_type y)
+    { return Layout::template row_iterator<row_iterator>(_m_data, pitch, Width, y); }
+    constexpr const_row_iterator row_end(size_type y) const
+    { return Layout::template row_iterator<const_row_iterator>(_m_data, pitch, Width, y); }
+    
+    ARRAY2D_CONSTEXPR14 column_iterator column_begin(size_type x)
+    { return Layout::template column_iterator<column_iterator>(_m_data, pitch, x, 0); }
+    constexpr const_column_iterator column_begin(size_type x) const
+    {
+        return Layout::template column_iterator<const_column_iterator>(
+            _m_data, pitch, x, 0);
+    }
+
+    ARRAY2D_CONSTEXPR14 column_iterator column_end(size_type x)
+    { return Layout::template column_iterator<column_iterator>(_m_data, pitch, x, Height); }
+    constexpr const_column_iterator column_end(size_type x) const
+    {
+        return Layout::template column_iterator<const_column_iterator>(
+            _m_data, pitch, x, Height);
+    }
+
+    tile_iterator tile_begin()
+    { return tile_iterator(_m_data, pitch, Width, Height, 0); }
+    const_tile_iterator tile_begin() const
+    { return const_tile_iterator(_m_data, pitch, Width, Height, 0); }
+
+    tile_iterator tile_end()
+    { return tile_iterator(_m_data, pitch, Width, Height, tile_count()); }
+    const_tile_iterator tile_end() const
+    { return const_tile_iterator(_m_data, pitch, Width, Height, tile_count()); }
+
+    size_type tile_count() const
+    { return array2d_tile_count<Layout>(Width, Height, pitch); }
+
+    ARRAY2D_CONSTEXPR14 reference index(size_type x, size_type y)
+    { return _m_data[Layout::offset(x, y, pitch)]; }
+    constexpr const_reference index(size_type x, size_type y) const
+    { return _m_data[Layout::offset(x, y, pitch)]; }
+
+    ARRAY2D_CONSTEXPR14 reference operator()(size_type x, size_type y)
+    { return _m_data[Layout::offset(x, y, pitch)]; }
+    constexpr const_reference operator()(size_type x, size_type y) const
+    { return _m_data[Layout::offset(x, y, pitch)]; }
+
+    //throws std::out_of_range if (x, y) is outside the grid
+    ARRAY2D_CONSTEXPR14 reference at(size_type x, size_type y)
+    {
+        return x < Width && y < Height ? _m_data[Layout::offset(x, y, pitch)] :
+               throw std::out_of_range("static_array2d::at");
+    }
+    constexpr const_reference at(size_type x, size_type y) const
+    {
+        return x < Width && y < Height ? _m_data[Layout::offset(x, y, pitch)] :
+               throw std::out_of_range("static_array2d::at");
+    }
+
+    template <typename... Args>
+    iterator emplace(size_type x, size_type y, Args&&... args)
+    {
+        typedef emplacer<iterator> emplacer;
+        return emplacer::emplace(make_iterator<iterator>(_m_data, x, y),
+                                 std::forward<Args>(args)...);
+    }
+
+    //pos may be an iterator, row_iterator or column_iterator
+    template <typename Iter, typename... Args>
+    typename std::enable_if<
+        std::is_same<Iter, iterator>::value ||
+        std::is_same<Iter, row_iterator>::value ||
+        std::is_same<Iter, column_iterator>::value,
+        Iter
+    >::type emplace(Iter pos, Args&&... args)
+    {
+        typedef emplacer<Iter> emplacer;
+        return emplacer::emplace(pos, std::forward<Args>(args)...);
+    }
+
+  private:
+    template <typename Iter, typename Ptr>
+    static constexpr Iter make_iterator(Ptr data, size_type x, size_type y, std::true_type)
+    { return Iter(data + Layout::offset(x, y, pitch)); }
+
+    template <typename Iter, typename Ptr>
+    static Iter make_iterator(Ptr data, size_type x, size_type y, std::false_type)
+    { return Layout::template iterator<Iter>(data, pitch, Width, Height, x, y); }
+
+    template <typename Iter, typename Ptr>
+    static constexpr Iter make_iterator(Ptr data, size_type x, size_type y)
+    {
+        return make_iterator<Iter>(data, x, y,
+                                   std::integral_constant<bool, Layout::strided>());
+    }
+
+    template <typename Iter, typename Ptr>
+    static constexpr Iter make_end(Ptr data, std::true_type)
+    { return Iter(data + storage_size); }
+
+    template <typename Iter, typename Ptr>
+    static Iter make_end(Ptr data, std::false_type)
+    { return Layout::template iterator_end<Iter>(data, pitch, Width, Height); }
+
+    template <typename Iter, typename Ptr>
+    static constexpr Iter make_end(Ptr data)
+    { return make_end<Iter>(data, std::integral_constant<bool, Layout::strided>()); }
+};
+
+
+//non-owning view of a rectangular region of a grid, described by a pointer,
+//a width, a height and a pitch. Views are shallow: copying one never copies
+//elements, and a view of const T gives read only access.
+template <typename T, typename Layout = row_major>
+class array2d_view
+{
+    static_assert(Layout::strided, "only strided layouts can be viewed");
+
+  public:
+    typedef typename std::remove_const<T>::type value_type;
+    typedef Layout              layout_type;
+    typedef T*                  pointer;
+    typedef const T*            const_pointer;
+    typedef T&                  reference;
+    typedef const T&            const_reference;
+    typedef std::size_t         size_type;
+    typedef std::ptrdiff_t      difference_type;
+
+    //iterates over every element in memory order
+    typedef typename Layout::template
+        iterators<value_type, T*, T&>::iterator                    iterator;
+    typedef typename Layout::template
+        iterators<value_type, const T*, const T&>::iterator        const_iterator;
+
+    //iterates down a column
+    typedef typename Layout::template
+        iterators<value_type, T*, T&>::column_iterator             column_iterator;
+    typedef typename Layout::template
+        iterators<value_type, const T*, const T&>::column_iterator const_column_iterator;
+
+    //iterates across a row
+    typedef typename Layout::template
+        iterators<value_type, T*, T&>::row_iterator                row_iterator;
+    typedef typename Layout::template
+        iterators<value_type, const T*, const T&>::row_iterator    const_row_iterator;
+
+    //a view of the same elements with x and y swapped
+    typedef array2d_view<T, typename Layout::transposed> transposed_view;
+
+  private:
+    T* m_data;
+    size_type m_width;
+    size_type m_height;
+    size_type m_pitch;
+
+  public:
+    array2d_view() : m_data(nullptr), m_width(0), m_height(0), m_pitch(0) { }
+
+    //view of an external buffer with tightly packed rows (or columns)
+    array2d_view(T* data, size_type width, size_type height)
+        : m_data(data),
+          m_width(width),
+          m_height(height),
+          m_pitch(Layout::minor_extent(width, height))
+    { }
+
+    array2d_view(T* data, size_type width, size_type height, size_type pitch)
+        : m_data(data), m_width(width), m_height(height), m_pitch(pitch)
+    { }
+
+    template <typename A, std::size_t R>
+    array2d_view(array2d<value_type, A, R, Layout>& a)
+        : m_data(a.data()), m_width(a.width()), m_height(a.height()), m_pitch(a.pitch())
+    { }
+
+    template <typename A, std::size_t R, typename U = T,
+              typename = typename std::enable_if<std::is_const<U>::value>::type>
+    array2d_view(const array2d<value_type, A, R, Layout>& a)
+        : m_data(a.data()), m_width(a.width()), m_height(a.height()), m_pitch(a.pitch())
+    { }
+
+    template <std::size_t W, std::size_t H>
+    array2d_view(static_array2d<value_type, W, H, Layout>& a)
+        : m_data(a.data()),
+          m_width(W),
+          m_height(H),
+          m_pitch(static_array2d<value_type, W, H, Layout>::pitch)
+    { }
+
+    template <std::size_t W, std::size_t H, typename U = T,
+              typename = typename std::enable_if<std::is_const<U>::value>::type>
+    array2d_view(const static_array2d<value_type, W, H, Layout>& a)
+        : m_data(a.data()),
+          m_width(W),
+          m_height(H),
+          m_pitch(static_array2d<value_type, W, H, Layout>::pitch)
+    { }
+
+    //allow non-const to const conversion
+    template <typename U>
+    array2d_view(const array2d_view<U, Layout>& o,
+                 typename std::enable_if<
+                     std::is_convertible<U*, T*>::value
+                 >::type* = nullptr)
+        : m_data(o.data()), m_width(o.width()), m_height(o.height()), m_pitch(o.pitch())
+    { }
+
+    size_type width() const { return m_width; }
+    size_type height() const { return m_height; }
+    size_type pitch() const { return m_pitch; }
+    pointer data() const { return m_data; }
+
+    //the w by h region whose top left element is (x, y)
+    array2d_view subview(size_type x, size_type y, size_type w, size_type h) const
+    { return array2d_view(m_data + Layout::offset(x, y, m_pitch), w, h, m_pitch); }
+
+    transposed_view transpose() const
+    { return transposed_view(m_data, m_height, m_width, m_pitch); }
+
+    iterator begin() const
+    { return Layout::template iterator<iterator>(m_data, m_pitch, m_width, m_height, 0, 0); }
+    iterator end() const
+    { return Layout::template iterator_end<iterator>(m_data, m_pitch, m_width, m_height); }
+
+    row_iterator row_begin(size_type y) const
+    { return Layout::template row_iterator<row_iterator>(m_data, m_pitch, 0, y); }
+
+    row_iterator row_end(size_type y) const
+    { return Layout::template row_iterator<row_iterator>(m_data, m_pitch, m_width, y); }
+
+    column_iterator column_begin(size_type x) const
+    { return Layout::template column_iterator<column_iterator>(m_data, m_pitch, x, 0); }
+
+    column_iterator column_end(size_type x) const
+    {
+        return Layout::template column_iterator<column_iterator>(
+            m_data, m_pitch, x, m_height);
+    }
+
+    reference index(size_type x, size_type y) const
+    {
+        ARRAY2D_CHECK(x < m_width && y < m_height, "coordinates out of range");
+        return m_data[Layout::offset(x, y, m_pitch)];
+    }
+
+    reference operator()(size_type x, size_type y) const { return index(x, y); }
+
+    //throws std::out_of_range if (x, y) is outside the view
+    reference at(size_type x, size_type y) const
+    {
+        if (x >= m_width || y >= m_height)
+            throw std::out_of_range("array2d_view::at");
+        return m_data[Layout::offset(x, y, m_pitch)];
+    }
+};
+
+template <typename T, typename Layout = row_major>
+using const_array2d_view = array2d_view<const T, Layout>;
+
+
+template <typename T, typename A, std::size_t R, typename Layout>
+void swap(array2d<T, A, R, Layout>& a, array2d<T, A, R, Layout>& b) noexcept { a.swap(b); }
+
+
+//The dimensions of any grid, for algorithms written once for array2d,
+//static_array2d and array2d_view.
+
+template <typename T, typename A, std::size_t R, typename Layout>
+std::size_t array2d_width(const array2d<T, A, R, Layout>& a) { return a.width(); }
+
+template <typename T, std::size_t W, std::size_t H, typename Layout>
+constexpr std::size_t array2d_width(const static_array2d<T, W, H, Layout>&) { return W; }
+
+template <typename T, typename Layout>
+std::size_t array2d_width(const array2d_view<T, Layout>& a) { return a.width(); }
+
+template <typename T, typename A, std::size_t R, typename Layout>
+std::size_t array2d_height(const array2d<T, A, R, Layout>& a) { return a.height(); }
+
+template <typename T, std::size_t W, std::size_t H, typename Layout>
+constexpr std::size_t array2d_height(const static_array2d<T, W, H, Layout>&) { return H; }
+
+template <typename T, typename Layout>
+std::size_t array2d_height(const array2d_view<T, Layout>& a) { return a.height(); }
+
+template <typename T, typename A, std::size_t R, typename Layout>
+std::size_t array2d_pitch(const array2d<T, A, R, Layout>& a) { return a.pitch(); }
+
+template <typename T, std::size_t W, std::size_t H, typename Layout>
+constexpr std::size_t array2d_pitch(const static_array2d<T, W, H, Layout>&)
+{ return static_array2d<T, W, H, Layout>::pitch; }
+
+template <typename T, typename Layout>
+std::size_t array2d_pitch(const array2d_view<T, Layout>& a) { return a.pitch(); }
 
 } //array2d
 
@@ -0,0 +1,488 @@
+/*
+ array2d_batch.hpp - Many grids of the same size in one allocation, stored
+                     grid after grid or with their elements interleaved.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#ifndef ARRAY2D_BATCH_H
+#define ARRAY2D_BATCH_H
+
+#include "array2d.hpp"
+#include "array2d_parallel.hpp"
+#include "array2d_reduce.hpp"
+#include "array2d_transpose.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+
+namespace array2d
+{
+
+//How an array2d_batch arranges its grids.
+
+//each grid is contiguous and row_major, and the grids follow one another
+struct batch_grid_major { };
+
+//Element (x, y) of every grid is contiguous, then element (x + 1, y) of
+//every grid and so on, so a vector register holds the same element of
+//consecutive grids and one instruction works on all of them.
+struct batch_interleaved { };
+
+
+//The layout_type of array2d_strided_view. Elements are x_stride apart along a
+//row and y_stride apart down a column, and array2d_pitch() is y_stride. This
+//is only a tag for the algorithms that choose a code path by layout, no
+//container is stored this way.
+struct batch_strided { };
+
+template <typename T>
+std::size_t parallel_row_multiple(batch_strided, std::size_t pitch)
+{ return parallel_row_multiple<T>(row_major(), pitch); }
+
+//x_stride isn't known here, so this assumes neighbouring columns are as close
+//as they can be
+template <typename T>
+std::size_t parallel_column_multiple(batch_strided, std::size_t pitch)
+{ return parallel_column_multiple<T>(row_major(), pitch); }
+
+
+//A non-owning view of a grid whose elements are x_stride apart along a row
+//and y_stride apart down a column, neither of which need be 1. This is how
+//the grids of an interleaved batch are seen. Like array2d_view it is
+//shallow, and a view of const T is read only.
+template <typename T>
+class array2d_strided_view
+{
+  public:
+    typedef typename std::remove_const<T>::type value_type;
+    typedef batch_strided       layout_type;
+    typedef T*                  pointer;
+    typedef const T*            const_pointer;
+    typedef T&                  reference;
+    typedef const T&            const_reference;
+    typedef std::size_t         size_type;
+    typedef std::ptrdiff_t      difference_type;
+
+    typedef array2d_index_iterator<T, const array2d_strided_view, iterate_grid> iterator;
+    typedef array2d_index_iterator<const T, const array2d_strided_view, iterate_grid>
+        const_iterator;
+    typedef array2d_column_iterator<value_type, T*, T&>                       row_iterator;
+    typedef array2d_column_iterator<value_type, const T*, const T&>     const_row_iterator;
+    typedef array2d_column_iterator<value_type, T*, T&>                       column_iterator;
+    typedef array2d_column_iterator<value_type, const T*, const T&>  const_column_iterator;
+
+  private:
+    T* m_data;
+    size_type m_width;
+    size_type m_height;
+    size_type m_x_stride;
+    size_type m_y_stride;
+
+  public:
+    array2d_strided_view()
+        : m_data(nullptr), m_width(0), m_height(0), m_x_stride(0), m_y_stride(0)
+    { }
+
+    array2d_strided_view(T* data, size_type width, size_type height, size_type x_stride,
+                         size_type y_stride)
+        : m_data(data), m_width(width), m_height(height), m_x_stride(x_stride),
+          m_y_stride(y_stride)
+    { }
+
+    //a row_major view is a strided view with an x_stride of 1
+    template <typename U>
+    array2d_strided_view(const array2d_view<U>& o,
+                         typename std::enable_if<
+                             std::is_convertible<U*, T*>::value
+                         >::type* = nullptr)
+        : m_data(o.data()), m_width(o.width()), m_height(o.height()), m_x_stride(1),
+          m_y_stride(o.pitch())
+    { }
+
+    //allow non-const to const conversion
+    template <typename U>
+    array2d_strided_view(const array2d_strided_view<U>& o,
+                         typename std::enable_if<
+                             std::is_convertible<U*, T*>::value
+                         >::type* = nullptr)
+        : m_data(o.data()), m_width(o.width()), m_height(o.height()),
+          m_x_stride(o.x_stride()), m_y_stride(o.y_stride())
+    { }
+
+    size_type width() const { return m_width; }
+    size_type height() const { return m_height; }
+    size_type x_stride() const { return m_x_stride; }
+    size_type y_stride() const { return m_y_stride; }
+    pointer data() const { return m_data; }
+
+    iterator begin() const { return iterator(this, m_width, 0, 0); }
+    iterator end() const { return iterator(this, m_width, 0, m_width == 0 ? 0 : m_height); }
+
+    row_iterator row_begin(size_type y) const
+    { return row_iterator(m_data + y * m_y_stride, m_x_stride); }
+    row_iterator row_end(size_type y) const
+    { return row_iterator(m_data + y * m_y_stride + m_width * m_x_stride, m_x_stride); }
+
+    column_iterator column_begin(size_type x) const
+    { return column_iterator(m_data + x * m_x_stride, m_y_stride); }
+    column_iterator column_end(size_type x) const
+    { return column_iterator(m_data + x * m_x_stride + m_height * m_y_stride, m_y_stride); }
+
+    reference index(size_type x, size_type y) const
+    {
+        ARRAY2D_CHECK(x < m_width && y < m_height, "coordinates out of range");
+        return m_data[x * m_x_stride + y * m_y_stride];
+    }
+
+    reference operator()(size_type x, size_type y) const { return index(x, y); }
+
+    //throws std::out_of_range if (x, y) is outside the view
+    reference at(size_type x, size_type y) const
+    {
+        if (x >= m_width || y >= m_height)
+            throw std::out_of_range("array2d_strided_view::at");
+        return m_data[x * m_x_stride + y * m_y_stride];
+    }
+};
+
+
+//What a batch's grids are seen as, and how its storage is arranged. The
+//storage is an array2d with one row per grid (grid major) or one row per
+//element position, holding that element of every grid (interleaved).
+template <typename T, typename Interleave>
+struct batch_traits;
+
+template <typename T>
+struct batch_traits<T, batch_grid_major>
+{
+    typedef array2d_view<T>       member_type;
+    typedef array2d_view<const T> const_member_type;
+
+    static std::size_t storage_width(std::size_t width, std::size_t height, std::size_t)
+    { return width * height; }
+    static std::size_t storage_height(std::size_t, std::size_t, std::size_t count)
+    { return count; }
+
+    template <typename U>
+    static array2d_view<U> member(U* data, std::size_t pitch, std::size_t width,
+                                  std::size_t height, std::size_t i)
+    { return array2d_view<U>(data + i * pitch, width, height, width); }
+
+    static std::size_t offset(std::size_t pitch, std::size_t width, std::size_t, std::size_t i,
+                              std::size_t x, std::size_t y)
+    { return i * pitch + y * width + x; }
+};
+
+template <typename T>
+struct batch_traits<T, batch_interleaved>
+{
+    typedef array2d_strided_view<T>       member_type;
+    typedef array2d_strided_view<const T> const_member_type;
+
+    static std::size_t storage_width(std::size_t, std::size_t, std::size_t count)
+    { return count; }
+    static std::size_t storage_height(std::size_t width, std::size_t height, std::size_t)
+    { return width * height; }
+
+    template <typename U>
+    static array2d_strided_view<U> member(U* data, std::size_t pitch, std::size_t width,
+                                          std::size_t height, std::size_t i)
+    { return array2d_strided_view<U>(data + i, width, height, pitch, width * pitch); }
+
+    static std::size_t offset(std::size_t pitch, std::size_t width, std::size_t, std::size_t i,
+                              std::size_t x, std::size_t y)
+    { return (y * width + x) * pitch + i; }
+};
+
+
+//count grids of width by height elements in a single allocation. Grid major
+//keeps each grid contiguous, which suits working on one grid at a time.
+//Interleaved puts the same element of every grid side by side, so that
+//elementwise work across the batch is vectorized over the grids and fills
+//whole registers however small the grids are. Either way, each grid is seen
+//through a view with the usual index(), row and column iterators, which can
+//be given to the reductions, scans, stencils, transposes and parallel loops
+//of the other headers. Expressions only take grid major members, interleaved
+//batches are combined through storage().
+//
+//The whole batch is storage(), an array2d, so arithmetic on every grid at
+//once is an expression on storages:
+//
+//  c.storage() = a.storage() * b.storage() + 1.0f;
+//
+//RowAlign aligns each grid (grid major) or each element position
+//(interleaved), e.g. 64 for AVX-512 loads across the batch.
+template <typename T,
+          typename Interleave = batch_grid_major,
+          typename Allocator = std::allocator<T>,
+          std::size_t RowAlign = alignof(T)>
+class array2d_batch
+{
+    typedef batch_traits<T, Interleave> traits;
+
+  public:
+    typedef T                                     value_type;
+    typedef Interleave                            interleave_type;
+    typedef Allocator                             allocator_type;
+    typedef T&                                    reference;
+    typedef const T&                              const_reference;
+    typedef std::size_t                           size_type;
+    typedef array2d<T, Allocator, RowAlign>       storage_type;
+    typedef typename traits::member_type          member_type;
+    typedef typename traits::const_member_type    const_member_type;
+
+  private:
+    size_type m_width;
+    size_type m_height;
+    size_type m_count;
+    storage_type m_storage;
+
+  public:
+    array2d_batch() = delete;
+
+    //count grids of default initialized elements
+    array2d_batch(size_type width, size_type height, size_type count,
+                  const Allocator& alloc = Allocator())
+        : m_width(width), m_height(height), m_count(count),
+          m_storage(traits::storage_width(width, height, count),
+                    traits::storage_height(width, height, count), alloc)
+    { }
+
+    //every element of every grid is a copy of value
+    array2d_batch(size_type width, size_type height, size_type count, const T& value,
+                  const Allocator& alloc = Allocator())
+        : m_width(width), m_height(height), m_count(count),
+          m_storage(traits::storage_width(width, height, count),
+                    traits::storage_height(width, height, count), value, alloc)
+    { }
+
+    //of each grid
+    size_type width() const { return m_width; }
+    size_type height() const { return m_height; }
+
+    //the number of grids
+    size_type size() const { return m_count; }
+
+    allocator_type get_allocator() const { return m_storage.get_allocator(); }
+
+    storage_type& storage() { return m_storage; }
+    const storage_type& storage() const { return m_storage; }
+
+    //grid i
+    member_type operator[](size_type i)
+    {
+        ARRAY2D_CHECK(i < m_count, "grid out of range");
+        return traits::member(m_storage.data(), m_storage.pitch(), m_width, m_height, i);
+    }
+    const_member_type operator[](size_type i) const
+    {
+        ARRAY2D_CHECK(i < m_count, "grid out of range");
+        return traits::member(static_cast<const T*>(m_storage.data()), m_storage.pitch(),
+                              m_width, m_height, i);
+    }
+
+    //element (x, y) of grid i
+    reference index(size_type i, size_type x, size_type y)
+    { return m_storage.data()[checked_offset(i, x, y)]; }
+    const_reference index(size_type i, size_type x, size_type y) const
+    { return m_storage.data()[checked_offset(i, x, y)]; }
+
+    reference operator()(size_type i, size_type x, size_type y) { return index(i, x, y); }
+    const_reference operator()(size_type i, size_type x, size_type y) const
+    { return index(i, x, y); }
+
+    void swap(array2d_batch& o) noexcept
+    {
+        using std::swap;
+        swap(m_width, o.m_width);
+        swap(m_height, o.m_height);
+        swap(m_count, o.m_count);
+        m_storage.swap(o.m_storage);
+    }
+
+  private:
+    size_type checked_offset(size_type i, size_type x, size_type y) const
+    {
+        ARRAY2D_CHECK(i < m_count && x < m_width && y < m_height, "coordinates out of range");
+        return traits::offset(m_storage.pitch(), m_width, m_height, i, x, y);
+    }
+};
+
+template <typename T, typename I, typename A, std::size_t R>
+void swap(array2d_batch<T, I, A, R>& a, array2d_batch<T, I, A, R>& b) noexcept { a.swap(b); }
+
+
+//dst = f(src) for every element of every grid. Both batches must have the
+//same dimensions and size and may be the same batch. Rows of the storage,
+//a grid or an element position each, are spread over the threads of pool,
+//and each is a loop over contiguous elements that the compiler can
+//vectorize. Throws std::invalid_argument if the batches don't agree.
+template <typename S, typename T, typename I, typename SA, typename TA, std::size_t SR,
+          std::size_t TR, typename F>
+void batch_transform(const array2d_batch<S, I, SA, SR>& src, array2d_batch<T, I, TA, TR>& dst,
+                     F f, chunking c = chunking(), thread_pool& pool = default_thread_pool())
+{
+    if (src.width() != dst.width() || src.height() != dst.height() || src.size() != dst.size())
+        throw std::invalid_argument("batch dimensions don't agree");
+
+    const auto& in = src.storage();
+    auto& out = dst.storage();
+    const std::size_t n = in.width();
+    pool.parallel_for(in.height(),
+                      [&](std::size_t begin, std::size_t end)
+                      {
+                          for (std::size_t y = begin; y < end; ++y)
+                          {
+                              const S* p = in.data() + y * in.pitch();
+                              T* q = out.data() + y * out.pitch();
+                              for (std::size_t i = 0; i < n; ++i)
+                                  q[i] = f(p[i]);
+                          }
+                      },
+                      c, parallel_row_multiple<T>(row_major(), out.pitch()));
+}
+
+//Writes op over every element of each grid to out, grid 0 first, and returns
+//out advanced past the last. A grid major batch reduces each grid as a
+//vectorized line. An interleaved batch accumulates every element position
+//into one line of results, vectorized across the grids. The result for
+//empty grids is value_type().
+template <typename T, typename A, std::size_t R, typename OutputIt, typename Op = plus_op>
+OutputIt batch_reduce(const array2d_batch<T, batch_grid_major, A, R>& a, OutputIt out,
+                      Op op = Op(), chunking c = chunking(),
+                      thread_pool& pool = default_thread_pool())
+{ return reduce_rows(a.storage(), out, op, c, pool); }
+
+template <typename T, typename A, std::size_t R, typename OutputIt, typename Op = plus_op>
+OutputIt batch_reduce(const array2d_batch<T, batch_interleaved, A, R>& a, OutputIt out,
+                      Op op = Op(), chunking c = chunking(),
+                      thread_pool& pool = default_thread_pool())
+{ return reduce_columns(a.storage(), out, op, c, pool); }
+
+//Transposes every grid of src into dst, whose grids are src.height() wide and
+//src.width() high. Grid major batches transpose each grid with the blocked
+//kernels of array2d_transpose.hpp, in parallel over the grids. Interleaved
+//batches only move whole element positions, a contiguous run of every grid's
+//element, in parallel over the positions. src and dst must not overlap.
+//Throws std::invalid_argument if the batches don't agree.
+template <typename T, typename A, std::size_t SR, std::size_t TR>
+void batch_transpose(const array2d_batch<T, batch_grid_major, A, SR>& src,
+                     array2d_batch<T, batch_grid_major, A, TR>& dst,
+                     chunking c = chunking(), thread_pool& pool = default_thread_pool())
+{
+    if (src.width() != dst.height() || src.height() != dst.width() || src.size() != dst.size())
+        throw std::invalid_argument("batch dimensions don't agree");
+
+    pool.parallel_for(src.size(),
+                      [&](std::size_t begin, std::size_t end)
+                      {
+                          for (std::size_t i = begin; i < end; ++i)
+                              transpose(src[i], dst[i]);
+                      },
+                      c);
+}
+
+template <typename T, typename A, std::size_t SR, std::size_t TR>
+void batch_transpose(const array2d_batch<T, batch_interleaved, A, SR>& src,
+                     array2d_batch<T, batch_interleaved, A, TR>& dst,
+                     chunking c = chunking(), thread_pool& pool = default_thread_pool())
+{
+    if (src.width() != dst.height() || src.height() != dst.width() || src.size() != dst.size())
+        throw std::invalid_argument("batch dimensions don't agree");
+
+    const std::size_t width = src.width();
+    const std::size_t height = src.height();
+    const std::size_t count = src.size();
+    const auto& in = src.storage();
+    auto& out = dst.storage();
+    pool.parallel_for(height,
+                      [&](std::size_t begin, std::size_t end)
+                      {
+                          for (std::size_t y = begin; y < end; ++y)
+                          {
+                              for (std::size_t x = 0; x < width; ++x)
+                              {
+                                  const T* p = in.data() + (y * width + x) * in.pitch();
+                                  std::copy(p, p + count,
+                                            out.data() + (x * height + y) * out.pitch());
+                              }
+                          }
+                      },
+                      c);
+}
+
+
+//dst(x, y) = src(y, x) for views that aren't contiguous along either axis,
+//such as the grids of an interleaved batch, a block at a time so that both
+//are walked within a few cache lines. dst must be src.height() wide and
+//src.width() high and must not overlap src.
+template <typename S, typename T>
+void transpose(array2d_strided_view<S> src, array2d_strided_view<T> dst)
+{
+    static_assert(std::is_same<typename std::remove_const<S>::type, T>::value,
+                  "source and destination element types must match");
+
+    const std::size_t block = 16;
+    const std::size_t width = src.width();
+    const std::size_t height = src.height();
+    for (std::size_t by = 0; by < height; by += block)
+    {
+        const std::size_t ey = std::min(by + block, height);
+        for (std::size_t bx = 0; bx < width; bx += block)
+        {
+            const std::size_t ex = std::min(bx + block, width);
+            for (std::size_t y = by; y < ey; ++y)
+            {
+                for (std::size_t x = bx; x < ex; ++x)
+                    dst.index(y, x) = src.index(x, y);
+            }
+        }
+    }
+}
+
+template <typename S, typename T>
+void transpose(array2d_view<S> src, array2d_strided_view<T> dst)
+{ transpose(array2d_strided_view<S>(src), dst); }
+
+template <typename S, typename T>
+void transpose(array2d_strided_view<S> src, array2d_view<T> dst)
+{ transpose(src, array2d_strided_view<T>(dst)); }
+
+
+template <typename T>
+std::size_t array2d_width(const array2d_strided_view<T>& a) { return a.width(); }
+
+template <typename T>
+std::size_t array2d_height(const array2d_strided_view<T>& a) { return a.height(); }
+
+template <typename T>
+std::size_t array2d_pitch(const array2d_strided_view<T>& a) { return a.y_stride(); }
+
+} //array2d
+
+#endif //ARRAY2D_BATCH_H
@@ -0,0 +1,239 @@
+/*
+ array2d_cow.hpp - A grid shared copy on write, so that readers can take
+                   snapshots of it that cost nothing until the grid is
+                   written to.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#ifndef ARRAY2D_COW_H
+#define ARRAY2D_COW_H
+
+#include "array2d.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+namespace array2d
+{
+
+//a grid and the number of cow_array2ds and snapshots sharing it
+template <typename Grid>
+struct array2d_shared_grid
+{
+    std::atomic<std::size_t> refs;
+    Grid grid;
+
+    template <typename... Args>
+    explicit array2d_shared_grid(Args&&... args)
+        : refs(1), grid(std::forward<Args>(args)...)
+    { }
+
+    void retain() { refs.fetch_add(1, std::memory_order_relaxed); }
+
+    //the last one out deletes the grid
+    static void release(array2d_shared_grid* g)
+    {
+        if (g && g->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            delete g;
+    }
+
+    //acquire, so that reads through snapshots released since happen before
+    //the writes that follow
+    bool shared() const { return refs.load(std::memory_order_acquire) != 1; }
+};
+
+
+//A read only reference to the contents a cow_array2d had when the snapshot
+//was taken. It stays valid, and unchanged, however the cow_array2d is written
+//to afterwards, and may be read, copied and released on any thread. A default
+//constructed snapshot holds nothing until it is assigned one.
+template <typename Grid>
+class array2d_snapshot
+{
+    typedef array2d_shared_grid<Grid> shared_grid;
+
+  public:
+    typedef Grid                                grid_type;
+    typedef typename Grid::value_type           value_type;
+    typedef typename Grid::const_reference      const_reference;
+    typedef typename Grid::size_type            size_type;
+    typedef typename Grid::const_iterator       const_iterator;
+    typedef typename Grid::const_row_iterator   const_row_iterator;
+    typedef typename Grid::const_column_iterator const_column_iterator;
+
+  private:
+    shared_grid* m_shared;
+
+    template <typename G>
+    friend class cow_array2d;
+
+    explicit array2d_snapshot(shared_grid* g) : m_shared(g) { m_shared->retain(); }
+
+  public:
+    array2d_snapshot() : m_shared(nullptr) { }
+
+    ~array2d_snapshot() { shared_grid::release(m_shared); }
+
+    array2d_snapshot(const array2d_snapshot& o) : m_shared(o.m_shared)
+    {
+        if (m_shared)
+            m_shared->retain();
+    }
+
+    array2d_snapshot(array2d_snapshot&& o) noexcept : m_shared(o.m_shared)
+    { o.m_shared = nullptr; }
+
+    array2d_snapshot& operator=(array2d_snapshot o) noexcept
+    {
+        swap(o);
+        return *this;
+    }
+
+    void swap(array2d_snapshot& o) noexcept { std::swap(m_shared, o.m_shared); }
+
+    bool empty() const { return m_shared == nullptr; }
+
+    //the grid, which must not be modified
+    const Grid& grid() const { return m_shared->grid; }
+
+    size_type width() const { return m_shared ? array2d_width(m_shared->grid) : 0; }
+    size_type height() const { return m_shared ? array2d_height(m_shared->grid) : 0; }
+
+    const_iterator begin() const { return grid().begin(); }
+    const_iterator end() const { return grid().end(); }
+
+    const_row_iterator row_begin(size_type y) const { return grid().row_begin(y); }
+    const_row_iterator row_end(size_type y) const { return grid().row_end(y); }
+
+    const_column_iterator column_begin(size_type x) const { return grid().column_begin(x); }
+    const_column_iterator column_end(size_type x) const { return grid().column_end(x); }
+
+    const_reference index(size_type x, size_type y) const { return grid().index(x, y); }
+    const_reference operator()(size_type x, size_type y) const { return grid().index(x, y); }
+};
+
+
+//A grid that can be shared copy on write. snapshot() and copying a
+//cow_array2d only count another reference. The first write() after that
+//copies the grid, so the snapshots keep what they saw, and later writes go
+//straight to the copy until the next snapshot. A writer that double buffers
+//frames takes one snapshot per frame and pays for at most one copy per
+//frame, and none while nobody holds a snapshot.
+//
+//Writes and snapshots of one cow_array2d must come from one thread at a time,
+//as with any other grid. References from write() are invalidated by the next
+//snapshot() or copy, since the write after that goes to a new grid.
+template <typename Grid>
+class cow_array2d
+{
+    typedef array2d_shared_grid<Grid> shared_grid;
+
+  public:
+    typedef Grid                            grid_type;
+    typedef array2d_snapshot<Grid>          snapshot_type;
+    typedef typename Grid::value_type       value_type;
+    typedef typename Grid::const_reference  const_reference;
+    typedef typename Grid::size_type        size_type;
+
+  private:
+    shared_grid* m_shared;
+
+  public:
+    //constructs the grid from args
+    template <typename Arg, typename... Args,
+              typename = typename std::enable_if<
+                  !std::is_same<typename std::decay<Arg>::type, cow_array2d>::value
+              >::type>
+    explicit cow_array2d(Arg&& arg, Args&&... args)
+        : m_shared(new shared_grid(std::forward<Arg>(arg), std::forward<Args>(args)...))
+    { }
+
+    ~cow_array2d() { shared_grid::release(m_shared); }
+
+    //Shares o's grid until one of them writes. There is no move, which would
+    //leave o without a grid, and copying is as cheap.
+    cow_array2d(const cow_array2d& o) : m_shared(o.m_shared) { m_shared->retain(); }
+
+    cow_array2d& operator=(const cow_array2d& o)
+    {
+        o.m_shared->retain();
+        shared_grid::release(m_shared);
+        m_shared = o.m_shared;
+        return *this;
+    }
+
+    void swap(cow_array2d& o) noexcept { std::swap(m_shared, o.m_shared); }
+
+    //whether a snapshot or another cow_array2d shares the grid, so that the
+    //next write() copies it
+    bool shared() const { return m_shared->shared(); }
+
+    snapshot_type snapshot() const { return snapshot_type(m_shared); }
+
+    const Grid& read() const { return m_shared->grid; }
+
+    //the grid, copied first if it is shared
+    Grid& write()
+    {
+        if (m_shared->shared())
+        {
+            shared_grid* g = new shared_grid(m_shared->grid);
+            shared_grid::release(m_shared);
+            m_shared = g;
+        }
+        return m_shared->grid;
+    }
+
+    size_type width() const { return array2d_width(m_shared->grid); }
+    size_type height() const { return array2d_height(m_shared->grid); }
+
+    const_reference index(size_type x, size_type y) const { return read().index(x, y); }
+    const_reference operator()(size_type x, size_type y) const { return read().index(x, y); }
+};
+
+template <typename Grid>
+void swap(array2d_snapshot<Grid>& a, array2d_snapshot<Grid>& b) noexcept { a.swap(b); }
+
+template <typename Grid>
+void swap(cow_array2d<Grid>& a, cow_array2d<Grid>& b) noexcept { a.swap(b); }
+
+
+template <typename Grid>
+std::size_t array2d_width(const array2d_snapshot<Grid>& a) { return a.width(); }
+
+template <typename Grid>
+std::size_t array2d_width(const cow_array2d<Grid>& a) { return a.width(); }
+
+template <typename Grid>
+std::size_t array2d_height(const array2d_snapshot<Grid>& a) { return a.height(); }
+
+template <typename Grid>
+std::size_t array2d_height(const cow_array2d<Grid>& a) { return a.height(); }
+
+} //array2d
+
+#endif //ARRAY2D_COW_H
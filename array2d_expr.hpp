@@ -0,0 +1,847 @@
+/*
+ array2d_expr.hpp - Lazy elementwise arithmetic and comparison of array2d,
+                    static_array2d and array2d_view, evaluated in a single
+                    vectorized pass.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#ifndef ARRAY2D_EXPR_H
+#define ARRAY2D_EXPR_H
+
+#include "array2d.hpp"
+
+#include <cmath>
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace array2d
+{
+
+//The widest vector registers the target was compiled for (-msse2, -mavx,
+//-mavx512f or -march=native) holding elements of type T. width is 1 for
+//types that are never vectorized.
+template <typename T>
+struct simd
+{
+    typedef T type;
+    static constexpr std::size_t width = 1;
+};
+
+#if defined(__AVX512F__)
+
+template <>
+struct simd<float>
+{
+    typedef __m512 type;
+    static constexpr std::size_t width = 16;
+
+    static type load(const float* p) { return _mm512_loadu_ps(p); }
+    static void store(float* p, type v) { _mm512_storeu_ps(p, v); }
+    static type set1(float v) { return _mm512_set1_ps(v); }
+
+    static type add(type a, type b) { return _mm512_add_ps(a, b); }
+    static type sub(type a, type b) { return _mm512_sub_ps(a, b); }
+    static type mul(type a, type b) { return _mm512_mul_ps(a, b); }
+    static type div(type a, type b) { return _mm512_div_ps(a, b); }
+    //operands are swapped so that ties and NaNs resolve as std::min does
+    static type min(type a, type b) { return _mm512_min_ps(b, a); }
+    static type max(type a, type b) { return _mm512_max_ps(b, a); }
+
+    static type neg(type a)
+    {
+        return _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(a),
+                                                    _mm512_set1_epi32(0x80000000)));
+    }
+    static type abs(type a) { return _mm512_abs_ps(a); }
+    static type sqrt(type a) { return _mm512_sqrt_ps(a); }
+};
+
+template <>
+struct simd<double>
+{
+    typedef __m512d type;
+    static constexpr std::size_t width = 8;
+
+    static type load(const double* p) { return _mm512_loadu_pd(p); }
+    static void store(double* p, type v) { _mm512_storeu_pd(p, v); }
+    static type set1(double v) { return _mm512_set1_pd(v); }
+
+    static type add(type a, type b) { return _mm512_add_pd(a, b); }
+    static type sub(type a, type b) { return _mm512_sub_pd(a, b); }
+    static type mul(type a, type b) { return _mm512_mul_pd(a, b); }
+    static type div(type a, type b) { return _mm512_div_pd(a, b); }
+    static type min(type a, type b) { return _mm512_min_pd(b, a); }
+    static type max(type a, type b) { return _mm512_max_pd(b, a); }
+
+    static type neg(type a)
+    {
+        return _mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(a),
+                                                    _mm512_set1_epi64(0x8000000000000000ll)));
+    }
+    static type abs(type a) { return _mm512_abs_pd(a); }
+    static type sqrt(type a) { return _mm512_sqrt_pd(a); }
+};
+
+#elif defined(__AVX__)
+
+template <>
+struct simd<float>
+{
+    typedef __m256 type;
+    static constexpr std::size_t width = 8;
+
+    static type load(const float* p) { return _mm256_loadu_ps(p); }
+    static void store(float* p, type v) { _mm256_storeu_ps(p, v); }
+    static type set1(float v) { return _mm256_set1_ps(v); }
+
+    static type add(type a, type b) { return _mm256_add_ps(a, b); }
+    static type sub(type a, type b) { return _mm256_sub_ps(a, b); }
+    static type mul(type a, type b) { return _mm256_mul_ps(a, b); }
+    static type div(type a, type b) { return _mm256_div_ps(a, b); }
+    static type min(type a, type b) { return _mm256_min_ps(b, a); }
+    static type max(type a, type b) { return _mm256_max_ps(b, a); }
+
+    static type neg(type a) { return _mm256_xor_ps(a, _mm256_set1_ps(-0.0f)); }
+    static type abs(type a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+    static type sqrt(type a) { return _mm256_sqrt_ps(a); }
+};
+
+template <>
+struct simd<double>
+{
+    typedef __m256d type;
+    static constexpr std::size_t width = 4;
+
+    static type load(const double* p) { return _mm256_loadu_pd(p); }
+    static void store(double* p, type v) { _mm256_storeu_pd(p, v); }
+    static type set1(double v) { return _mm256_set1_pd(v); }
+
+    static type add(type a, type b) { return _mm256_add_pd(a, b); }
+    static type sub(type a, type b) { return _mm256_sub_pd(a, b); }
+    static type mul(type a, type b) { return _mm256_mul_pd(a, b); }
+    static type div(type a, type b) { return _mm256_div_pd(a, b); }
+    static type min(type a, type b) { return _mm256_min_pd(b, a); }
+    static type max(type a, type b) { return _mm256_max_pd(b, a); }
+
+    static type neg(type a) { return _mm256_xor_pd(a, _mm256_set1_pd(-0.0)); }
+    static type abs(type a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+    static type sqrt(type a) { return _mm256_sqrt_pd(a); }
+};
+
+#elif defined(__SSE2__)
+
+template <>
+struct simd<float>
+{
+    typedef __m128 type;
+    static constexpr std::size_t width = 4;
+
+    static type load(const float* p) { return _mm_loadu_ps(p); }
+    static void store(float* p, type v) { _mm_storeu_ps(p, v); }
+    static type set1(float v) { return _mm_set1_ps(v); }
+
+    static type add(type a, type b) { return _mm_add_ps(a, b); }
+    static type sub(type a, type b) { return _mm_sub_ps(a, b); }
+    static type mul(type a, type b) { return _mm_mul_ps(a, b); }
+    static type div(type a, type b) { return _mm_div_ps(a, b); }
+    static type min(type a, type b) { return _mm_min_ps(b, a); }
+    static type max(type a, type b) { return _mm_max_ps(b, a); }
+
+    static type neg(type a) { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+    static type abs(type a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+    static type sqrt(type a) { return _mm_sqrt_ps(a); }
+};
+
+template <>
+struct simd<double>
+{
+    typedef __m128d type;
+    static constexpr std::size_t width = 2;
+
+    static type load(const double* p) { return _mm_loadu_pd(p); }
+    static void store(double* p, type v) { _mm_storeu_pd(p, v); }
+    static type set1(double v) { return _mm_set1_pd(v); }
+
+    static type add(type a, type b) { return _mm_add_pd(a, b); }
+    static type sub(type a, type b) { return _mm_sub_pd(a, b); }
+    static type mul(type a, type b) { return _mm_mul_pd(a, b); }
+    static type div(type a, type b) { return _mm_div_pd(a, b); }
+    static type min(type a, type b) { return _mm_min_pd(b, a); }
+    static type max(type a, type b) { return _mm_max_pd(b, a); }
+
+    static type neg(type a) { return _mm_xor_pd(a, _mm_set1_pd(-0.0)); }
+    static type abs(type a) { return _mm_andnot_pd(_mm_set1_pd(-0.0), a); }
+    static type sqrt(type a) { return _mm_sqrt_pd(a); }
+};
+
+#endif
+
+
+//Every expression E derives from array2d_expression<E> and provides
+//
+//  value_type
+//  static constexpr bool vectorizable
+//  width(), height()   0 for an operand that is broadcast along that axis
+//  operator()(x, y)    the element at (x, y)
+//  packet(x, y)        simd<value_type>::width elements starting at (x, y),
+//                      when vectorizable
+//  aliases(dst)        whether writing dst at one position could change what
+//                      the expression reads at another
+//
+//Expressions refer to the grids they were built from, so they should be
+//evaluated in the statement that creates them.
+template <typename E>
+struct array2d_expression
+{
+    const E& self() const { return static_cast<const E&>(*this); }
+};
+
+//views are held by value, containers by reference
+template <typename Grid>
+struct grid_expression_storage
+{
+    typedef const Grid& type;
+};
+
+template <typename T, typename Layout>
+struct grid_expression_storage<array2d_view<T, Layout> >
+{
+    typedef array2d_view<T, Layout> type;
+};
+
+//the address range the elements of a grid lie in, as [first, last)
+template <typename Grid>
+const char* expression_first(const Grid& g)
+{ return reinterpret_cast<const char*>(g.data()); }
+
+template <typename Grid>
+const char* expression_last(const Grid& g)
+{
+    typedef typename Grid::layout_type layout;
+    const std::size_t width = array2d_width(g);
+    const std::size_t height = array2d_height(g);
+    const std::size_t pitch = array2d_pitch(g);
+    const std::size_t extent =
+        width == 0 || height == 0 ? 0 :
+        layout::strided ? layout::offset(width - 1, height - 1, pitch) + 1 :
+                          layout::storage_size(width, height, pitch);
+    return expression_first(g) + extent * sizeof(typename Grid::value_type);
+}
+
+inline bool expression_ranges_overlap(const char* a_first, const char* a_last,
+                                      const char* b_first, const char* b_last)
+{
+    std::less<const char*> less;
+    return less(a_first, b_last) && less(b_first, a_last);
+}
+
+//a grid as an operand
+template <typename Grid>
+class grid_expression : public array2d_expression<grid_expression<Grid> >
+{
+  public:
+    typedef typename Grid::value_type value_type;
+
+    //row_major rows are contiguous, so can be loaded a packet at a time
+    static constexpr bool vectorizable =
+        std::is_same<typename Grid::layout_type, row_major>::value &&
+        simd<value_type>::width > 1;
+
+  private:
+    typename grid_expression_storage<Grid>::type m_grid;
+
+  public:
+    explicit grid_expression(const Grid& grid) : m_grid(grid) { }
+
+    std::size_t width() const { return array2d_width(m_grid); }
+    std::size_t height() const { return array2d_height(m_grid); }
+
+    value_type operator()(std::size_t x, std::size_t y) const { return m_grid(x, y); }
+
+    typename simd<value_type>::type packet(std::size_t x, std::size_t y) const
+    { return simd<value_type>::load(m_grid.data() + y * array2d_pitch(m_grid) + x); }
+
+    //The grid's storage overlaps dst, other than as the same grid (or a view
+    //of it) with every element at the same position, as in a = a * 2.
+    template <typename Dst>
+    bool aliases(const Dst& dst) const
+    {
+        if (!expression_ranges_overlap(expression_first(m_grid), expression_last(m_grid),
+                                       expression_first(dst), expression_last(dst)))
+            return false;
+        return !(std::is_same<typename Grid::layout_type, typename Dst::layout_type>::value &&
+                 std::is_same<value_type, typename Dst::value_type>::value &&
+                 expression_first(m_grid) == expression_first(dst) &&
+                 array2d_pitch(m_grid) == array2d_pitch(dst));
+    }
+};
+
+//a scalar, the same at every position
+template <typename T>
+class scalar_expression : public array2d_expression<scalar_expression<T> >
+{
+  public:
+    typedef T value_type;
+
+    static constexpr bool vectorizable = simd<T>::width > 1;
+
+  private:
+    T m_value;
+
+  public:
+    explicit scalar_expression(const T& value) : m_value(value) { }
+
+    std::size_t width() const { return 0; }
+    std::size_t height() const { return 0; }
+
+    value_type operator()(std::size_t, std::size_t) const { return m_value; }
+
+    typename simd<T>::type packet(std::size_t, std::size_t) const
+    { return simd<T>::set1(m_value); }
+
+    template <typename Dst>
+    bool aliases(const Dst&) const { return false; }
+};
+
+//a row of values repeated down every row, see broadcast_row
+template <typename T>
+class row_broadcast : public array2d_expression<row_broadcast<T> >
+{
+  public:
+    typedef T value_type;
+
+    static constexpr bool vectorizable = simd<T>::width > 1;
+
+  private:
+    const T* m_data;
+    std::size_t m_width;
+
+  public:
+    row_broadcast(const T* data, std::size_t width) : m_data(data), m_width(width) { }
+
+    std::size_t width() const { return m_width; }
+    std::size_t height() const { return 0; }
+
+    value_type operator()(std::size_t x, std::size_t) const { return m_data[x]; }
+
+    typename simd<T>::type packet(std::size_t x, std::size_t) const
+    { return simd<T>::load(m_data + x); }
+
+    template <typename Dst>
+    bool aliases(const Dst& dst) const
+    {
+        const char* first = reinterpret_cast<const char*>(m_data);
+        return expression_ranges_overlap(first, first + m_width * sizeof(T),
+                                         expression_first(dst), expression_last(dst));
+    }
+};
+
+//a column of values repeated across every column, see broadcast_column
+template <typename T>
+class column_broadcast : public array2d_expression<column_broadcast<T> >
+{
+  public:
+    typedef T value_type;
+
+    static constexpr bool vectorizable = simd<T>::width > 1;
+
+  private:
+    const T* m_data;
+    std::size_t m_height;
+
+  public:
+    column_broadcast(const T* data, std::size_t height) : m_data(data), m_height(height) { }
+
+    std::size_t width() const { return 0; }
+    std::size_t height() const { return m_height; }
+
+    value_type operator()(std::size_t, std::size_t y) const { return m_data[y]; }
+
+    typename simd<T>::type packet(std::size_t, std::size_t y) const
+    { return simd<T>::set1(m_data[y]); }
+
+    template <typename Dst>
+    bool aliases(const Dst& dst) const
+    {
+        const char* first = reinterpret_cast<const char*>(m_data);
+        return expression_ranges_overlap(first, first + m_height * sizeof(T),
+                                         expression_first(dst), expression_last(dst));
+    }
+};
+
+template <typename T>
+row_broadcast<T> broadcast_row(const T* data, std::size_t width)
+{ return row_broadcast<T>(data, width); }
+
+template <typename T, typename A>
+row_broadcast<T> broadcast_row(const std::vector<T, A>& v)
+{ return row_broadcast<T>(v.data(), v.size()); }
+
+template <typename T>
+column_broadcast<T> broadcast_column(const T* data, std::size_t height)
+{ return column_broadcast<T>(data, height); }
+
+template <typename T, typename A>
+column_broadcast<T> broadcast_column(const std::vector<T, A>& v)
+{ return column_broadcast<T>(v.data(), v.size()); }
+
+
+//Elementwise operations. apply computes one element, packet a register of
+//them. Comparisons have no packet form.
+
+struct negate_op
+{
+    static constexpr bool vectorizable = true;
+
+    template <typename A>
+    static A apply(const A& a) { return -a; }
+
+    template <typename T>
+    static typename simd<T>::type packet(typename simd<T>::type a) { return simd<T>::neg(a); }
+};
+
+struct abs_op
+{
+    static constexpr bool vectorizable = true;
+
+    template <typename A>
+    static A apply(const A& a) { using std::abs; return abs(a); }
+
+    template <typename T>
+    static typename simd<T>::type packet(typename simd<T>::type a) { return simd<T>::abs(a); }
+};
+
+struct sqrt_op
+{
+    static constexpr bool vectorizable = true;
+
+    template <typename A>
+    static A apply(const A& a) { using std::sqrt; return sqrt(a); }
+
+    template <typename T>
+    static typename simd<T>::type packet(typename simd<T>::type a) { return simd<T>::sqrt(a); }
+};
+
+#define ARRAY2D_EXPR_ARITHMETIC_OP(NAME, EXPR, PACKET)                          \
+    struct NAME                                                                 \
+    {                                                                           \
+        static constexpr bool vectorizable = true;                              \
+                                                                                \
+        template <typename A, typename B>                                       \
+        struct result { typedef typename std::common_type<A, B>::type type; }; \
+                                                                                \
+        template <typename A>                                                   \
+        static A apply(const A& a, const A& b) { return EXPR; }                 \
+                                                                                \
+        template <typename T>                                                   \
+        static typename simd<T>::type packet(typename simd<T>::type a,          \
+                                             typename simd<T>::type b)          \
+        { return simd<T>::PACKET(a, b); }                                       \
+    };
+
+ARRAY2D_EXPR_ARITHMETIC_OP(plus_op, a + b, add)
+ARRAY2D_EXPR_ARITHMETIC_OP(minus_op, a - b, sub)
+ARRAY2D_EXPR_ARITHMETIC_OP(multiplies_op, a * b, mul)
+ARRAY2D_EXPR_ARITHMETIC_OP(divides_op, a / b, div)
+ARRAY2D_EXPR_ARITHMETIC_OP(min_op, b < a ? b : a, min)
+ARRAY2D_EXPR_ARITHMETIC_OP(max_op, a < b ? b : a, max)
+
+#undef ARRAY2D_EXPR_ARITHMETIC_OP
+
+#define ARRAY2D_EXPR_COMPARISON_OP(NAME, OP)                                    \
+    struct NAME                                                                 \
+    {                                                                           \
+        static constexpr bool vectorizable = false;                             \
+                                                                                \
+        template <typename A, typename B>                                       \
+        struct result { typedef bool type; };                                   \
+                                                                                \
+        template <typename A>                                                   \
+        static bool apply(const A& a, const A& b) { return a OP b; }            \
+    };
+
+ARRAY2D_EXPR_COMPARISON_OP(equal_op, ==)
+ARRAY2D_EXPR_COMPARISON_OP(not_equal_op, !=)
+ARRAY2D_EXPR_COMPARISON_OP(less_op, <)
+ARRAY2D_EXPR_COMPARISON_OP(less_equal_op, <=)
+ARRAY2D_EXPR_COMPARISON_OP(greater_op, >)
+ARRAY2D_EXPR_COMPARISON_OP(greater_equal_op, >=)
+
+#undef ARRAY2D_EXPR_COMPARISON_OP
+
+
+template <typename Op, typename E>
+class unary_expression : public array2d_expression<unary_expression<Op, E> >
+{
+  public:
+    typedef typename E::value_type value_type;
+
+    static constexpr bool vectorizable = Op::vectorizable && E::vectorizable;
+
+  private:
+    E m_e;
+
+  public:
+    explicit unary_expression(const E& e) : m_e(e) { }
+
+    std::size_t width() const { return m_e.width(); }
+    std::size_t height() const { return m_e.height(); }
+
+    value_type operator()(std::size_t x, std::size_t y) const
+    { return Op::apply(m_e(x, y)); }
+
+    typename simd<value_type>::type packet(std::size_t x, std::size_t y) const
+    { return Op::template packet<value_type>(m_e.packet(x, y)); }
+
+    template <typename Dst>
+    bool aliases(const Dst& dst) const { return m_e.aliases(dst); }
+};
+
+//Operands are converted to the common type of their elements before the
+//operation. Only operations whose operands already have the same element type
+//are vectorized. Operands must be the same size, apart from the axes they are
+//broadcast along, or std::invalid_argument is thrown.
+template <typename Op, typename L, typename R>
+class binary_expression : public array2d_expression<binary_expression<Op, L, R> >
+{
+  public:
+    typedef typename std::common_type<typename L::value_type,
+                                      typename R::value_type>::type operand_type;
+    typedef typename Op::template result<typename L::value_type,
+                                         typename R::value_type>::type value_type;
+
+    static constexpr bool vectorizable =
+        Op::vectorizable && L::vectorizable && R::vectorizable &&
+        std::is_same<typename L::value_type, value_type>::value &&
+        std::is_same<typename R::value_type, value_type>::value;
+
+  private:
+    L m_l;
+    R m_r;
+
+  public:
+    binary_expression(const L& l, const R& r) : m_l(l), m_r(r)
+    {
+        if ((l.width() != 0 && r.width() != 0 && l.width() != r.width()) ||
+            (l.height() != 0 && r.height() != 0 && l.height() != r.height()))
+            throw std::invalid_argument("expression operands differ in size");
+    }
+
+    std::size_t width() const
+    { return m_l.width() != 0 ? m_l.width() : m_r.width(); }
+    std::size_t height() const
+    { return m_l.height() != 0 ? m_l.height() : m_r.height(); }
+
+    value_type operator()(std::size_t x, std::size_t y) const
+    {
+        return Op::apply(static_cast<operand_type>(m_l(x, y)),
+                         static_cast<operand_type>(m_r(x, y)));
+    }
+
+    typename simd<value_type>::type packet(std::size_t x, std::size_t y) const
+    { return Op::template packet<value_type>(m_l.packet(x, y), m_r.packet(x, y)); }
+
+    template <typename Dst>
+    bool aliases(const Dst& dst) const { return m_l.aliases(dst) || m_r.aliases(dst); }
+};
+
+
+//How each kind of operand enters an expression. Expressions are themselves,
+//and grids are wrapped in a grid_expression. Other types have no member type
+//and can't be operands.
+template <typename X, bool = std::is_base_of<array2d_expression<X>, X>::value>
+struct expression_of { };
+
+template <typename X>
+struct expression_of<X, true>
+{
+    typedef X type;
+    static const X& make(const X& x) { return x; }
+};
+
+template <typename T, typename A, std::size_t R, typename Layout>
+struct expression_of<array2d<T, A, R, Layout>, false>
+{
+    typedef grid_expression<array2d<T, A, R, Layout> > type;
+    static type make(const array2d<T, A, R, Layout>& a) { return type(a); }
+};
+
+template <typename T, std::size_t W, std::size_t H, typename Layout>
+struct expression_of<static_array2d<T, W, H, Layout>, false>
+{
+    typedef grid_expression<static_array2d<T, W, H, Layout> > type;
+    static type make(const static_array2d<T, W, H, Layout>& a) { return type(a); }
+};
+
+template <typename T, typename Layout>
+struct expression_of<array2d_view<T, Layout>, false>
+{
+    typedef grid_expression<array2d_view<T, Layout> > type;
+    static type make(const array2d_view<T, Layout>& a) { return type(a); }
+};
+
+template <typename X>
+struct expression_void { typedef void type; };
+
+template <typename X, typename = void>
+struct is_expression_operand : std::false_type { };
+
+template <typename X>
+struct is_expression_operand<X, typename expression_void<typename expression_of<X>::type>::type>
+    : std::true_type { };
+
+//The expression for Op applied to l and r, where at least one is a grid or an
+//expression and the other may be an arithmetic scalar, which takes the
+//element type of the other side. Other combinations have no member type, so
+//the operators below don't apply to them.
+template <typename Op, typename L, typename R, typename = void>
+struct make_binary { };
+
+template <typename Op, typename L, typename R>
+struct make_binary<Op, L, R, typename std::enable_if<
+    is_expression_operand<L>::value && is_expression_operand<R>::value>::type>
+{
+    typedef binary_expression<Op, typename expression_of<L>::type,
+                              typename expression_of<R>::type> type;
+
+    static type make(const L& l, const R& r)
+    { return type(expression_of<L>::make(l), expression_of<R>::make(r)); }
+};
+
+template <typename Op, typename L, typename R>
+struct make_binary<Op, L, R, typename std::enable_if<
+    is_expression_operand<L>::value && std::is_arithmetic<R>::value>::type>
+{
+    typedef typename expression_of<L>::type left;
+    typedef scalar_expression<typename left::value_type> right;
+    typedef binary_expression<Op, left, right> type;
+
+    static type make(const L& l, const R& r)
+    { return type(expression_of<L>::make(l), right(static_cast<typename left::value_type>(r))); }
+};
+
+template <typename Op, typename L, typename R>
+struct make_binary<Op, L, R, typename std::enable_if<
+    std::is_arithmetic<L>::value && is_expression_operand<R>::value>::type>
+{
+    typedef typename expression_of<R>::type right;
+    typedef scalar_expression<typename right::value_type> left;
+    typedef binary_expression<Op, left, right> type;
+
+    static type make(const L& l, const R& r)
+    { return type(left(static_cast<typename right::value_type>(l)), expression_of<R>::make(r)); }
+};
+
+template <typename Op, typename X, typename = void>
+struct make_unary { };
+
+template <typename Op, typename X>
+struct make_unary<Op, X, typename std::enable_if<is_expression_operand<X>::value>::type>
+{
+    typedef unary_expression<Op, typename expression_of<X>::type> type;
+
+    static type make(const X& x) { return type(expression_of<X>::make(x)); }
+};
+
+
+#define ARRAY2D_EXPR_BINARY_FUNCTION(NAME, OP)                                  \
+    template <typename L, typename R>                                           \
+    typename make_binary<OP, L, R>::type NAME(const L& l, const R& r)           \
+    { return make_binary<OP, L, R>::make(l, r); }
+
+ARRAY2D_EXPR_BINARY_FUNCTION(operator+, plus_op)
+ARRAY2D_EXPR_BINARY_FUNCTION(operator-, minus_op)
+ARRAY2D_EXPR_BINARY_FUNCTION(operator*, multiplies_op)
+ARRAY2D_EXPR_BINARY_FUNCTION(operator/, divides_op)
+ARRAY2D_EXPR_BINARY_FUNCTION(operator==, equal_op)
+ARRAY2D_EXPR_BINARY_FUNCTION(operator!=, not_equal_op)
+ARRAY2D_EXPR_BINARY_FUNCTION(operator<, less_op)
+ARRAY2D_EXPR_BINARY_FUNCTION(operator<=, less_equal_op)
+ARRAY2D_EXPR_BINARY_FUNCTION(operator>, greater_op)
+ARRAY2D_EXPR_BINARY_FUNCTION(operator>=, greater_equal_op)
+ARRAY2D_EXPR_BINARY_FUNCTION(min, min_op)
+ARRAY2D_EXPR_BINARY_FUNCTION(max, max_op)
+
+#undef ARRAY2D_EXPR_BINARY_FUNCTION
+
+#define ARRAY2D_EXPR_UNARY_FUNCTION(NAME, OP)                                   \
+    template <typename X>                                                       \
+    typename make_unary<OP, X>::type NAME(const X& x)                           \
+    { return make_unary<OP, X>::make(x); }
+
+ARRAY2D_EXPR_UNARY_FUNCTION(operator-, negate_op)
+ARRAY2D_EXPR_UNARY_FUNCTION(abs, abs_op)
+ARRAY2D_EXPR_UNARY_FUNCTION(sqrt, sqrt_op)
+
+#undef ARRAY2D_EXPR_UNARY_FUNCTION
+
+
+//row_major destinations of the expression's own element type are written a
+//register at a time, with the elements past the last whole register at the
+//end of each row done one by one
+template <typename Grid, typename E>
+void evaluate_rows(Grid& dst, const E& e, std::true_type)
+{
+    typedef simd<typename E::value_type> packet;
+
+    const std::size_t width = array2d_width(dst);
+    const std::size_t height = array2d_height(dst);
+    const std::size_t pitch = array2d_pitch(dst);
+    typename Grid::value_type* data = dst.data();
+    for (std::size_t y = 0; y < height; ++y)
+    {
+        typename Grid::value_type* row = data + y * pitch;
+        std::size_t x = 0;
+        for (; x + packet::width <= width; x += packet::width)
+            packet::store(row + x, e.packet(x, y));
+        for (; x < width; ++x)
+            row[x] = e(x, y);
+    }
+}
+
+template <typename Grid, typename E>
+void evaluate_rows(Grid& dst, const E& e, std::false_type)
+{
+    typedef typename Grid::value_type value_type;
+
+    const std::size_t width = array2d_width(dst);
+    const std::size_t height = array2d_height(dst);
+    for (std::size_t y = 0; y < height; ++y)
+    {
+        auto out = dst.row_begin(y);
+        for (std::size_t x = 0; x < width; ++x, ++out)
+            *out = static_cast<value_type>(e(x, y));
+    }
+}
+
+template <typename Grid, typename E>
+void evaluate_rows(Grid& dst, const E& e)
+{
+    evaluate_rows(dst, e, std::integral_constant<bool,
+        E::vectorizable &&
+        std::is_same<typename Grid::layout_type, row_major>::value &&
+        std::is_same<typename Grid::value_type, typename E::value_type>::value>());
+}
+
+//dst(x, y) = e(x, y) for every element of dst, in one pass. The dimensions of
+//e must match dst, apart from those of broadcast operands, or
+//std::invalid_argument is thrown. An operand may be dst itself, as in
+//a = a * 2. When an operand shares dst's memory any other way, such as a
+//transposed or shifted view of it, e is evaluated into a temporary grid that
+//is then copied to dst, so that no element is read after it is written.
+template <typename Grid, typename E>
+void evaluate(Grid& dst, const array2d_expression<E>& e)
+{
+    const E& self = e.self();
+    const std::size_t width = array2d_width(dst);
+    const std::size_t height = array2d_height(dst);
+    if ((self.width() != 0 && self.width() != width) ||
+        (self.height() != 0 && self.height() != height))
+        throw std::invalid_argument("expression dimensions don't match the destination");
+
+    if (!self.aliases(dst))
+    {
+        evaluate_rows(dst, self);
+        return;
+    }
+
+    array2d<typename Grid::value_type> tmp(width, height);
+    evaluate_rows(tmp, self);
+    for (std::size_t y = 0; y < height; ++y)
+        std::copy(tmp.row_begin(y), tmp.row_end(y), dst.row_begin(y));
+}
+
+//so that a view can be the target of a temporary, as in
+//evaluate(array2d_view<T>(a).subview(...), e)
+template <typename T, typename Layout, typename E>
+void evaluate(array2d_view<T, Layout>&& dst, const array2d_expression<E>& e)
+{
+    evaluate(dst, e);
+}
+
+
+//compound assignment of a grid, e.g. a += b * 2
+#define ARRAY2D_EXPR_COMPOUND_ASSIGNMENT(NAME, OP)                              \
+    template <typename Grid, typename R>                                        \
+    typename std::enable_if<                                                    \
+        !std::is_base_of<array2d_expression<Grid>, Grid>::value,                \
+        typename std::conditional<false, typename make_binary<OP, Grid, R>::type, \
+                                  Grid&>::type                                  \
+    >::type NAME(Grid& a, const R& r)                                           \
+    {                                                                           \
+        evaluate(a, make_binary<OP, Grid, R>::make(a, r));                      \
+        return a;                                                               \
+    }
+
+ARRAY2D_EXPR_COMPOUND_ASSIGNMENT(operator+=, plus_op)
+ARRAY2D_EXPR_COMPOUND_ASSIGNMENT(operator-=, minus_op)
+ARRAY2D_EXPR_COMPOUND_ASSIGNMENT(operator*=, multiplies_op)
+ARRAY2D_EXPR_COMPOUND_ASSIGNMENT(operator/=, divides_op)
+
+#undef ARRAY2D_EXPR_COMPOUND_ASSIGNMENT
+
+
+//whether e is true at every position, or at any
+template <typename E>
+bool all(const array2d_expression<E>& e)
+{
+    const E& self = e.self();
+    for (std::size_t y = 0; y < self.height(); ++y)
+    {
+        for (std::size_t x = 0; x < self.width(); ++x)
+        {
+            if (!self(x, y))
+                return false;
+        }
+    }
+    return true;
+}
+
+template <typename E>
+bool any(const array2d_expression<E>& e)
+{
+    const E& self = e.self();
+    for (std::size_t y = 0; y < self.height(); ++y)
+    {
+        for (std::size_t x = 0; x < self.width(); ++x)
+        {
+            if (self(x, y))
+                return true;
+        }
+    }
+    return false;
+}
+
+} //array2d
+
+#endif //ARRAY2D_EXPR_H
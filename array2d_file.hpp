@@ -0,0 +1,659 @@
+/*
+ array2d_file.hpp - A binary file format for grids, memory mapped access to
+                    it, and a writer that streams rows into it.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#ifndef ARRAY2D_FILE_H
+#define ARRAY2D_FILE_H
+
+#include "array2d.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace array2d
+{
+
+//The file format. A file is a 64 byte header, padded with zeros out to
+//data_offset, followed by height rows (or width columns for column_major) of
+//pitch elements each, or for a tiled layout the tiles one after another. Padding
+//elements are zero. Every
+//field, and the elements, are in the byte order of the machine that wrote the
+//file, which byte_order identifies.
+//
+//  offset  size  field
+//       0     8  magic, "ARRAY2D" and a zero byte
+//       8     4  version, 1
+//      12     4  byte_order, 0x01020304 as written by the writer
+//      16     4  type_tag, see array2d_type_tag
+//      20     4  layout, see array2d_file_layout
+//      24     8  width
+//      32     8  height
+//      40     8  pitch, in elements
+//      48     8  data_offset, in bytes from the start of the file
+//      56     8  checksum of the data, see array2d_checksum
+struct array2d_file_header
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byte_order;
+    std::uint32_t type_tag;
+    std::uint32_t layout;
+    std::uint64_t width;
+    std::uint64_t height;
+    std::uint64_t pitch;
+    std::uint64_t data_offset;
+    std::uint64_t checksum;
+};
+
+static_assert(sizeof(array2d_file_header) == 64, "the header must be 64 bytes");
+
+//data starts on a page boundary, so mapped rows are as aligned as in memory
+constexpr std::size_t array2d_file_data_offset = 4096;
+
+constexpr std::uint32_t array2d_file_version = 1;
+constexpr std::uint32_t array2d_file_byte_order = 0x01020304;
+
+//Identifies the element type of a file: the kind in the top byte (1 for
+//signed integers, 2 for unsigned integers and bool, 3 for floating point and
+//0 for anything else) and sizeof(T) below it.
+template <typename T>
+struct array2d_type_tag
+{
+    static constexpr std::uint32_t kind =
+        std::is_floating_point<T>::value ? 3 :
+        std::is_integral<T>::value ? (std::is_signed<T>::value ? 1 : 2) : 0;
+
+    static constexpr std::uint32_t value =
+        (kind << 24) | static_cast<std::uint32_t>(sizeof(T) & 0xFFFFFF);
+};
+
+constexpr std::uint32_t array2d_file_log2(std::size_t v)
+{ return v <= 1 ? 0 : 1 + array2d_file_log2(v / 2); }
+
+//Identifies the layout of a file: 0 for row_major, 1 for column_major and 2
+//for tiled, with the log2 of the tile width in bits 8 to 15 and of the tile
+//height in bits 16 to 23.
+template <typename Layout>
+struct array2d_file_layout;
+
+template <>
+struct array2d_file_layout<row_major>
+{
+    static constexpr std::uint32_t value = 0;
+};
+
+template <>
+struct array2d_file_layout<column_major>
+{
+    static constexpr std::uint32_t value = 1;
+};
+
+template <std::size_t TileWidth, std::size_t TileHeight>
+struct array2d_file_layout<tiled<TileWidth, TileHeight> >
+{
+    static constexpr std::uint32_t value =
+        2 | (array2d_file_log2(TileWidth) << 8) | (array2d_file_log2(TileHeight) << 16);
+};
+
+
+//FNV-1a applied to the data 8 bytes at a time, each 8 bytes read as a word in
+//the file's byte order. A final partial word is padded with zero bytes. Data
+//may be given in pieces of any size.
+class array2d_checksum
+{
+  private:
+    std::uint64_t m_hash;
+    unsigned char m_tail[8];
+    std::size_t m_tail_size;
+
+    static constexpr std::uint64_t prime = 1099511628211ull;
+
+  public:
+    array2d_checksum() : m_hash(14695981039346656037ull), m_tail(), m_tail_size(0) { }
+
+    void update(const void* data, std::size_t size)
+    {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        if (m_tail_size != 0)
+        {
+            const std::size_t n = std::min(size, sizeof(m_tail) - m_tail_size);
+            std::memcpy(m_tail + m_tail_size, p, n);
+            m_tail_size += n;
+            p += n;
+            size -= n;
+            if (m_tail_size < sizeof(m_tail))
+                return;
+            mix(m_tail);
+            m_tail_size = 0;
+        }
+
+        for (; size >= 8; p += 8, size -= 8)
+            mix(p);
+
+        std::memcpy(m_tail, p, size);
+        m_tail_size = size;
+    }
+
+    std::uint64_t value() const
+    {
+        if (m_tail_size == 0)
+            return m_hash;
+        array2d_checksum c(*this);
+        std::memset(c.m_tail + c.m_tail_size, 0, sizeof(m_tail) - c.m_tail_size);
+        c.mix(c.m_tail);
+        return c.m_hash;
+    }
+
+  private:
+    void mix(const unsigned char* p)
+    {
+        std::uint64_t w;
+        std::memcpy(&w, p, sizeof(w));
+        m_hash = (m_hash ^ w) * prime;
+    }
+};
+
+//the checksum of size zero bytes
+inline std::uint64_t array2d_zero_checksum(std::size_t size)
+{
+    array2d_checksum c;
+    const unsigned char zeros[4096] = { };
+    for (; size >= sizeof(zeros); size -= sizeof(zeros))
+        c.update(zeros, sizeof(zeros));
+    c.update(zeros, size);
+    return c.value();
+}
+
+
+inline std::system_error array2d_file_error(const std::string& what)
+{ return std::system_error(errno, std::generic_category(), what); }
+
+//Checks that header describes a file of T with the given layout that can be
+//used on this machine, throwing std::runtime_error if not.
+template <typename T, typename Layout>
+void check_array2d_header(const array2d_file_header& header, std::uint64_t file_size)
+{
+    if (std::memcmp(header.magic, "ARRAY2D", 8) != 0)
+        throw std::runtime_error("not an array2d file");
+    if (header.byte_order != array2d_file_byte_order)
+        throw std::runtime_error("array2d file has a different byte order");
+    if (header.version != array2d_file_version)
+        throw std::runtime_error("unsupported array2d file version");
+    if (header.type_tag != array2d_type_tag<T>::value)
+        throw std::runtime_error("array2d file has a different element type");
+    if (header.layout != array2d_file_layout<Layout>::value)
+        throw std::runtime_error("array2d file has a different layout");
+
+    const std::uint64_t pitch = Layout::pitch(header.width, header.height, 1);
+    const std::uint64_t rows = Layout::storage_size(header.width, header.height, 1);
+    if (header.pitch < pitch || header.data_offset < sizeof(array2d_file_header) ||
+        header.data_offset > file_size ||
+        header.data_offset % alignof(T) != 0 ||
+        (file_size - header.data_offset) / sizeof(T) / std::max<std::uint64_t>(header.pitch, 1) < rows)
+    {
+        throw std::runtime_error("array2d file is truncated or corrupt");
+    }
+}
+
+template <typename T, typename Layout>
+array2d_file_header make_array2d_header(std::size_t width, std::size_t height, std::size_t pitch)
+{
+    array2d_file_header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "ARRAY2D", 8);
+    header.version = array2d_file_version;
+    header.byte_order = array2d_file_byte_order;
+    header.type_tag = array2d_type_tag<T>::value;
+    header.layout = array2d_file_layout<Layout>::value;
+    header.width = width;
+    header.height = height;
+    header.pitch = pitch;
+    header.data_offset = array2d_file_data_offset;
+    header.checksum = array2d_checksum().value();
+    return header;
+}
+
+//the header of the file at path, for inspecting a file of unknown type
+inline array2d_file_header read_array2d_header(const std::string& path)
+{
+    std::ifstream in(path.c_str(), std::ios::binary);
+    array2d_file_header header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)))
+        throw std::runtime_error("can't read array2d header from " + path);
+    return header;
+}
+
+
+//A grid stored in an array2d file, accessed in place through a shared memory
+//mapping of the file, so nothing is read until it is touched. Like
+//array2d_view its accessors are all const; mapped_array2d<const T> maps the
+//file read only, mapped_array2d<T> read write, with writes going straight to
+//the file. Layout must be row_major or column_major and match the file.
+//
+//Writes leave the checksum in the header stale, so read_array2d() rejects the
+//file until the checksum is stored again by sync() or by the destructor of a
+//read write grid, which reads the whole grid to do it. The destructor only
+//does so if the grid may have been written to: if an element was accessed
+//since the last sync(), or if data(), view() or an iterator was ever taken,
+//since writes through those can't be seen.
+template <typename T, typename Layout = row_major>
+class mapped_array2d
+{
+  public:
+    typedef array2d_view<T, Layout> view_type;
+
+    typedef typename view_type::value_type            value_type;
+    typedef Layout                                    layout_type;
+    typedef typename view_type::pointer               pointer;
+    typedef typename view_type::const_pointer         const_pointer;
+    typedef typename view_type::reference             reference;
+    typedef typename view_type::const_reference       const_reference;
+    typedef typename view_type::size_type             size_type;
+    typedef typename view_type::difference_type       difference_type;
+    typedef typename view_type::iterator              iterator;
+    typedef typename view_type::const_iterator        const_iterator;
+    typedef typename view_type::row_iterator          row_iterator;
+    typedef typename view_type::const_row_iterator    const_row_iterator;
+    typedef typename view_type::column_iterator       column_iterator;
+    typedef typename view_type::const_column_iterator const_column_iterator;
+
+    static_assert(std::is_trivially_copyable<value_type>::value,
+                  "only trivially copyable types can be mapped");
+
+    static constexpr bool writable = !std::is_const<T>::value;
+
+  private:
+    unsigned char* m_map;
+    std::size_t m_map_size;
+    view_type m_view;
+
+    //whether an element may have been written to since the checksum was last
+    //stored, and whether mutable access outlives the call that gave it out
+    mutable bool m_unsynced;
+    mutable bool m_exposed;
+
+  public:
+    //maps an existing file
+    explicit mapped_array2d(const std::string& path)
+        : m_map(nullptr), m_map_size(0), m_view(), m_unsynced(false), m_exposed(false)
+    {
+        const int fd = ::open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+        if (fd < 0)
+            throw array2d_file_error("can't open " + path);
+
+        try
+        {
+            struct stat st;
+            if (::fstat(fd, &st) != 0)
+                throw array2d_file_error("can't stat " + path);
+            const std::uint64_t file_size = static_cast<std::uint64_t>(st.st_size);
+
+            array2d_file_header header;
+            if (file_size < sizeof(header) ||
+                ::pread(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)))
+            {
+                throw std::runtime_error("can't read array2d header from " + path);
+            }
+            check_array2d_header<value_type, Layout>(header, file_size);
+
+            map(fd, static_cast<std::size_t>(file_size), header);
+        }
+        catch (...)
+        {
+            ::close(fd);
+            throw;
+        }
+        ::close(fd);
+    }
+
+    //creates (or replaces) the file at path with a zeroed width by height grid
+    //and maps it. Rows (or columns) are padded so that each starts on a
+    //row_align byte boundary.
+    static mapped_array2d create(const std::string& path, size_type width, size_type height,
+                                 size_type row_align = alignof(value_type))
+    {
+        static_assert(writable, "a read only grid can't create a file");
+
+        const size_type multiple = row_align / array2d_gcd(row_align, sizeof(value_type));
+        const size_type pitch = Layout::pitch(width, height, multiple);
+        const size_type data_size =
+            Layout::major_extent(width, height) * pitch * sizeof(value_type);
+        const size_type file_size = array2d_file_data_offset + data_size;
+
+        array2d_file_header header = make_array2d_header<value_type, Layout>(width, height, pitch);
+        header.checksum = array2d_zero_checksum(data_size);
+
+        const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0666);
+        if (fd < 0)
+            throw array2d_file_error("can't create " + path);
+
+        mapped_array2d m;
+        try
+        {
+            if (::ftruncate(fd, static_cast<off_t>(file_size)) != 0)
+                throw array2d_file_error("can't size " + path);
+            if (::pwrite(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)))
+                throw array2d_file_error("can't write " + path);
+            m.map(fd, file_size, header);
+        }
+        catch (...)
+        {
+            ::close(fd);
+            throw;
+        }
+        ::close(fd);
+        return m;
+    }
+
+    mapped_array2d(mapped_array2d&& o)
+        : m_map(o.m_map), m_map_size(o.m_map_size), m_view(o.m_view),
+          m_unsynced(o.m_unsynced), m_exposed(o.m_exposed)
+    {
+        o.m_map = nullptr;
+        o.m_map_size = 0;
+        o.m_view = view_type();
+    }
+
+    mapped_array2d& operator=(mapped_array2d&& o)
+    {
+        std::swap(m_map, o.m_map);
+        std::swap(m_map_size, o.m_map_size);
+        std::swap(m_view, o.m_view);
+        std::swap(m_unsynced, o.m_unsynced);
+        std::swap(m_exposed, o.m_exposed);
+        return *this;
+    }
+
+    mapped_array2d(const mapped_array2d&) = delete;
+    mapped_array2d& operator=(const mapped_array2d&) = delete;
+
+    //a read write grid that may have been written to since the last sync()
+    //syncs first, ignoring any errors; call sync() first to see them
+    ~mapped_array2d()
+    {
+        if (m_map == nullptr)
+            return;
+        if (m_unsynced)
+            sync_on_close(std::integral_constant<bool, writable>());
+        ::munmap(m_map, m_map_size);
+    }
+
+    size_type width() const { return m_view.width(); }
+    size_type height() const { return m_view.height(); }
+    size_type pitch() const { return m_view.pitch(); }
+    pointer data() const { return expose(m_view.data()); }
+
+    //the whole grid as a view, e.g. for the algorithms in the other headers
+    view_type view() const { return expose(m_view); }
+
+    const array2d_file_header& header() const
+    { return *reinterpret_cast<const array2d_file_header*>(m_map); }
+
+    //the checksum of the data as it is now, which matches header().checksum
+    //unless the grid has been written to since the last sync()
+    std::uint64_t checksum() const
+    {
+        array2d_checksum c;
+        c.update(m_map + header().data_offset,
+                 Layout::major_extent(width(), height()) * pitch() * sizeof(value_type));
+        return c.value();
+    }
+
+    bool verify() const { return checksum() == header().checksum; }
+
+    //stores the checksum of the data in the header and flushes the mapping to
+    //the file. This reads the whole grid.
+    void sync()
+    {
+        static_assert(writable, "a read only grid can't be synced");
+        if (m_map == nullptr)
+            return;
+        reinterpret_cast<array2d_file_header*>(m_map)->checksum = checksum();
+        if (::msync(m_map, m_map_size, MS_SYNC) != 0)
+            throw array2d_file_error("can't sync mapped array2d");
+        m_unsynced = m_exposed;
+    }
+
+    iterator begin() const { return expose(m_view.begin()); }
+    iterator end() const { return expose(m_view.end()); }
+
+    row_iterator row_begin(size_type y) const { return expose(m_view.row_begin(y)); }
+    row_iterator row_end(size_type y) const { return expose(m_view.row_end(y)); }
+
+    column_iterator column_begin(size_type x) const { return expose(m_view.column_begin(x)); }
+    column_iterator column_end(size_type x) const { return expose(m_view.column_end(x)); }
+
+    reference index(size_type x, size_type y) const
+    {
+        m_unsynced = writable;
+        return m_view.index(x, y);
+    }
+    reference operator()(size_type x, size_type y) const
+    {
+        m_unsynced = writable;
+        return m_view(x, y);
+    }
+
+  private:
+    mapped_array2d()
+        : m_map(nullptr), m_map_size(0), m_view(), m_unsynced(false), m_exposed(false)
+    {
+    }
+
+    //notes that u gives mutable access to the grid for as long as it is kept
+    template <typename U>
+    U expose(U u) const
+    {
+        m_unsynced = writable;
+        m_exposed = writable;
+        return u;
+    }
+
+    void sync_on_close(std::false_type) { }
+
+    void sync_on_close(std::true_type)
+    {
+        try
+        {
+            sync();
+        }
+        catch (...)
+        {
+        }
+    }
+
+    void map(int fd, std::size_t size, const array2d_file_header& header)
+    {
+        void* p = ::mmap(nullptr, size, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                         MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED)
+            throw array2d_file_error("can't map array2d file");
+
+        m_map = static_cast<unsigned char*>(p);
+        m_map_size = size;
+        m_view = view_type(reinterpret_cast<pointer>(m_map + header.data_offset),
+                           static_cast<size_type>(header.width),
+                           static_cast<size_type>(header.height),
+                           static_cast<size_type>(header.pitch));
+    }
+};
+
+
+//Writes a row_major array2d file a row at a time, so that a grid of any
+//height can be written without holding it in memory. The header is written
+//again with the final height and checksum by close(), which the destructor
+//calls if it hasn't been. T must be trivially copyable.
+template <typename T>
+class array2d_writer
+{
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "only trivially copyable types can be written");
+
+  public:
+    typedef T           value_type;
+    typedef std::size_t size_type;
+
+  private:
+    std::ofstream m_out;
+    std::string m_path;
+    size_type m_width;
+    size_type m_pitch;
+    size_type m_height;
+    std::vector<T> m_row;
+    array2d_checksum m_checksum;
+
+  public:
+    //rows are padded so that each starts on a row_align byte boundary
+    array2d_writer(const std::string& path, size_type width,
+                   size_type row_align = alignof(T))
+        : m_out(path.c_str(), std::ios::binary | std::ios::trunc),
+          m_path(path),
+          m_width(width),
+          m_pitch(row_major::pitch(width, 0, row_align / array2d_gcd(row_align, sizeof(T)))),
+          m_height(0),
+          m_row(),
+          m_checksum()
+    {
+        if (!m_out)
+            throw array2d_file_error("can't create " + path);
+
+        //padding elements are written as zero bytes
+        m_row.resize(m_pitch);
+        std::memset(static_cast<void*>(m_row.data()), 0, m_pitch * sizeof(T));
+
+        write_header();
+        const std::vector<char> zeros(array2d_file_data_offset - sizeof(array2d_file_header));
+        write(zeros.data(), zeros.size());
+    }
+
+    ~array2d_writer()
+    {
+        try
+        {
+            close();
+        }
+        catch (...)
+        {
+        }
+    }
+
+    array2d_writer(const array2d_writer&) = delete;
+    array2d_writer& operator=(const array2d_writer&) = delete;
+
+    size_type width() const { return m_width; }
+    size_type pitch() const { return m_pitch; }
+
+    //the number of rows written so far
+    size_type height() const { return m_height; }
+
+    //appends the width elements starting at first
+    template <typename InputIterator>
+    void write_row(InputIterator first)
+    {
+        std::copy_n(first, m_width, m_row.begin());
+        m_checksum.update(m_row.data(), m_pitch * sizeof(T));
+        write(m_row.data(), m_pitch * sizeof(T));
+        ++m_height;
+    }
+
+    //appends every row of a grid of the same width
+    template <typename Grid>
+    void write_rows(const Grid& a)
+    {
+        for (std::size_t y = 0; y < array2d_height(a); ++y)
+            write_row(a.row_begin(y));
+    }
+
+    bool is_open() const { return m_out.is_open(); }
+
+    void close()
+    {
+        if (!m_out.is_open())
+            return;
+        m_out.seekp(0);
+        write_header();
+        m_out.close();
+        if (m_out.fail())
+            throw array2d_file_error("can't write " + m_path);
+    }
+
+  private:
+    void write_header()
+    {
+        array2d_file_header header = make_array2d_header<T, row_major>(m_width, m_height, m_pitch);
+        header.checksum = m_checksum.value();
+        write(&header, sizeof(header));
+    }
+
+    void write(const void* data, std::size_t size)
+    {
+        if (!m_out.write(static_cast<const char*>(data), static_cast<std::streamsize>(size)))
+            throw array2d_file_error("can't write " + m_path);
+    }
+};
+
+
+//writes any grid to an array2d file at path, row by row
+template <typename Grid>
+void write_array2d(const std::string& path, const Grid& a)
+{
+    array2d_writer<typename Grid::value_type> writer(path, array2d_width(a));
+    writer.write_rows(a);
+    writer.close();
+}
+
+//reads a row_major array2d file at path into memory, checking its checksum
+template <typename T>
+array2d<T> read_array2d(const std::string& path)
+{
+    mapped_array2d<const T> m(path);
+    if (!m.verify())
+        throw std::runtime_error("array2d file " + path + " fails its checksum");
+
+    array2d<T> a(m.width(), m.height());
+    for (std::size_t y = 0; y < m.height(); ++y)
+        std::copy(m.row_begin(y), m.row_end(y), a.row_begin(y));
+    return a;
+}
+
+} //array2d
+
+#endif //ARRAY2D_FILE_H
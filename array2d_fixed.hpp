@@ -0,0 +1,190 @@
+/*
+ array2d_fixed.hpp - Kernels over static_array2d unrolled at compile time, so
+                     that a whole small grid can be kept in registers.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#ifndef ARRAY2D_FIXED_H
+#define ARRAY2D_FIXED_H
+
+#include "array2d.hpp"
+
+#include <cstddef>
+#include <type_traits>
+
+namespace array2d
+{
+
+//The sum of f(i) for i in [Begin, Begin + Count), written out in full. It is
+//split in halves, so the additions form a tree rather than a chain.
+template <std::size_t Begin, std::size_t Count>
+struct array2d_unrolled_sum
+{
+    template <typename A, typename F>
+    static constexpr A sum(const F& f)
+    {
+        return array2d_unrolled_sum<Begin, Count / 2>::template sum<A>(f) +
+               array2d_unrolled_sum<Begin + Count / 2, Count - Count / 2>::template sum<A>(f);
+    }
+};
+
+template <std::size_t Begin>
+struct array2d_unrolled_sum<Begin, 1>
+{
+    template <typename A, typename F>
+    static constexpr A sum(const F& f) { return static_cast<A>(f(Begin)); }
+};
+
+template <std::size_t Begin>
+struct array2d_unrolled_sum<Begin, 0>
+{
+    template <typename A, typename F>
+    static constexpr A sum(const F&) { return A(); }
+};
+
+
+//the coordinates of the i'th element in memory of a static_array2d
+template <typename Layout>
+constexpr std::size_t array2d_fixed_x(std::size_t i, std::size_t width, std::size_t height)
+{ return std::is_same<Layout, row_major>::value ? i % width : i / height; }
+
+template <typename Layout>
+constexpr std::size_t array2d_fixed_y(std::size_t i, std::size_t width, std::size_t height)
+{ return std::is_same<Layout, row_major>::value ? i / width : i % height; }
+
+template <typename Grid, typename F, std::size_t... I>
+constexpr Grid array2d_fixed_generate(const F& f, array2d_indices<I...>)
+{
+    return Grid{{
+        static_cast<typename Grid::value_type>(
+            f(array2d_fixed_x<typename Grid::layout_type>(I, Grid::width, Grid::height),
+              array2d_fixed_y<typename Grid::layout_type>(I, Grid::width, Grid::height)))...
+    }};
+}
+
+//A static_array2d whose element at (x, y) is f(x, y), with every element
+//initialized by its own expression. When f is a constexpr function object
+//the result can be a constant expression, even in C++11.
+template <typename T, std::size_t W, std::size_t H, typename Layout = row_major, typename F>
+constexpr static_array2d<T, W, H, Layout> make_static_array2d(const F& f)
+{
+    static_assert(Layout::strided, "only strided layouts can be generated");
+    return array2d_fixed_generate<static_array2d<T, W, H, Layout> >(
+        f, typename array2d_make_indices<W * H>::type());
+}
+
+
+template <typename A, typename Lhs, typename Rhs>
+struct array2d_fixed_product
+{
+    const Lhs& a;
+    const Rhs& b;
+
+    struct term
+    {
+        const Lhs& a;
+        const Rhs& b;
+        std::size_t x;
+        std::size_t y;
+
+        constexpr A operator()(std::size_t k) const
+        { return static_cast<A>(a(k, y)) * static_cast<A>(b(x, k)); }
+    };
+
+    constexpr A operator()(std::size_t x, std::size_t y) const
+    { return array2d_unrolled_sum<0, Lhs::width>::template sum<A>(term{a, b, x, y}); }
+};
+
+//The matrix product of a (K wide and H high) and b (W wide and K high), with
+//x as the column and y as the row. Every multiply and add is written out, so
+//for small sizes such as 4 by 4 the compiler can keep both operands and the
+//result in registers. The sums are accumulated in the common type of the
+//element types and converted to the result's element type with static_cast.
+template <typename T, typename U, std::size_t K, std::size_t H, std::size_t W,
+          typename Layout>
+constexpr static_array2d<typename std::common_type<T, U>::type, W, H, Layout>
+multiply(const static_array2d<T, K, H, Layout>& a, const static_array2d<U, W, K, Layout>& b)
+{
+    typedef typename std::common_type<T, U>::type A;
+    return make_static_array2d<A, W, H, Layout>(
+        array2d_fixed_product<A, static_array2d<T, K, H, Layout>,
+                              static_array2d<U, W, K, Layout> >{a, b});
+}
+
+
+constexpr std::size_t array2d_fixed_clamp(std::size_t v, std::size_t r, std::size_t size)
+{ return v < r ? 0 : v - r >= size ? size - 1 : v - r; }
+
+template <typename A, typename Src, typename Kernel>
+struct array2d_fixed_stencil
+{
+    const Src& src;
+    const Kernel& k;
+
+    struct term
+    {
+        const Src& src;
+        const Kernel& k;
+        std::size_t x;
+        std::size_t y;
+
+        constexpr A operator()(std::size_t t) const
+        {
+            return static_cast<A>(k(t % Kernel::width, t / Kernel::width)) *
+                   static_cast<A>(src(array2d_fixed_clamp(x + t % Kernel::width,
+                                                          Kernel::width / 2, Src::width),
+                                      array2d_fixed_clamp(y + t / Kernel::width,
+                                                          Kernel::height / 2, Src::height)));
+        }
+    };
+
+    constexpr A operator()(std::size_t x, std::size_t y) const
+    {
+        return array2d_unrolled_sum<0, Kernel::width * Kernel::height>::template sum<A>(
+            term{src, k, x, y});
+    }
+};
+
+//dst(x, y) = the sum of k(i, j) * src(x + i - KW / 2, y + j - KH / 2), like
+//convolve in array2d_stencil.hpp with a clamp_boundary, but with the kernel
+//fixed at compile time and every tap of every element written out. Meant
+//for small grids such as a tile of an image, where the whole computation
+//fits in registers. Sums are accumulated in the common type of the element
+//types and converted to T with static_cast.
+template <typename T, std::size_t W, std::size_t H, typename Layout,
+          typename K, std::size_t KW, std::size_t KH, typename KLayout>
+constexpr static_array2d<T, W, H, Layout>
+convolve(const static_array2d<T, W, H, Layout>& src,
+         const static_array2d<K, KW, KH, KLayout>& k)
+{
+    return make_static_array2d<T, W, H, Layout>(
+        array2d_fixed_stencil<typename std::common_type<T, K>::type,
+                              static_array2d<T, W, H, Layout>,
+                              static_array2d<K, KW, KH, KLayout> >{src, k});
+}
+
+} //array2d
+
+#endif //ARRAY2D_FIXED_H
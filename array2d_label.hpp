@@ -0,0 +1,422 @@
+/*
+ array2d_label.hpp - Connected component labeling and flood fill over
+                     array2d, static_array2d and array2d_view.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#ifndef ARRAY2D_LABEL_H
+#define ARRAY2D_LABEL_H
+
+#include "array2d.hpp"
+#include "array2d_parallel.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+namespace array2d
+{
+
+//which neighbors of an element are connected to it
+enum connectivity
+{
+    connect_4 = 4,      //left, right, up and down
+    connect_8 = 8       //and the four diagonals
+};
+
+//The size and bounding box of a connected component. The box is inclusive,
+//(min_x, min_y) and (max_x, max_y) are both in it.
+struct component_stats
+{
+    std::size_t area;
+    std::size_t min_x;
+    std::size_t min_y;
+    std::size_t max_x;
+    std::size_t max_y;
+
+    component_stats() : area(0), min_x(0), min_y(0), max_x(0), max_y(0) { }
+
+    std::size_t width() const { return area == 0 ? 0 : max_x - min_x + 1; }
+    std::size_t height() const { return area == 0 ? 0 : max_y - min_y + 1; }
+
+    //adds the elements [x0, x1] of row y
+    void add_run(std::size_t x0, std::size_t x1, std::size_t y)
+    {
+        if (area == 0)
+        {
+            min_x = x0;
+            min_y = y;
+            max_x = x1;
+            max_y = y;
+        }
+        else
+        {
+            min_x = std::min(min_x, x0);
+            min_y = std::min(min_y, y);
+            max_x = std::max(max_x, x1);
+            max_y = std::max(max_y, y);
+        }
+        area += x1 - x0 + 1;
+    }
+
+    void merge(const component_stats& o)
+    {
+        if (o.area == 0)
+            return;
+        if (area == 0)
+        {
+            *this = o;
+            return;
+        }
+        min_x = std::min(min_x, o.min_x);
+        min_y = std::min(min_y, o.min_y);
+        max_x = std::max(max_x, o.max_x);
+        max_y = std::max(max_y, o.max_y);
+        area += o.area;
+    }
+};
+
+
+//Union find over provisional labels, where every label's parent is no
+//greater than the label itself. Roots are joined by pointing the greater at
+//the lesser, which keeps that true, so resolve() can number the components
+//in one pass in label order.
+class label_forest
+{
+  private:
+    std::vector<std::size_t> m_parent;
+
+  public:
+    std::size_t size() const { return m_parent.size(); }
+
+    std::size_t add()
+    {
+        m_parent.push_back(m_parent.size());
+        return m_parent.size() - 1;
+    }
+
+    //adds o's labels after ours
+    void append(const label_forest& o)
+    {
+        const std::size_t offset = m_parent.size();
+        for (std::size_t i = 0; i < o.m_parent.size(); ++i)
+            m_parent.push_back(o.m_parent[i] + offset);
+    }
+
+    std::size_t find(std::size_t l)
+    {
+        while (m_parent[l] != l)
+        {
+            m_parent[l] = m_parent[m_parent[l]];
+            l = m_parent[l];
+        }
+        return l;
+    }
+
+    //the root of both, once joined
+    std::size_t join(std::size_t a, std::size_t b)
+    {
+        a = find(a);
+        b = find(b);
+        if (a < b)
+            std::swap(a, b);
+        m_parent[a] = b;
+        return b;
+    }
+
+    //Replaces every label's parent with its component's number, counting from
+    //1 in order of each component's lowest label, and returns how many there
+    //are. A parent is resolved before its children since it is never greater.
+    std::size_t resolve()
+    {
+        std::size_t count = 0;
+        for (std::size_t l = 0; l < m_parent.size(); ++l)
+            m_parent[l] = m_parent[l] == l ? ++count : m_parent[m_parent[l]];
+        return count;
+    }
+
+    //after resolve(), the component of label l
+    std::size_t operator[](std::size_t l) const { return m_parent[l]; }
+};
+
+//Labels rows [begin, end) of src into dst by runs of non zero elements,
+//numbering from 1 within the band. Label l is l - 1 in forest and stats. Each
+//run joins the labels of the runs it touches in the row above, and its stats
+//are added to whichever of them is the root.
+template <typename Src, typename Dst>
+void label_band(const Src& src, Dst& dst, std::size_t begin, std::size_t end,
+                connectivity conn, label_forest& forest,
+                std::vector<component_stats>& stats)
+{
+    typedef typename Src::value_type T;
+    typedef typename Dst::value_type L;
+
+    const std::size_t width = array2d_width(src);
+    const std::size_t reach = conn == connect_8 ? 1 : 0;
+
+    for (std::size_t y = begin; y < end; ++y)
+    {
+        auto in = src.row_begin(y);
+        auto out = dst.row_begin(y);
+        std::size_t x = 0;
+        while (x < width)
+        {
+            if (in[x] == T())
+            {
+                out[x] = L();
+                ++x;
+                continue;
+            }
+
+            const std::size_t x0 = x;
+            while (x < width && !(in[x] == T()))
+                ++x;
+            const std::size_t x1 = x - 1;
+
+            std::size_t label = 0;
+            if (y != begin)
+            {
+                auto above = dst.row_begin(y - 1);
+                const std::size_t first = x0 < reach ? 0 : x0 - reach;
+                const std::size_t last = std::min(width - 1, x1 + reach);
+                for (std::size_t i = first; i <= last; ++i)
+                {
+                    const std::size_t a = static_cast<std::size_t>(above[i]);
+                    if (a != 0)
+                        label = 1 + (label == 0 ? forest.find(a - 1)
+                                                : forest.join(label - 1, a - 1));
+                }
+            }
+            if (label == 0)
+            {
+                label = forest.add() + 1;
+                stats.push_back(component_stats());
+            }
+
+            std::fill(out + x0, out + x, static_cast<L>(label));
+            stats[label - 1].add_run(x0, x1, y);
+        }
+    }
+}
+
+//Labels the connected components of the non zero elements of src. dst, which
+//must have src's dimensions, gets 0 for zero elements and a component number
+//from 1 for the rest, numbered in the order their first element is met going
+//row by row. Returns each component's stats, component n at [n - 1].
+//
+//Runs of non zero elements are labeled in bands of rows in parallel, joining
+//each run to the runs it touches in the row above with union find, and
+//collecting stats per run. The labels of neighboring bands are then joined
+//along the seams between them, and a second parallel pass replaces
+//provisional labels with component numbers. The stats are merged from the
+//runs' without another pass over the grid. dst's element type must be able to
+//count the runs in a band as well as the components, an integer at least as
+//wide as the number of elements is always enough. Throws
+//std::invalid_argument if the dimensions differ.
+template <typename Src, typename Dst>
+std::vector<component_stats> label_components(const Src& src, Dst& dst,
+                                              connectivity conn = connect_8,
+                                              chunking c = chunking(),
+                                              thread_pool& pool = default_thread_pool())
+{
+    typedef typename Dst::value_type L;
+
+    const std::size_t width = array2d_width(src);
+    const std::size_t height = array2d_height(src);
+    if (array2d_width(dst) != width || array2d_height(dst) != height)
+        throw std::invalid_argument("grid dimensions don't agree");
+    if (width == 0 || height == 0)
+        return std::vector<component_stats>();
+
+    //each band is one item of the loop, a thread's worth of rows unless the
+    //chunking's grain says otherwise
+    const std::size_t threads = pool.concurrency();
+    const std::size_t rows = c.grain != 0 ? c.grain : (height + threads - 1) / threads;
+    const std::size_t bands = (height + rows - 1) / rows;
+
+    std::vector<label_forest> forests(bands);
+    std::vector<std::vector<component_stats> > band_stats(bands);
+    pool.parallel_for(bands,
+                      [&](std::size_t begin, std::size_t end)
+                      {
+                          for (std::size_t b = begin; b < end; ++b)
+                          {
+                              label_band(src, dst, b * rows, std::min(height, (b + 1) * rows),
+                                         conn, forests[b], band_stats[b]);
+                          }
+                      },
+                      chunking(c.mode, 1));
+
+    //band b's label l is offsets[b] + l - 1 in the forest of the whole grid
+    label_forest forest;
+    std::vector<std::size_t> offsets(bands);
+    for (std::size_t b = 0; b < bands; ++b)
+    {
+        offsets[b] = forest.size();
+        forest.append(forests[b]);
+    }
+
+    const std::size_t reach = conn == connect_8 ? 1 : 0;
+    for (std::size_t b = 1; b < bands; ++b)
+    {
+        const std::size_t y = b * rows;
+        auto above = dst.row_begin(y - 1);
+        auto row = dst.row_begin(y);
+        for (std::size_t x = 0; x < width; ++x)
+        {
+            const std::size_t l = static_cast<std::size_t>(row[x]);
+            if (l == 0)
+                continue;
+            const std::size_t last = std::min(width - 1, x + reach);
+            for (std::size_t i = x < reach ? 0 : x - reach; i <= last; ++i)
+            {
+                const std::size_t a = static_cast<std::size_t>(above[i]);
+                if (a != 0)
+                    forest.join(offsets[b] + l - 1, offsets[b - 1] + a - 1);
+            }
+        }
+    }
+
+    std::vector<component_stats> stats(forest.resolve());
+    for (std::size_t b = 0; b < bands; ++b)
+    {
+        for (std::size_t l = 0; l < band_stats[b].size(); ++l)
+            stats[forest[offsets[b] + l] - 1].merge(band_stats[b][l]);
+    }
+
+    pool.parallel_for(bands,
+                      [&](std::size_t begin, std::size_t end)
+                      {
+                          for (std::size_t b = begin; b < end; ++b)
+                          {
+                              const std::size_t last = std::min(height, (b + 1) * rows);
+                              for (std::size_t y = b * rows; y < last; ++y)
+                              {
+                                  auto out = dst.row_begin(y);
+                                  for (std::size_t x = 0; x < width; ++x, ++out)
+                                  {
+                                      const std::size_t l = static_cast<std::size_t>(*out);
+                                      if (l != 0)
+                                          *out = static_cast<L>(forest[offsets[b] + l - 1]);
+                                  }
+                              }
+                          }
+                      },
+                      chunking(c.mode, 1));
+    return stats;
+}
+
+
+//The scanline fill behind flood_fill. inside(x, y) is whether an element
+//still has to be filled and fill(x, y) fills it, after which it is no longer
+//inside.
+template <typename Inside, typename Fill>
+void flood_fill_runs(std::size_t width, std::size_t height, std::size_t x, std::size_t y,
+                     connectivity conn, component_stats& stats, Inside inside, Fill fill)
+{
+    struct seed { std::size_t x, y; };
+
+    const std::size_t reach = conn == connect_8 ? 1 : 0;
+    std::vector<seed> seeds;
+    seeds.push_back(seed{ x, y });
+    while (!seeds.empty())
+    {
+        const seed s = seeds.back();
+        seeds.pop_back();
+        if (!inside(s.x, s.y))
+            continue;
+
+        std::size_t x0 = s.x;
+        while (x0 > 0 && inside(x0 - 1, s.y))
+            --x0;
+        std::size_t x1 = s.x;
+        while (x1 + 1 < width && inside(x1 + 1, s.y))
+            ++x1;
+        for (std::size_t i = x0; i <= x1; ++i)
+            fill(i, s.y);
+        stats.add_run(x0, x1, s.y);
+
+        const std::size_t first = x0 < reach ? 0 : x0 - reach;
+        const std::size_t last = std::min(width - 1, x1 + reach);
+        for (int d = -1; d <= 1; d += 2)
+        {
+            if ((d < 0 && s.y == 0) || (d > 0 && s.y + 1 == height))
+                continue;
+            const std::size_t row = d < 0 ? s.y - 1 : s.y + 1;
+            bool run = false;
+            for (std::size_t i = first; i <= last; ++i)
+            {
+                const bool in = inside(i, row);
+                if (in && !run)
+                    seeds.push_back(seed{ i, row });
+                run = in;
+            }
+        }
+    }
+}
+
+//Fills the region of (x, y) with value, where the region is every element
+//equal to a(x, y) that is connected to it, and returns its stats. The fill
+//works a row at a time from a stack of seeds kept on the heap, so any region
+//can be filled. Each seed is widened to the whole run of matching elements
+//on its row, which is filled, and the rows above and below get a seed at the
+//start of every matching run next to it. When a(x, y) already equals value
+//nothing changes, but the region is still measured, using a grid of flags
+//to remember where it has been.
+template <typename Grid>
+component_stats flood_fill(Grid& a, std::size_t x, std::size_t y,
+                           const typename Grid::value_type& value,
+                           connectivity conn = connect_4)
+{
+    typedef typename Grid::value_type T;
+
+    const std::size_t width = array2d_width(a);
+    const std::size_t height = array2d_height(a);
+    if (x >= width || y >= height)
+        throw std::out_of_range("flood_fill seed is outside the grid");
+
+    const T old = a.index(x, y);
+    component_stats stats;
+    if (old == value)
+    {
+        array2d<unsigned char> seen(width, height, static_cast<unsigned char>(0));
+        flood_fill_runs(width, height, x, y, conn, stats,
+                        [&](std::size_t i, std::size_t j)
+                        { return !seen.index(i, j) && a.index(i, j) == old; },
+                        [&](std::size_t i, std::size_t j) { seen.index(i, j) = 1; });
+    }
+    else
+    {
+        flood_fill_runs(width, height, x, y, conn, stats,
+                        [&](std::size_t i, std::size_t j) { return a.index(i, j) == old; },
+                        [&](std::size_t i, std::size_t j) { a.index(i, j) = value; });
+    }
+    return stats;
+}
+
+} //array2d
+
+#endif //ARRAY2D_LABEL_H
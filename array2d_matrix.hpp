@@ -0,0 +1,532 @@
+/*
+ array2d_matrix.hpp - Matrix products of array2d, static_array2d and
+                      array2d_view, blocked for the caches and run on a
+                      thread pool.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#ifndef ARRAY2D_MATRIX_H
+#define ARRAY2D_MATRIX_H
+
+#include "array2d.hpp"
+#include "array2d_expr.hpp"
+#include "array2d_fixed.hpp"
+#include "array2d_parallel.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace array2d
+{
+
+//Grids are matrices with x as the column and y as the row, so the product of
+//a (K wide and M high) and b (N wide and K high) is N wide and M high.
+
+//a * b + c, fused into one instruction when the target has FMA
+template <typename T>
+typename simd<T>::type gemm_fma(typename simd<T>::type a, typename simd<T>::type b,
+                                typename simd<T>::type c)
+{ return simd<T>::add(simd<T>::mul(a, b), c); }
+
+#if defined(__AVX512F__)
+
+template <>
+inline __m512 gemm_fma<float>(__m512 a, __m512 b, __m512 c) { return _mm512_fmadd_ps(a, b, c); }
+
+template <>
+inline __m512d gemm_fma<double>(__m512d a, __m512d b, __m512d c)
+{ return _mm512_fmadd_pd(a, b, c); }
+
+#elif defined(__AVX__) && defined(__FMA__)
+
+template <>
+inline __m256 gemm_fma<float>(__m256 a, __m256 b, __m256 c) { return _mm256_fmadd_ps(a, b, c); }
+
+template <>
+inline __m256d gemm_fma<double>(__m256d a, __m256d b, __m256d c)
+{ return _mm256_fmadd_pd(a, b, c); }
+
+#endif
+
+
+//The blocking of a product of T. The micro kernel keeps an mr by nr tile of
+//the result in registers, two vector registers wide, while it steps through
+//kc elements of a row of a and of a column of b. An mc by kc block of a is
+//packed to stay in the L2 cache and a kc by nc panel of b in the last level
+//cache.
+template <typename T>
+struct gemm_blocking
+{
+    static constexpr bool vectorized = simd<T>::width > 1;
+
+    static constexpr std::size_t mr = vectorized ? 6 : 4;
+    static constexpr std::size_t nr = vectorized ? 2 * simd<T>::width : 4;
+    static constexpr std::size_t kc = 256;
+    static constexpr std::size_t mc =
+        mr * (128 * 1024 / (kc * sizeof(T) * mr) > 0 ? 128 * 1024 / (kc * sizeof(T) * mr) : 1);
+    static constexpr std::size_t nc =
+        nr * (4 * 1024 * 1024 / (kc * sizeof(T) * nr) > 0 ?
+              4 * 1024 * 1024 / (kc * sizeof(T) * nr) : 1);
+};
+
+template <typename T>
+void gemm_store(T* c, typename simd<T>::type v0, typename simd<T>::type v1, bool accumulate)
+{
+    typedef simd<T> S;
+    if (accumulate)
+    {
+        v0 = S::add(S::load(c), v0);
+        v1 = S::add(S::load(c + S::width), v1);
+    }
+    S::store(c, v0);
+    S::store(c + S::width, v1);
+}
+
+//c (ldc elements between rows) = or += the product of the packed sliver a,
+//mr rows by kc, and the packed sliver b, kc by nr
+template <typename T>
+void gemm_micro_kernel(std::size_t kc, const T* a, const T* b, T* c, std::size_t ldc,
+                       bool accumulate, std::true_type)
+{
+    typedef simd<T> S;
+    typedef typename S::type V;
+    const std::size_t w = S::width;
+
+    V c00 = S::set1(T()), c01 = c00, c10 = c00, c11 = c00, c20 = c00, c21 = c00;
+    V c30 = c00, c31 = c00, c40 = c00, c41 = c00, c50 = c00, c51 = c00;
+    for (std::size_t k = 0; k < kc; ++k, a += 6, b += 2 * w)
+    {
+        const V b0 = S::load(b);
+        const V b1 = S::load(b + w);
+        V ai;
+
+#define ARRAY2D_GEMM_ROW(i)                         \
+        ai = S::set1(a[i]);                         \
+        c##i##0 = gemm_fma<T>(ai, b0, c##i##0);     \
+        c##i##1 = gemm_fma<T>(ai, b1, c##i##1);
+
+        ARRAY2D_GEMM_ROW(0)
+        ARRAY2D_GEMM_ROW(1)
+        ARRAY2D_GEMM_ROW(2)
+        ARRAY2D_GEMM_ROW(3)
+        ARRAY2D_GEMM_ROW(4)
+        ARRAY2D_GEMM_ROW(5)
+
+#undef ARRAY2D_GEMM_ROW
+    }
+
+    gemm_store<T>(c, c00, c01, accumulate);
+    gemm_store<T>(c + ldc, c10, c11, accumulate);
+    gemm_store<T>(c + 2 * ldc, c20, c21, accumulate);
+    gemm_store<T>(c + 3 * ldc, c30, c31, accumulate);
+    gemm_store<T>(c + 4 * ldc, c40, c41, accumulate);
+    gemm_store<T>(c + 5 * ldc, c50, c51, accumulate);
+}
+
+template <typename T>
+void gemm_micro_kernel(std::size_t kc, const T* a, const T* b, T* c, std::size_t ldc,
+                       bool accumulate, std::false_type)
+{
+    const std::size_t mr = gemm_blocking<T>::mr;
+    const std::size_t nr = gemm_blocking<T>::nr;
+
+    T acc[mr][nr] = {};
+    for (std::size_t k = 0; k < kc; ++k, a += mr, b += nr)
+    {
+        for (std::size_t i = 0; i < mr; ++i)
+        {
+            for (std::size_t j = 0; j < nr; ++j)
+                acc[i][j] += a[i] * b[j];
+        }
+    }
+
+    for (std::size_t i = 0; i < mr; ++i, c += ldc)
+    {
+        for (std::size_t j = 0; j < nr; ++j)
+            c[j] = accumulate ? c[j] + acc[i][j] : acc[i][j];
+    }
+}
+
+template <typename T>
+void gemm_micro_kernel(std::size_t kc, const T* a, const T* b, T* c, std::size_t ldc,
+                       bool accumulate)
+{
+    gemm_micro_kernel(kc, a, b, c, ldc, accumulate,
+                      std::integral_constant<bool, gemm_blocking<T>::vectorized>());
+}
+
+
+//Copies rows [y, y + m) and columns [x, x + k) of a into slivers of mr rows,
+//each stored a column at a time. The last sliver is padded with zeros.
+template <typename T, typename Grid>
+void gemm_pack_a(const Grid& a, std::size_t x, std::size_t y, std::size_t k, std::size_t m,
+                 T* dst)
+{
+    const std::size_t mr = gemm_blocking<T>::mr;
+    for (std::size_t i = 0; i < m; i += mr)
+    {
+        const std::size_t rows = std::min(mr, m - i);
+        for (std::size_t r = 0; r < rows; ++r)
+        {
+            typename Grid::const_row_iterator it = a.row_begin(y + i + r) + x;
+            for (std::size_t j = 0; j < k; ++j, ++it)
+                dst[j * mr + r] = static_cast<T>(*it);
+        }
+        for (std::size_t r = rows; r < mr; ++r)
+        {
+            for (std::size_t j = 0; j < k; ++j)
+                dst[j * mr + r] = T();
+        }
+        dst += mr * k;
+    }
+}
+
+//Copies slivers [first, last) of nr columns of the k rows from y and the n
+//columns from x of b, each stored a row at a time. The last sliver is padded
+//with zeros.
+template <typename T, typename Grid>
+void gemm_pack_b(const Grid& b, std::size_t x, std::size_t y, std::size_t k, std::size_t n,
+                 std::size_t first, std::size_t last, T* dst)
+{
+    const std::size_t nr = gemm_blocking<T>::nr;
+    for (std::size_t s = first; s < last; ++s)
+    {
+        T* sliver = dst + s * nr * k;
+        const std::size_t j = s * nr;
+        const std::size_t cols = std::min(nr, n - j);
+        for (std::size_t i = 0; i < k; ++i)
+        {
+            typename Grid::const_row_iterator it = b.row_begin(y + i) + (x + j);
+            T* out = sliver + i * nr;
+            for (std::size_t c = 0; c < cols; ++c, ++it)
+                out[c] = static_cast<T>(*it);
+            std::fill(out + cols, out + nr, T());
+        }
+    }
+}
+
+//Adds (or stores) an m by n tile of the product, starting at (x, y) of c. A
+//whole tile of a row_major c is written straight from the registers, the
+//rest go through a buffer.
+template <typename T, typename Grid>
+void gemm_tile(std::size_t kc, const T* a, const T* b, Grid& c, std::size_t x, std::size_t y,
+               std::size_t m, std::size_t n, bool accumulate)
+{
+    const std::size_t mr = gemm_blocking<T>::mr;
+    const std::size_t nr = gemm_blocking<T>::nr;
+
+    if (std::is_same<typename Grid::layout_type, row_major>::value && m == mr && n == nr)
+    {
+        gemm_micro_kernel(kc, a, b, &c.index(x, y), array2d_pitch(c), accumulate);
+        return;
+    }
+
+    T tile[mr * nr];
+    gemm_micro_kernel(kc, a, b, tile, nr, false);
+    for (std::size_t i = 0; i < m; ++i)
+    {
+        for (std::size_t j = 0; j < n; ++j)
+        {
+            T& e = c.index(x + j, y + i);
+            e = accumulate ? e + tile[i * nr + j] : tile[i * nr + j];
+        }
+    }
+}
+
+//the product of m rows of packed a and n columns of packed b, at (x, y) of c
+template <typename T, typename Grid>
+void gemm_macro_kernel(std::size_t kc, const T* a, const T* b, Grid& c, std::size_t x,
+                       std::size_t y, std::size_t m, std::size_t n, bool accumulate)
+{
+    const std::size_t mr = gemm_blocking<T>::mr;
+    const std::size_t nr = gemm_blocking<T>::nr;
+
+    //a sliver of b stays in L1 while every sliver of a goes past it
+    for (std::size_t j = 0; j < n; j += nr)
+    {
+        for (std::size_t i = 0; i < m; i += mr)
+        {
+            gemm_tile(kc, a + i * kc, b + j * kc, c, x + j, y + i,
+                      std::min(mr, m - i), std::min(nr, n - j), accumulate);
+        }
+    }
+}
+
+//c = a * b one row at a time, for products too small to be worth packing
+template <typename A, typename B, typename C>
+void gemm_small(const A& a, const B& b, C& c)
+{
+    typedef typename C::value_type T;
+
+    const std::size_t m = array2d_height(a);
+    const std::size_t k = array2d_width(a);
+    const std::size_t n = array2d_width(b);
+    for (std::size_t y = 0; y < m; ++y)
+    {
+        std::fill(c.row_begin(y), c.row_end(y), T());
+        for (std::size_t i = 0; i < k; ++i)
+        {
+            const T s = static_cast<T>(a.index(i, y));
+            typename B::const_row_iterator in = b.row_begin(i);
+            typename C::row_iterator out = c.row_begin(y);
+            for (std::size_t j = 0; j < n; ++j, ++in, ++out)
+                *out += s * static_cast<T>(*in);
+        }
+    }
+}
+
+
+//c = a * b, where a is K wide and M high, b is N wide and K high, and c is N
+//wide and M high. Blocks of a and panels of b are packed so that the micro
+//kernel reads them in order from the L2 and last level caches, and the result
+//is built a register tile at a time with fused multiply-adds where the
+//target has them (-mavx2 -mfma, or -mavx512f). Blocks of rows of c are
+//computed in parallel. Any element type works, float and double are
+//vectorized. c must not overlap a or b. Throws std::invalid_argument if the
+//dimensions don't agree.
+template <typename A, typename B, typename C>
+void multiply_into(const A& a, const B& b, C& c, chunking ch = chunking(),
+                   thread_pool& pool = default_thread_pool())
+{
+    typedef typename C::value_type T;
+    typedef gemm_blocking<T> blocking;
+
+    const std::size_t m = array2d_height(a);
+    const std::size_t k = array2d_width(a);
+    const std::size_t n = array2d_width(b);
+    if (array2d_height(b) != k || array2d_width(c) != n || array2d_height(c) != m)
+        throw std::invalid_argument("matrix dimensions don't agree");
+    if (m == 0 || n == 0)
+        return;
+
+    //this includes k == 0, which leaves c all zero
+    if (m * n * k <= 32 * 32 * 32)
+    {
+        gemm_small(a, b, c);
+        return;
+    }
+
+    const std::size_t mr = blocking::mr;
+    const std::size_t nr = blocking::nr;
+    const std::size_t kc = blocking::kc;
+    const std::size_t nc = blocking::nc;
+
+    //blocks of rows are made smaller when there are fewer than threads
+    const std::size_t threads = pool.concurrency();
+    std::size_t mc = blocking::mc;
+    if ((m + mc - 1) / mc < threads)
+        mc = std::max(mr, ((m + threads - 1) / threads + mr - 1) / mr * mr);
+    const std::size_t blocks = (m + mc - 1) / mc;
+
+    std::vector<T> packed_b(std::min(nc, (n + nr - 1) / nr * nr) * kc);
+    for (std::size_t jc = 0; jc < n; jc += nc)
+    {
+        const std::size_t nb = std::min(nc, n - jc);
+        for (std::size_t pc = 0; pc < k; pc += kc)
+        {
+            const std::size_t kb = std::min(kc, k - pc);
+            const bool accumulate = pc != 0;
+
+            pool.parallel_for((nb + nr - 1) / nr,
+                              [&](std::size_t begin, std::size_t end)
+                              { gemm_pack_b(b, jc, pc, kb, nb, begin, end, packed_b.data()); });
+
+            pool.parallel_for(blocks,
+                              [&](std::size_t begin, std::size_t end)
+                              {
+                                  std::vector<T> packed_a(mc * kb);
+                                  for (std::size_t i = begin; i < end; ++i)
+                                  {
+                                      const std::size_t ic = i * mc;
+                                      const std::size_t mb = std::min(mc, m - ic);
+                                      gemm_pack_a(a, pc, ic, kb, mb, packed_a.data());
+                                      gemm_macro_kernel(kb, packed_a.data(), packed_b.data(),
+                                                        c, jc, ic, mb, nb, accumulate);
+                                  }
+                              },
+                              ch);
+        }
+    }
+}
+
+//the product of a and b, see multiply_into
+template <typename T, typename Alloc, std::size_t R, typename Layout>
+array2d<T, Alloc, R, Layout> multiply(const array2d<T, Alloc, R, Layout>& a,
+                                      const array2d<T, Alloc, R, Layout>& b,
+                                      chunking ch = chunking(),
+                                      thread_pool& pool = default_thread_pool())
+{
+    array2d<T, Alloc, R, Layout> c(b.width(), a.height(), a.get_allocator());
+    multiply_into(a, b, c, ch, pool);
+    return c;
+}
+
+
+//the sum of first[i] * b[i] for i in [0, n), with four registers of partial
+//sums when first is contiguous
+template <typename Iter, typename T>
+T gemv_dot(Iter first, const T* b, std::size_t n, std::true_type)
+{
+    typedef simd<T> S;
+    typedef typename S::type V;
+    const std::size_t w = S::width;
+    const T* a = &*first;
+
+    V s0 = S::set1(T()), s1 = s0, s2 = s0, s3 = s0;
+    std::size_t i = 0;
+    for (; i + 4 * w <= n; i += 4 * w)
+    {
+        s0 = gemm_fma<T>(S::load(a + i), S::load(b + i), s0);
+        s1 = gemm_fma<T>(S::load(a + i + w), S::load(b + i + w), s1);
+        s2 = gemm_fma<T>(S::load(a + i + 2 * w), S::load(b + i + 2 * w), s2);
+        s3 = gemm_fma<T>(S::load(a + i + 3 * w), S::load(b + i + 3 * w), s3);
+    }
+    for (; i + w <= n; i += w)
+        s0 = gemm_fma<T>(S::load(a + i), S::load(b + i), s0);
+    s0 = S::add(S::add(s0, s1), S::add(s2, s3));
+
+    T lanes[S::width];
+    S::store(lanes, s0);
+    T sum = T();
+    for (std::size_t j = 0; j < w; ++j)
+        sum += lanes[j];
+    for (; i < n; ++i)
+        sum += a[i] * b[i];
+    return sum;
+}
+
+template <typename Iter, typename T>
+T gemv_dot(Iter a, const T* b, std::size_t n, std::false_type)
+{
+    T sum = T();
+    for (std::size_t i = 0; i < n; ++i, ++a)
+        sum += static_cast<T>(*a) * b[i];
+    return sum;
+}
+
+//acc[i] += s * a[i] for i in [0, n)
+template <typename T>
+void gemv_axpy(T* acc, const T* a, T s, std::size_t n, std::true_type)
+{
+    typedef simd<T> S;
+    const std::size_t w = S::width;
+    const typename S::type sv = S::set1(s);
+    std::size_t i = 0;
+    for (; i + w <= n; i += w)
+        S::store(acc + i, gemm_fma<T>(sv, S::load(a + i), S::load(acc + i)));
+    for (; i < n; ++i)
+        acc[i] += s * a[i];
+}
+
+template <typename T, typename Iter>
+void gemv_axpy(T* acc, Iter a, T s, std::size_t n, std::false_type)
+{
+    for (std::size_t i = 0; i < n; ++i, ++a)
+        acc[i] += s * static_cast<T>(*a);
+}
+
+template <typename Grid, typename T, typename Layout>
+void gemv_rows(const Grid& a, const T* v, T* out, chunking c, thread_pool& pool, Layout)
+{
+    typedef typename Grid::value_type U;
+    typedef std::integral_constant<bool,
+        std::is_same<Layout, row_major>::value && std::is_same<U, T>::value &&
+        gemm_blocking<T>::vectorized> vectorized;
+
+    const std::size_t width = array2d_width(a);
+    pool.parallel_for(array2d_height(a),
+                      [&](std::size_t begin, std::size_t end)
+                      {
+                          for (std::size_t y = begin; y < end; ++y)
+                              out[y] = gemv_dot(a.row_begin(y), v, width, vectorized());
+                      },
+                      c, parallel_row_multiple<T>(Layout(), array2d_pitch(a)));
+}
+
+//a column_major grid adds up its contiguous columns scaled by v, each thread
+//taking a band of rows
+template <typename Grid, typename T>
+void gemv_rows(const Grid& a, const T* v, T* out, chunking c, thread_pool& pool, column_major)
+{
+    typedef typename Grid::value_type U;
+    typedef std::integral_constant<bool,
+        std::is_same<U, T>::value && gemm_blocking<T>::vectorized> vectorized;
+
+    const std::size_t width = array2d_width(a);
+    pool.parallel_for(array2d_height(a),
+                      [&](std::size_t begin, std::size_t end)
+                      {
+                          std::fill(out + begin, out + end, T());
+                          for (std::size_t x = 0; x < width; ++x)
+                          {
+                              gemv_axpy(out + begin, &*(a.column_begin(x) + begin), v[x],
+                                        end - begin, vectorized());
+                          }
+                      },
+                      c, parallel_row_multiple<T>(column_major(), array2d_pitch(a)));
+}
+
+//out[y] = the sum of a(x, y) * v[x], the product of a and the column vector
+//v, which has a's width elements and out its height. Rows of a row_major a
+//are dot products, a column_major a is summed a column at a time, and both
+//are vectorized for float and double and split between threads by rows.
+//out must not overlap v.
+template <typename Grid, typename T>
+void multiply_vector_into(const Grid& a, const T* v, T* out, chunking c = chunking(),
+                          thread_pool& pool = default_thread_pool())
+{
+    if (array2d_width(a) == 0)
+    {
+        std::fill(out, out + array2d_height(a), T());
+        return;
+    }
+    gemv_rows(a, v, out, c, pool, typename Grid::layout_type());
+}
+
+//the product of a and v, see multiply_vector_into. Throws
+//std::invalid_argument if v doesn't have a's width elements.
+template <typename Grid, typename T, typename Alloc>
+std::vector<T, Alloc> multiply_vector(const Grid& a, const std::vector<T, Alloc>& v,
+                                      chunking c = chunking(),
+                                      thread_pool& pool = default_thread_pool())
+{
+    if (v.size() != array2d_width(a))
+        throw std::invalid_argument("matrix and vector dimensions don't agree");
+
+    std::vector<T, Alloc> out(array2d_height(a), T(), v.get_allocator());
+    multiply_vector_into(a, v.data(), out.data(), c, pool);
+    return out;
+}
+
+} //array2d
+
+#endif //ARRAY2D_MATRIX_H
@@ -0,0 +1,306 @@
+/*
+ array2d_numa.hpp - An allocator that places large grids on the NUMA nodes
+                    of the machine, and parallel first touch initialization.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#ifndef ARRAY2D_NUMA_H
+#define ARRAY2D_NUMA_H
+
+#include "array2d.hpp"
+#include "array2d_parallel.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <new>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace array2d
+{
+
+//Where numa_allocator puts the pages of an allocation.
+enum numa_policy
+{
+    //wherever each page is first written, which is the node of the thread
+    //that writes it. Use first_touch() to spread a grid over the workers.
+    numa_local,
+
+    //page by page across every node in turn
+    numa_interleave,
+
+    //the allocation is cut into one band of pages per node, in node order,
+    //so the rows of a row_major grid are split into contiguous bands. Pages
+    //go elsewhere when a node runs out.
+    numa_bands
+};
+
+//The numbers of the NUMA nodes that are online, read from sysfs once. A
+//machine that isn't NUMA, or where this can't be read, has just node 0.
+inline const std::vector<int>& numa_nodes()
+{
+    static const std::vector<int> nodes = []
+    {
+        std::vector<int> n;
+#ifdef __linux__
+        //a list of ranges such as "0-1" or "0,2-3"
+        std::ifstream in("/sys/devices/system/node/online");
+        std::string list;
+        std::getline(in, list);
+        std::size_t i = 0;
+        while (i < list.size())
+        {
+            std::size_t end = list.find(',', i);
+            if (end == std::string::npos)
+                end = list.size();
+            const std::string range = list.substr(i, end - i);
+            const std::size_t dash = range.find('-');
+            try
+            {
+                const int first = std::stoi(range.substr(0, dash));
+                const int last = dash == std::string::npos ? first
+                                                           : std::stoi(range.substr(dash + 1));
+                for (int node = first; node <= last; ++node)
+                    n.push_back(node);
+            }
+            catch (...)
+            {
+                n.clear();
+                break;
+            }
+            i = end + 1;
+        }
+#endif
+        if (n.empty())
+            n.push_back(0);
+        return n;
+    }();
+    return nodes;
+}
+
+inline std::size_t numa_node_count() { return numa_nodes().size(); }
+
+#ifdef __linux__
+
+//Applies policy to [p, p + size), which is page aligned. This is advice,
+//errors such as a kernel without NUMA support or a container that forbids
+//mbind are ignored and leave the pages local.
+inline void numa_bind(void* p, std::size_t size, numa_policy policy)
+{
+    const std::vector<int>& nodes = numa_nodes();
+    if (policy == numa_local || nodes.size() < 2)
+        return;
+
+    const std::size_t bits = 8 * sizeof(unsigned long);
+    const std::size_t max_node = static_cast<std::size_t>(nodes.back()) + 1;
+    std::vector<unsigned long> mask((max_node + bits - 1) / bits);
+    const unsigned long mask_bits = static_cast<unsigned long>(mask.size() * bits);
+
+    if (policy == numa_interleave)
+    {
+        for (std::size_t i = 0; i < nodes.size(); ++i)
+            mask[nodes[i] / bits] |= 1ul << (nodes[i] % bits);
+        syscall(SYS_mbind, p, size, MPOL_INTERLEAVE, mask.data(), mask_bits + 1, 0);
+        return;
+    }
+
+    const std::size_t page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    const std::size_t pages = size / page;
+    for (std::size_t i = 0; i < nodes.size(); ++i)
+    {
+        const std::size_t first = pages * i / nodes.size();
+        const std::size_t last = pages * (i + 1) / nodes.size();
+        if (first == last)
+            continue;
+        std::fill(mask.begin(), mask.end(), 0ul);
+        mask[nodes[i] / bits] |= 1ul << (nodes[i] % bits);
+        syscall(SYS_mbind, static_cast<char*>(p) + first * page, (last - first) * page,
+                MPOL_PREFERRED, mask.data(), mask_bits + 1, 0);
+    }
+}
+
+#endif //__linux__
+
+
+//An allocator for large grids. Allocations of at least threshold bytes are
+//mapped straight from the kernel, page aligned, with their pages placed by a
+//numa_policy, and optionally advised to use transparent huge pages, in which
+//case they are aligned to and rounded up to 2 MB. Smaller allocations, and
+//all of them off Linux, come from operator new. Nothing is touched, so pages
+//are only placed when they are first written.
+//
+//  typedef array2d::array2d<float, array2d::numa_allocator<float> > grid;
+//  grid a(width, height, array2d::numa_allocator<float>(array2d::numa_bands));
+//  array2d::first_touch(a, 0.0f);
+template <typename T>
+class numa_allocator
+{
+  public:
+    typedef T value_type;
+
+    static constexpr std::size_t threshold = 1 << 20;
+    static constexpr std::size_t huge_page_size = 2 << 20;
+
+  private:
+    numa_policy m_policy;
+    bool m_huge_pages;
+
+    template <typename U>
+    friend class numa_allocator;
+
+  public:
+    numa_allocator(numa_policy policy = numa_interleave, bool huge_pages = false) noexcept
+        : m_policy(policy), m_huge_pages(huge_pages)
+    { }
+
+    template <typename U>
+    numa_allocator(const numa_allocator<U>& o) noexcept
+        : m_policy(o.m_policy), m_huge_pages(o.m_huge_pages)
+    { }
+
+    numa_policy policy() const { return m_policy; }
+    bool huge_pages() const { return m_huge_pages; }
+
+    T* allocate(std::size_t n)
+    {
+        const std::size_t size = n * sizeof(T);
+        if (size < threshold)
+            return static_cast<T*>(::operator new(size));
+
+#ifdef __linux__
+        const std::size_t align = alignment();
+        const std::size_t length = mapped_size(size);
+
+        //huge pages need the mapping aligned to one, so map an extra page and
+        //trim off what's on either side of the aligned part
+        const std::size_t extra = m_huge_pages ? align : 0;
+        void* map = ::mmap(nullptr, length + extra, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (map == MAP_FAILED)
+            throw std::bad_alloc();
+
+        char* base = static_cast<char*>(map);
+        char* p = base;
+        if (extra != 0)
+        {
+            p = reinterpret_cast<char*>((reinterpret_cast<std::uintptr_t>(base) + align - 1) /
+                                        align * align);
+            if (p != base)
+                ::munmap(base, p - base);
+            if (p + length != base + length + extra)
+                ::munmap(p + length, base + extra - p);
+#ifdef MADV_HUGEPAGE
+            ::madvise(p, length, MADV_HUGEPAGE);
+#endif
+        }
+
+        numa_bind(p, length, m_policy);
+        return reinterpret_cast<T*>(p);
+#else
+        return static_cast<T*>(::operator new(size));
+#endif
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept
+    {
+        const std::size_t size = n * sizeof(T);
+#ifdef __linux__
+        if (size >= threshold)
+        {
+            ::munmap(p, mapped_size(size));
+            return;
+        }
+#endif
+        (void)size;
+        ::operator delete(p);
+    }
+
+  private:
+#ifdef __linux__
+    std::size_t alignment() const
+    {
+        return m_huge_pages ? huge_page_size
+                            : static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    }
+
+    std::size_t mapped_size(std::size_t size) const
+    {
+        const std::size_t align = alignment();
+        return (size + align - 1) / align * align;
+    }
+#endif
+};
+
+template <typename T>
+constexpr std::size_t numa_allocator<T>::threshold;
+
+template <typename T>
+constexpr std::size_t numa_allocator<T>::huge_page_size;
+
+template <typename T, typename U>
+bool operator==(const numa_allocator<T>& a, const numa_allocator<U>& b)
+{ return a.policy() == b.policy() && a.huge_pages() == b.huge_pages(); }
+
+template <typename T, typename U>
+bool operator!=(const numa_allocator<T>& a, const numa_allocator<U>& b)
+{ return !(a == b); }
+
+
+//Writes value to every element of a, a band of rows per thread of pool. The
+//bands are pinned_chunks, so no idle thread steals one, and a later loop over
+//a's rows with the same chunking runs each band on the thread that touched
+//it. With numa_local each band's pages then land on the node of the thread
+//that works on them. The pool's threads aren't bound to CPUs, so this holds
+//as long as the scheduler keeps each thread on its node; bind the process to
+//its CPUs (e.g. with numactl) to be sure. This only helps elements that
+//haven't been written yet, construct the grid without a value (trivial types
+//are then left untouched) and call this before anything else writes it.
+template <typename Grid>
+void first_touch(Grid& a, const typename Grid::value_type& value = typename Grid::value_type(),
+                 chunking c = chunking(chunking::pinned_chunks),
+                 thread_pool& pool = default_thread_pool())
+{
+    pool.parallel_for(array2d_height(a),
+                      [&](std::size_t begin, std::size_t end)
+                      {
+                          for (std::size_t y = begin; y < end; ++y)
+                              std::fill(a.row_begin(y), a.row_end(y), value);
+                      },
+                      c, parallel_row_multiple<typename Grid::value_type>(
+                             typename Grid::layout_type(), array2d_pitch(a)));
+}
+
+} //array2d
+
+#endif //ARRAY2D_NUMA_H
@@ -0,0 +1,719 @@
+/*
+ array2d_ooc.hpp - An out of core grid, kept on disk as tiles with a cache of
+                   the tiles in use.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#ifndef ARRAY2D_OOC_H
+#define ARRAY2D_OOC_H
+
+#include "array2d.hpp"
+#include "array2d_file.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace array2d
+{
+
+//how many tiles an ooc_array2d keeps in memory
+struct ooc_array2d_options
+{
+    //the most tiles held in the cache, at least 1
+    std::size_t cache_tiles;
+
+    //how many tiles after each one looked up are read ahead, 0 for none
+    std::size_t prefetch_tiles;
+
+    explicit ooc_array2d_options(std::size_t cache_tiles = 64, std::size_t prefetch_tiles = 2)
+        : cache_tiles(cache_tiles), prefetch_tiles(prefetch_tiles) { }
+};
+
+//what the tile cache of an ooc_array2d has done
+struct ooc_array2d_stats
+{
+    std::uint64_t hits;          //tiles found in the cache
+    std::uint64_t misses;        //tiles that weren't, however they were loaded
+    std::uint64_t prefetch_hits; //misses loaded from a tile that was prefetched
+    std::uint64_t evictions;     //tiles dropped from the cache to make room
+    std::uint64_t writebacks;    //dirty tiles written to the file
+    std::uint64_t prefetches;    //tiles read ahead by the prefetch thread
+
+    ooc_array2d_stats()
+        : hits(0), misses(0), prefetch_hits(0), evictions(0), writebacks(0),
+          prefetches(0) { }
+};
+
+
+//iterates over the tiles of an ooc_array2d in row order, loading each one
+//into the cache when it is dereferenced
+template <typename T, typename Grid>
+struct ooc_array2d_tile_iterator
+{
+    typedef std::ptrdiff_t                                  difference_type;
+    typedef std::random_access_iterator_tag                 iterator_category;
+    typedef array2d_tile<T, typename Grid::layout_type>     value_type;
+    typedef void                                            pointer;
+    typedef value_type                                      reference;
+
+    Grid* _m_grid;
+    std::size_t _m_index;
+
+    ooc_array2d_tile_iterator() : _m_grid(nullptr), _m_index(0) { }
+    ooc_array2d_tile_iterator(Grid* grid, std::size_t index)
+        : _m_grid(grid), _m_index(index) { }
+
+    //allow non-const to const conversion
+    template <typename U, typename G>
+    ooc_array2d_tile_iterator(const ooc_array2d_tile_iterator<U, G>& o,
+                              typename std::enable_if<
+                                  std::is_convertible<G*, Grid*>::value
+                              >::type* = nullptr)
+        : _m_grid(o._m_grid), _m_index(o._m_index)
+    { }
+
+    reference operator*() const { return _m_grid->tile(_m_index); }
+    reference operator[](difference_type n) const { return _m_grid->tile(_m_index + n); }
+
+    ooc_array2d_tile_iterator& operator++() { ++_m_index; return *this; }
+    ooc_array2d_tile_iterator operator++(int)
+    {
+        ooc_array2d_tile_iterator tmp(*this);
+        ++_m_index;
+        return tmp;
+    }
+
+    ooc_array2d_tile_iterator& operator--() { --_m_index; return *this; }
+    ooc_array2d_tile_iterator operator--(int)
+    {
+        ooc_array2d_tile_iterator tmp(*this);
+        --_m_index;
+        return tmp;
+    }
+
+    ooc_array2d_tile_iterator& operator+=(difference_type n) { _m_index += n; return *this; }
+    ooc_array2d_tile_iterator& operator-=(difference_type n) { _m_index -= n; return *this; }
+
+    ooc_array2d_tile_iterator operator+(difference_type n) const
+    { return ooc_array2d_tile_iterator(_m_grid, _m_index + n); }
+
+    ooc_array2d_tile_iterator operator-(difference_type n) const
+    { return ooc_array2d_tile_iterator(_m_grid, _m_index - n); }
+
+    template <typename U, typename G>
+    difference_type operator-(const ooc_array2d_tile_iterator<U, G>& o) const
+    { return static_cast<difference_type>(_m_index - o._m_index); }
+
+    template <typename U, typename G>
+    bool operator==(const ooc_array2d_tile_iterator<U, G>& o) const
+    { return _m_index == o._m_index; }
+    template <typename U, typename G>
+    bool operator!=(const ooc_array2d_tile_iterator<U, G>& o) const
+    { return _m_index != o._m_index; }
+
+    template <typename U, typename G>
+    bool operator<(const ooc_array2d_tile_iterator<U, G>& o) const
+    { return _m_index < o._m_index; }
+    template <typename U, typename G>
+    bool operator>(const ooc_array2d_tile_iterator<U, G>& o) const
+    { return _m_index > o._m_index; }
+
+    template <typename U, typename G>
+    bool operator<=(const ooc_array2d_tile_iterator<U, G>& o) const
+    { return _m_index <= o._m_index; }
+    template <typename U, typename G>
+    bool operator>=(const ooc_array2d_tile_iterator<U, G>& o) const
+    { return _m_index >= o._m_index; }
+};
+
+
+//A grid too big for memory, stored in an array2d file with a tiled layout.
+//At most cache_tiles tiles are held in memory, the least recently used being
+//evicted to make room for another, and written back to the file if they have
+//been modified. Whenever a tile is looked up, a background thread reads the
+//next prefetch_tiles tiles in row order, so scanning the grid by rows or by
+//tiles rarely waits for the disk.
+//
+//Non-const access marks a tile dirty; to read without writing back, access the
+//grid through a const reference. A reference to an element stays valid until
+//its tile is evicted, which can only happen when another tile is looked up, so
+//no more than cache_tiles tiles' worth of references can be held at once. The
+//cache is not locked, so a grid (even a const one) must only be used by one
+//thread at a time. T must be trivially copyable.
+template <typename T, std::size_t TileWidth = 256, std::size_t TileHeight = TileWidth>
+class ooc_array2d
+{
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "only trivially copyable types can be stored out of core");
+
+  public:
+    typedef T                           value_type;
+    typedef tiled<TileWidth, TileHeight> layout_type;
+    typedef T*                          pointer;
+    typedef const T*                    const_pointer;
+    typedef T&                          reference;
+    typedef const T&                    const_reference;
+    typedef std::size_t                 size_type;
+    typedef std::ptrdiff_t              difference_type;
+
+    typedef array2d_index_iterator<T, ooc_array2d, iterate_grid>               iterator;
+    typedef array2d_index_iterator<const T, const ooc_array2d, iterate_grid>   const_iterator;
+    typedef array2d_index_iterator<T, ooc_array2d, iterate_row>                row_iterator;
+    typedef array2d_index_iterator<const T, const ooc_array2d, iterate_row>    const_row_iterator;
+    typedef array2d_index_iterator<T, ooc_array2d, iterate_column>             column_iterator;
+    typedef array2d_index_iterator<const T, const ooc_array2d, iterate_column> const_column_iterator;
+    typedef ooc_array2d_tile_iterator<T, ooc_array2d>                          tile_iterator;
+    typedef ooc_array2d_tile_iterator<const T, const ooc_array2d>              const_tile_iterator;
+
+    typedef array2d_tile<T, layout_type>       tile_type;
+    typedef array2d_tile<const T, layout_type> const_tile_type;
+
+    static constexpr size_type tile_width = TileWidth;
+    static constexpr size_type tile_height = TileHeight;
+    static constexpr size_type tile_size = TileWidth * TileHeight;
+
+  private:
+    static constexpr size_type no_tile = static_cast<size_type>(-1);
+
+    struct cached_tile
+    {
+        std::vector<T> data;
+        bool dirty;
+        std::list<size_type>::iterator lru;
+    };
+
+    typedef std::unordered_map<size_type, cached_tile> tile_map;
+
+    int m_fd;
+    std::string m_path;
+    size_type m_width;
+    size_type m_height;
+    size_type m_pitch;
+    size_type m_tiles_across;
+    size_type m_tile_count;
+    std::uint64_t m_data_offset;
+    size_type m_cache_tiles;
+    size_type m_prefetch_tiles;
+
+    //the cache, only used by the owning thread. m_lru holds the resident
+    //tiles, most recently used first, and m_last the tile last looked up.
+    mutable tile_map m_cache;
+    mutable std::list<size_type> m_lru;
+    mutable size_type m_last_index;
+    mutable cached_tile* m_last;
+    mutable ooc_array2d_stats m_stats;
+
+    //whether a tile has been written to since the checksum was last stored
+    bool m_unsynced;
+
+    //shared with the prefetch thread under m_mutex. Tiles wait in m_queue,
+    //are read by the thread one at a time (m_reading) and then wait in
+    //m_staged, oldest first in m_staged_order, until they are looked up.
+    mutable std::mutex m_mutex;
+    mutable std::condition_variable m_wake;
+    mutable std::condition_variable m_read;
+    mutable std::deque<size_type> m_queue;
+    mutable std::unordered_map<size_type, std::vector<T> > m_staged;
+    mutable std::deque<size_type> m_staged_order;
+    mutable std::vector<std::vector<T> > m_spare;
+    mutable size_type m_reading;
+    mutable std::uint64_t m_prefetches;
+    bool m_stop;
+    std::thread m_thread;
+
+  public:
+    //creates (or replaces) the file at path with a zeroed width by height grid
+    ooc_array2d(const std::string& path, size_type width, size_type height,
+                const ooc_array2d_options& options = ooc_array2d_options())
+        : m_fd(-1), m_path(path), m_width(width), m_height(height),
+          m_pitch(layout_type::pitch(width, height, 1)),
+          m_tiles_across(0), m_tile_count(0), m_data_offset(array2d_file_data_offset),
+          m_cache_tiles(std::max<size_type>(options.cache_tiles, 1)),
+          m_prefetch_tiles(options.prefetch_tiles),
+          m_cache(), m_lru(), m_last_index(no_tile), m_last(nullptr), m_stats(),
+          m_unsynced(false),
+          m_mutex(), m_wake(), m_read(), m_queue(), m_staged(), m_staged_order(),
+          m_spare(), m_reading(no_tile), m_prefetches(0), m_stop(false), m_thread()
+    {
+        const std::size_t data_size =
+            layout_type::storage_size(width, height, m_pitch) * sizeof(T);
+
+        array2d_file_header header = make_array2d_header<T, layout_type>(width, height, m_pitch);
+        header.checksum = array2d_zero_checksum(data_size);
+
+        m_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0666);
+        if (m_fd < 0)
+            throw array2d_file_error("can't create " + path);
+
+        try
+        {
+            if (::ftruncate(m_fd, static_cast<off_t>(m_data_offset + data_size)) != 0)
+                throw array2d_file_error("can't size " + path);
+            if (::pwrite(m_fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)))
+                throw array2d_file_error("can't write " + path);
+            start();
+        }
+        catch (...)
+        {
+            ::close(m_fd);
+            throw;
+        }
+    }
+
+    //opens an existing file, which must have a tiled layout with the same tile size
+    explicit ooc_array2d(const std::string& path,
+                         const ooc_array2d_options& options = ooc_array2d_options())
+        : m_fd(-1), m_path(path), m_width(0), m_height(0), m_pitch(0),
+          m_tiles_across(0), m_tile_count(0), m_data_offset(0),
+          m_cache_tiles(std::max<size_type>(options.cache_tiles, 1)),
+          m_prefetch_tiles(options.prefetch_tiles),
+          m_cache(), m_lru(), m_last_index(no_tile), m_last(nullptr), m_stats(),
+          m_unsynced(false),
+          m_mutex(), m_wake(), m_read(), m_queue(), m_staged(), m_staged_order(),
+          m_spare(), m_reading(no_tile), m_prefetches(0), m_stop(false), m_thread()
+    {
+        m_fd = ::open(path.c_str(), O_RDWR);
+        if (m_fd < 0)
+            throw array2d_file_error("can't open " + path);
+
+        try
+        {
+            struct stat st;
+            if (::fstat(m_fd, &st) != 0)
+                throw array2d_file_error("can't stat " + path);
+
+            array2d_file_header header;
+            if (static_cast<std::uint64_t>(st.st_size) < sizeof(header) ||
+                ::pread(m_fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)))
+            {
+                throw std::runtime_error("can't read array2d header from " + path);
+            }
+            check_array2d_header<T, layout_type>(header, static_cast<std::uint64_t>(st.st_size));
+
+            m_width = static_cast<size_type>(header.width);
+            m_height = static_cast<size_type>(header.height);
+            m_pitch = static_cast<size_type>(header.pitch);
+            m_data_offset = header.data_offset;
+            start();
+        }
+        catch (...)
+        {
+            ::close(m_fd);
+            throw;
+        }
+    }
+
+    //Writes back the dirty tiles and, if the grid was written to since the
+    //last sync(), stores the checksum so that the file can be read again.
+    //Errors are ignored; call sync() first to see them.
+    ~ooc_array2d()
+    {
+        stop();
+        try
+        {
+            if (m_unsynced)
+                sync();
+            else
+                flush();
+        }
+        catch (...)
+        {
+        }
+        ::close(m_fd);
+    }
+
+    ooc_array2d(const ooc_array2d&) = delete;
+    ooc_array2d& operator=(const ooc_array2d&) = delete;
+
+    size_type width() const { return m_width; }
+    size_type height() const { return m_height; }
+    size_type pitch() const { return m_pitch; }
+    const std::string& path() const { return m_path; }
+
+    size_type cache_tiles() const { return m_cache_tiles; }
+    size_type prefetch_tiles() const { return m_prefetch_tiles; }
+
+    //the number of tiles resident in the cache
+    size_type cached_tiles() const { return m_cache.size(); }
+
+    ooc_array2d_stats stats() const
+    {
+        ooc_array2d_stats s = m_stats;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        s.prefetches = m_prefetches;
+        return s;
+    }
+
+    void reset_stats()
+    {
+        m_stats = ooc_array2d_stats();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_prefetches = 0;
+    }
+
+    //writes every dirty tile back to the file, leaving them in the cache
+    void flush()
+    {
+        for (typename tile_map::iterator it = m_cache.begin(); it != m_cache.end(); ++it)
+        {
+            if (it->second.dirty)
+            {
+                write_tile(it->first, it->second.data);
+                it->second.dirty = false;
+            }
+        }
+    }
+
+    //flushes, then stores the checksum of the data in the header, which reads
+    //the whole file, and flushes the file to disk
+    void sync()
+    {
+        flush();
+
+        array2d_checksum c;
+        std::vector<T> buffer(tile_size);
+        for (size_type i = 0; i < tile_count(); ++i)
+        {
+            read_tile(i, buffer);
+            c.update(buffer.data(), tile_size * sizeof(T));
+        }
+
+        const std::uint64_t checksum = c.value();
+        const off_t offset = static_cast<off_t>(offsetof(array2d_file_header, checksum));
+        if (::pwrite(m_fd, &checksum, sizeof(checksum), offset) != static_cast<ssize_t>(sizeof(checksum)) ||
+            ::fsync(m_fd) != 0)
+        {
+            throw array2d_file_error("can't write " + m_path);
+        }
+        m_unsynced = false;
+    }
+
+    iterator begin() { return iterator(this, m_width, 0, 0); }
+    const_iterator begin() const { return const_iterator(this, m_width, 0, 0); }
+    const_iterator cbegin() const { return begin(); }
+
+    iterator end() { return iterator(this, m_width, 0, m_height); }
+    const_iterator end() const { return const_iterator(this, m_width, 0, m_height); }
+    const_iterator cend() const { return end(); }
+
+    row_iterator row_begin(size_type y) { return row_iterator(this, m_width, 0, y); }
+    const_row_iterator row_begin(size_type y) const
+    { return const_row_iterator(this, m_width, 0, y); }
+
+    row_iterator row_end(size_type y) { return row_iterator(this, m_width, m_width, y); }
+    const_row_iterator row_end(size_type y) const
+    { return const_row_iterator(this, m_width, m_width, y); }
+
+    column_iterator column_begin(size_type x) { return column_iterator(this, m_width, x, 0); }
+    const_column_iterator column_begin(size_type x) const
+    { return const_column_iterator(this, m_width, x, 0); }
+
+    column_iterator column_end(size_type x)
+    { return column_iterator(this, m_width, x, m_height); }
+    const_column_iterator column_end(size_type x) const
+    { return const_column_iterator(this, m_width, x, m_height); }
+
+    tile_iterator tile_begin() { return tile_iterator(this, 0); }
+    const_tile_iterator tile_begin() const { return const_tile_iterator(this, 0); }
+
+    tile_iterator tile_end() { return tile_iterator(this, tile_count()); }
+    const_tile_iterator tile_end() const { return const_tile_iterator(this, tile_count()); }
+
+    size_type tile_count() const
+    { return array2d_tile_count<layout_type>(m_width, m_height, m_pitch); }
+
+    //the i'th tile in row order, loaded into the cache
+    tile_type tile(size_type i)
+    {
+        cached_tile& t = lookup(i);
+        t.dirty = true;
+        m_unsynced = true;
+        return make_tile<T>(i, t.data.data());
+    }
+    const_tile_type tile(size_type i) const
+    { return make_tile<const T>(i, lookup(i).data.data()); }
+
+    reference index(size_type x, size_type y)
+    {
+        cached_tile& t = lookup((y / TileHeight) * m_tiles_across + x / TileWidth);
+        t.dirty = true;
+        m_unsynced = true;
+        return t.data[(y % TileHeight) * TileWidth + x % TileWidth];
+    }
+    const_reference index(size_type x, size_type y) const
+    {
+        const cached_tile& t = lookup((y / TileHeight) * m_tiles_across + x / TileWidth);
+        return t.data[(y % TileHeight) * TileWidth + x % TileWidth];
+    }
+
+    reference operator()(size_type x, size_type y) { return index(x, y); }
+    const_reference operator()(size_type x, size_type y) const { return index(x, y); }
+
+  private:
+    void start()
+    {
+        m_tiles_across = (m_width + TileWidth - 1) / TileWidth;
+        m_tile_count = tile_count();
+        m_cache.reserve(m_cache_tiles);
+        if (m_prefetch_tiles != 0)
+            m_thread = std::thread(&ooc_array2d::prefetch_loop, this);
+    }
+
+    void stop()
+    {
+        if (!m_thread.joinable())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_one();
+        m_thread.join();
+    }
+
+    template <typename U>
+    array2d_tile<U, layout_type> make_tile(size_type i, U* data) const
+    {
+        const size_type x = (i % m_tiles_across) * TileWidth;
+        const size_type y = (i / m_tiles_across) * TileHeight;
+        return array2d_tile<U, layout_type>(data, x, y,
+                                            std::min(TileWidth, m_width - x),
+                                            std::min(TileHeight, m_height - y),
+                                            TileWidth, TileHeight);
+    }
+
+    off_t tile_offset(size_type i) const
+    { return static_cast<off_t>(m_data_offset + static_cast<std::uint64_t>(i) * tile_size * sizeof(T)); }
+
+    void read_tile(size_type i, std::vector<T>& data) const
+    {
+        const ssize_t size = static_cast<ssize_t>(tile_size * sizeof(T));
+        if (::pread(m_fd, data.data(), size, tile_offset(i)) != size)
+            throw array2d_file_error("can't read " + m_path);
+    }
+
+    void write_tile(size_type i, const std::vector<T>& data) const
+    {
+        const ssize_t size = static_cast<ssize_t>(tile_size * sizeof(T));
+        if (::pwrite(m_fd, data.data(), size, tile_offset(i)) != size)
+            throw array2d_file_error("can't write " + m_path);
+        ++m_stats.writebacks;
+    }
+
+    cached_tile& lookup(size_type i) const
+    {
+        if (i == m_last_index)
+            return *m_last;
+
+        typename tile_map::iterator it = m_cache.find(i);
+        if (it != m_cache.end())
+        {
+            ++m_stats.hits;
+            m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+        }
+        else
+        {
+            ++m_stats.misses;
+            it = load(i);
+        }
+
+        m_last_index = i;
+        m_last = &it->second;
+        prefetch_after(i);
+        return it->second;
+    }
+
+    //brings tile i into the cache, evicting the least recently used tile if
+    //the cache is full
+    typename tile_map::iterator load(size_type i) const
+    {
+        std::vector<T> data;
+        if (m_cache.size() >= m_cache_tiles)
+        {
+            const size_type victim = m_lru.back();
+            typename tile_map::iterator v = m_cache.find(victim);
+            if (v->second.dirty)
+                write_tile(victim, v->second.data);
+            data.swap(v->second.data);
+            m_lru.pop_back();
+            m_cache.erase(v);
+            if (m_last_index == victim)
+                m_last_index = no_tile;
+            ++m_stats.evictions;
+        }
+
+        if (take_prefetched(i, data))
+            ++m_stats.prefetch_hits;
+        else
+        {
+            data.resize(tile_size);
+            read_tile(i, data);
+        }
+
+        m_lru.push_front(i);
+        cached_tile& t = m_cache[i];
+        t.data.swap(data);
+        t.dirty = false;
+        t.lru = m_lru.begin();
+        return m_cache.find(i);
+    }
+
+    //takes tile i from the prefetch thread if it has been, or is being, read,
+    //handing it data to reuse in exchange
+    bool take_prefetched(size_type i, std::vector<T>& data) const
+    {
+        if (!m_thread.joinable())
+            return false;
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        std::deque<size_type>::iterator q = std::find(m_queue.begin(), m_queue.end(), i);
+        if (q != m_queue.end())
+            m_queue.erase(q);
+        while (m_reading == i)
+            m_read.wait(lock);
+
+        typename std::unordered_map<size_type, std::vector<T> >::iterator s = m_staged.find(i);
+        if (s == m_staged.end())
+            return false;
+
+        if (!data.empty() && m_spare.size() < m_prefetch_tiles)
+            m_spare.push_back(std::move(data));
+        data.swap(s->second);
+        m_staged.erase(s);
+        m_staged_order.erase(std::find(m_staged_order.begin(), m_staged_order.end(), i));
+        return true;
+    }
+
+    //queues the prefetch_tiles tiles after i that aren't already on their way
+    void prefetch_after(size_type i) const
+    {
+        if (!m_thread.joinable())
+            return;
+
+        bool queued = false;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (size_type j = i + 1; j <= i + m_prefetch_tiles && j < m_tile_count; ++j)
+            {
+                if (m_cache.count(j) != 0 || m_staged.count(j) != 0 || m_reading == j ||
+                    std::find(m_queue.begin(), m_queue.end(), j) != m_queue.end())
+                {
+                    continue;
+                }
+                m_queue.push_back(j);
+                queued = true;
+            }
+
+            //requests from further back are unlikely to be wanted any more
+            while (m_queue.size() > m_prefetch_tiles)
+                m_queue.pop_front();
+        }
+        if (queued)
+            m_wake.notify_one();
+    }
+
+    void prefetch_loop()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;)
+        {
+            m_wake.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+            if (m_stop)
+                return;
+
+            const size_type i = m_queue.front();
+            m_queue.pop_front();
+            m_reading = i;
+
+            //make room by dropping the oldest tile that was never looked up
+            std::vector<T> data;
+            if (m_staged.size() >= m_prefetch_tiles)
+            {
+                data.swap(m_staged[m_staged_order.front()]);
+                m_staged.erase(m_staged_order.front());
+                m_staged_order.pop_front();
+            }
+            else if (!m_spare.empty())
+            {
+                data.swap(m_spare.back());
+                m_spare.pop_back();
+            }
+
+            lock.unlock();
+            bool ok = true;
+            try
+            {
+                data.resize(tile_size);
+                const ssize_t size = static_cast<ssize_t>(tile_size * sizeof(T));
+                ok = ::pread(m_fd, data.data(), size, tile_offset(i)) == size;
+            }
+            catch (...)
+            {
+                //the tile will be read again when it is looked up
+                ok = false;
+            }
+            lock.lock();
+
+            if (ok)
+            {
+                m_staged[i].swap(data);
+                m_staged_order.push_back(i);
+                ++m_prefetches;
+            }
+            m_reading = no_tile;
+            m_read.notify_all();
+        }
+    }
+};
+
+template <typename T, std::size_t TW, std::size_t TH>
+std::size_t array2d_width(const ooc_array2d<T, TW, TH>& a) { return a.width(); }
+
+template <typename T, std::size_t TW, std::size_t TH>
+std::size_t array2d_height(const ooc_array2d<T, TW, TH>& a) { return a.height(); }
+
+template <typename T, std::size_t TW, std::size_t TH>
+std::size_t array2d_pitch(const ooc_array2d<T, TW, TH>& a) { return a.pitch(); }
+
+} //array2d
+
+#endif //ARRAY2D_OOC_H
@@ -0,0 +1,530 @@
+/*
+ array2d_parallel.hpp - Parallel loops over the rows and tiles of array2d,
+                        static_array2d and array2d_view, run on a work
+                        stealing thread pool.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#ifndef ARRAY2D_PARALLEL_H
+#define ARRAY2D_PARALLEL_H
+
+#include "array2d.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//the unit of memory shared between cores, parallel loops keep the data each
+//thread writes on separate cache lines
+#ifndef ARRAY2D_CACHE_LINE_SIZE
+#define ARRAY2D_CACHE_LINE_SIZE 64
+#endif
+
+namespace array2d
+{
+
+//How a parallel loop divides its range between threads. static_chunks hands
+//each thread one contiguous share up front. dynamic_chunks splits the range
+//in half on demand, down to grain items, and idle threads steal the halves
+//that haven't been started, which balances uneven work. pinned_chunks deals
+//out the same shares as static_chunks but they are never stolen, so each
+//runs on the thread it was dealt to, for work such as first touch page
+//placement that must land on the same threads every time.
+struct chunking
+{
+    enum mode_type { static_chunks, dynamic_chunks, pinned_chunks };
+
+    mode_type mode;
+
+    //the smallest number of rows or tiles a thread is given at once, 0 picks
+    //one from the size of the range and the number of threads
+    std::size_t grain;
+
+    chunking(mode_type mode = dynamic_chunks, std::size_t grain = 0)
+        : mode(mode), grain(grain) { }
+};
+
+
+//A fixed set of worker threads, each with its own deque of tasks. A worker
+//takes the newest task from its own deque and, when that is empty, steals
+//the oldest task from another. The thread that starts a loop works on it too
+//until it is finished, so loops may be nested and a pool with no workers
+//runs everything on the calling thread.
+class thread_pool
+{
+  private:
+    //runs items [begin, end) of the loop job points at. Pinned tasks are
+    //only run by the threads of the queue they were pushed to.
+    struct task
+    {
+        void (*run)(void* job, std::size_t begin, std::size_t end);
+        void* job;
+        std::size_t begin;
+        std::size_t end;
+        bool pinned;
+    };
+
+    //queues are allocated separately and padded out by a cache line so that
+    //workers pushing and popping their own tasks don't contend
+    struct task_queue
+    {
+        std::mutex mutex;
+        std::deque<task> tasks;
+        char padding[ARRAY2D_CACHE_LINE_SIZE];
+    };
+
+    template <typename F>
+    struct loop
+    {
+        thread_pool* pool;
+        F* f;
+        std::size_t grain;
+        std::size_t multiple;
+        bool split;
+        std::atomic<std::size_t> remaining;
+        std::mutex error_mutex;
+        std::exception_ptr error;
+    };
+
+    //queue 0 is shared by threads outside the pool, queue i + 1 belongs to
+    //worker i
+    std::vector<std::unique_ptr<task_queue> > m_queues;
+    std::vector<std::thread> m_workers;
+
+    //tasks in all the queues, and those of them that can be stolen
+    std::atomic<std::size_t> m_queued;
+    std::atomic<std::size_t> m_stealable;
+    std::atomic<std::size_t> m_sleeping;
+    std::mutex m_sleep_mutex;
+    std::condition_variable m_wake;
+    bool m_stop;
+
+  public:
+    //defaults to one worker per hardware thread besides the caller
+    explicit thread_pool(std::size_t workers = default_workers())
+        : m_queues(), m_workers(), m_queued(0), m_stealable(0), m_sleeping(0), m_stop(false)
+    {
+        for (std::size_t i = 0; i <= workers; ++i)
+            m_queues.emplace_back(new task_queue());
+
+        m_workers.reserve(workers);
+        try
+        {
+            for (std::size_t i = 0; i < workers; ++i)
+                m_workers.emplace_back(&thread_pool::work, this, i + 1);
+        }
+        catch (...)
+        {
+            stop();
+            throw;
+        }
+    }
+
+    ~thread_pool() { stop(); }
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    static std::size_t default_workers()
+    {
+        const std::size_t n = std::thread::hardware_concurrency();
+        return n > 1 ? n - 1 : 0;
+    }
+
+    //the number of threads that work on a loop, the workers and the caller
+    std::size_t concurrency() const { return m_workers.size() + 1; }
+
+    //Calls f(begin, end) on subranges that together cover [0, count) once
+    //each and returns when they have all finished. Every subrange but the
+    //last starts and ends on a multiple of multiple. The first exception
+    //thrown by f is rethrown once the rest of the loop has finished.
+    template <typename F>
+    void parallel_for(std::size_t count, F f, chunking c = chunking(),
+                      std::size_t multiple = 1)
+    {
+        if (count == 0)
+            return;
+        if (multiple == 0)
+            multiple = 1;
+
+        const std::size_t threads = concurrency();
+
+        loop<F> l;
+        l.pool = this;
+        l.f = &f;
+        l.multiple = multiple;
+        l.split = c.mode == chunking::dynamic_chunks;
+        l.remaining.store(count);
+
+        if (l.split)
+        {
+            //enough pieces that a thread finishing early finds more to steal
+            l.grain = round_up(c.grain != 0 ? c.grain : count / (threads * 8), multiple);
+            run_loop<F>(&l, 0, count);
+        }
+        else
+        {
+            l.grain = round_up(c.grain != 0 ? c.grain : (count + threads - 1) / threads,
+                               multiple);
+
+            //shares are dealt out to the workers' own queues in turn, the
+            //caller takes the first
+            const bool pinned = c.mode == chunking::pinned_chunks;
+            std::size_t begin = l.grain;
+            for (std::size_t i = 1; begin < count; ++i, begin += l.grain)
+            {
+                task t = { &run_loop<F>, &l, begin, std::min(begin + l.grain, count), pinned };
+                push(t, i % m_queues.size());
+            }
+            run_loop<F>(&l, 0, std::min(l.grain, count));
+        }
+
+        //help with whatever is queued, ours or not, until every item is done
+        while (l.remaining.load() != 0)
+        {
+            task t;
+            if (pop(t))
+                t.run(t.job, t.begin, t.end);
+            else
+                std::this_thread::yield();
+        }
+
+        if (l.error)
+            std::rethrow_exception(l.error);
+    }
+
+  private:
+    static std::size_t round_up(std::size_t n, std::size_t multiple)
+    { return n == 0 ? multiple : (n + multiple - 1) / multiple * multiple; }
+
+    //set on each worker thread, so a thread can find its own queue
+    static thread_pool*& worker_pool()
+    {
+        static thread_local thread_pool* pool = nullptr;
+        return pool;
+    }
+
+    static std::size_t& worker_queue()
+    {
+        static thread_local std::size_t queue = 0;
+        return queue;
+    }
+
+    //the queue of the calling thread, 0 when it isn't one of our workers
+    std::size_t own_queue() const
+    { return worker_pool() == this ? worker_queue() : 0; }
+
+    template <typename F>
+    static void run_loop(void* job, std::size_t begin, std::size_t end)
+    {
+        loop<F>& l = *static_cast<loop<F>*>(job);
+
+        //keep the first half and leave the second for a thief
+        if (l.split)
+        {
+            while (end - begin > l.grain)
+            {
+                const std::size_t mid =
+                    begin + round_up((end - begin) / 2, l.multiple);
+                if (mid >= end)
+                    break;
+                task t = { &run_loop<F>, job, mid, end, false };
+                l.pool->push(t, l.pool->own_queue());
+                end = mid;
+            }
+        }
+
+        try
+        {
+            (*l.f)(begin, end);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(l.error_mutex);
+            if (!l.error)
+                l.error = std::current_exception();
+        }
+        l.remaining.fetch_sub(end - begin);
+    }
+
+    void push(const task& t, std::size_t queue)
+    {
+        {
+            task_queue& q = *m_queues[queue];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            q.tasks.push_back(t);
+        }
+        m_queued.fetch_add(1);
+        if (!t.pinned)
+            m_stealable.fetch_add(1);
+
+        //a worker going to sleep counts itself before it checks its queue and
+        //m_stealable, so either it sees this task or we see it and wake it.
+        //Only the owner of the queue can run a pinned task, so all are woken.
+        if (m_sleeping.load() != 0)
+        {
+            std::lock_guard<std::mutex> lock(m_sleep_mutex);
+            if (t.pinned)
+                m_wake.notify_all();
+            else
+                m_wake.notify_one();
+        }
+    }
+
+    bool has_tasks(std::size_t queue)
+    {
+        task_queue& q = *m_queues[queue];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        return !q.tasks.empty();
+    }
+
+    //the newest task on our own queue, or else the oldest that isn't pinned
+    //on another
+    bool pop(task& t)
+    {
+        if (m_queued.load() == 0)
+            return false;
+
+        const std::size_t self = own_queue();
+        const std::size_t n = m_queues.size();
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            if (i != 0 && m_stealable.load() == 0)
+                return false;
+
+            task_queue& q = *m_queues[(self + i) % n];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (q.tasks.empty())
+                continue;
+            if (i == 0)
+            {
+                t = q.tasks.back();
+                q.tasks.pop_back();
+            }
+            else
+            {
+                std::deque<task>::iterator it = q.tasks.begin();
+                while (it != q.tasks.end() && it->pinned)
+                    ++it;
+                if (it == q.tasks.end())
+                    continue;
+                t = *it;
+                q.tasks.erase(it);
+            }
+            m_queued.fetch_sub(1);
+            if (!t.pinned)
+                m_stealable.fetch_sub(1);
+            return true;
+        }
+        return false;
+    }
+
+    void work(std::size_t queue)
+    {
+        worker_pool() = this;
+        worker_queue() = queue;
+
+        for (;;)
+        {
+            task t;
+            if (pop(t))
+            {
+                t.run(t.job, t.begin, t.end);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(m_sleep_mutex);
+            m_sleeping.fetch_add(1);
+            m_wake.wait(lock, [this, queue]
+                        { return m_stop || m_stealable.load() != 0 || has_tasks(queue); });
+            m_sleeping.fetch_sub(1);
+            if (m_stop)
+                return;
+        }
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_sleep_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        for (std::size_t i = 0; i < m_workers.size(); ++i)
+            m_workers[i].join();
+        m_workers.clear();
+    }
+};
+
+//the pool used by parallel loops that aren't given one, created on first use
+inline thread_pool& default_thread_pool()
+{
+    static thread_pool pool;
+    return pool;
+}
+
+
+//The number of rows (or columns) a thread's share is rounded to, so that
+//neighbouring shares start on separate cache lines and threads don't write to
+//the same line. Shares of rows of a row_major grid begin on a cache line when
+//a whole number of rows fills a whole number of lines. Column_major needs a
+//whole line of each column. Tiled layouts split between rows of tiles, and
+//morton between blocks of at least a cache line.
+
+template <typename T>
+std::size_t parallel_row_multiple(row_major, std::size_t pitch)
+{
+    return ARRAY2D_CACHE_LINE_SIZE /
+           array2d_gcd(ARRAY2D_CACHE_LINE_SIZE, pitch * sizeof(T));
+}
+
+template <typename T>
+std::size_t parallel_row_multiple(column_major, std::size_t)
+{ return ARRAY2D_CACHE_LINE_SIZE / array2d_gcd(ARRAY2D_CACHE_LINE_SIZE, sizeof(T)); }
+
+template <typename T, std::size_t TileWidth, std::size_t TileHeight>
+std::size_t parallel_row_multiple(tiled<TileWidth, TileHeight>, std::size_t)
+{ return TileHeight; }
+
+template <typename T>
+std::size_t parallel_row_multiple(morton, std::size_t)
+{
+    std::size_t side = 1;
+    while (side * side * sizeof(T) < ARRAY2D_CACHE_LINE_SIZE)
+        side *= 2;
+    return side;
+}
+
+template <typename T>
+std::size_t parallel_column_multiple(row_major, std::size_t)
+{ return ARRAY2D_CACHE_LINE_SIZE / array2d_gcd(ARRAY2D_CACHE_LINE_SIZE, sizeof(T)); }
+
+template <typename T>
+std::size_t parallel_column_multiple(column_major, std::size_t pitch)
+{
+    return ARRAY2D_CACHE_LINE_SIZE /
+           array2d_gcd(ARRAY2D_CACHE_LINE_SIZE, pitch * sizeof(T));
+}
+
+template <typename T, std::size_t TileWidth, std::size_t TileHeight>
+std::size_t parallel_column_multiple(tiled<TileWidth, TileHeight>, std::size_t)
+{ return TileWidth; }
+
+template <typename T>
+std::size_t parallel_column_multiple(morton, std::size_t pitch)
+{ return parallel_row_multiple<T>(morton(), pitch); }
+
+
+//Calls f(y) once for every row y of a, spreading the rows over the threads of
+//pool. Shares of rows are rounded to parallel_row_multiple.
+template <typename Grid, typename F>
+void parallel_for_rows(Grid& a, F f, chunking c = chunking(),
+                       thread_pool& pool = default_thread_pool())
+{
+    typedef typename Grid::value_type value_type;
+    typedef typename Grid::layout_type layout_type;
+
+    const std::size_t multiple =
+        parallel_row_multiple<value_type>(layout_type(), array2d_pitch(a));
+    pool.parallel_for(array2d_height(a),
+                      [&f](std::size_t begin, std::size_t end)
+                      {
+                          for (std::size_t y = begin; y < end; ++y)
+                              f(y);
+                      },
+                      c, multiple);
+}
+
+//Calls f(x, y, w, h) once for every tile of a, where (x, y) is the top left
+//element of the tile and w by h its size. Tiles on the right and bottom edges
+//are cut short by the grid. tile_width and tile_height are rounded up to
+//parallel_column_multiple and parallel_row_multiple so that no two tiles share
+//a cache line. The grain of c counts tiles.
+template <typename Grid, typename F>
+void parallel_for_tiles(Grid& a, std::size_t tile_width, std::size_t tile_height, F f,
+                        chunking c = chunking(),
+                        thread_pool& pool = default_thread_pool())
+{
+    typedef typename Grid::value_type value_type;
+    typedef typename Grid::layout_type layout_type;
+
+    const std::size_t width = array2d_width(a);
+    const std::size_t height = array2d_height(a);
+    const std::size_t pitch = array2d_pitch(a);
+    if (width == 0 || height == 0)
+        return;
+
+    const std::size_t xm = parallel_column_multiple<value_type>(layout_type(), pitch);
+    const std::size_t ym = parallel_row_multiple<value_type>(layout_type(), pitch);
+    const std::size_t tw = tile_width == 0 ? xm : (tile_width + xm - 1) / xm * xm;
+    const std::size_t th = tile_height == 0 ? ym : (tile_height + ym - 1) / ym * ym;
+    const std::size_t across = (width + tw - 1) / tw;
+    const std::size_t down = (height + th - 1) / th;
+
+    pool.parallel_for(across * down,
+                      [&](std::size_t begin, std::size_t end)
+                      {
+                          for (std::size_t i = begin; i < end; ++i)
+                          {
+                              const std::size_t x = i % across * tw;
+                              const std::size_t y = i / across * th;
+                              f(x, y, std::min(tw, width - x), std::min(th, height - y));
+                          }
+                      },
+                      c);
+}
+
+//dst(x, y) = f(src(x, y)) for every element, with the rows of dst spread
+//over the threads of pool. src and dst must have the same dimensions, and may
+//be the same grid.
+template <typename Src, typename Dst, typename F>
+void parallel_transform(const Src& src, Dst& dst, F f, chunking c = chunking(),
+                        thread_pool& pool = default_thread_pool())
+{
+    typedef typename Dst::value_type value_type;
+    typedef typename Dst::layout_type layout_type;
+
+    const std::size_t multiple =
+        parallel_row_multiple<value_type>(layout_type(), array2d_pitch(dst));
+    pool.parallel_for(array2d_height(dst),
+                      [&](std::size_t begin, std::size_t end)
+                      {
+                          for (std::size_t y = begin; y < end; ++y)
+                              std::transform(src.row_begin(y), src.row_end(y),
+                                             dst.row_begin(y), f);
+                      },
+                      c, multiple);
+}
+
+} //array2d
+
+#endif //ARRAY2D_PARALLEL_H
@@ -0,0 +1,564 @@
+/*
+ array2d_profile.hpp - Access counting and hardware counter sampling for
+                       finding grids that are walked in cache hostile ways.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#ifndef ARRAY2D_PROFILE_H
+#define ARRAY2D_PROFILE_H
+
+#include "array2d.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace array2d
+{
+
+//Histogram bins for the distance in elements between consecutive accesses.
+//Bin 0 counts repeated accesses to one element and bin k > 0 distances from
+//2^(k - 1) up to 2^k - 1, with the last bin taking everything larger.
+constexpr std::size_t array2d_stride_bins = 33;
+
+inline std::size_t array2d_stride_bin(std::uint64_t stride)
+{
+    std::size_t bin = 0;
+    while (stride != 0 && bin < array2d_stride_bins - 1)
+    {
+        stride >>= 1;
+        ++bin;
+    }
+    return bin;
+}
+
+//What a profiled grid has counted. Nothing here is atomic, so a grid should
+//be profiled from one thread at a time.
+struct array2d_access_counts
+{
+    std::uint64_t index_calls;  //index(x, y) and operator()
+    std::uint64_t row_steps;    //moves of a row_iterator
+    std::uint64_t column_steps; //moves of a column_iterator
+    std::uint64_t grid_steps;   //moves of an iterator over every element
+    std::uint64_t emplaces;
+    std::uint64_t copies;       //times the grid was copied from
+    std::uint64_t moves;        //times the grid was moved from
+
+    //distances between consecutive index() calls, see array2d_stride_bin, so
+    //one fewer than index_calls
+    std::uint64_t index_strides[array2d_stride_bins];
+
+    //totals over the array2d_perf_regions that could read the hardware
+    //counters, and how many regions ran without them
+    std::uint64_t perf_regions;
+    std::uint64_t perf_unavailable;
+    std::uint64_t cycles;
+    std::uint64_t instructions;
+    std::uint64_t cache_references;
+    std::uint64_t cache_misses;
+
+    array2d_access_counts() { reset(); }
+
+    void reset() { std::memset(this, 0, sizeof(*this)); }
+};
+
+
+//Times a region of code with the CPU's cycle, instruction and last level
+//cache counters, adding them to counts when it ends. The counters are opened
+//with perf_event_open for this thread, user space only. They can't be opened
+//off Linux, in many containers, or when the kernel's perf_event_paranoid
+//setting forbids it, and then the region only counts itself in
+//perf_unavailable.
+class array2d_perf_region
+{
+    enum { cycles, instructions, cache_references, cache_misses, counters };
+
+    array2d_access_counts* m_counts;
+    int m_fd[counters];
+
+  public:
+    explicit array2d_perf_region(array2d_access_counts& counts)
+        : m_counts(&counts)
+    {
+        for (int i = 0; i < counters; ++i)
+            m_fd[i] = -1;
+#ifdef __linux__
+        static const std::uint64_t configs[counters] = {
+            PERF_COUNT_HW_CPU_CYCLES,
+            PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_REFERENCES,
+            PERF_COUNT_HW_CACHE_MISSES
+        };
+
+        for (int i = 0; i < counters; ++i)
+        {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.size = sizeof(attr);
+            attr.config = configs[i];
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            m_fd[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+            if (m_fd[i] < 0)
+            {
+                close_counters();
+                return;
+            }
+        }
+
+        for (int i = 0; i < counters; ++i)
+        {
+            ioctl(m_fd[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(m_fd[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    array2d_perf_region(const array2d_perf_region&) = delete;
+    array2d_perf_region& operator=(const array2d_perf_region&) = delete;
+
+    ~array2d_perf_region()
+    {
+        if (m_fd[0] < 0)
+        {
+            ++m_counts->perf_unavailable;
+            return;
+        }
+
+#ifdef __linux__
+        std::uint64_t values[counters];
+        for (int i = 0; i < counters; ++i)
+            ioctl(m_fd[i], PERF_EVENT_IOC_DISABLE, 0);
+        bool ok = true;
+        for (int i = 0; i < counters; ++i)
+            ok = read(m_fd[i], &values[i], sizeof(values[i])) == sizeof(values[i]) && ok;
+        close_counters();
+
+        if (!ok)
+        {
+            ++m_counts->perf_unavailable;
+            return;
+        }
+
+        ++m_counts->perf_regions;
+        m_counts->cycles += values[cycles];
+        m_counts->instructions += values[instructions];
+        m_counts->cache_references += values[cache_references];
+        m_counts->cache_misses += values[cache_misses];
+#endif
+    }
+
+    //whether the hardware counters are running
+    bool available() const { return m_fd[0] >= 0; }
+
+  private:
+    void close_counters()
+    {
+        for (int i = 0; i < counters; ++i)
+        {
+#ifdef __linux__
+            if (m_fd[i] >= 0)
+                close(m_fd[i]);
+#endif
+            m_fd[i] = -1;
+        }
+    }
+};
+
+
+//An iterator that counts how far it has been moved in *steps. Everything
+//else is done by the iterator it wraps, which base() returns.
+template <typename Iter>
+struct array2d_counted_iterator
+{
+    typedef typename std::iterator_traits<Iter>::difference_type   difference_type;
+    typedef typename std::iterator_traits<Iter>::iterator_category iterator_category;
+    typedef typename std::iterator_traits<Iter>::value_type        value_type;
+    typedef typename std::iterator_traits<Iter>::pointer           pointer;
+    typedef typename std::iterator_traits<Iter>::reference         reference;
+
+    Iter _m_it;
+    std::uint64_t* _m_steps;
+
+    array2d_counted_iterator() : _m_it(), _m_steps(nullptr) { }
+    array2d_counted_iterator(Iter it, std::uint64_t* steps) : _m_it(it), _m_steps(steps) { }
+
+    //allow non-const to const conversion
+    template <typename I>
+    array2d_counted_iterator(const array2d_counted_iterator<I>& o,
+                             typename std::enable_if<
+                                 std::is_convertible<I, Iter>::value
+                             >::type* = nullptr)
+        : _m_it(o._m_it), _m_steps(o._m_steps)
+    { }
+
+    Iter base() const { return _m_it; }
+
+    reference operator*() const { return *_m_it; }
+    pointer operator->() const { return std::addressof(*_m_it); }
+
+    array2d_counted_iterator& operator++()
+    {
+        ++*_m_steps;
+        ++_m_it;
+        return *this;
+    }
+    array2d_counted_iterator operator++(int)
+    {
+        array2d_counted_iterator tmp(*this);
+        ++*this;
+        return tmp;
+    }
+
+    array2d_counted_iterator& operator--()
+    {
+        ++*_m_steps;
+        --_m_it;
+        return *this;
+    }
+    array2d_counted_iterator operator--(int)
+    {
+        array2d_counted_iterator tmp(*this);
+        --*this;
+        return tmp;
+    }
+
+    array2d_counted_iterator& operator+=(difference_type n)
+    {
+        *_m_steps += n < 0 ? -n : n;
+        _m_it += n;
+        return *this;
+    }
+
+    array2d_counted_iterator& operator-=(difference_type n) { return *this += -n; }
+
+    array2d_counted_iterator operator+(difference_type n) const
+    {
+        array2d_counted_iterator tmp(*this);
+        return tmp += n;
+    }
+
+    array2d_counted_iterator operator-(difference_type n) const
+    {
+        array2d_counted_iterator tmp(*this);
+        return tmp += -n;
+    }
+
+    template <typename I>
+    difference_type operator-(const array2d_counted_iterator<I>& o) const
+    { return _m_it - o._m_it; }
+
+    //jumps straight to the element, so counts as one step
+    reference operator[](difference_type n) const
+    {
+        ++*_m_steps;
+        return _m_it[n];
+    }
+
+    template <typename I>
+    bool operator==(const array2d_counted_iterator<I>& o) const { return _m_it == o._m_it; }
+    template <typename I>
+    bool operator!=(const array2d_counted_iterator<I>& o) const { return _m_it != o._m_it; }
+
+    template <typename I>
+    bool operator<(const array2d_counted_iterator<I>& o) const { return _m_it < o._m_it; }
+    template <typename I>
+    bool operator>(const array2d_counted_iterator<I>& o) const { return _m_it > o._m_it; }
+
+    template <typename I>
+    bool operator<=(const array2d_counted_iterator<I>& o) const { return !(_m_it > o._m_it); }
+    template <typename I>
+    bool operator>=(const array2d_counted_iterator<I>& o) const { return !(_m_it < o._m_it); }
+};
+
+
+//Wraps a grid (array2d, static_array2d, array2d_view, ring_array2d or any
+//other with the same interface) and counts how it is used: index() calls and
+//the distance between consecutive ones, steps of each kind of iterator,
+//emplaces, copies and moves. report() writes the counts out and points out
+//column walks that would be unit stride if the grid were transposed.
+//
+//Profiling is chosen at compile time by which type a grid is declared as, so
+//the usual way to use this is a typedef that switches on a build flag:
+//
+//  #ifdef PROFILE_GRIDS
+//  typedef array2d::profiled_array2d<array2d::array2d<float> > frame_type;
+//  #else
+//  typedef array2d::array2d<float> frame_type;
+//  #endif
+//
+//Grids that aren't wrapped are untouched, so there is no cost when it's off.
+template <typename Grid>
+class profiled_array2d
+{
+  public:
+    typedef Grid                                 grid_type;
+    typedef typename Grid::value_type            value_type;
+    typedef typename Grid::reference             reference;
+    typedef typename Grid::const_reference       const_reference;
+    typedef typename Grid::size_type             size_type;
+    typedef typename Grid::difference_type       difference_type;
+
+    typedef array2d_counted_iterator<typename Grid::iterator>              iterator;
+    typedef array2d_counted_iterator<typename Grid::const_iterator>        const_iterator;
+    typedef array2d_counted_iterator<typename Grid::row_iterator>          row_iterator;
+    typedef array2d_counted_iterator<typename Grid::const_row_iterator>    const_row_iterator;
+    typedef array2d_counted_iterator<typename Grid::column_iterator>       column_iterator;
+    typedef array2d_counted_iterator<typename Grid::const_column_iterator> const_column_iterator;
+
+  private:
+    Grid m_grid;
+    mutable array2d_access_counts m_counts;
+    mutable const volatile void* m_last;
+
+  public:
+    //constructs the grid from args
+    template <typename Arg, typename... Args,
+              typename = typename std::enable_if<
+                  !std::is_same<typename std::decay<Arg>::type, profiled_array2d>::value
+              >::type>
+    explicit profiled_array2d(Arg&& arg, Args&&... args)
+        : m_grid(std::forward<Arg>(arg), std::forward<Args>(args)...), m_counts(),
+          m_last(nullptr)
+    { }
+
+    //the copy starts with no counts, the grid copied from counts a copy
+    profiled_array2d(const profiled_array2d& o)
+        : m_grid(o.m_grid), m_counts(), m_last(nullptr)
+    { ++o.m_counts.copies; }
+
+    profiled_array2d(profiled_array2d&& o)
+        : m_grid(std::move(o.m_grid)), m_counts(), m_last(nullptr)
+    { ++o.m_counts.moves; }
+
+    profiled_array2d& operator=(const profiled_array2d& o)
+    {
+        m_grid = o.m_grid;
+        ++o.m_counts.copies;
+        return *this;
+    }
+
+    profiled_array2d& operator=(profiled_array2d&& o)
+    {
+        m_grid = std::move(o.m_grid);
+        ++o.m_counts.moves;
+        return *this;
+    }
+
+    //the wrapped grid, whose use isn't counted
+    Grid& grid() { return m_grid; }
+    const Grid& grid() const { return m_grid; }
+
+    size_type width() const { return array2d_width(m_grid); }
+    size_type height() const { return array2d_height(m_grid); }
+
+    const array2d_access_counts& counts() const { return m_counts; }
+    void reset_counts()
+    {
+        m_counts.reset();
+        m_last = nullptr;
+    }
+
+    //starts sampling the hardware counters for this grid until the returned
+    //region is destroyed
+    std::unique_ptr<array2d_perf_region> perf_region() const
+    { return std::unique_ptr<array2d_perf_region>(new array2d_perf_region(m_counts)); }
+
+    iterator begin() { return iterator(m_grid.begin(), &m_counts.grid_steps); }
+    const_iterator begin() const { return const_iterator(m_grid.begin(), &m_counts.grid_steps); }
+
+    iterator end() { return iterator(m_grid.end(), &m_counts.grid_steps); }
+    const_iterator end() const { return const_iterator(m_grid.end(), &m_counts.grid_steps); }
+
+    row_iterator row_begin(size_type y)
+    { return row_iterator(m_grid.row_begin(y), &m_counts.row_steps); }
+    const_row_iterator row_begin(size_type y) const
+    { return const_row_iterator(m_grid.row_begin(y), &m_counts.row_steps); }
+
+    row_iterator row_end(size_type y)
+    { return row_iterator(m_grid.row_end(y), &m_counts.row_steps); }
+    const_row_iterator row_end(size_type y) const
+    { return const_row_iterator(m_grid.row_end(y), &m_counts.row_steps); }
+
+    column_iterator column_begin(size_type x)
+    { return column_iterator(m_grid.column_begin(x), &m_counts.column_steps); }
+    const_column_iterator column_begin(size_type x) const
+    { return const_column_iterator(m_grid.column_begin(x), &m_counts.column_steps); }
+
+    column_iterator column_end(size_type x)
+    { return column_iterator(m_grid.column_end(x), &m_counts.column_steps); }
+    const_column_iterator column_end(size_type x) const
+    { return const_column_iterator(m_grid.column_end(x), &m_counts.column_steps); }
+
+    reference index(size_type x, size_type y) { return count_index(m_grid.index(x, y)); }
+    const_reference index(size_type x, size_type y) const
+    { return count_index(m_grid.index(x, y)); }
+
+    reference operator()(size_type x, size_type y) { return index(x, y); }
+    const_reference operator()(size_type x, size_type y) const { return index(x, y); }
+
+    template <typename... Args>
+    iterator emplace(size_type x, size_type y, Args&&... args)
+    {
+        ++m_counts.emplaces;
+        return iterator(m_grid.emplace(x, y, std::forward<Args>(args)...),
+                        &m_counts.grid_steps);
+    }
+
+    //pos may be an iterator, row_iterator or column_iterator
+    template <typename Iter, typename... Args>
+    array2d_counted_iterator<Iter> emplace(array2d_counted_iterator<Iter> pos,
+                                           Args&&... args)
+    {
+        ++m_counts.emplaces;
+        return array2d_counted_iterator<Iter>(
+            m_grid.emplace(pos.base(), std::forward<Args>(args)...), pos._m_steps);
+    }
+
+    //Writes the counts, one per line, under a heading of name and the grid's
+    //dimensions. Row and column steps are shown with the distance in elements
+    //each one moves, measured on the grid as it is now.
+    void report(std::ostream& os, const std::string& name = std::string()) const
+    {
+        const std::uint64_t row_stride = step_stride(1, 0);
+        const std::uint64_t column_stride = step_stride(0, 1);
+
+        os << "array2d profile";
+        if (!name.empty())
+            os << ' ' << name;
+        os << " (" << width() << 'x' << height() << ")\n";
+        os << "  index calls    " << m_counts.index_calls << '\n';
+        os << "  row steps      " << m_counts.row_steps << " (stride " << row_stride << ")\n";
+        os << "  column steps   " << m_counts.column_steps
+           << " (stride " << column_stride << ")\n";
+        os << "  grid steps     " << m_counts.grid_steps << '\n';
+        os << "  emplaces       " << m_counts.emplaces << '\n';
+        os << "  copied from    " << m_counts.copies << '\n';
+        os << "  moved from     " << m_counts.moves << '\n';
+
+        //strides are between calls, so there are none until the second
+        if (m_counts.index_calls > 1)
+        {
+            os << "  index strides ";
+            for (std::size_t i = 0; i < array2d_stride_bins; ++i)
+            {
+                if (m_counts.index_strides[i] == 0)
+                    continue;
+                const std::uint64_t low = i == 0 ? 0 : std::uint64_t(1) << (i - 1);
+                os << ' ' << low;
+                if (i > 1 && i < array2d_stride_bins - 1)
+                    os << '-' << (low * 2 - 1);
+                else if (i == array2d_stride_bins - 1)
+                    os << '+';
+                os << ':' << m_counts.index_strides[i];
+            }
+            os << '\n';
+        }
+
+        if (m_counts.perf_regions != 0)
+        {
+            os << "  perf regions   " << m_counts.perf_regions
+               << ": cycles " << m_counts.cycles
+               << ", instructions " << m_counts.instructions
+               << ", cache references " << m_counts.cache_references
+               << ", cache misses " << m_counts.cache_misses << '\n';
+        }
+        if (m_counts.perf_unavailable != 0)
+        {
+            os << "  perf regions without hardware counters "
+               << m_counts.perf_unavailable << '\n';
+        }
+
+        //a walk is worth transposing when it is most of the traffic and the
+        //other direction would be unit stride
+        const std::uint64_t steps = m_counts.row_steps + m_counts.column_steps +
+                                    m_counts.grid_steps;
+        if (column_stride > 1 && row_stride == 1 && m_counts.column_steps * 2 > steps)
+        {
+            os << "  most steps walk columns " << column_stride
+               << " elements apart, transposing the grid would make them unit stride\n";
+        }
+        else if (row_stride > 1 && column_stride == 1 && m_counts.row_steps * 2 > steps)
+        {
+            os << "  most steps walk rows " << row_stride
+               << " elements apart, transposing the grid would make them unit stride\n";
+        }
+    }
+
+  private:
+    template <typename R>
+    R& count_index(R& r) const
+    {
+        typedef const volatile typename std::remove_reference<R>::type* address;
+        address p = std::addressof(r);
+        ++m_counts.index_calls;
+        //the first access has nothing to be a distance from
+        if (m_last)
+        {
+            const std::ptrdiff_t d = p - static_cast<address>(m_last);
+            ++m_counts.index_strides[array2d_stride_bin(d < 0 ? -d : d)];
+        }
+        m_last = p;
+        return r;
+    }
+
+    //how many elements apart (0, 0) and (dx, dy) are stored
+    std::uint64_t step_stride(size_type dx, size_type dy) const
+    {
+        if (width() <= dx || height() <= dy)
+            return 0;
+        typedef const volatile value_type* address;
+        const Grid& g = m_grid;
+        const std::ptrdiff_t d = static_cast<address>(std::addressof(g.index(dx, dy))) -
+                                 static_cast<address>(std::addressof(g.index(0, 0)));
+        return d < 0 ? -d : d;
+    }
+};
+
+
+template <typename Grid>
+std::size_t array2d_width(const profiled_array2d<Grid>& a) { return a.width(); }
+
+template <typename Grid>
+std::size_t array2d_height(const profiled_array2d<Grid>& a) { return a.height(); }
+
+} //array2d
+
+#endif //ARRAY2D_PROFILE_H
@@ -0,0 +1,415 @@
+/*
+ array2d_reduce.hpp - Reductions along the rows, columns and whole of array2d,
+                      static_array2d and array2d_view, and two dimensional
+                      prefix sums.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#ifndef ARRAY2D_REDUCE_H
+#define ARRAY2D_REDUCE_H
+
+#include "array2d.hpp"
+#include "array2d_expr.hpp"
+#include "array2d_parallel.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace array2d
+{
+
+//Reductions combine elements with an operation from array2d_expr.hpp, such as
+//plus_op, multiplies_op, min_op or max_op, or any type with the same static
+//apply (and packet, if it is vectorizable). The operation must be
+//associative. Work is split between threads so that every result is computed
+//in the same order whatever the number of threads or the chunking, so
+//floating point results are reproducible.
+
+//a row_major row iterator is only a pointer, which the vectorized loops use
+template <typename Iter>
+Iter reduce_pointer(const Iter& it) { return it; }
+
+template <typename T, typename Pointer, typename Reference>
+Pointer reduce_pointer(const array2d_iterator<T, Pointer, Reference>& it) { return it._m_pos; }
+
+template <typename T, typename Op>
+struct reduce_vectorized
+    : std::integral_constant<bool, Op::vectorizable && (simd<T>::width > 1)>
+{ };
+
+
+template <typename Iter, typename Op>
+typename std::iterator_traits<Iter>::value_type
+reduce_line(Iter first, std::size_t n, Op, std::false_type)
+{
+    typename std::iterator_traits<Iter>::value_type r = *first;
+    for (std::size_t i = 1; i < n; ++i)
+        r = Op::apply(r, *++first);
+    return r;
+}
+
+//Four registers of partial results hide the latency of the operation. They
+//are combined with each other and then lane by lane in a fixed order.
+template <typename T, typename Op>
+T reduce_line(const T* p, std::size_t n, Op op, std::true_type)
+{
+    typedef simd<T> S;
+    const std::size_t w = S::width;
+    if (n < 4 * w)
+        return reduce_line(p, n, op, std::false_type());
+
+    typename S::type r0 = S::load(p);
+    typename S::type r1 = S::load(p + w);
+    typename S::type r2 = S::load(p + 2 * w);
+    typename S::type r3 = S::load(p + 3 * w);
+    std::size_t i = 4 * w;
+    for (; i + 4 * w <= n; i += 4 * w)
+    {
+        r0 = Op::template packet<T>(r0, S::load(p + i));
+        r1 = Op::template packet<T>(r1, S::load(p + i + w));
+        r2 = Op::template packet<T>(r2, S::load(p + i + 2 * w));
+        r3 = Op::template packet<T>(r3, S::load(p + i + 3 * w));
+    }
+    for (; i + w <= n; i += w)
+        r0 = Op::template packet<T>(r0, S::load(p + i));
+    r0 = Op::template packet<T>(Op::template packet<T>(r0, r1),
+                                Op::template packet<T>(r2, r3));
+
+    T lanes[S::width];
+    S::store(lanes, r0);
+    T r = reduce_line(lanes, w, op, std::false_type());
+    for (; i < n; ++i)
+        r = Op::apply(r, p[i]);
+    return r;
+}
+
+//op over the n > 0 elements from first on, vectorized when first is a pointer
+template <typename Iter, typename Op>
+typename std::iterator_traits<Iter>::value_type reduce_line(Iter first, std::size_t n, Op op)
+{
+    typedef typename std::iterator_traits<Iter>::value_type T;
+    return reduce_line(first, n, op, std::integral_constant<bool,
+                           std::is_pointer<Iter>::value && reduce_vectorized<T, Op>::value>());
+}
+
+
+template <typename Acc, typename Iter, typename Op>
+void reduce_accumulate(Acc acc, Iter first, std::size_t n, Op, std::false_type)
+{
+    for (std::size_t i = 0; i < n; ++i, ++acc, ++first)
+        *acc = Op::apply(*acc, static_cast<typename std::iterator_traits<Acc>::value_type>(*first));
+}
+
+template <typename T, typename Op>
+void reduce_accumulate(T* acc, const T* p, std::size_t n, Op op, std::true_type)
+{
+    typedef simd<T> S;
+    const std::size_t w = S::width;
+    std::size_t i = 0;
+    for (; i + w <= n; i += w)
+        S::store(acc + i, Op::template packet<T>(S::load(acc + i), S::load(p + i)));
+    reduce_accumulate(acc + i, p + i, n - i, op, std::false_type());
+}
+
+//acc[i] = op(acc[i], first[i]) for i in [0, n), vectorized when both are
+//pointers to the same type
+template <typename Acc, typename Iter, typename Op>
+void reduce_accumulate(Acc acc, Iter first, std::size_t n, Op op)
+{
+    typedef typename std::iterator_traits<Acc>::value_type T;
+    typedef typename std::iterator_traits<Iter>::value_type U;
+    reduce_accumulate(acc, first, n, op, std::integral_constant<bool,
+                          std::is_pointer<Acc>::value && std::is_pointer<Iter>::value &&
+                          std::is_same<T, U>::value && reduce_vectorized<T, Op>::value>());
+}
+
+
+//the elements of a row whose running reduction fits in the L1 cache, for
+//reductions down columns
+template <typename T>
+std::size_t reduce_block()
+{ return std::max<std::size_t>(16 * 1024 / sizeof(T), 1); }
+
+//res[x] = op down column x for x in [begin, end), or with Across across row
+//x. Lines are accumulated one after the other, a block at a time, so memory
+//is read in order.
+template <bool Across, typename Grid, typename T, typename Op>
+void reduce_lines_range(const Grid& a, T* res, std::size_t begin, std::size_t end, Op op)
+{
+    const std::size_t lines = Across ? array2d_width(a) : array2d_height(a);
+    const std::size_t block = reduce_block<T>();
+    for (std::size_t i = begin; i < end; i += block)
+    {
+        const std::size_t n = std::min(block, end - i);
+        if (Across)
+        {
+            std::copy(a.column_begin(0) + i, a.column_begin(0) + i + n, res + i);
+            for (std::size_t x = 1; x < lines; ++x)
+                reduce_accumulate(res + i, reduce_pointer(a.column_begin(x) + i), n, op);
+        }
+        else
+        {
+            std::copy(a.row_begin(0) + i, a.row_begin(0) + i + n, res + i);
+            for (std::size_t y = 1; y < lines; ++y)
+                reduce_accumulate(res + i, reduce_pointer(a.row_begin(y) + i), n, op);
+        }
+    }
+}
+
+//res[y] = op over row y, one row at a time
+template <typename Grid, typename T, typename Op, typename Layout>
+void reduce_rows_into(const Grid& a, T* res, Op op, chunking c, thread_pool& pool, Layout)
+{
+    const std::size_t width = array2d_width(a);
+    pool.parallel_for(array2d_height(a),
+                      [&](std::size_t begin, std::size_t end)
+                      {
+                          for (std::size_t y = begin; y < end; ++y)
+                              res[y] = reduce_line(reduce_pointer(a.row_begin(y)), width, op);
+                      },
+                      c, parallel_row_multiple<T>(Layout(), array2d_pitch(a)));
+}
+
+//a column_major grid accumulates its contiguous columns instead
+template <typename Grid, typename T, typename Op>
+void reduce_rows_into(const Grid& a, T* res, Op op, chunking c, thread_pool& pool,
+                      column_major)
+{
+    pool.parallel_for(array2d_height(a),
+                      [&](std::size_t begin, std::size_t end)
+                      { reduce_lines_range<true>(a, res, begin, end, op); },
+                      c, parallel_row_multiple<T>(column_major(), array2d_pitch(a)));
+}
+
+//res[x] = op down column x, accumulating a row at a time
+template <typename Grid, typename T, typename Op, typename Layout>
+void reduce_columns_into(const Grid& a, T* res, Op op, chunking c, thread_pool& pool, Layout)
+{
+    pool.parallel_for(array2d_width(a),
+                      [&](std::size_t begin, std::size_t end)
+                      { reduce_lines_range<false>(a, res, begin, end, op); },
+                      c, parallel_column_multiple<T>(Layout(), array2d_pitch(a)));
+}
+
+//a column_major grid reduces its contiguous columns one at a time
+template <typename Grid, typename T, typename Op>
+void reduce_columns_into(const Grid& a, T* res, Op op, chunking c, thread_pool& pool,
+                         column_major)
+{
+    const std::size_t height = array2d_height(a);
+    pool.parallel_for(array2d_width(a),
+                      [&](std::size_t begin, std::size_t end)
+                      {
+                          for (std::size_t x = begin; x < end; ++x)
+                              res[x] = reduce_line(reduce_pointer(a.column_begin(x)), height, op);
+                      },
+                      c, parallel_column_multiple<T>(column_major(), array2d_pitch(a)));
+}
+
+
+//Writes op over each row of a to out, from the top row down, and returns out
+//advanced past the last. Rows of a row_major grid are reduced a vector
+//register at a time, those of a column_major grid by accumulating whole
+//columns. The result for a row with no elements is value_type().
+template <typename Grid, typename OutputIt, typename Op = plus_op>
+OutputIt reduce_rows(const Grid& a, OutputIt out, Op op = Op(), chunking c = chunking(),
+                     thread_pool& pool = default_thread_pool())
+{
+    typedef typename Grid::value_type T;
+
+    const std::size_t height = array2d_height(a);
+    if (array2d_width(a) == 0)
+        return std::fill_n(out, height, T());
+
+    std::vector<T> res(height);
+    reduce_rows_into(a, res.data(), op, c, pool, typename Grid::layout_type());
+    return std::copy(res.begin(), res.end(), out);
+}
+
+//Writes op down each column of a to out, from the left column across, and
+//returns out advanced past the last. Columns are accumulated a row at a time,
+//so a row_major grid is read in memory order and vectorized across the
+//columns, and each thread takes a band of columns. Columns of a column_major
+//grid are reduced directly. The result for a column with no elements is
+//value_type().
+template <typename Grid, typename OutputIt, typename Op = plus_op>
+OutputIt reduce_columns(const Grid& a, OutputIt out, Op op = Op(), chunking c = chunking(),
+                        thread_pool& pool = default_thread_pool())
+{
+    typedef typename Grid::value_type T;
+
+    const std::size_t width = array2d_width(a);
+    if (array2d_height(a) == 0)
+        return std::fill_n(out, width, T());
+
+    std::vector<T> res(width);
+    reduce_columns_into(a, res.data(), op, c, pool, typename Grid::layout_type());
+    return std::copy(res.begin(), res.end(), out);
+}
+
+//op over every element of a, or value_type() when a is empty. Each row (each
+//column of a column_major grid) is reduced separately and the results are
+//then reduced in order.
+template <typename Grid, typename Op = plus_op>
+typename Grid::value_type reduce_all(const Grid& a, Op op = Op(), chunking c = chunking(),
+                                     thread_pool& pool = default_thread_pool())
+{
+    typedef typename Grid::value_type T;
+    typedef typename Grid::layout_type layout_type;
+
+    const std::size_t width = array2d_width(a);
+    const std::size_t height = array2d_height(a);
+    if (width == 0 || height == 0)
+        return T();
+
+    const bool by_column = std::is_same<layout_type, column_major>::value;
+    std::vector<T> res(by_column ? width : height);
+    if (by_column)
+        reduce_columns_into(a, res.data(), op, c, pool, layout_type());
+    else
+        reduce_rows_into(a, res.data(), op, c, pool, layout_type());
+    return reduce_line(res.data(), res.size(), op);
+}
+
+
+//The position of the first extreme element of each row, found with a
+//vectorized reduction of the row and then a search for its result
+template <typename Op, typename Iter>
+std::size_t reduce_find(Iter first, std::size_t n)
+{
+    const typename std::iterator_traits<Iter>::value_type m = reduce_line(first, n, Op());
+    std::size_t x = 0;
+    while (*first != m)
+        ++first, ++x;
+    return x;
+}
+
+template <typename Op, typename Grid>
+std::pair<std::size_t, std::size_t> reduce_arg(const Grid& a, chunking c, thread_pool& pool)
+{
+    typedef typename Grid::value_type T;
+    typedef typename Grid::layout_type layout_type;
+
+    const std::size_t width = array2d_width(a);
+    const std::size_t height = array2d_height(a);
+    if (width == 0 || height == 0)
+        throw std::invalid_argument("no extreme element of an empty grid");
+
+    std::vector<std::size_t> xs(height);
+    pool.parallel_for(height,
+                      [&](std::size_t begin, std::size_t end)
+                      {
+                          for (std::size_t y = begin; y < end; ++y)
+                              xs[y] = reduce_find<Op>(reduce_pointer(a.row_begin(y)), width);
+                      },
+                      c, parallel_row_multiple<T>(layout_type(), array2d_pitch(a)));
+
+    //a later row only wins when op prefers its element over the best so far
+    std::size_t best = 0;
+    for (std::size_t y = 1; y < height; ++y)
+    {
+        const T& v = a.index(xs[y], y);
+        const T& b = a.index(xs[best], best);
+        if (v != b && Op::apply(b, v) == v)
+            best = y;
+    }
+    return std::make_pair(xs[best], best);
+}
+
+//The (x, y) of the smallest element of a, the first in row order when there
+//is a tie. Throws std::invalid_argument if a is empty. Elements must be
+//ordered, so floating point grids must not hold NaNs.
+template <typename Grid>
+std::pair<std::size_t, std::size_t> argmin(const Grid& a, chunking c = chunking(),
+                                           thread_pool& pool = default_thread_pool())
+{ return reduce_arg<min_op>(a, c, pool); }
+
+//the (x, y) of the largest element of a, see argmin
+template <typename Grid>
+std::pair<std::size_t, std::size_t> argmax(const Grid& a, chunking c = chunking(),
+                                           thread_pool& pool = default_thread_pool())
+{ return reduce_arg<max_op>(a, c, pool); }
+
+
+//dst(x, y) = op over src(i, j) for every i <= x and j <= y, so with plus_op
+//dst is the integral image (summed-area table) of src, from which the sum of
+//any rectangle takes four lookups. Elements are converted to dst's element
+//type first, so a wide type such as std::uint32_t or double avoids overflow.
+//Each row is scanned in parallel, then each row has the one above it added,
+//which for a row_major dst is vectorized and split between threads by
+//columns. src and dst must have the same dimensions, and may be the same grid.
+template <typename Src, typename Dst, typename Op = plus_op>
+void inclusive_scan_2d(const Src& src, Dst& dst, Op op = Op(), chunking c = chunking(),
+                       thread_pool& pool = default_thread_pool())
+{
+    typedef typename Dst::value_type T;
+    typedef typename Dst::layout_type layout_type;
+
+    const std::size_t width = array2d_width(dst);
+    const std::size_t height = array2d_height(dst);
+    if (width == 0 || height == 0)
+        return;
+
+    pool.parallel_for(height,
+                      [&](std::size_t begin, std::size_t end)
+                      {
+                          for (std::size_t y = begin; y < end; ++y)
+                          {
+                              typename Src::const_row_iterator in = src.row_begin(y);
+                              typename Dst::row_iterator out = dst.row_begin(y);
+                              T acc = static_cast<T>(*in);
+                              *out = acc;
+                              for (std::size_t x = 1; x < width; ++x)
+                              {
+                                  acc = Op::apply(acc, static_cast<T>(*++in));
+                                  *++out = acc;
+                              }
+                          }
+                      },
+                      c, parallel_row_multiple<T>(layout_type(), array2d_pitch(dst)));
+
+    pool.parallel_for(width,
+                      [&](std::size_t begin, std::size_t end)
+                      {
+                          const std::size_t n = end - begin;
+                          for (std::size_t y = 1; y < height; ++y)
+                          {
+                              const Dst& above = dst;
+                              reduce_accumulate(reduce_pointer(dst.row_begin(y) + begin),
+                                                reduce_pointer(above.row_begin(y - 1) + begin),
+                                                n, op);
+                          }
+                      },
+                      c, parallel_column_multiple<T>(layout_type(), array2d_pitch(dst)));
+}
+
+} //array2d
+
+#endif //ARRAY2D_REDUCE_H
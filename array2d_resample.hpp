@@ -0,0 +1,391 @@
+/*
+ array2d_resample.hpp - Conversion between element types and resizing of
+                        array2d, static_array2d and array2d_view, into
+                        destination grids allocated by the caller.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#ifndef ARRAY2D_RESAMPLE_H
+#define ARRAY2D_RESAMPLE_H
+
+#include "array2d.hpp"
+#include "array2d_expr.hpp"
+#include "array2d_parallel.hpp"
+#include "array2d_reduce.hpp"
+#include "array2d_stencil.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace array2d
+{
+
+//The type conversions and filters are computed in. float is exact for every
+//value of an integer of up to 16 bits, anything wider or double uses double.
+template <typename T>
+struct resample_narrow
+    : std::integral_constant<bool, std::is_same<T, float>::value ||
+                                   (std::is_integral<T>::value && sizeof(T) <= 2)>
+{ };
+
+template <typename S, typename D>
+struct resample_work
+{
+    typedef typename std::conditional<resample_narrow<S>::value && resample_narrow<D>::value,
+                                      float, double>::type type;
+};
+
+
+//out[i] = saturate_cast<D>(in[i] * scale + offset) for i in [0, n)
+template <typename In, typename Out, typename W>
+void convert_line(In in, Out out, std::size_t n, W scale, W offset)
+{
+    typedef typename std::iterator_traits<Out>::value_type D;
+
+    for (std::size_t i = 0; i < n; ++i, ++in, ++out)
+        *out = saturate_cast<D>(static_cast<W>(*in) * scale + offset);
+}
+
+#if defined(__SSE2__)
+
+inline void convert_line(const float* in, float* out, std::size_t n, float scale, float offset)
+{
+    typedef simd<float> v;
+
+    std::size_t i = 0;
+    const v::type s = v::set1(scale);
+    const v::type o = v::set1(offset);
+    for (; i + v::width <= n; i += v::width)
+        v::store(out + i, v::add(v::mul(v::load(in + i), s), o));
+    for (; i < n; ++i)
+        out[i] = in[i] * scale + offset;
+}
+
+inline void convert_line(const std::uint8_t* in, float* out, std::size_t n, float scale,
+                         float offset)
+{
+    std::size_t i = 0;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 s = _mm_set1_ps(scale);
+    const __m128 o = _mm_set1_ps(offset);
+    for (; i + 16 <= n; i += 16)
+    {
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        const __m128i lo = _mm_unpacklo_epi8(b, zero);
+        const __m128i hi = _mm_unpackhi_epi8(b, zero);
+        const __m128i q[4] = { _mm_unpacklo_epi16(lo, zero), _mm_unpackhi_epi16(lo, zero),
+                               _mm_unpacklo_epi16(hi, zero), _mm_unpackhi_epi16(hi, zero) };
+        for (int k = 0; k < 4; ++k)
+            _mm_storeu_ps(out + i + 4 * k, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(q[k]), s), o));
+    }
+    for (; i < n; ++i)
+        out[i] = static_cast<float>(in[i]) * scale + offset;
+}
+
+//Clamps to [0, 255] before rounding half up, so NaN becomes 0 as it does in
+//saturate_cast. The tail does the same arithmetic as the vector loop so that
+//every element of a row rounds alike.
+inline void convert_line(const float* in, std::uint8_t* out, std::size_t n, float scale,
+                         float offset)
+{
+    std::size_t i = 0;
+    const __m128 s = _mm_set1_ps(scale);
+    const __m128 o = _mm_set1_ps(offset);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 top = _mm_set1_ps(255.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i q[4];
+        for (int k = 0; k < 4; ++k)
+        {
+            __m128 f = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(in + i + 4 * k), s), o);
+            f = _mm_min_ps(_mm_max_ps(f, zero), top);
+            q[k] = _mm_cvttps_epi32(_mm_add_ps(f, half));
+        }
+        const __m128i w = _mm_packus_epi16(_mm_packs_epi32(q[0], q[1]),
+                                           _mm_packs_epi32(q[2], q[3]));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), w);
+    }
+    for (; i < n; ++i)
+    {
+        float f = in[i] * scale + offset;
+        f = f > 0.0f ? f : 0.0f;
+        f = f < 255.0f ? f : 255.0f;
+        out[i] = static_cast<std::uint8_t>(static_cast<int>(f + 0.5f));
+    }
+}
+
+#endif //__SSE2__
+
+
+//Copies src into dst, which must have the same dimensions, converting every
+//element to dst's type as saturate_cast(src(x, y) * scale + offset). Scale
+//and offset normalize, 1.0 / 255 takes uint8_t to [0, 1] and 255 takes it
+//back. Rows of contiguous uint8_t and float are converted with SSE2. Rows are
+//converted in bands in parallel. Throws std::invalid_argument if the
+//dimensions differ.
+template <typename Src, typename Dst>
+void convert_into(const Src& src, Dst& dst, double scale = 1, double offset = 0,
+                  chunking c = chunking(), thread_pool& pool = default_thread_pool())
+{
+    typedef typename resample_work<typename Src::value_type,
+                                   typename Dst::value_type>::type W;
+
+    const std::size_t width = array2d_width(src);
+    if (array2d_width(dst) != width || array2d_height(dst) != array2d_height(src))
+        throw std::invalid_argument("grid dimensions don't agree");
+
+    const W s = static_cast<W>(scale);
+    const W o = static_cast<W>(offset);
+    pool.parallel_for(array2d_height(src),
+                      [&](std::size_t begin, std::size_t end)
+                      {
+                          for (std::size_t y = begin; y < end; ++y)
+                          {
+                              convert_line(reduce_pointer(src.row_begin(y)),
+                                           reduce_pointer(dst.row_begin(y)), width, s, o);
+                          }
+                      },
+                      c, parallel_row_multiple<typename Dst::value_type>(
+                             typename Dst::layout_type(), array2d_pitch(dst)));
+}
+
+//an array2d of U with the allocator, row alignment and layout of array2d A
+template <typename U, typename A>
+struct converted_array2d;
+
+template <typename U, typename T, typename Alloc, std::size_t R, typename Layout>
+struct converted_array2d<U, array2d<T, Alloc, R, Layout>>
+{
+    typedef array2d<U,
+                    typename std::allocator_traits<Alloc>::template rebind_alloc<U>,
+                    (R > alignof(U) ? R : alignof(U)),
+                    Layout> type;
+};
+
+//a copy of a with elements of type U, see convert_into
+template <typename U, typename T, typename Alloc, std::size_t R, typename Layout>
+typename converted_array2d<U, array2d<T, Alloc, R, Layout>>::type
+convert(const array2d<T, Alloc, R, Layout>& a, double scale = 1, double offset = 0,
+        chunking c = chunking(), thread_pool& pool = default_thread_pool())
+{
+    typedef typename converted_array2d<U, array2d<T, Alloc, R, Layout>>::type result;
+
+    result res(a.width(), a.height(), typename result::allocator_type(a.get_allocator()));
+    convert_into(a, res, scale, offset, c, pool);
+    return res;
+}
+
+
+enum resize_mode
+{
+    resize_nearest,     //the source element under each destination center
+    resize_bilinear,    //a linear blend of the two nearest source elements
+    resize_area         //the mean of the source elements each destination
+                        //element covers, bilinear when enlarging
+};
+
+//How the elements of one line of a resized grid are made from the elements
+//of the source line. Every output element i is the sum of weights[i * taps + j]
+//* in[first[i] + j] for j in [0, taps). Weights past the end of a short run
+//are zero, and runs are moved back from the end of the line so that they
+//never read past it.
+template <typename W>
+struct resize_taps
+{
+    std::size_t taps;
+    std::vector<std::size_t> first;
+    std::vector<W> weights;
+
+    resize_taps(std::size_t in, std::size_t out, resize_mode mode)
+        : taps(1), first(out)
+    {
+        //source coordinates are those of element centers, so that the edges
+        //of the grids line up
+        const double scale = static_cast<double>(in) / static_cast<double>(out);
+        if (mode == resize_area && scale > 1)
+        {
+            taps = std::min(in, static_cast<std::size_t>(std::ceil(scale)) + 1);
+            weights.assign(out * taps, W());
+            for (std::size_t i = 0; i < out; ++i)
+            {
+                const double lo = static_cast<double>(i) * scale;
+                const double hi = std::min(lo + scale, static_cast<double>(in));
+                const std::size_t a = static_cast<std::size_t>(lo);
+                const std::size_t f = std::min(a, in - taps);
+                first[i] = f;
+                for (std::size_t k = a; k < in && static_cast<double>(k) < hi; ++k)
+                {
+                    const double cover = std::min(hi, static_cast<double>(k + 1)) -
+                                         std::max(lo, static_cast<double>(k));
+                    weights[i * taps + (k - f)] = static_cast<W>(cover / scale);
+                }
+            }
+        }
+        else if (mode != resize_nearest)
+        {
+            taps = std::min<std::size_t>(in, 2);
+            weights.assign(out * taps, W());
+            for (std::size_t i = 0; i < out; ++i)
+            {
+                double s = (static_cast<double>(i) + 0.5) * scale - 0.5;
+                s = std::min(std::max(s, 0.0), static_cast<double>(in - 1));
+                const std::size_t a = std::min(static_cast<std::size_t>(s), in - taps);
+                const double t = s - static_cast<double>(a);
+                first[i] = a;
+                if (taps == 1)
+                {
+                    weights[i] = W(1);
+                }
+                else
+                {
+                    weights[i * 2] = static_cast<W>(1 - t);
+                    weights[i * 2 + 1] = static_cast<W>(t);
+                }
+            }
+        }
+        else
+        {
+            for (std::size_t i = 0; i < out; ++i)
+                first[i] = std::min(in - 1, (2 * i + 1) * in / (2 * out));
+        }
+    }
+};
+
+//Resizes src into dst, whose dimensions are the new size, converting to
+//dst's element type with saturate_cast. Nearest only copies elements.
+//Bilinear and area are separable: each destination row blends the source
+//rows it needs, converted to float (double for wide element types) and kept
+//across consecutive destination rows, and then blends along the row.
+//Contiguous uint8_t and float rows are converted with SSE2, and the vertical
+//pass is vectorized. Rows of dst are computed in bands in parallel, with
+//scratch lines allocated once per band. src and dst must not overlap.
+template <typename Src, typename Dst>
+void resize_into(const Src& src, Dst& dst, resize_mode mode = resize_bilinear,
+                 chunking c = chunking(), thread_pool& pool = default_thread_pool())
+{
+    typedef typename Dst::value_type T;
+    typedef typename resample_work<typename Src::value_type, T>::type W;
+
+    const std::size_t in_width = array2d_width(src);
+    const std::size_t in_height = array2d_height(src);
+    const std::size_t width = array2d_width(dst);
+    const std::size_t height = array2d_height(dst);
+    if (width == 0 || height == 0)
+        return;
+    if (in_width == 0 || in_height == 0)
+        throw std::invalid_argument("can't resize an empty grid");
+
+    const resize_taps<W> tx(in_width, width, mode);
+    const resize_taps<W> ty(in_height, height, mode);
+    const std::size_t multiple = parallel_row_multiple<T>(typename Dst::layout_type(),
+                                                          array2d_pitch(dst));
+
+    if (mode == resize_nearest)
+    {
+        pool.parallel_for(height, [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t y = begin; y < end; ++y)
+            {
+                auto in = src.row_begin(ty.first[y]);
+                auto out = dst.row_begin(y);
+                for (std::size_t x = 0; x < width; ++x, ++out)
+                    *out = saturate_cast<T>(in[tx.first[x]]);
+            }
+        }, c, multiple);
+        return;
+    }
+
+    pool.parallel_for(height, [&](std::size_t begin, std::size_t end)
+    {
+        //source row r, converted, is line r % ty.taps, so the rows a
+        //destination row needs never share a line
+        std::vector<W> lines(ty.taps * in_width);
+        std::vector<std::size_t> held(ty.taps, in_height);
+        std::vector<W> acc(in_width);
+        std::vector<W> out(width);
+
+        for (std::size_t y = begin; y < end; ++y)
+        {
+            std::fill(acc.begin(), acc.end(), W());
+            for (std::size_t j = 0; j < ty.taps; ++j)
+            {
+                const W w = ty.weights[y * ty.taps + j];
+                if (w == W())
+                    continue;
+
+                const std::size_t r = ty.first[y] + j;
+                W* line = lines.data() + (r % ty.taps) * in_width;
+                if (held[r % ty.taps] != r)
+                {
+                    convert_line(reduce_pointer(src.row_begin(r)), line, in_width, W(1), W());
+                    held[r % ty.taps] = r;
+                }
+                stencil_accumulate(acc.data(), static_cast<const W*>(line), w, in_width);
+            }
+
+            for (std::size_t x = 0; x < width; ++x)
+            {
+                const W* in = acc.data() + tx.first[x];
+                const W* w = tx.weights.data() + x * tx.taps;
+                W sum = W();
+                for (std::size_t i = 0; i < tx.taps; ++i)
+                    sum += w[i] * in[i];
+                out[x] = sum;
+            }
+            convert_line(static_cast<const W*>(out.data()), reduce_pointer(dst.row_begin(y)),
+                         width, W(1), W());
+        }
+    }, c, multiple);
+}
+
+//a width by height copy of a, see resize_into
+template <typename T, typename Alloc, std::size_t R, typename Layout>
+array2d<T, Alloc, R, Layout> resize(const array2d<T, Alloc, R, Layout>& a,
+                                    std::size_t width, std::size_t height,
+                                    resize_mode mode = resize_bilinear,
+                                    chunking c = chunking(),
+                                    thread_pool& pool = default_thread_pool())
+{
+    array2d<T, Alloc, R, Layout> res(width, height, a.get_allocator());
+    resize_into(a, res, mode, c, pool);
+    return res;
+}
+
+} //array2d
+
+#endif //ARRAY2D_RESAMPLE_H
@@ -0,0 +1,250 @@
+/*
+ array2d_ring.hpp - A grid whose rows are kept in a circular buffer, for
+                    windows that gain a row at one end and lose one at the
+                    other.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#ifndef ARRAY2D_RING_H
+#define ARRAY2D_RING_H
+
+#include "array2d.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace array2d
+{
+
+//A grid whose rows live in a circular buffer of row_major rows. Logical row y
+//is physical row (head + y) mod capacity, so dropping the oldest row only
+//moves the head and roll() replaces the oldest row with a new newest one in
+//O(width), without moving any other row or reallocating.
+//
+//Rows are contiguous and row_begin(y) is a pointer iterator. Columns and the
+//whole grid are walked with index(x, y), since they wrap around the end of
+//the buffer. Pushing a row onto a full ring doubles its capacity.
+template <typename T,
+          typename Allocator = std::allocator<T>,
+          std::size_t RowAlign = alignof(T)>
+class ring_array2d
+{
+    typedef array2d<T, Allocator, RowAlign> storage_type;
+
+  public:
+    typedef T               value_type;
+    typedef Allocator       allocator_type;
+    typedef T*              pointer;
+    typedef const T*        const_pointer;
+    typedef T&              reference;
+    typedef const T&        const_reference;
+    typedef std::size_t     size_type;
+    typedef std::ptrdiff_t  difference_type;
+
+    typedef array2d_index_iterator<T, ring_array2d, iterate_grid>               iterator;
+    typedef array2d_index_iterator<const T, const ring_array2d, iterate_grid>   const_iterator;
+    typedef array2d_index_iterator<T, ring_array2d, iterate_column>             column_iterator;
+    typedef array2d_index_iterator<const T, const ring_array2d, iterate_column> const_column_iterator;
+    typedef typename storage_type::row_iterator                                 row_iterator;
+    typedef typename storage_type::const_row_iterator                           const_row_iterator;
+
+  private:
+    storage_type m_rows;
+    size_type m_head;
+    size_type m_height;
+
+  public:
+    ring_array2d() = delete;
+
+    //height rows of default initialized elements, with no room for more
+    ring_array2d(size_type width, size_type height, const Allocator& alloc = Allocator())
+        : m_rows(width, height, alloc), m_head(0), m_height(height)
+    { }
+
+    //every element is a copy of value
+    ring_array2d(size_type width, size_type height, const T& value,
+                 const Allocator& alloc = Allocator())
+        : m_rows(width, height, value, alloc), m_head(0), m_height(height)
+    { }
+
+    size_type width() const { return m_rows.width(); }
+    size_type height() const { return m_height; }
+
+    //the number of rows the buffer holds before pushing one reallocates
+    size_type capacity() const { return m_rows.height(); }
+
+    bool full() const { return m_height == capacity(); }
+
+    allocator_type get_allocator() const { return m_rows.get_allocator(); }
+
+    //makes room for at least rows rows
+    void reserve(size_type rows)
+    {
+        if (rows > capacity())
+            reallocate(rows);
+    }
+
+    //Appends a row after the newest one, copied from the width elements
+    //starting at first or filled with value.
+    template <typename InputIt,
+              typename = typename std::enable_if<
+                  !std::is_convertible<InputIt, T>::value
+              >::type>
+    void push_row(InputIt first)
+    { std::copy_n(first, width(), open_row()); }
+
+    void push_row(const T& value = T())
+    {
+        row_iterator row = open_row();
+        std::fill(row, row + width(), value);
+    }
+
+    //drops the newest row, which must exist
+    void pop_row() { --m_height; }
+
+    //drops the oldest row, which must exist, moving every other row up by one
+    void pop_front_row()
+    {
+        m_head = wrap(m_head + 1);
+        --m_height;
+    }
+
+    //Drops the oldest row and appends a row copied from first or filled with
+    //value, so the window moves down by one without reallocating. An empty
+    //ring just gains the row.
+    template <typename InputIt,
+              typename = typename std::enable_if<
+                  !std::is_convertible<InputIt, T>::value
+              >::type>
+    void roll(InputIt first)
+    {
+        if (m_height != 0)
+            pop_front_row();
+        push_row(first);
+    }
+
+    void roll(const T& value)
+    {
+        if (m_height != 0)
+            pop_front_row();
+        push_row(value);
+    }
+
+    void clear()
+    {
+        m_head = 0;
+        m_height = 0;
+    }
+
+    iterator begin() { return iterator(this, width(), 0, 0); }
+    const_iterator begin() const { return const_iterator(this, width(), 0, 0); }
+
+    iterator end() { return iterator(this, width(), 0, width() == 0 ? 0 : m_height); }
+    const_iterator end() const
+    { return const_iterator(this, width(), 0, width() == 0 ? 0 : m_height); }
+
+    row_iterator row_begin(size_type y) { return m_rows.row_begin(physical_row(y)); }
+    const_row_iterator row_begin(size_type y) const
+    { return m_rows.row_begin(physical_row(y)); }
+
+    row_iterator row_end(size_type y) { return m_rows.row_end(physical_row(y)); }
+    const_row_iterator row_end(size_type y) const
+    { return m_rows.row_end(physical_row(y)); }
+
+    column_iterator column_begin(size_type x)
+    { return column_iterator(this, width(), x, 0); }
+    const_column_iterator column_begin(size_type x) const
+    { return const_column_iterator(this, width(), x, 0); }
+
+    column_iterator column_end(size_type x)
+    { return column_iterator(this, width(), x, m_height); }
+    const_column_iterator column_end(size_type x) const
+    { return const_column_iterator(this, width(), x, m_height); }
+
+    reference index(size_type x, size_type y)
+    { return m_rows.index(x, physical_row(y)); }
+    const_reference index(size_type x, size_type y) const
+    { return m_rows.index(x, physical_row(y)); }
+
+    reference operator()(size_type x, size_type y) { return index(x, y); }
+    const_reference operator()(size_type x, size_type y) const { return index(x, y); }
+
+    //copies the rows, oldest first, into a grid of the same dimensions
+    template <typename Grid>
+    void copy_to(Grid& a) const
+    {
+        for (size_type y = 0; y < m_height; ++y)
+            std::copy(row_begin(y), row_end(y), a.row_begin(y));
+    }
+
+    void swap(ring_array2d& o)
+    {
+        using std::swap;
+        swap(m_rows, o.m_rows);
+        swap(m_head, o.m_head);
+        swap(m_height, o.m_height);
+    }
+
+  private:
+    size_type wrap(size_type row) const
+    { return row < capacity() ? row : row - capacity(); }
+
+    size_type physical_row(size_type y) const { return wrap(m_head + y); }
+
+    //adds a row after the newest one, doubling the buffer if it is full
+    row_iterator open_row()
+    {
+        if (full())
+            reallocate(std::max<size_type>(1, 2 * capacity()));
+        return row_begin(m_height++);
+    }
+
+    //moves the rows, oldest first, to the start of a buffer of rows rows
+    void reallocate(size_type rows)
+    {
+        storage_type tmp(width(), rows, m_rows.get_allocator());
+        for (size_type y = 0; y < m_height; ++y)
+            std::move(row_begin(y), row_end(y), tmp.row_begin(y));
+        m_rows = std::move(tmp);
+        m_head = 0;
+    }
+};
+
+template <typename T, typename A, std::size_t R>
+void swap(ring_array2d<T, A, R>& a, ring_array2d<T, A, R>& b) { a.swap(b); }
+
+
+template <typename T, typename A, std::size_t R>
+std::size_t array2d_width(const ring_array2d<T, A, R>& a) { return a.width(); }
+
+template <typename T, typename A, std::size_t R>
+std::size_t array2d_height(const ring_array2d<T, A, R>& a) { return a.height(); }
+
+} //array2d
+
+#endif //ARRAY2D_RING_H
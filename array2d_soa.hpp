@@ -0,0 +1,236 @@
+/*
+ array2d_soa.hpp - A grid of records stored as one plane per field.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#ifndef ARRAY2D_SOA_H
+#define ARRAY2D_SOA_H
+
+#include "array2d.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace array2d
+{
+
+//Whether each field reference in the tuple From converts to the one in the
+//same place in To, e.g. int& to const int&, and never const int& to int&.
+template <typename From, typename To>
+struct soa_fields_convertible : std::false_type { };
+
+template <>
+struct soa_fields_convertible<std::tuple<>, std::tuple<>> : std::true_type { };
+
+template <typename F, typename... Fs, typename T, typename... Ts>
+struct soa_fields_convertible<std::tuple<F, Fs...>, std::tuple<T, Ts...>>
+    : std::integral_constant<bool, std::is_convertible<F&, T&>::value &&
+                                   soa_fields_convertible<std::tuple<Fs...>,
+                                                          std::tuple<Ts...>>::value>
+{
+};
+
+//Refers to one cell of a soa_array2d, which is spread across the planes, as
+//a tuple of references to its fields. Assigning to it writes every field, and
+//it converts to a tuple of their values. Fields are const for a const cell.
+template <typename... Fields>
+class soa_array2d_reference
+{
+  public:
+    typedef std::tuple<typename std::remove_const<Fields>::type...> value_type;
+
+  private:
+    std::tuple<Fields&...> m_fields;
+
+    template <typename... F>
+    friend class soa_array2d_reference;
+
+  public:
+    explicit soa_array2d_reference(Fields&... fields) : m_fields(fields...) { }
+
+    //allow non-const to const conversion
+    template <typename... F>
+    soa_array2d_reference(const soa_array2d_reference<F...>& o,
+                          typename std::enable_if<
+                              soa_fields_convertible<std::tuple<F...>,
+                                                     std::tuple<Fields...>>::value &&
+                              !std::is_same<soa_array2d_reference<F...>,
+                                            soa_array2d_reference>::value
+                          >::type* = nullptr)
+        : m_fields(o.m_fields)
+    { }
+
+    //copies the fields of the cell o refers to, not the reference
+    soa_array2d_reference& operator=(const soa_array2d_reference& o)
+    {
+        m_fields = value_type(o);
+        return *this;
+    }
+
+    soa_array2d_reference& operator=(const value_type& v)
+    {
+        m_fields = v;
+        return *this;
+    }
+
+    operator value_type() const { return value_type(m_fields); }
+
+    template <std::size_t I>
+    typename std::tuple_element<I, std::tuple<Fields...> >::type& get() const
+    { return std::get<I>(m_fields); }
+};
+
+template <std::size_t I, typename... Fields>
+typename std::tuple_element<I, std::tuple<Fields...> >::type&
+get(const soa_array2d_reference<Fields...>& r)
+{ return r.template get<I>(); }
+
+
+//A grid of records whose fields are kept in separate planes, one array2d per
+//field, all with the same width and height. A pass that reads one field only
+//reads that field's plane. Planes are reached with plane<I>(), an
+//array2d_view with the usual iterators, and whole cells with operator(),
+//which returns a soa_array2d_reference.
+template <typename... Fields>
+class soa_array2d
+{
+    static_assert(sizeof...(Fields) > 0, "soa_array2d needs at least one field");
+
+  public:
+    typedef std::tuple<Fields...>                   value_type;
+    typedef soa_array2d_reference<Fields...>        reference;
+    typedef soa_array2d_reference<const Fields...>  const_reference;
+    typedef std::size_t                             size_type;
+    typedef std::ptrdiff_t                          difference_type;
+
+    static constexpr size_type fields = sizeof...(Fields);
+
+    //the element type of field I
+    template <std::size_t I>
+    using field_type = typename std::tuple_element<I, value_type>::type;
+
+    template <std::size_t I>
+    using plane_type = array2d_view<field_type<I> >;
+
+    template <std::size_t I>
+    using const_plane_type = array2d_view<const field_type<I> >;
+
+  private:
+    typedef typename array2d_make_indices<sizeof...(Fields)>::type indices;
+
+    size_type m_width;
+    size_type m_height;
+    std::tuple<array2d<Fields>...> m_planes;
+
+  public:
+    soa_array2d() = delete;
+
+    soa_array2d(size_type width, size_type height)
+        : m_width(width), m_height(height), m_planes(array2d<Fields>(width, height)...)
+    { }
+
+    //every cell is a copy of value
+    soa_array2d(size_type width, size_type height, const value_type& value)
+        : soa_array2d(width, height, value, indices())
+    { }
+
+    size_type width() const { return m_width; }
+    size_type height() const { return m_height; }
+
+    //field I of every cell
+    template <std::size_t I>
+    plane_type<I> plane() { return plane_type<I>(std::get<I>(m_planes)); }
+    template <std::size_t I>
+    const_plane_type<I> plane() const { return const_plane_type<I>(std::get<I>(m_planes)); }
+
+    template <std::size_t I>
+    field_type<I>& get(size_type x, size_type y) { return std::get<I>(m_planes)(x, y); }
+    template <std::size_t I>
+    const field_type<I>& get(size_type x, size_type y) const
+    { return std::get<I>(m_planes)(x, y); }
+
+    reference index(size_type x, size_type y)
+    { return make_reference<reference>(*this, x, y, indices()); }
+    const_reference index(size_type x, size_type y) const
+    { return make_reference<const_reference>(*this, x, y, indices()); }
+
+    reference operator()(size_type x, size_type y)
+    { return make_reference<reference>(*this, x, y, indices()); }
+    const_reference operator()(size_type x, size_type y) const
+    { return make_reference<const_reference>(*this, x, y, indices()); }
+
+    //sets every cell to value, a plane at a time
+    void fill(const value_type& value) { fill(value, indices()); }
+
+    void swap(soa_array2d& o)
+    {
+        using std::swap;
+        swap(m_width, o.m_width);
+        swap(m_height, o.m_height);
+        swap(m_planes, o.m_planes);
+    }
+
+  private:
+    template <std::size_t... I>
+    soa_array2d(size_type width, size_type height, const value_type& value,
+                array2d_indices<I...>)
+        : m_width(width),
+          m_height(height),
+          m_planes(array2d<Fields>(width, height, std::get<I>(value))...)
+    { }
+
+    template <typename Ref, typename Self, std::size_t... I>
+    static Ref make_reference(Self& self, size_type x, size_type y, array2d_indices<I...>)
+    { return Ref(std::get<I>(self.m_planes)(x, y)...); }
+
+    template <std::size_t... I>
+    void fill(const value_type& value, array2d_indices<I...>)
+    {
+        //expands to one fill per plane, in order
+        const int order[] = { (fill_plane(std::get<I>(m_planes), std::get<I>(value)), 0)... };
+        (void)order;
+    }
+
+    template <typename T>
+    static void fill_plane(array2d<T>& plane, const T& value)
+    { std::fill(plane.begin(), plane.end(), value); }
+};
+
+template <typename... Fields>
+void swap(soa_array2d<Fields...>& a, soa_array2d<Fields...>& b) { a.swap(b); }
+
+
+template <typename... Fields>
+std::size_t array2d_width(const soa_array2d<Fields...>& a) { return a.width(); }
+
+template <typename... Fields>
+std::size_t array2d_height(const soa_array2d<Fields...>& a) { return a.height(); }
+
+} //array2d
+
+#endif //ARRAY2D_SOA_H
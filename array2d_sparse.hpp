@@ -0,0 +1,651 @@
+/*
+ array2d_sparse.hpp - Grids that only store the elements that differ from a
+                      default value, in blocks or as runs.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#ifndef ARRAY2D_SPARSE_H
+#define ARRAY2D_SPARSE_H
+
+#include "array2d.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+namespace array2d
+{
+
+//an element that differs from the default value of a sparse grid
+template <typename T>
+struct array2d_cell
+{
+    std::size_t x;
+    std::size_t y;
+    T value;
+};
+
+//a run of length equal elements of a row starting at x
+template <typename T>
+struct array2d_run
+{
+    std::size_t x;
+    std::size_t length;
+    T value;
+};
+
+
+template <typename T, std::size_t BlockWidth, std::size_t BlockHeight>
+class sparse_array2d;
+
+//iterates over the elements of a sparse_array2d that differ from its default
+//value, block by block
+template <typename T, std::size_t BlockWidth, std::size_t BlockHeight>
+struct sparse_array2d_cell_iterator
+{
+    typedef std::ptrdiff_t              difference_type;
+    typedef std::forward_iterator_tag   iterator_category;
+    typedef array2d_cell<T>             value_type;
+    typedef void                        pointer;
+    typedef value_type                  reference;
+
+    typedef sparse_array2d<T, BlockWidth, BlockHeight> grid_type;
+
+    const grid_type* _m_grid;
+    std::size_t _m_block_row;
+    std::size_t _m_block;
+    std::size_t _m_cell;
+
+    sparse_array2d_cell_iterator()
+        : _m_grid(nullptr), _m_block_row(0), _m_block(0), _m_cell(0) { }
+    sparse_array2d_cell_iterator(const grid_type* grid, std::size_t block_row)
+        : _m_grid(grid), _m_block_row(block_row), _m_block(0), _m_cell(0)
+    { skip(); }
+
+    reference operator*() const
+    {
+        const typename grid_type::block& b = _m_grid->m_rows[_m_block_row][_m_block];
+        const value_type c = {
+            b.x * BlockWidth + _m_cell % BlockWidth,
+            _m_block_row * BlockHeight + _m_cell / BlockWidth,
+            _m_grid->m_pool[b.offset + _m_cell]
+        };
+        return c;
+    }
+
+    sparse_array2d_cell_iterator& operator++()
+    {
+        ++_m_cell;
+        skip();
+        return *this;
+    }
+    sparse_array2d_cell_iterator operator++(int)
+    {
+        sparse_array2d_cell_iterator tmp(*this);
+        ++*this;
+        return tmp;
+    }
+
+    bool operator==(const sparse_array2d_cell_iterator& o) const
+    {
+        return _m_block_row == o._m_block_row && _m_block == o._m_block &&
+               _m_cell == o._m_cell;
+    }
+    bool operator!=(const sparse_array2d_cell_iterator& o) const
+    { return !(*this == o); }
+
+  private:
+    //moves forward to the next element that isn't the default, padding of
+    //blocks on the edge of the grid always being the default
+    void skip()
+    {
+        const std::size_t rows = _m_grid->m_rows.size();
+        for (; _m_block_row < rows; ++_m_block_row, _m_block = 0)
+        {
+            const std::vector<typename grid_type::block>& row = _m_grid->m_rows[_m_block_row];
+            for (; _m_block < row.size(); ++_m_block, _m_cell = 0)
+            {
+                const T* data = &_m_grid->m_pool[row[_m_block].offset];
+                for (; _m_cell < BlockWidth * BlockHeight; ++_m_cell)
+                {
+                    if (!(data[_m_cell] == _m_grid->m_default))
+                        return;
+                }
+            }
+        }
+        _m_block = 0;
+        _m_cell = 0;
+    }
+};
+
+
+//A grid in which only BlockWidth by BlockHeight blocks containing an element
+//other than the default value are stored. The blocks of each row of blocks
+//are kept sorted by x, so finding an element is a binary search of its row of
+//blocks, and blocks share one pool of storage.
+//
+//Reading never stores anything, but the non-const index(x, y) stores the block
+//holding (x, y) so that it can return a reference, as does set() unless the
+//value is the default. Storing a block invalidates references to elements.
+//Iterators are all const; elements are written with index() or set(). T must
+//be copy assignable and equality comparable.
+template <typename T, std::size_t BlockWidth = 16, std::size_t BlockHeight = BlockWidth>
+class sparse_array2d
+{
+    static_assert(BlockWidth != 0 && (BlockWidth & (BlockWidth - 1)) == 0 &&
+                  BlockHeight != 0 && (BlockHeight & (BlockHeight - 1)) == 0,
+                  "block dimensions must be powers of two");
+
+    friend struct sparse_array2d_cell_iterator<T, BlockWidth, BlockHeight>;
+
+  public:
+    typedef T               value_type;
+    typedef T*              pointer;
+    typedef const T*        const_pointer;
+    typedef T&              reference;
+    typedef const T&        const_reference;
+    typedef std::size_t     size_type;
+    typedef std::ptrdiff_t  difference_type;
+
+    typedef array2d_index_iterator<const T, const sparse_array2d, iterate_grid>   const_iterator;
+    typedef array2d_index_iterator<const T, const sparse_array2d, iterate_row>    const_row_iterator;
+    typedef array2d_index_iterator<const T, const sparse_array2d, iterate_column> const_column_iterator;
+    typedef const_iterator                                                        iterator;
+    typedef const_row_iterator                                                    row_iterator;
+    typedef const_column_iterator                                                 column_iterator;
+    typedef sparse_array2d_cell_iterator<T, BlockWidth, BlockHeight>              cell_iterator;
+
+    static constexpr size_type block_width = BlockWidth;
+    static constexpr size_type block_height = BlockHeight;
+    static constexpr size_type block_size = BlockWidth * BlockHeight;
+
+  private:
+    struct block
+    {
+        size_type x;
+        size_type offset;
+    };
+
+    size_type m_width;
+    size_type m_height;
+    T m_default;
+    std::vector<std::vector<block> > m_rows;
+    std::vector<T> m_pool;
+    std::vector<size_type> m_free;
+
+  public:
+    sparse_array2d(size_type width, size_type height, const T& default_value = T())
+        : m_width(width), m_height(height), m_default(default_value),
+          m_rows((height + BlockHeight - 1) / BlockHeight), m_pool(), m_free()
+    { }
+
+    //stores the elements of any grid that differ from default_value
+    template <typename Grid>
+    explicit sparse_array2d(const Grid& a, const T& default_value = T(),
+                            typename std::enable_if<
+                                !std::is_convertible<Grid, size_type>::value
+                            >::type* = nullptr)
+        : m_width(array2d_width(a)), m_height(array2d_height(a)), m_default(default_value),
+          m_rows((m_height + BlockHeight - 1) / BlockHeight), m_pool(), m_free()
+    {
+        for (size_type y = 0; y < m_height; ++y)
+        {
+            typename Grid::const_row_iterator it = a.row_begin(y);
+            for (size_type x = 0; x < m_width; ++x, ++it)
+            {
+                if (!(*it == m_default))
+                    index(x, y) = *it;
+            }
+        }
+    }
+
+    size_type width() const { return m_width; }
+    size_type height() const { return m_height; }
+    const T& default_value() const { return m_default; }
+
+    //the number of blocks stored
+    size_type block_count() const
+    { return m_pool.size() / block_size - m_free.size(); }
+
+    //an estimate of the memory used, in bytes
+    size_type memory_size() const
+    {
+        size_type size = sizeof(*this) + m_pool.capacity() * sizeof(T) +
+                         m_free.capacity() * sizeof(size_type) +
+                         m_rows.capacity() * sizeof(std::vector<block>);
+        for (size_type i = 0; i < m_rows.size(); ++i)
+            size += m_rows[i].capacity() * sizeof(block);
+        return size;
+    }
+
+    const_iterator begin() const { return const_iterator(this, m_width, 0, 0); }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator end() const { return const_iterator(this, m_width, 0, m_height); }
+    const_iterator cend() const { return end(); }
+
+    const_row_iterator row_begin(size_type y) const
+    { return const_row_iterator(this, m_width, 0, y); }
+    const_row_iterator row_end(size_type y) const
+    { return const_row_iterator(this, m_width, m_width, y); }
+
+    const_column_iterator column_begin(size_type x) const
+    { return const_column_iterator(this, m_width, x, 0); }
+    const_column_iterator column_end(size_type x) const
+    { return const_column_iterator(this, m_width, x, m_height); }
+
+    //the elements that differ from the default value
+    cell_iterator cells_begin() const { return cell_iterator(this, 0); }
+    cell_iterator cells_end() const { return cell_iterator(this, m_rows.size()); }
+
+    const_reference index(size_type x, size_type y) const
+    {
+        const T* data = find(x / BlockWidth, y / BlockHeight);
+        return data == nullptr ? m_default : data[offset(x, y)];
+    }
+
+    //stores the block holding (x, y) if it isn't already
+    reference index(size_type x, size_type y)
+    { return store(x / BlockWidth, y / BlockHeight)[offset(x, y)]; }
+
+    const_reference operator()(size_type x, size_type y) const { return index(x, y); }
+    reference operator()(size_type x, size_type y) { return index(x, y); }
+
+    //like index(x, y) = value, but doesn't store a block to hold the default value
+    void set(size_type x, size_type y, const T& value)
+    {
+        if (value == m_default)
+        {
+            T* data = find(x / BlockWidth, y / BlockHeight);
+            if (data != nullptr)
+                data[offset(x, y)] = value;
+        }
+        else
+            index(x, y) = value;
+    }
+
+    //drops the blocks that only hold the default value
+    void prune()
+    {
+        for (size_type i = 0; i < m_rows.size(); ++i)
+        {
+            std::vector<block>& row = m_rows[i];
+            typename std::vector<block>::iterator out = row.begin();
+            for (typename std::vector<block>::iterator b = row.begin(); b != row.end(); ++b)
+            {
+                const T* data = &m_pool[b->offset];
+                if (std::find_if(data, data + block_size, not_default(m_default)) ==
+                    data + block_size)
+                {
+                    m_free.push_back(b->offset);
+                }
+                else
+                    *out++ = *b;
+            }
+            row.erase(out, row.end());
+        }
+    }
+
+    void clear()
+    {
+        for (size_type i = 0; i < m_rows.size(); ++i)
+            m_rows[i].clear();
+        m_pool.clear();
+        m_free.clear();
+    }
+
+    //writes every element into a grid of the same dimensions
+    template <typename Grid>
+    void copy_to(Grid& a) const
+    {
+        for (size_type y = 0; y < m_height; ++y)
+            std::fill(a.row_begin(y), a.row_end(y), m_default);
+
+        for (size_type by = 0; by < m_rows.size(); ++by)
+        {
+            const std::vector<block>& row = m_rows[by];
+            const size_type y0 = by * BlockHeight;
+            const size_type h = std::min(BlockHeight, m_height - y0);
+            for (size_type i = 0; i < row.size(); ++i)
+            {
+                const size_type x0 = row[i].x * BlockWidth;
+                const size_type w = std::min(BlockWidth, m_width - x0);
+                const T* data = &m_pool[row[i].offset];
+                for (size_type y = 0; y < h; ++y)
+                    std::copy(data + y * BlockWidth, data + y * BlockWidth + w,
+                              a.row_begin(y0 + y) + x0);
+            }
+        }
+    }
+
+    array2d<T> to_array2d() const
+    {
+        array2d<T> a(m_width, m_height, m_default);
+        copy_to(a);
+        return a;
+    }
+
+  private:
+    struct not_default
+    {
+        const T& value;
+        explicit not_default(const T& value) : value(value) { }
+        bool operator()(const T& v) const { return !(v == value); }
+    };
+
+    struct block_less
+    {
+        bool operator()(const block& b, size_type x) const { return b.x < x; }
+    };
+
+    static size_type offset(size_type x, size_type y)
+    { return (y % BlockHeight) * BlockWidth + x % BlockWidth; }
+
+    const T* find(size_type bx, size_type by) const
+    {
+        const std::vector<block>& row = m_rows[by];
+        typename std::vector<block>::const_iterator it =
+            std::lower_bound(row.begin(), row.end(), bx, block_less());
+        return it != row.end() && it->x == bx ? &m_pool[it->offset] : nullptr;
+    }
+
+    T* find(size_type bx, size_type by)
+    { return const_cast<T*>(static_cast<const sparse_array2d&>(*this).find(bx, by)); }
+
+    T* store(size_type bx, size_type by)
+    {
+        std::vector<block>& row = m_rows[by];
+        typename std::vector<block>::iterator it =
+            std::lower_bound(row.begin(), row.end(), bx, block_less());
+        if (it != row.end() && it->x == bx)
+            return &m_pool[it->offset];
+
+        block b;
+        b.x = bx;
+        if (!m_free.empty())
+        {
+            b.offset = m_free.back();
+            m_free.pop_back();
+            std::fill_n(m_pool.begin() + b.offset, block_size, m_default);
+        }
+        else
+        {
+            b.offset = m_pool.size();
+            m_pool.resize(m_pool.size() + block_size, m_default);
+        }
+        row.insert(it, b);
+        return &m_pool[b.offset];
+    }
+};
+
+
+//A read only grid stored as runs of equal elements, row by row, leaving out
+//runs of the default value. The runs of all rows are kept in one array with
+//the index of each row's first run alongside, so finding an element is a
+//binary search of its row's runs. Rows can be replaced with set_row(). T must
+//be copy constructible and equality comparable.
+template <typename T>
+class rle_array2d
+{
+  public:
+    typedef T               value_type;
+    typedef const T*        pointer;
+    typedef const T*        const_pointer;
+    typedef const T&        reference;
+    typedef const T&        const_reference;
+    typedef std::size_t     size_type;
+    typedef std::ptrdiff_t  difference_type;
+    typedef array2d_run<T>  run_type;
+
+    typedef array2d_index_iterator<const T, const rle_array2d, iterate_grid>   const_iterator;
+    typedef array2d_index_iterator<const T, const rle_array2d, iterate_row>    const_row_iterator;
+    typedef array2d_index_iterator<const T, const rle_array2d, iterate_column> const_column_iterator;
+    typedef const_iterator                                                     iterator;
+    typedef const_row_iterator                                                 row_iterator;
+    typedef const_column_iterator                                              column_iterator;
+    typedef const run_type*                                                    run_iterator;
+
+    struct cell_iterator
+    {
+        typedef std::ptrdiff_t              difference_type;
+        typedef std::forward_iterator_tag   iterator_category;
+        typedef array2d_cell<T>             value_type;
+        typedef void                        pointer;
+        typedef value_type                  reference;
+
+        const rle_array2d* _m_grid;
+        size_type _m_run;
+        size_type _m_y;
+        size_type _m_i;
+
+        cell_iterator() : _m_grid(nullptr), _m_run(0), _m_y(0), _m_i(0) { }
+        cell_iterator(const rle_array2d* grid, size_type run)
+            : _m_grid(grid), _m_run(run), _m_y(0), _m_i(0)
+        {
+            const std::vector<size_type>& rows = _m_grid->m_row_runs;
+            _m_y = std::upper_bound(rows.begin(), rows.end(), run) - rows.begin() - 1;
+        }
+
+        reference operator*() const
+        {
+            const run_type& r = _m_grid->m_runs[_m_run];
+            const value_type c = { r.x + _m_i, _m_y, r.value };
+            return c;
+        }
+
+        cell_iterator& operator++()
+        {
+            if (++_m_i == _m_grid->m_runs[_m_run].length)
+            {
+                _m_i = 0;
+                ++_m_run;
+                while (_m_y + 1 < _m_grid->m_row_runs.size() &&
+                       _m_grid->m_row_runs[_m_y + 1] <= _m_run)
+                {
+                    ++_m_y;
+                }
+            }
+            return *this;
+        }
+        cell_iterator operator++(int)
+        {
+            cell_iterator tmp(*this);
+            ++*this;
+            return tmp;
+        }
+
+        bool operator==(const cell_iterator& o) const
+        { return _m_run == o._m_run && _m_i == o._m_i; }
+        bool operator!=(const cell_iterator& o) const
+        { return !(*this == o); }
+    };
+
+  private:
+    size_type m_width;
+    size_type m_height;
+    T m_default;
+    std::vector<run_type> m_runs;
+    std::vector<size_type> m_row_runs;
+
+  public:
+    rle_array2d(size_type width, size_type height, const T& default_value = T())
+        : m_width(width), m_height(height), m_default(default_value),
+          m_runs(), m_row_runs(height + 1, 0)
+    { }
+
+    //encodes any grid, leaving out runs of default_value
+    template <typename Grid>
+    explicit rle_array2d(const Grid& a, const T& default_value = T(),
+                         typename std::enable_if<
+                             !std::is_convertible<Grid, size_type>::value
+                         >::type* = nullptr)
+        : m_width(array2d_width(a)), m_height(array2d_height(a)), m_default(default_value),
+          m_runs(), m_row_runs()
+    {
+        m_row_runs.reserve(m_height + 1);
+        for (size_type y = 0; y < m_height; ++y)
+        {
+            m_row_runs.push_back(m_runs.size());
+            encode(a.row_begin(y), m_runs);
+        }
+        m_row_runs.push_back(m_runs.size());
+    }
+
+    size_type width() const { return m_width; }
+    size_type height() const { return m_height; }
+    const T& default_value() const { return m_default; }
+
+    //the number of runs stored
+    size_type run_count() const { return m_runs.size(); }
+
+    //an estimate of the memory used, in bytes
+    size_type memory_size() const
+    {
+        return sizeof(*this) + m_runs.capacity() * sizeof(run_type) +
+               m_row_runs.capacity() * sizeof(size_type);
+    }
+
+    //replaces row y with the width elements starting at first
+    template <typename InputIterator>
+    void set_row(size_type y, InputIterator first)
+    {
+        std::vector<run_type> runs;
+        encode(first, runs);
+
+        const difference_type change = static_cast<difference_type>(runs.size()) -
+            static_cast<difference_type>(m_row_runs[y + 1] - m_row_runs[y]);
+        typename std::vector<run_type>::iterator pos =
+            m_runs.erase(m_runs.begin() + m_row_runs[y], m_runs.begin() + m_row_runs[y + 1]);
+        m_runs.insert(pos, runs.begin(), runs.end());
+        for (size_type i = y + 1; i < m_row_runs.size(); ++i)
+            m_row_runs[i] += change;
+    }
+
+    const_iterator begin() const { return const_iterator(this, m_width, 0, 0); }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator end() const { return const_iterator(this, m_width, 0, m_height); }
+    const_iterator cend() const { return end(); }
+
+    const_row_iterator row_begin(size_type y) const
+    { return const_row_iterator(this, m_width, 0, y); }
+    const_row_iterator row_end(size_type y) const
+    { return const_row_iterator(this, m_width, m_width, y); }
+
+    const_column_iterator column_begin(size_type x) const
+    { return const_column_iterator(this, m_width, x, 0); }
+    const_column_iterator column_end(size_type x) const
+    { return const_column_iterator(this, m_width, x, m_height); }
+
+    //the runs of row y, in order of x, which leave out the default value
+    run_iterator runs_begin(size_type y) const { return m_runs.data() + m_row_runs[y]; }
+    run_iterator runs_end(size_type y) const { return m_runs.data() + m_row_runs[y + 1]; }
+
+    //the elements that differ from the default value, row by row
+    cell_iterator cells_begin() const { return cell_iterator(this, 0); }
+    cell_iterator cells_end() const { return cell_iterator(this, m_runs.size()); }
+
+    const_reference index(size_type x, size_type y) const
+    {
+        const run_type* first = runs_begin(y);
+        const run_type* last = runs_end(y);
+        const run_type* r = std::upper_bound(first, last, x, run_after());
+        if (r == first || x >= (r - 1)->x + (r - 1)->length)
+            return m_default;
+        return (r - 1)->value;
+    }
+
+    const_reference operator()(size_type x, size_type y) const { return index(x, y); }
+
+    //writes every element into a grid of the same dimensions
+    template <typename Grid>
+    void copy_to(Grid& a) const
+    {
+        for (size_type y = 0; y < m_height; ++y)
+        {
+            typename Grid::row_iterator row = a.row_begin(y);
+            size_type x = 0;
+            for (run_iterator r = runs_begin(y); r != runs_end(y); ++r)
+            {
+                std::fill(row + x, row + r->x, m_default);
+                std::fill(row + r->x, row + (r->x + r->length), r->value);
+                x = r->x + r->length;
+            }
+            std::fill(row + x, row + m_width, m_default);
+        }
+    }
+
+    array2d<T> to_array2d() const
+    {
+        array2d<T> a(m_width, m_height, m_default);
+        copy_to(a);
+        return a;
+    }
+
+  private:
+    struct run_after
+    {
+        bool operator()(size_type x, const run_type& r) const { return x < r.x; }
+    };
+
+    template <typename InputIterator>
+    void encode(InputIterator first, std::vector<run_type>& runs) const
+    {
+        size_type x = 0;
+        while (x < m_width)
+        {
+            const T value = *first;
+            size_type length = 1;
+            for (++first; x + length < m_width; ++first, ++length)
+            {
+                if (!(*first == value))
+                    break;
+            }
+            if (!(value == m_default))
+            {
+                const run_type r = { x, length, value };
+                runs.push_back(r);
+            }
+            x += length;
+        }
+    }
+};
+
+
+template <typename T, std::size_t BW, std::size_t BH>
+std::size_t array2d_width(const sparse_array2d<T, BW, BH>& a) { return a.width(); }
+
+template <typename T>
+std::size_t array2d_width(const rle_array2d<T>& a) { return a.width(); }
+
+template <typename T, std::size_t BW, std::size_t BH>
+std::size_t array2d_height(const sparse_array2d<T, BW, BH>& a) { return a.height(); }
+
+template <typename T>
+std::size_t array2d_height(const rle_array2d<T>& a) { return a.height(); }
+
+} //array2d
+
+#endif //ARRAY2D_SPARSE_H
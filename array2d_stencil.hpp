@@ -0,0 +1,583 @@
+/*
+ array2d_stencil.hpp - Convolution and neighborhood stencils over array2d,
+                       static_array2d and array2d_view, with boundary
+                       policies for the elements outside the grid.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#ifndef ARRAY2D_STENCIL_H
+#define ARRAY2D_STENCIL_H
+
+#include "array2d.hpp"
+#include "array2d_parallel.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace array2d
+{
+
+//Boundary policies decide what a stencil sees outside the grid. index(i, n)
+//maps a coordinate that may lie outside [0, n) to one inside it, or returns
+//-1 for fill() to be used instead.
+
+//repeats the edge element, -1 reads 0 and n reads n - 1
+struct clamp_boundary
+{
+    static std::ptrdiff_t index(std::ptrdiff_t i, std::ptrdiff_t n)
+    { return i < 0 ? 0 : (i >= n ? n - 1 : i); }
+
+    template <typename U>
+    U fill() const { return U(); }
+};
+
+//the grid repeats, -1 reads n - 1 and n reads 0
+struct wrap_boundary
+{
+    static std::ptrdiff_t index(std::ptrdiff_t i, std::ptrdiff_t n)
+    {
+        i %= n;
+        return i < 0 ? i + n : i;
+    }
+
+    template <typename U>
+    U fill() const { return U(); }
+};
+
+//reflects about the edge element without repeating it, -1 reads 1 and n
+//reads n - 2
+struct mirror_boundary
+{
+    static std::ptrdiff_t index(std::ptrdiff_t i, std::ptrdiff_t n)
+    {
+        if (n == 1)
+            return 0;
+        const std::ptrdiff_t period = 2 * n - 2;
+        i %= period;
+        if (i < 0)
+            i += period;
+        return i < n ? i : period - i;
+    }
+
+    template <typename U>
+    U fill() const { return U(); }
+};
+
+//everything outside the grid is value
+template <typename T>
+struct constant_boundary
+{
+    T value;
+
+    constant_boundary(const T& value = T()) : value(value) { }
+
+    static std::ptrdiff_t index(std::ptrdiff_t i, std::ptrdiff_t n)
+    { return i < 0 || i >= n ? -1 : i; }
+
+    template <typename U>
+    U fill() const { return U(value); }
+};
+
+
+//Converts v to T, rounding to nearest when going from floating point to an
+//integer and clamping to the range of T, so that a blur of uint8_t can't wrap.
+template <typename T, typename U, bool Integral = std::is_integral<T>::value,
+          bool FromFloat = std::is_floating_point<U>::value>
+struct saturate
+{
+    static T cast(const U& v) { return static_cast<T>(v); }
+};
+
+template <typename T, typename U>
+struct saturate<T, U, true, true>
+{
+    static T cast(U v)
+    {
+        if (!(v == v))
+            return T();
+        if (v <= static_cast<U>(std::numeric_limits<T>::min()))
+            return std::numeric_limits<T>::min();
+        if (v >= static_cast<U>(std::numeric_limits<T>::max()))
+            return std::numeric_limits<T>::max();
+        return static_cast<T>(std::round(v));
+    }
+};
+
+template <typename T, typename U>
+struct saturate<T, U, true, false>
+{
+    static T cast(U v) { return cast(v, std::is_integral<U>()); }
+
+  private:
+    static T cast(U v, std::false_type) { return static_cast<T>(v); }
+
+    static T cast(U v, std::true_type)
+    {
+        typedef std::numeric_limits<T> limits;
+        if (v < U())
+        {
+            if (!limits::is_signed)
+                return T();
+            if (static_cast<std::intmax_t>(v) < static_cast<std::intmax_t>(limits::min()))
+                return limits::min();
+        }
+        else if (static_cast<std::uintmax_t>(v) > static_cast<std::uintmax_t>(limits::max()))
+        {
+            return limits::max();
+        }
+        return static_cast<T>(v);
+    }
+};
+
+template <typename T, typename U>
+T saturate_cast(const U& v) { return saturate<T, U>::cast(v); }
+
+
+//acc[i] += w * line[i] for i in [0, n). This is the inner loop of every
+//convolution, vectorized for float and double.
+template <typename A>
+void stencil_accumulate(A* acc, const A* line, A w, std::size_t n)
+{
+    for (std::size_t i = 0; i < n; ++i)
+        acc[i] += w * line[i];
+}
+
+#if defined(__SSE2__)
+
+inline void stencil_accumulate(float* acc, const float* line, float w, std::size_t n)
+{
+    std::size_t i = 0;
+#if defined(__AVX__)
+    const __m256 w8 = _mm256_set1_ps(w);
+    for (; i + 8 <= n; i += 8)
+    {
+        _mm256_storeu_ps(acc + i, _mm256_add_ps(_mm256_loadu_ps(acc + i),
+                                                _mm256_mul_ps(w8, _mm256_loadu_ps(line + i))));
+    }
+#endif
+    const __m128 w4 = _mm_set1_ps(w);
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i), _mm_mul_ps(w4, _mm_loadu_ps(line + i))));
+    for (; i < n; ++i)
+        acc[i] += w * line[i];
+}
+
+inline void stencil_accumulate(double* acc, const double* line, double w, std::size_t n)
+{
+    std::size_t i = 0;
+#if defined(__AVX__)
+    const __m256d w4 = _mm256_set1_pd(w);
+    for (; i + 4 <= n; i += 4)
+    {
+        _mm256_storeu_pd(acc + i, _mm256_add_pd(_mm256_loadu_pd(acc + i),
+                                                _mm256_mul_pd(w4, _mm256_loadu_pd(line + i))));
+    }
+#endif
+    const __m128d w2 = _mm_set1_pd(w);
+    for (; i + 2 <= n; i += 2)
+        _mm_storeu_pd(acc + i, _mm_add_pd(_mm_loadu_pd(acc + i), _mm_mul_pd(w2, _mm_loadu_pd(line + i))));
+    for (; i < n; ++i)
+        acc[i] += w * line[i];
+}
+
+#endif //__SSE2__
+
+
+//Copies row y of src, converted to A, into line, which has room for radius
+//extra elements on both sides. line points at the first of those extra
+//elements. Rows and elements outside src are supplied by the boundary policy.
+//Only the halo at either end of the row goes through the policy, the rest is
+//a straight copy.
+template <typename A, typename Grid, typename Boundary>
+void stencil_load_line(A* line, const Grid& src, std::ptrdiff_t y, std::ptrdiff_t radius,
+                       const Boundary& b)
+{
+    const std::ptrdiff_t width = static_cast<std::ptrdiff_t>(array2d_width(src));
+    const std::ptrdiff_t height = static_cast<std::ptrdiff_t>(array2d_height(src));
+
+    const std::ptrdiff_t sy = b.index(y, height);
+    if (sy < 0)
+    {
+        std::fill(line, line + width + 2 * radius, b.template fill<A>());
+        return;
+    }
+
+    A* row = line + radius;
+    std::copy(src.row_begin(static_cast<std::size_t>(sy)),
+              src.row_end(static_cast<std::size_t>(sy)), row);
+
+    for (std::ptrdiff_t x = -radius; x < 0; ++x)
+    {
+        const std::ptrdiff_t sx = b.index(x, width);
+        row[x] = sx < 0 ? b.template fill<A>() : row[sx];
+    }
+    for (std::ptrdiff_t x = width; x < width + radius; ++x)
+    {
+        const std::ptrdiff_t sx = b.index(x, width);
+        row[x] = sx < 0 ? b.template fill<A>() : row[sx];
+    }
+}
+
+//The lines of source rows a band of output rows needs, radius_y above and
+//below the current row, kept in a ring so that moving down a row loads just
+//one new line.
+template <typename A>
+class stencil_lines
+{
+  private:
+    std::vector<A> m_storage;
+    std::vector<A*> m_lines;
+    std::size_t m_length;
+
+  public:
+    stencil_lines(std::size_t count, std::size_t length)
+        : m_storage(count * length), m_lines(count), m_length(length)
+    {
+        for (std::size_t i = 0; i < count; ++i)
+            m_lines[i] = m_storage.data() + i * length;
+    }
+
+    std::size_t size() const { return m_lines.size(); }
+
+    A* operator[](std::size_t i) const { return m_lines[i]; }
+    A* const* data() const { return m_lines.data(); }
+
+    //moves the oldest line to the end, to be overwritten by the next row
+    A* advance()
+    {
+        std::rotate(m_lines.begin(), m_lines.begin() + 1, m_lines.end());
+        return m_lines.back();
+    }
+};
+
+
+template <typename K>
+bool stencil_divides(const K& a, const K& b, std::true_type) { return a % b == K(); }
+
+template <typename K>
+bool stencil_divides(const K&, const K&, std::false_type) { return true; }
+
+//Factors k into column * row if it is separable (rank one), storing the
+//factors in row and column. Integral kernels are only separated into
+//integral factors, and floating point kernels to within a few ulps of their
+//largest weight.
+template <typename Kernel, typename A>
+bool stencil_separate(const Kernel& k, std::vector<A>& row, std::vector<A>& column)
+{
+    typedef typename Kernel::value_type K;
+
+    const std::size_t kw = array2d_width(k);
+    const std::size_t kh = array2d_height(k);
+
+    //the largest weight is the pivot, an all zero kernel is trivially separable
+    std::size_t px = 0;
+    std::size_t py = 0;
+    K largest = K();
+    for (std::size_t y = 0; y < kh; ++y)
+    {
+        for (std::size_t x = 0; x < kw; ++x)
+        {
+            const K v = k(x, y) < K() ? K() - k(x, y) : k(x, y);
+            if (v > largest)
+            {
+                largest = v;
+                px = x;
+                py = y;
+            }
+        }
+    }
+
+    std::vector<K> c(kh);
+    std::vector<K> r(kw);
+    for (std::size_t y = 0; y < kh; ++y)
+        c[y] = k(px, y);
+
+    if (std::is_integral<K>::value)
+    {
+        //divide out the common factor of the column so the row stays integral
+        std::uintmax_t g = 0;
+        for (std::size_t y = 0; y < kh; ++y)
+        {
+            const std::uintmax_t v = static_cast<std::uintmax_t>(c[y] < K() ? K() - c[y] : c[y]);
+            g = array2d_gcd(static_cast<std::size_t>(v), static_cast<std::size_t>(g));
+        }
+        if (g > 1)
+        {
+            for (std::size_t y = 0; y < kh; ++y)
+                c[y] = static_cast<K>(c[y] / static_cast<K>(g));
+        }
+    }
+
+    if (largest != K())
+    {
+        for (std::size_t x = 0; x < kw; ++x)
+        {
+            if (!stencil_divides(k(x, py), c[py], std::is_integral<K>()))
+                return false;
+            r[x] = k(x, py) / c[py];
+        }
+    }
+
+    const K tolerance = std::is_integral<K>::value ? K() :
+                        static_cast<K>(largest * 8 * std::numeric_limits<K>::epsilon());
+    for (std::size_t y = 0; y < kh; ++y)
+    {
+        for (std::size_t x = 0; x < kw; ++x)
+        {
+            const K d = k(x, y) - c[y] * r[x];
+            if ((d < K() ? K() - d : d) > tolerance)
+                return false;
+        }
+    }
+
+    row.assign(r.begin(), r.end());
+    column.assign(c.begin(), c.end());
+    return true;
+}
+
+//true when k is the product of a column and a row, so it can be applied as
+//two one dimensional passes
+template <typename Kernel>
+bool is_separable(const Kernel& k)
+{
+    std::vector<typename Kernel::value_type> row;
+    std::vector<typename Kernel::value_type> column;
+    return stencil_separate(k, row, column);
+}
+
+
+//dst(x, y) = the sum of k(i, j) * src(x + i - kw / 2, y + j - kh / 2) over
+//the kw by kh kernel k (a correlation, the kernel isn't flipped). The kernel
+//is any grid, use a static_array2d for one fixed at compile time. Sums are
+//accumulated in the common type of the source and kernel elements and
+//converted to dst's element type with saturate_cast. Separable kernels are
+//applied as a horizontal pass and then a vertical one. Rows of dst are
+//computed in bands in parallel. src and dst must have the same dimensions and
+//must not overlap.
+template <typename Src, typename Dst, typename Kernel, typename Boundary = clamp_boundary>
+void convolve(const Src& src, Dst& dst, const Kernel& k, const Boundary& b = Boundary(),
+              chunking c = chunking(), thread_pool& pool = default_thread_pool())
+{
+    typedef typename Dst::value_type T;
+    typedef typename std::common_type<typename Src::value_type,
+                                      typename Kernel::value_type>::type A;
+
+    const std::size_t width = array2d_width(src);
+    const std::size_t height = array2d_height(src);
+    const std::size_t kw = array2d_width(k);
+    const std::size_t kh = array2d_height(k);
+    if (width == 0 || height == 0 || kw == 0 || kh == 0)
+        return;
+
+    const std::ptrdiff_t rx = static_cast<std::ptrdiff_t>(kw / 2);
+    const std::ptrdiff_t ry = static_cast<std::ptrdiff_t>(kh / 2);
+    const std::size_t multiple =
+        parallel_row_multiple<T>(typename Dst::layout_type(), array2d_pitch(dst));
+
+    std::vector<A> row;
+    std::vector<A> column;
+    if (kw > 1 && kh > 1 && stencil_separate(k, row, column))
+    {
+        //the ring holds rows that have already been filtered horizontally
+        pool.parallel_for(height, [&](std::size_t begin, std::size_t end)
+        {
+            std::vector<A> padded(width + 2 * rx);
+            std::vector<A> acc(width);
+            stencil_lines<A> lines(kh, width);
+
+            auto filter_row = [&](A* out, std::ptrdiff_t y)
+            {
+                stencil_load_line(padded.data(), src, y, rx, b);
+                std::fill(out, out + width, A());
+                for (std::size_t i = 0; i < kw; ++i)
+                {
+                    if (row[i] != A())
+                        stencil_accumulate(out, padded.data() + i, row[i], width);
+                }
+            };
+
+            const std::ptrdiff_t first = static_cast<std::ptrdiff_t>(begin);
+            for (std::size_t j = 0; j + 1 < kh; ++j)
+                filter_row(lines[j + 1], first - ry + static_cast<std::ptrdiff_t>(j));
+
+            for (std::size_t y = begin; y < end; ++y)
+            {
+                filter_row(lines.advance(), static_cast<std::ptrdiff_t>(y) + ry);
+
+                std::fill(acc.begin(), acc.end(), A());
+                for (std::size_t j = 0; j < kh; ++j)
+                {
+                    if (column[j] != A())
+                        stencil_accumulate(acc.data(), lines[j], column[j], width);
+                }
+                std::transform(acc.begin(), acc.end(), dst.row_begin(y),
+                               [](const A& v) { return saturate_cast<T>(v); });
+            }
+        }, c, multiple);
+        return;
+    }
+
+    std::vector<A> weights(kw * kh);
+    for (std::size_t j = 0; j < kh; ++j)
+    {
+        for (std::size_t i = 0; i < kw; ++i)
+            weights[j * kw + i] = static_cast<A>(k(i, j));
+    }
+
+    pool.parallel_for(height, [&](std::size_t begin, std::size_t end)
+    {
+        std::vector<A> acc(width);
+        stencil_lines<A> lines(kh, width + 2 * rx);
+
+        const std::ptrdiff_t first = static_cast<std::ptrdiff_t>(begin);
+        for (std::size_t j = 0; j + 1 < kh; ++j)
+            stencil_load_line(lines[j + 1], src, first - ry + static_cast<std::ptrdiff_t>(j), rx, b);
+
+        for (std::size_t y = begin; y < end; ++y)
+        {
+            stencil_load_line(lines.advance(), src, static_cast<std::ptrdiff_t>(y) + ry, rx, b);
+
+            std::fill(acc.begin(), acc.end(), A());
+            for (std::size_t j = 0; j < kh; ++j)
+            {
+                for (std::size_t i = 0; i < kw; ++i)
+                {
+                    const A w = weights[j * kw + i];
+                    if (w != A())
+                        stencil_accumulate(acc.data(), lines[j] + i, w, width);
+                }
+            }
+            std::transform(acc.begin(), acc.end(), dst.row_begin(y),
+                           [](const A& v) { return saturate_cast<T>(v); });
+        }
+    }, c, multiple);
+}
+
+
+//The neighborhood of one element, as seen by the function given to
+//apply_stencil. w(dx, dy) is the element dx across and dy down from the
+//center, for dx and dy within the radii.
+template <typename T>
+class stencil_window
+{
+  private:
+    const T* const* m_lines;
+    std::ptrdiff_t m_x;
+    std::ptrdiff_t m_radius_x;
+    std::ptrdiff_t m_radius_y;
+
+  public:
+    stencil_window(const T* const* lines, std::ptrdiff_t x, std::ptrdiff_t radius_x,
+                   std::ptrdiff_t radius_y)
+        : m_lines(lines), m_x(x), m_radius_x(radius_x), m_radius_y(radius_y) { }
+
+    std::size_t x() const { return static_cast<std::size_t>(m_x); }
+    std::size_t radius_x() const { return static_cast<std::size_t>(m_radius_x); }
+    std::size_t radius_y() const { return static_cast<std::size_t>(m_radius_y); }
+
+    const T& operator()(std::ptrdiff_t dx, std::ptrdiff_t dy) const
+    { return m_lines[m_radius_y + dy][m_radius_x + m_x + dx]; }
+
+    const T& center() const { return m_lines[m_radius_y][m_radius_x + m_x]; }
+};
+
+//dst(x, y) = f(w) for a stencil_window w centered on src(x, y), reaching
+//radius_x elements across and radius_y down in each direction. f can be any
+//update rule, from a median filter to a cellular automaton. Rows of dst are
+//computed in bands in parallel. src and dst must have the same dimensions and
+//must not overlap.
+template <typename Src, typename Dst, typename F, typename Boundary = clamp_boundary>
+void apply_stencil(const Src& src, Dst& dst, std::size_t radius_x, std::size_t radius_y,
+                   F f, const Boundary& b = Boundary(), chunking c = chunking(),
+                   thread_pool& pool = default_thread_pool())
+{
+    typedef typename Src::value_type S;
+
+    const std::size_t width = array2d_width(src);
+    const std::size_t height = array2d_height(src);
+    if (width == 0 || height == 0)
+        return;
+
+    const std::ptrdiff_t rx = static_cast<std::ptrdiff_t>(radius_x);
+    const std::ptrdiff_t ry = static_cast<std::ptrdiff_t>(radius_y);
+    const std::size_t kh = 2 * radius_y + 1;
+    const std::size_t multiple = parallel_row_multiple<typename Dst::value_type>(
+        typename Dst::layout_type(), array2d_pitch(dst));
+
+    pool.parallel_for(height, [&](std::size_t begin, std::size_t end)
+    {
+        stencil_lines<S> lines(kh, width + 2 * radius_x);
+
+        const std::ptrdiff_t first = static_cast<std::ptrdiff_t>(begin);
+        for (std::size_t j = 0; j + 1 < kh; ++j)
+            stencil_load_line(lines[j + 1], src, first - ry + static_cast<std::ptrdiff_t>(j), rx, b);
+
+        for (std::size_t y = begin; y < end; ++y)
+        {
+            stencil_load_line(lines.advance(), src, static_cast<std::ptrdiff_t>(y) + ry, rx, b);
+
+            const S* const* rows = lines.data();
+            auto out = dst.row_begin(y);
+            for (std::ptrdiff_t x = 0; x < static_cast<std::ptrdiff_t>(width); ++x, ++out)
+                *out = f(stencil_window<S>(rows, x, rx, ry));
+        }
+    }, c, multiple);
+}
+
+
+//Runs steps updates of a, each reading one buffer and writing the other with
+//step(src, dst), then swapping them. Only one extra grid is ever allocated,
+//and a holds the result of the last step.
+template <typename Grid, typename Step>
+void stencil_iterate(Grid& a, std::size_t steps, Step step)
+{
+    if (steps == 0)
+        return;
+
+    Grid other(a);
+    Grid* src = &a;
+    Grid* dst = &other;
+    for (std::size_t i = 0; i < steps; ++i)
+    {
+        step(static_cast<const Grid&>(*src), *dst);
+        std::swap(src, dst);
+    }
+    if (src != &a)
+        a = std::move(other);
+}
+
+} //array2d
+
+#endif //ARRAY2D_STENCIL_H
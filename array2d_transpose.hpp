@@ -0,0 +1,633 @@
+/*
+ array2d_transpose.hpp - Cache-oblivious transpose, rotation and flipping of
+                         array2d, static_array2d and array2d_view.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#ifndef ARRAY2D_TRANSPOSE_H
+#define ARRAY2D_TRANSPOSE_H
+
+#include "array2d.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace array2d
+{
+
+//Transposes a Block by Block square of elements of the given size, reading
+//rows src_stride bytes apart and writing rows dst_stride bytes apart.
+//Block is 0 when there is no vectorized kernel for the element size.
+template <std::size_t Size>
+struct transpose_micro_kernel
+{
+    static constexpr std::size_t block = 0;
+
+    static void run(const unsigned char*, std::ptrdiff_t, unsigned char*, std::ptrdiff_t) { }
+};
+
+#if defined(__SSE2__)
+
+template <>
+struct transpose_micro_kernel<1>
+{
+    static constexpr std::size_t block = 8;
+
+    static void run(const unsigned char* src, std::ptrdiff_t ss,
+                    unsigned char* dst, std::ptrdiff_t ds)
+    {
+        const __m128i r0 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src));
+        const __m128i r1 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + ss));
+        const __m128i r2 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + 2 * ss));
+        const __m128i r3 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + 3 * ss));
+        const __m128i r4 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + 4 * ss));
+        const __m128i r5 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + 5 * ss));
+        const __m128i r6 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + 6 * ss));
+        const __m128i r7 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + 7 * ss));
+
+        const __m128i a0 = _mm_unpacklo_epi8(r0, r1);
+        const __m128i a1 = _mm_unpacklo_epi8(r2, r3);
+        const __m128i a2 = _mm_unpacklo_epi8(r4, r5);
+        const __m128i a3 = _mm_unpacklo_epi8(r6, r7);
+
+        const __m128i b0 = _mm_unpacklo_epi16(a0, a1);
+        const __m128i b1 = _mm_unpackhi_epi16(a0, a1);
+        const __m128i b2 = _mm_unpacklo_epi16(a2, a3);
+        const __m128i b3 = _mm_unpackhi_epi16(a2, a3);
+
+        const __m128i c0 = _mm_unpacklo_epi32(b0, b2);
+        const __m128i c1 = _mm_unpackhi_epi32(b0, b2);
+        const __m128i c2 = _mm_unpacklo_epi32(b1, b3);
+        const __m128i c3 = _mm_unpackhi_epi32(b1, b3);
+
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst), c0);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + ds), _mm_unpackhi_epi64(c0, c0));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + 2 * ds), c1);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + 3 * ds), _mm_unpackhi_epi64(c1, c1));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + 4 * ds), c2);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + 5 * ds), _mm_unpackhi_epi64(c2, c2));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + 6 * ds), c3);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + 7 * ds), _mm_unpackhi_epi64(c3, c3));
+    }
+};
+
+template <>
+struct transpose_micro_kernel<2>
+{
+    static constexpr std::size_t block = 8;
+
+    static void run(const unsigned char* src, std::ptrdiff_t ss,
+                    unsigned char* dst, std::ptrdiff_t ds)
+    {
+        __m128i r[8];
+        for (int i = 0; i < 8; ++i)
+            r[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * ss));
+
+        __m128i a[8];
+        for (int i = 0; i < 4; ++i)
+        {
+            a[2 * i] = _mm_unpacklo_epi16(r[2 * i], r[2 * i + 1]);
+            a[2 * i + 1] = _mm_unpackhi_epi16(r[2 * i], r[2 * i + 1]);
+        }
+
+        //b[4 * h + j] holds columns 2j and 2j + 1 of rows 4h to 4h + 3
+        __m128i b[8];
+        for (int h = 0; h < 2; ++h)
+        {
+            b[4 * h] = _mm_unpacklo_epi32(a[4 * h], a[4 * h + 2]);
+            b[4 * h + 1] = _mm_unpackhi_epi32(a[4 * h], a[4 * h + 2]);
+            b[4 * h + 2] = _mm_unpacklo_epi32(a[4 * h + 1], a[4 * h + 3]);
+            b[4 * h + 3] = _mm_unpackhi_epi32(a[4 * h + 1], a[4 * h + 3]);
+        }
+
+        for (int j = 0; j < 4; ++j)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 2 * j * ds),
+                             _mm_unpacklo_epi64(b[j], b[j + 4]));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + (2 * j + 1) * ds),
+                             _mm_unpackhi_epi64(b[j], b[j + 4]));
+        }
+    }
+};
+
+#if defined(__AVX__)
+
+template <>
+struct transpose_micro_kernel<4>
+{
+    static constexpr std::size_t block = 8;
+
+    static void run(const unsigned char* src, std::ptrdiff_t ss,
+                    unsigned char* dst, std::ptrdiff_t ds)
+    {
+        __m256 r[8];
+        for (int i = 0; i < 8; ++i)
+            r[i] = _mm256_loadu_ps(reinterpret_cast<const float*>(src + i * ss));
+
+        __m256 t[8];
+        for (int i = 0; i < 4; ++i)
+        {
+            t[2 * i] = _mm256_unpacklo_ps(r[2 * i], r[2 * i + 1]);
+            t[2 * i + 1] = _mm256_unpackhi_ps(r[2 * i], r[2 * i + 1]);
+        }
+
+        __m256 u[8];
+        for (int h = 0; h < 2; ++h)
+        {
+            u[4 * h] = _mm256_shuffle_ps(t[4 * h], t[4 * h + 2], _MM_SHUFFLE(1, 0, 1, 0));
+            u[4 * h + 1] = _mm256_shuffle_ps(t[4 * h], t[4 * h + 2], _MM_SHUFFLE(3, 2, 3, 2));
+            u[4 * h + 2] = _mm256_shuffle_ps(t[4 * h + 1], t[4 * h + 3], _MM_SHUFFLE(1, 0, 1, 0));
+            u[4 * h + 3] = _mm256_shuffle_ps(t[4 * h + 1], t[4 * h + 3], _MM_SHUFFLE(3, 2, 3, 2));
+        }
+
+        for (int j = 0; j < 4; ++j)
+        {
+            _mm256_storeu_ps(reinterpret_cast<float*>(dst + j * ds),
+                             _mm256_permute2f128_ps(u[j], u[j + 4], 0x20));
+            _mm256_storeu_ps(reinterpret_cast<float*>(dst + (j + 4) * ds),
+                             _mm256_permute2f128_ps(u[j], u[j + 4], 0x31));
+        }
+    }
+};
+
+template <>
+struct transpose_micro_kernel<8>
+{
+    static constexpr std::size_t block = 4;
+
+    static void run(const unsigned char* src, std::ptrdiff_t ss,
+                    unsigned char* dst, std::ptrdiff_t ds)
+    {
+        const __m256d r0 = _mm256_loadu_pd(reinterpret_cast<const double*>(src));
+        const __m256d r1 = _mm256_loadu_pd(reinterpret_cast<const double*>(src + ss));
+        const __m256d r2 = _mm256_loadu_pd(reinterpret_cast<const double*>(src + 2 * ss));
+        const __m256d r3 = _mm256_loadu_pd(reinterpret_cast<const double*>(src + 3 * ss));
+
+        const __m256d t0 = _mm256_unpacklo_pd(r0, r1);
+        const __m256d t1 = _mm256_unpackhi_pd(r0, r1);
+        const __m256d t2 = _mm256_unpacklo_pd(r2, r3);
+        const __m256d t3 = _mm256_unpackhi_pd(r2, r3);
+
+        _mm256_storeu_pd(reinterpret_cast<double*>(dst),
+                         _mm256_permute2f128_pd(t0, t2, 0x20));
+        _mm256_storeu_pd(reinterpret_cast<double*>(dst + ds),
+                         _mm256_permute2f128_pd(t1, t3, 0x20));
+        _mm256_storeu_pd(reinterpret_cast<double*>(dst + 2 * ds),
+                         _mm256_permute2f128_pd(t0, t2, 0x31));
+        _mm256_storeu_pd(reinterpret_cast<double*>(dst + 3 * ds),
+                         _mm256_permute2f128_pd(t1, t3, 0x31));
+    }
+};
+
+#else //__AVX__
+
+template <>
+struct transpose_micro_kernel<4>
+{
+    static constexpr std::size_t block = 4;
+
+    static void run(const unsigned char* src, std::ptrdiff_t ss,
+                    unsigned char* dst, std::ptrdiff_t ds)
+    {
+        __m128 r0 = _mm_loadu_ps(reinterpret_cast<const float*>(src));
+        __m128 r1 = _mm_loadu_ps(reinterpret_cast<const float*>(src + ss));
+        __m128 r2 = _mm_loadu_ps(reinterpret_cast<const float*>(src + 2 * ss));
+        __m128 r3 = _mm_loadu_ps(reinterpret_cast<const float*>(src + 3 * ss));
+
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+        _mm_storeu_ps(reinterpret_cast<float*>(dst), r0);
+        _mm_storeu_ps(reinterpret_cast<float*>(dst + ds), r1);
+        _mm_storeu_ps(reinterpret_cast<float*>(dst + 2 * ds), r2);
+        _mm_storeu_ps(reinterpret_cast<float*>(dst + 3 * ds), r3);
+    }
+};
+
+template <>
+struct transpose_micro_kernel<8>
+{
+    static constexpr std::size_t block = 2;
+
+    static void run(const unsigned char* src, std::ptrdiff_t ss,
+                    unsigned char* dst, std::ptrdiff_t ds)
+    {
+        const __m128d r0 = _mm_loadu_pd(reinterpret_cast<const double*>(src));
+        const __m128d r1 = _mm_loadu_pd(reinterpret_cast<const double*>(src + ss));
+
+        _mm_storeu_pd(reinterpret_cast<double*>(dst), _mm_unpacklo_pd(r0, r1));
+        _mm_storeu_pd(reinterpret_cast<double*>(dst + ds), _mm_unpackhi_pd(r0, r1));
+    }
+};
+
+#endif //__AVX__
+#endif //__SSE2__
+
+
+//Transposes w by h elements of src, whose rows are src_stride elements apart,
+//into h by w elements of dst, whose rows are dst_stride elements apart. Strides
+//may be negative to walk rows bottom up.
+template <typename T>
+struct transposer
+{
+    typedef transpose_micro_kernel<
+        std::is_trivially_copyable<T>::value ? sizeof(T) : 0
+    > kernel;
+
+    static constexpr std::ptrdiff_t block = kernel::block;
+
+    //elements are addressed with signed offsets so strides can be negative
+
+    //largest block transposed without splitting further, so that it and its
+    //destination stay in L1
+    static constexpr std::ptrdiff_t leaf = sizeof(T) <= 2 ? 64 : 32;
+
+    static void leaf_transpose(const T* src, std::ptrdiff_t ss, T* dst, std::ptrdiff_t ds,
+                               std::ptrdiff_t w, std::ptrdiff_t h)
+    {
+        std::ptrdiff_t bw = 0;
+        std::ptrdiff_t bh = 0;
+        if (block != 0)
+        {
+            bw = w / block * block;
+            bh = h / block * block;
+            for (std::ptrdiff_t y = 0; y < bh; y += block)
+            {
+                for (std::ptrdiff_t x = 0; x < bw; x += block)
+                    kernel::run(reinterpret_cast<const unsigned char*>(src + y * ss + x),
+                                ss * static_cast<std::ptrdiff_t>(sizeof(T)),
+                                reinterpret_cast<unsigned char*>(dst + x * ds + y),
+                                ds * static_cast<std::ptrdiff_t>(sizeof(T)));
+            }
+        }
+
+        //whatever the kernel didn't cover: the right edge of the blocked rows
+        //and then every remaining row
+        for (std::ptrdiff_t y = 0; y < bh; ++y)
+        {
+            for (std::ptrdiff_t x = bw; x < w; ++x)
+                dst[x * ds + y] = src[y * ss + x];
+        }
+        for (std::ptrdiff_t y = bh; y < h; ++y)
+        {
+            for (std::ptrdiff_t x = 0; x < w; ++x)
+                dst[x * ds + y] = src[y * ss + x];
+        }
+    }
+
+    //half of n, rounded to a whole number of kernel blocks
+    static std::ptrdiff_t split(std::ptrdiff_t n)
+    {
+        const std::ptrdiff_t half = n / 2;
+        if (block == 0 || half < block)
+            return half;
+        return half / block * block;
+    }
+
+    static void transpose(const T* src, std::ptrdiff_t ss, T* dst, std::ptrdiff_t ds,
+                          std::ptrdiff_t w, std::ptrdiff_t h)
+    {
+        while (w > leaf || h > leaf)
+        {
+            if (w >= h)
+            {
+                const std::ptrdiff_t half = split(w);
+                transpose(src, ss, dst, ds, half, h);
+                src += half;
+                dst += half * ds;
+                w -= half;
+            }
+            else
+            {
+                const std::ptrdiff_t half = split(h);
+                transpose(src, ss, dst, ds, w, half);
+                src += half * ss;
+                dst += half;
+                h -= half;
+            }
+        }
+        leaf_transpose(src, ss, dst, ds, w, h);
+    }
+
+    //transposes the n by n square in place
+    static void transpose_square(T* data, std::ptrdiff_t stride, std::ptrdiff_t n)
+    {
+        for (std::ptrdiff_t by = 0; by < n; by += leaf)
+        {
+            const std::ptrdiff_t bh = n - by < leaf ? n - by : leaf;
+            for (std::ptrdiff_t bx = by; bx < n; bx += leaf)
+            {
+                const std::ptrdiff_t bw = n - bx < leaf ? n - bx : leaf;
+                if (bx == by)
+                    transpose_diagonal(data + by * stride + bx, stride, bw);
+                else
+                    swap_transposed(data + by * stride + bx, data + bx * stride + by,
+                                    stride, bw, bh);
+            }
+        }
+    }
+
+    static void transpose_diagonal(T* data, std::ptrdiff_t stride, std::ptrdiff_t n)
+    {
+        using std::swap;
+        for (std::ptrdiff_t y = 0; y < n; ++y)
+        {
+            for (std::ptrdiff_t x = y + 1; x < n; ++x)
+                swap(data[y * stride + x], data[x * stride + y]);
+        }
+    }
+
+    //swaps the w by h block at a with the transpose of the h by w block at b
+    static void swap_transposed(T* a, T* b, std::ptrdiff_t stride,
+                                std::ptrdiff_t w, std::ptrdiff_t h)
+    {
+        using std::swap;
+        const std::ptrdiff_t bw = block != 0 ? w / block * block : 0;
+        const std::ptrdiff_t bh = block != 0 ? h / block * block : 0;
+        swap_transposed_blocks(a, b, stride, bw, bh,
+                               std::integral_constant<bool, block != 0>());
+
+        for (std::ptrdiff_t y = 0; y < bh; ++y)
+        {
+            for (std::ptrdiff_t x = bw; x < w; ++x)
+                swap(a[y * stride + x], b[x * stride + y]);
+        }
+        for (std::ptrdiff_t y = bh; y < h; ++y)
+        {
+            for (std::ptrdiff_t x = 0; x < w; ++x)
+                swap(a[y * stride + x], b[x * stride + y]);
+        }
+    }
+
+    static void swap_transposed_blocks(T*, T*, std::ptrdiff_t, std::ptrdiff_t,
+                                       std::ptrdiff_t, std::false_type)
+    { }
+
+    //the bw by bh part of swap_transposed covered by whole kernel blocks
+    static void swap_transposed_blocks(T* a, T* b, std::ptrdiff_t stride,
+                                       std::ptrdiff_t bw, std::ptrdiff_t bh, std::true_type)
+    {
+        const std::ptrdiff_t bytes = stride * static_cast<std::ptrdiff_t>(sizeof(T));
+        const std::ptrdiff_t tmp_bytes = block * static_cast<std::ptrdiff_t>(sizeof(T));
+        T tmp[block * block];
+        for (std::ptrdiff_t y = 0; y < bh; y += block)
+        {
+            for (std::ptrdiff_t x = 0; x < bw; x += block)
+            {
+                T* pa = a + y * stride + x;
+                T* pb = b + x * stride + y;
+                kernel::run(reinterpret_cast<const unsigned char*>(pa), bytes,
+                            reinterpret_cast<unsigned char*>(tmp), tmp_bytes);
+                kernel::run(reinterpret_cast<const unsigned char*>(pb), bytes,
+                            reinterpret_cast<unsigned char*>(pa), bytes);
+                for (std::ptrdiff_t i = 0; i < block; ++i)
+                    std::copy(tmp + i * block, tmp + (i + 1) * block, pb + i * stride);
+            }
+        }
+    }
+};
+
+
+//Each operation below writes src into dst, which must have the right
+//dimensions and must not overlap src. Views must be row_major.
+
+//dst(x, y) = src(y, x), dst is src.height() wide and src.width() high
+template <typename S, typename T>
+void transpose(array2d_view<S> src, array2d_view<T> dst)
+{
+    static_assert(std::is_same<typename std::remove_const<S>::type, T>::value,
+                  "source and destination element types must match");
+    transposer<T>::transpose(src.data(), src.pitch(), dst.data(), dst.pitch(),
+                             src.width(), src.height());
+}
+
+//quarter turn clockwise, dst(x, y) = src(y, src.height() - 1 - x)
+template <typename S, typename T>
+void rotate90(array2d_view<S> src, array2d_view<T> dst)
+{
+    static_assert(std::is_same<typename std::remove_const<S>::type, T>::value,
+                  "source and destination element types must match");
+    if (src.height() == 0)
+        return;
+
+    //transpose src with its rows in reverse order
+    const std::ptrdiff_t pitch = static_cast<std::ptrdiff_t>(src.pitch());
+    transposer<T>::transpose(src.data() + (src.height() - 1) * src.pitch(), -pitch,
+                             dst.data(), dst.pitch(), src.width(), src.height());
+}
+
+//quarter turn counter-clockwise, dst(x, y) = src(src.width() - 1 - y, x)
+template <typename S, typename T>
+void rotate270(array2d_view<S> src, array2d_view<T> dst)
+{
+    static_assert(std::is_same<typename std::remove_const<S>::type, T>::value,
+                  "source and destination element types must match");
+    if (src.width() == 0)
+        return;
+
+    //transpose src into dst with dst's rows in reverse order
+    const std::ptrdiff_t pitch = static_cast<std::ptrdiff_t>(dst.pitch());
+    transposer<T>::transpose(src.data(), src.pitch(),
+                             dst.data() + (dst.height() - 1) * dst.pitch(), -pitch,
+                             src.width(), src.height());
+}
+
+//half turn, dst(x, y) = src(src.width() - 1 - x, src.height() - 1 - y)
+template <typename S, typename T>
+void rotate180(array2d_view<S> src, array2d_view<T> dst)
+{
+    static_assert(std::is_same<typename std::remove_const<S>::type, T>::value,
+                  "source and destination element types must match");
+    const std::size_t h = src.height();
+    for (std::size_t y = 0; y < h; ++y)
+        std::reverse_copy(src.row_begin(y), src.row_end(y), dst.row_begin(h - 1 - y));
+}
+
+//mirror left to right, dst(x, y) = src(src.width() - 1 - x, y)
+template <typename S, typename T>
+void flip_horizontal(array2d_view<S> src, array2d_view<T> dst)
+{
+    static_assert(std::is_same<typename std::remove_const<S>::type, T>::value,
+                  "source and destination element types must match");
+    for (std::size_t y = 0; y < src.height(); ++y)
+        std::reverse_copy(src.row_begin(y), src.row_end(y), dst.row_begin(y));
+}
+
+//mirror top to bottom, dst(x, y) = src(x, src.height() - 1 - y)
+template <typename S, typename T>
+void flip_vertical(array2d_view<S> src, array2d_view<T> dst)
+{
+    static_assert(std::is_same<typename std::remove_const<S>::type, T>::value,
+                  "source and destination element types must match");
+    const std::size_t h = src.height();
+    for (std::size_t y = 0; y < h; ++y)
+        std::copy(src.row_begin(y), src.row_end(y), dst.row_begin(h - 1 - y));
+}
+
+
+//In place operations. transpose_in_place requires a square view.
+
+template <typename T>
+void transpose_in_place(array2d_view<T> a)
+{
+    transposer<T>::transpose_square(a.data(), a.pitch(), a.width());
+}
+
+template <typename T>
+void flip_horizontal_in_place(array2d_view<T> a)
+{
+    for (std::size_t y = 0; y < a.height(); ++y)
+        std::reverse(a.row_begin(y), a.row_end(y));
+}
+
+template <typename T>
+void flip_vertical_in_place(array2d_view<T> a)
+{
+    for (std::size_t y = 0, h = a.height(); y < h / 2; ++y)
+        std::swap_ranges(a.row_begin(y), a.row_end(y), a.row_begin(h - 1 - y));
+}
+
+template <typename T>
+void rotate180_in_place(array2d_view<T> a)
+{
+    const std::size_t h = a.height();
+    for (std::size_t y = 0; y < h / 2; ++y)
+    {
+        std::reverse(a.row_begin(y), a.row_end(y));
+        std::reverse(a.row_begin(h - 1 - y), a.row_end(h - 1 - y));
+        std::swap_ranges(a.row_begin(y), a.row_end(y), a.row_begin(h - 1 - y));
+    }
+    if (h % 2 != 0)
+        std::reverse(a.row_begin(h / 2), a.row_end(h / 2));
+}
+
+
+//Container versions, which return a new container. The row alignment and
+//allocator of src are kept.
+
+template <typename T, typename A, std::size_t R>
+array2d<T, A, R> transpose(const array2d<T, A, R>& src)
+{
+    array2d<T, A, R> dst(src.height(), src.width(), src.get_allocator());
+    transpose(const_array2d_view<T>(src), array2d_view<T>(dst));
+    return dst;
+}
+
+template <typename T, typename A, std::size_t R>
+array2d<T, A, R> rotate90(const array2d<T, A, R>& src)
+{
+    array2d<T, A, R> dst(src.height(), src.width(), src.get_allocator());
+    rotate90(const_array2d_view<T>(src), array2d_view<T>(dst));
+    return dst;
+}
+
+template <typename T, typename A, std::size_t R>
+array2d<T, A, R> rotate180(const array2d<T, A, R>& src)
+{
+    array2d<T, A, R> dst(src.width(), src.height(), src.get_allocator());
+    rotate180(const_array2d_view<T>(src), array2d_view<T>(dst));
+    return dst;
+}
+
+template <typename T, typename A, std::size_t R>
+array2d<T, A, R> rotate270(const array2d<T, A, R>& src)
+{
+    array2d<T, A, R> dst(src.height(), src.width(), src.get_allocator());
+    rotate270(const_array2d_view<T>(src), array2d_view<T>(dst));
+    return dst;
+}
+
+template <typename T, typename A, std::size_t R>
+array2d<T, A, R> flip_horizontal(const array2d<T, A, R>& src)
+{
+    array2d<T, A, R> dst(src.width(), src.height(), src.get_allocator());
+    flip_horizontal(const_array2d_view<T>(src), array2d_view<T>(dst));
+    return dst;
+}
+
+template <typename T, typename A, std::size_t R>
+array2d<T, A, R> flip_vertical(const array2d<T, A, R>& src)
+{
+    array2d<T, A, R> dst(src.width(), src.height(), src.get_allocator());
+    flip_vertical(const_array2d_view<T>(src), array2d_view<T>(dst));
+    return dst;
+}
+
+template <typename T, std::size_t W, std::size_t H>
+static_array2d<T, H, W> transpose(const static_array2d<T, W, H>& src)
+{
+    static_array2d<T, H, W> dst;
+    transpose(const_array2d_view<T>(src), array2d_view<T>(dst));
+    return dst;
+}
+
+template <typename T, std::size_t W, std::size_t H>
+static_array2d<T, H, W> rotate90(const static_array2d<T, W, H>& src)
+{
+    static_array2d<T, H, W> dst;
+    rotate90(const_array2d_view<T>(src), array2d_view<T>(dst));
+    return dst;
+}
+
+template <typename T, std::size_t W, std::size_t H>
+static_array2d<T, W, H> rotate180(const static_array2d<T, W, H>& src)
+{
+    static_array2d<T, W, H> dst;
+    rotate180(const_array2d_view<T>(src), array2d_view<T>(dst));
+    return dst;
+}
+
+template <typename T, std::size_t W, std::size_t H>
+static_array2d<T, H, W> rotate270(const static_array2d<T, W, H>& src)
+{
+    static_array2d<T, H, W> dst;
+    rotate270(const_array2d_view<T>(src), array2d_view<T>(dst));
+    return dst;
+}
+
+template <typename T, std::size_t W, std::size_t H>
+static_array2d<T, W, H> flip_horizontal(const static_array2d<T, W, H>& src)
+{
+    static_array2d<T, W, H> dst;
+    flip_horizontal(const_array2d_view<T>(src), array2d_view<T>(dst));
+    return dst;
+}
+
+template <typename T, std::size_t W, std::size_t H>
+static_array2d<T, W, H> flip_vertical(const static_array2d<T, W, H>& src)
+{
+    static_array2d<T, W, H> dst;
+    flip_vertical(const_array2d_view<T>(src), array2d_view<T>(dst));
+    return dst;
+}
+
+} //array2d
+
+#endif //ARRAY2D_TRANSPOSE_H
@@ -0,0 +1,253 @@
+/*
+ access_bench.cpp - Iteration, element access, emplace, copy and move of
+                    array2d, static_array2d and std::vector.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#include "benchmark.hpp"
+#include "grids.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace array2d_bench
+{
+
+namespace
+{
+
+//random coordinates spread over the whole grid, cheap enough to make on the
+//fly that lookups are what is timed
+class coordinates
+{
+  private:
+    std::uint64_t m_state;
+    std::uint64_t m_width;
+    std::uint64_t m_height;
+
+  public:
+    coordinates(std::size_t width, std::size_t height)
+        : m_state(0x9E3779B97F4A7C15ull), m_width(width), m_height(height) { }
+
+    void next(std::size_t& x, std::size_t& y)
+    {
+        m_state ^= m_state << 13;
+        m_state ^= m_state >> 7;
+        m_state ^= m_state << 17;
+        x = static_cast<std::size_t>(((m_state >> 32) * m_width) >> 32);
+        y = static_cast<std::size_t>(((m_state & 0xFFFFFFFFu) * m_height) >> 32);
+    }
+};
+
+template <typename Grid>
+std::unique_ptr<Grid> make_grid(std::size_t width, std::size_t height)
+{ return grid_traits<Grid>::make(width, height); }
+
+template <typename Grid>
+void full_iteration(state& s, std::size_t width, std::size_t height)
+{
+    std::unique_ptr<Grid> g = make_grid<Grid>(width, height);
+    for (auto _ : s)
+        do_not_optimize(sum_all(*g));
+    s.set_bytes_processed(s.iterations() * width * height * sizeof(typename Grid::value_type));
+}
+
+template <typename Grid>
+void row_traversal(state& s, std::size_t width, std::size_t height)
+{
+    std::unique_ptr<Grid> g = make_grid<Grid>(width, height);
+    for (auto _ : s)
+        do_not_optimize(sum_rows(*g, width, height));
+    s.set_bytes_processed(s.iterations() * width * height * sizeof(typename Grid::value_type));
+}
+
+template <typename Grid>
+void column_traversal(state& s, std::size_t width, std::size_t height)
+{
+    std::unique_ptr<Grid> g = make_grid<Grid>(width, height);
+    for (auto _ : s)
+        do_not_optimize(sum_columns(*g, width, height));
+    s.set_bytes_processed(s.iterations() * width * height * sizeof(typename Grid::value_type));
+}
+
+//each item is one lookup
+template <typename Grid>
+void random_index(state& s, std::size_t width, std::size_t height)
+{
+    typedef typename Grid::value_type T;
+    const std::size_t lookups = 1024;
+    std::unique_ptr<Grid> g = make_grid<Grid>(width, height);
+    coordinates c(width, height);
+    for (auto _ : s)
+    {
+        T sum = T();
+        for (std::size_t i = 0; i < lookups; ++i)
+        {
+            std::size_t x, y;
+            c.next(x, y);
+            sum += index(*g, x, y);
+        }
+        do_not_optimize(sum);
+    }
+    s.set_items_processed(s.iterations() * lookups);
+}
+
+template <typename Grid>
+void emplace(state& s, std::size_t width, std::size_t height)
+{
+    typedef typename Grid::value_type T;
+    std::unique_ptr<Grid> g = make_grid<Grid>(width, height);
+    T value = T();
+    for (auto _ : s)
+    {
+        emplace_all(*g, width, height, value);
+        clobber_memory();
+        value += T(1);
+    }
+    s.set_bytes_processed(s.iterations() * width * height * sizeof(T));
+}
+
+template <typename Grid>
+void copy_construct(state& s, std::size_t width, std::size_t height)
+{
+    std::unique_ptr<Grid> g = make_grid<Grid>(width, height);
+    for (auto _ : s)
+    {
+        std::unique_ptr<Grid> copy(new Grid(*g));
+        do_not_optimize(data(*copy));
+    }
+    s.set_bytes_processed(s.iterations() * width * height * sizeof(typename Grid::value_type));
+}
+
+template <typename Grid>
+void copy_assign(state& s, std::size_t width, std::size_t height)
+{
+    std::unique_ptr<Grid> g = make_grid<Grid>(width, height);
+    std::unique_ptr<Grid> copy = make_grid<Grid>(width, height);
+    for (auto _ : s)
+    {
+        *copy = *g;
+        do_not_optimize(data(*copy));
+    }
+    s.set_bytes_processed(s.iterations() * width * height * sizeof(typename Grid::value_type));
+}
+
+//moves the grid out and back again, so each item is one move construction
+//and one move assignment
+template <typename Grid>
+void move_construct(state& s, std::size_t width, std::size_t height)
+{
+    std::unique_ptr<Grid> g = make_grid<Grid>(width, height);
+    for (auto _ : s)
+    {
+        std::unique_ptr<Grid> moved(new Grid(std::move(*g)));
+        *g = std::move(*moved);
+        do_not_optimize(data(*g));
+    }
+    s.set_items_processed(s.iterations());
+}
+
+//each item is one move assignment
+template <typename Grid>
+void move_assign(state& s, std::size_t width, std::size_t height)
+{
+    std::unique_ptr<Grid> g = make_grid<Grid>(width, height);
+    std::unique_ptr<Grid> other = make_grid<Grid>(width, height);
+    for (auto _ : s)
+    {
+        *other = std::move(*g);
+        *g = std::move(*other);
+        do_not_optimize(data(*g));
+    }
+    s.set_items_processed(s.iterations() * 2);
+}
+
+
+template <typename Grid>
+void register_grid(const std::string& size, std::size_t width, std::size_t height)
+{
+    typedef void (*function)(state&, std::size_t, std::size_t);
+    const struct
+    {
+        const char* name;
+        function run;
+    } benchmarks[] = {
+        { "full_iteration", &full_iteration<Grid> },
+        { "row_traversal", &row_traversal<Grid> },
+        { "column_traversal", &column_traversal<Grid> },
+        { "random_index", &random_index<Grid> },
+        { "emplace", &emplace<Grid> },
+        { "copy_construct", &copy_construct<Grid> },
+        { "copy_assign", &copy_assign<Grid> },
+        { "move_construct", &move_construct<Grid> },
+        { "move_assign", &move_assign<Grid> }
+    };
+
+    for (std::size_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); ++i)
+    {
+        const function run = benchmarks[i].run;
+        register_benchmark(std::string(benchmarks[i].name) + "/" + grid_traits<Grid>::name() +
+                           "/" + size,
+                           [=](state& s) { run(s, width, height); });
+    }
+}
+
+template <typename T, std::size_t Bytes>
+void register_size(const std::string& size)
+{
+    const std::size_t side = grid_side<T, Bytes>::value;
+    register_grid<vector_grid<T> >(size, side, side);
+    register_grid<array2d::array2d<T> >(size, side, side);
+    register_grid<array2d::static_array2d<T, side, side> >(size, side, side);
+}
+
+template <typename T>
+void register_type()
+{
+    //sizes that fit in L1, L2 and the last level cache, and one that fits in none
+    register_size<T, 16 * 1024>("16KiB");
+    register_size<T, 256 * 1024>("256KiB");
+    register_size<T, 4 * 1024 * 1024>("4MiB");
+    register_size<T, 64 * 1024 * 1024>("64MiB");
+}
+
+struct registrar
+{
+    registrar()
+    {
+        register_type<std::uint8_t>();
+        register_type<float>();
+        register_type<double>();
+    }
+} register_access_benchmarks;
+
+} //namespace
+
+} //array2d_bench
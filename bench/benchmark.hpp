@@ -0,0 +1,496 @@
+/*
+ benchmark.hpp - A small benchmark harness in the style of Google Benchmark,
+                 which writes the same JSON so its tools can compare runs.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#ifndef ARRAY2D_BENCHMARK_H
+#define ARRAY2D_BENCHMARK_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace array2d_bench
+{
+
+inline double cpu_seconds()
+{
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+    timespec ts;
+    ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) * 1e-9;
+#else
+    return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+#endif
+}
+
+//Passed to each benchmark, which runs its timed loop as
+//
+//    for (auto _ : s)
+//        ...
+//
+//and may then report how much work an iteration did. Only the loop is timed,
+//so setting up before it and checking after it are free.
+class state
+{
+  private:
+    std::uint64_t m_iterations;
+    std::uint64_t m_bytes;
+    std::uint64_t m_items;
+    std::chrono::steady_clock::time_point m_start;
+    double m_cpu_start;
+    double m_real_time;
+    double m_cpu_time;
+
+  public:
+    //the loop variable, which is marked so it isn't reported as unused
+#if defined(__GNUC__)
+    struct __attribute__((unused)) value { };
+#else
+    struct value { };
+#endif
+
+    struct iterator
+    {
+        state* s;
+        std::uint64_t n;
+
+        bool operator!=(const iterator& o) const
+        {
+            if (n != o.n)
+                return true;
+            s->stop();
+            return false;
+        }
+        iterator& operator++() { ++n; return *this; }
+        value operator*() const { return value(); }
+    };
+
+    explicit state(std::uint64_t iterations)
+        : m_iterations(iterations), m_bytes(0), m_items(0), m_start(),
+          m_cpu_start(0), m_real_time(0), m_cpu_time(0) { }
+
+    iterator begin()
+    {
+        iterator it = { this, 0 };
+        m_cpu_start = cpu_seconds();
+        m_start = std::chrono::steady_clock::now();
+        return it;
+    }
+    iterator end() { iterator it = { this, m_iterations }; return it; }
+
+    std::uint64_t iterations() const { return m_iterations; }
+
+    //totals over every iteration
+    void set_bytes_processed(std::uint64_t bytes) { m_bytes = bytes; }
+    void set_items_processed(std::uint64_t items) { m_items = items; }
+
+    std::uint64_t bytes_processed() const { return m_bytes; }
+    std::uint64_t items_processed() const { return m_items; }
+
+    //seconds spent in the loop
+    double real_time() const { return m_real_time; }
+    double cpu_time() const { return m_cpu_time; }
+
+  private:
+    void stop()
+    {
+        m_real_time = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - m_start).count();
+        m_cpu_time = cpu_seconds() - m_cpu_start;
+    }
+};
+
+//keeps the compiler from optimizing away the computation of value
+template <typename T>
+inline void do_not_optimize(const T& value)
+{
+#if defined(__GNUC__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+//keeps the compiler from optimizing away writes to memory
+inline void clobber_memory()
+{
+#if defined(__GNUC__)
+    asm volatile("" : : : "memory");
+#endif
+}
+
+
+struct benchmark
+{
+    std::string name;
+    std::function<void(state&)> run;
+};
+
+inline std::vector<benchmark>& registry()
+{
+    static std::vector<benchmark> benchmarks;
+    return benchmarks;
+}
+
+inline void register_benchmark(const std::string& name, std::function<void(state&)> run)
+{
+    benchmark b = { name, run };
+    registry().push_back(b);
+}
+
+
+//the result of running a benchmark, per iteration
+struct result
+{
+    std::string name;
+    std::uint64_t iterations;
+    double real_time;   //nanoseconds
+    double cpu_time;    //nanoseconds
+    double bytes_per_second;
+    double items_per_second;
+};
+
+//runs b with more and more iterations until a run takes min_time seconds
+inline result run_benchmark(const benchmark& b, double min_time)
+{
+    std::uint64_t iterations = 1;
+    for (;;)
+    {
+        state s(iterations);
+        b.run(s);
+        const double real = s.real_time();
+        const double cpu = s.cpu_time();
+
+        const std::uint64_t max_iterations = 1000000000;
+        if (real >= min_time || iterations >= max_iterations)
+        {
+            result r;
+            r.name = b.name;
+            r.iterations = iterations;
+            r.real_time = real * 1e9 / static_cast<double>(iterations);
+            r.cpu_time = cpu * 1e9 / static_cast<double>(iterations);
+            r.bytes_per_second = real > 0 ? static_cast<double>(s.bytes_processed()) / real : 0;
+            r.items_per_second = real > 0 ? static_cast<double>(s.items_processed()) / real : 0;
+            return r;
+        }
+
+        //aim a little past min_time, growing at most tenfold while runs are
+        //too short to predict from
+        double multiplier = min_time * 1.4 / std::max(real, 1e-9);
+        if (real / min_time <= 0.1)
+            multiplier = std::min(multiplier, 10.0);
+        const double next = std::max(static_cast<double>(iterations) * multiplier,
+                                     static_cast<double>(iterations) + 1);
+        iterations = static_cast<std::uint64_t>(
+            std::min(next, static_cast<double>(max_iterations)));
+    }
+}
+
+
+//Cache sizes as Linux reports them, for the context of a JSON report.
+struct cache_info
+{
+    std::string type;
+    int level;
+    std::uint64_t size;
+    int num_sharing;
+};
+
+inline std::vector<cache_info> caches()
+{
+    std::vector<cache_info> result;
+    for (int i = 0; ; ++i)
+    {
+        std::ostringstream dir;
+        dir << "/sys/devices/system/cpu/cpu0/cache/index" << i << "/";
+
+        std::ifstream type_file((dir.str() + "type").c_str());
+        std::ifstream level_file((dir.str() + "level").c_str());
+        std::ifstream size_file((dir.str() + "size").c_str());
+        if (!type_file || !level_file || !size_file)
+            break;
+
+        cache_info c;
+        std::string size;
+        type_file >> c.type;
+        level_file >> c.level;
+        size_file >> size;
+        c.size = std::strtoull(size.c_str(), nullptr, 10);
+        if (!size.empty() && (size.back() == 'K' || size.back() == 'k'))
+            c.size *= 1024;
+        else if (!size.empty() && size.back() == 'M')
+            c.size *= 1024 * 1024;
+
+        //the shared cpus are a list of ranges such as 0-3,8-11
+        c.num_sharing = 0;
+        std::ifstream shared_file((dir.str() + "shared_cpu_list").c_str());
+        std::string range;
+        while (std::getline(shared_file, range, ','))
+        {
+            int first = 0, last = 0;
+            const int n = std::sscanf(range.c_str(), "%d-%d", &first, &last);
+            c.num_sharing += n == 2 ? last - first + 1 : n == 1 ? 1 : 0;
+        }
+        result.push_back(c);
+    }
+    return result;
+}
+
+inline std::string json_escape(const std::string& s)
+{
+    std::string out;
+    for (std::size_t i = 0; i < s.size(); ++i)
+    {
+        if (s[i] == '"' || s[i] == '\\')
+            out += '\\';
+        out += s[i];
+    }
+    return out;
+}
+
+inline void write_json(std::ostream& out, const std::string& executable,
+                       const std::vector<result>& results)
+{
+    char date[64];
+    const std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", std::localtime(&now));
+
+    out.precision(10);
+    out << "{\n"
+        << "  \"context\": {\n"
+        << "    \"date\": \"" << date << "\",\n"
+        << "    \"executable\": \"" << json_escape(executable) << "\",\n"
+        << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n"
+        << "    \"caches\": [";
+
+    const std::vector<cache_info> c = caches();
+    for (std::size_t i = 0; i < c.size(); ++i)
+    {
+        out << (i == 0 ? "\n" : ",\n")
+            << "      {\n"
+            << "        \"type\": \"" << json_escape(c[i].type) << "\",\n"
+            << "        \"level\": " << c[i].level << ",\n"
+            << "        \"size\": " << c[i].size << ",\n"
+            << "        \"num_sharing\": " << c[i].num_sharing << "\n"
+            << "      }";
+    }
+
+    out << (c.empty() ? "],\n" : "\n    ],\n")
+#ifdef NDEBUG
+        << "    \"library_build_type\": \"release\"\n"
+#else
+        << "    \"library_build_type\": \"debug\"\n"
+#endif
+        << "  },\n"
+        << "  \"benchmarks\": [";
+
+    for (std::size_t i = 0; i < results.size(); ++i)
+    {
+        const result& r = results[i];
+        out << (i == 0 ? "\n" : ",\n")
+            << "    {\n"
+            << "      \"name\": \"" << json_escape(r.name) << "\",\n"
+            << "      \"run_name\": \"" << json_escape(r.name) << "\",\n"
+            << "      \"run_type\": \"iteration\",\n"
+            << "      \"repetitions\": 1,\n"
+            << "      \"repetition_index\": 0,\n"
+            << "      \"threads\": 1,\n"
+            << "      \"iterations\": " << r.iterations << ",\n"
+            << "      \"real_time\": " << r.real_time << ",\n"
+            << "      \"cpu_time\": " << r.cpu_time << ",\n"
+            << "      \"time_unit\": \"ns\"";
+        if (r.bytes_per_second > 0)
+            out << ",\n      \"bytes_per_second\": " << r.bytes_per_second;
+        if (r.items_per_second > 0)
+            out << ",\n      \"items_per_second\": " << r.items_per_second;
+        out << "\n    }";
+    }
+
+    out << (results.empty() ? "]\n" : "\n  ]\n") << "}\n";
+}
+
+inline std::string human_rate(double v, const char* unit)
+{
+    const char* prefixes[] = { "", "k", "M", "G", "T" };
+    int i = 0;
+    for (; v >= 1000 && i < 4; ++i)
+        v /= 1000;
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.4g%s%s/s", v, prefixes[i], unit);
+    return buffer;
+}
+
+inline void write_console_header(std::ostream& out, std::size_t name_width)
+{
+    out << std::string(name_width + 50, '-') << "\n"
+        << std::string("Benchmark").append(name_width - 9, ' ')
+        << "          Time             CPU   Iterations\n"
+        << std::string(name_width + 50, '-') << "\n";
+}
+
+inline void write_console(std::ostream& out, const result& r, std::size_t name_width)
+{
+    char line[128];
+    std::snprintf(line, sizeof(line), " %12.0f ns %12.0f ns %12llu",
+                  r.real_time, r.cpu_time, static_cast<unsigned long long>(r.iterations));
+    out << r.name << std::string(name_width - std::min(name_width, r.name.size()), ' ')
+        << line;
+    if (r.bytes_per_second > 0)
+        out << " bytes_per_second=" << human_rate(r.bytes_per_second, "B");
+    if (r.items_per_second > 0)
+        out << " items_per_second=" << human_rate(r.items_per_second, "");
+    out << std::endl;
+}
+
+
+//Runs the registered benchmarks, taking the Google Benchmark flags
+//
+//  --benchmark_filter=<regex>          only run benchmarks whose names match
+//  --benchmark_min_time=<seconds>      run each for at least this long
+//  --benchmark_format=<console|json>   what to write to stdout
+//  --benchmark_out=<file>              also write the results to file
+//  --benchmark_out_format=<console|json>
+//  --benchmark_list_tests              list the benchmarks instead of running them
+inline int main(int argc, char** argv)
+{
+    std::string filter = ".";
+    double min_time = 0.5;
+    std::string format = "console";
+    std::string out_path;
+    std::string out_format = "json";
+    bool list = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const std::string::size_type eq = arg.find('=');
+        const std::string flag = arg.substr(0, eq);
+        const std::string value = eq == std::string::npos ? std::string() : arg.substr(eq + 1);
+
+        if (flag == "--benchmark_filter")
+            filter = value;
+        else if (flag == "--benchmark_min_time")
+            min_time = std::strtod(value.c_str(), nullptr);
+        else if (flag == "--benchmark_format")
+            format = value;
+        else if (flag == "--benchmark_out")
+            out_path = value;
+        else if (flag == "--benchmark_out_format")
+            out_format = value;
+        else if (flag == "--benchmark_list_tests")
+            list = value.empty() || value == "true";
+        else
+        {
+            std::cerr << "unknown flag " << arg << "\n";
+            return 1;
+        }
+    }
+
+    if ((format != "console" && format != "json") ||
+        (out_format != "console" && out_format != "json"))
+    {
+        std::cerr << "the format must be console or json\n";
+        return 1;
+    }
+
+    std::vector<benchmark> selected;
+    try
+    {
+        const std::regex re(filter);
+        for (std::size_t i = 0; i < registry().size(); ++i)
+        {
+            if (std::regex_search(registry()[i].name, re))
+                selected.push_back(registry()[i]);
+        }
+    }
+    catch (const std::regex_error&)
+    {
+        std::cerr << "bad --benchmark_filter " << filter << "\n";
+        return 1;
+    }
+
+    if (list)
+    {
+        for (std::size_t i = 0; i < selected.size(); ++i)
+            std::cout << selected[i].name << "\n";
+        return 0;
+    }
+
+    std::size_t name_width = 10;
+    for (std::size_t i = 0; i < selected.size(); ++i)
+        name_width = std::max(name_width, selected[i].name.size() + 1);
+
+    if (format == "console")
+        write_console_header(std::cout, name_width);
+
+    std::vector<result> results;
+    for (std::size_t i = 0; i < selected.size(); ++i)
+    {
+        results.push_back(run_benchmark(selected[i], min_time));
+        if (format == "console")
+            write_console(std::cout, results.back(), name_width);
+    }
+
+    if (format == "json")
+        write_json(std::cout, argv[0], results);
+
+    if (!out_path.empty())
+    {
+        std::ofstream out(out_path.c_str());
+        if (out_format == "json")
+            write_json(out, argv[0], results);
+        else
+        {
+            write_console_header(out, name_width);
+            for (std::size_t i = 0; i < results.size(); ++i)
+                write_console(out, results[i], name_width);
+        }
+        if (!out)
+        {
+            std::cerr << "can't write " << out_path << "\n";
+            return 1;
+        }
+    }
+    return 0;
+}
+
+} //array2d_bench
+
+#endif //ARRAY2D_BENCHMARK_H
@@ -0,0 +1,242 @@
+/*
+ grids.hpp - The grids the benchmarks compare, made and walked the same way.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#ifndef ARRAY2D_BENCH_GRIDS_H
+#define ARRAY2D_BENCH_GRIDS_H
+
+#include <array2d.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace array2d_bench
+{
+
+constexpr std::size_t isqrt(std::size_t n, std::size_t low = 0,
+                            std::size_t high = std::size_t(1) << 32)
+{
+    return low + 1 >= high ? low :
+           ((low + high) / 2) * ((low + high) / 2) <= n ? isqrt(n, (low + high) / 2, high) :
+                                                          isqrt(n, low, (low + high) / 2);
+}
+
+//the side of a square grid of T that takes about Bytes bytes
+template <typename T, std::size_t Bytes>
+struct grid_side
+{
+    static constexpr std::size_t value = isqrt(Bytes / sizeof(T));
+};
+
+template <typename T> inline std::string type_name();
+template <> inline std::string type_name<std::uint8_t>() { return "uint8_t"; }
+template <> inline std::string type_name<std::int32_t>() { return "int32_t"; }
+template <> inline std::string type_name<float>() { return "float"; }
+template <> inline std::string type_name<double>() { return "double"; }
+
+
+//a grid kept in a std::vector and indexed by hand, as a baseline
+template <typename T>
+struct vector_grid
+{
+    typedef T value_type;
+
+    std::vector<T> data;
+    std::size_t width;
+    std::size_t height;
+
+    vector_grid(std::size_t width, std::size_t height)
+        : data(width * height), width(width), height(height) { }
+};
+
+
+//Makes and names each kind of grid. Grids are always made on the heap, since
+//a static_array2d can be too big for the stack, and filled with small values.
+template <typename Grid>
+struct grid_traits;
+
+template <typename T>
+struct grid_traits<vector_grid<T> >
+{
+    static std::string name() { return "vector<" + type_name<T>() + ">"; }
+
+    static std::unique_ptr<vector_grid<T> > make(std::size_t width, std::size_t height)
+    {
+        std::unique_ptr<vector_grid<T> > g(new vector_grid<T>(width, height));
+        for (std::size_t i = 0; i < g->data.size(); ++i)
+            g->data[i] = static_cast<T>(i % 7);
+        return g;
+    }
+};
+
+template <typename T>
+struct grid_traits<array2d::array2d<T> >
+{
+    static std::string name() { return "array2d<" + type_name<T>() + ">"; }
+
+    static std::unique_ptr<array2d::array2d<T> > make(std::size_t width, std::size_t height)
+    {
+        std::unique_ptr<array2d::array2d<T> > g(new array2d::array2d<T>(width, height));
+        std::size_t i = 0;
+        for (typename array2d::array2d<T>::iterator it = g->begin(); it != g->end(); ++it)
+            *it = static_cast<T>(i++ % 7);
+        return g;
+    }
+};
+
+template <typename T, std::size_t W, std::size_t H>
+struct grid_traits<array2d::static_array2d<T, W, H> >
+{
+    typedef array2d::static_array2d<T, W, H> grid_type;
+
+    static std::string name() { return "static_array2d<" + type_name<T>() + ">"; }
+
+    static std::unique_ptr<grid_type> make(std::size_t, std::size_t)
+    {
+        std::unique_ptr<grid_type> g(new grid_type());
+        std::size_t i = 0;
+        for (typename grid_type::iterator it = g->begin(); it != g->end(); ++it)
+            *it = static_cast<T>(i++ % 7);
+        return g;
+    }
+};
+
+
+//The kernels the benchmarks time. Grids are walked with their own iterators,
+//and vector_grid with the loops the iterators stand in for.
+template <typename Grid>
+typename Grid::value_type sum_all(const Grid& g)
+{
+    typename Grid::value_type sum = typename Grid::value_type();
+    for (typename Grid::const_iterator it = g.begin(); it != g.end(); ++it)
+        sum += *it;
+    return sum;
+}
+
+template <typename T>
+T sum_all(const vector_grid<T>& g)
+{
+    T sum = T();
+    for (typename std::vector<T>::const_iterator it = g.data.begin(); it != g.data.end(); ++it)
+        sum += *it;
+    return sum;
+}
+
+template <typename Grid>
+typename Grid::value_type sum_rows(const Grid& g, std::size_t, std::size_t height)
+{
+    typename Grid::value_type sum = typename Grid::value_type();
+    for (std::size_t y = 0; y < height; ++y)
+    {
+        for (typename Grid::const_row_iterator it = g.row_begin(y); it != g.row_end(y); ++it)
+            sum += *it;
+    }
+    return sum;
+}
+
+template <typename T>
+T sum_rows(const vector_grid<T>& g, std::size_t width, std::size_t height)
+{
+    T sum = T();
+    for (std::size_t y = 0; y < height; ++y)
+    {
+        const T* row = g.data.data() + y * width;
+        for (std::size_t x = 0; x < width; ++x)
+            sum += row[x];
+    }
+    return sum;
+}
+
+template <typename Grid>
+typename Grid::value_type sum_columns(const Grid& g, std::size_t width, std::size_t)
+{
+    typename Grid::value_type sum = typename Grid::value_type();
+    for (std::size_t x = 0; x < width; ++x)
+    {
+        for (typename Grid::const_column_iterator it = g.column_begin(x);
+             it != g.column_end(x); ++it)
+        {
+            sum += *it;
+        }
+    }
+    return sum;
+}
+
+template <typename T>
+T sum_columns(const vector_grid<T>& g, std::size_t width, std::size_t height)
+{
+    T sum = T();
+    for (std::size_t x = 0; x < width; ++x)
+    {
+        const T* p = g.data.data() + x;
+        for (std::size_t y = 0; y < height; ++y, p += width)
+            sum += *p;
+    }
+    return sum;
+}
+
+template <typename Grid>
+const typename Grid::value_type& index(const Grid& g, std::size_t x, std::size_t y)
+{ return g.index(x, y); }
+
+template <typename T>
+const T& index(const vector_grid<T>& g, std::size_t x, std::size_t y)
+{ return g.data[y * g.width + x]; }
+
+template <typename Grid>
+void emplace_all(Grid& g, std::size_t width, std::size_t height,
+                 const typename Grid::value_type& value)
+{
+    for (std::size_t y = 0; y < height; ++y)
+    {
+        for (std::size_t x = 0; x < width; ++x)
+            g.emplace(x, y, value);
+    }
+}
+
+template <typename T>
+void emplace_all(vector_grid<T>& g, std::size_t width, std::size_t height, const T& value)
+{
+    for (std::size_t y = 0; y < height; ++y)
+    {
+        for (std::size_t x = 0; x < width; ++x)
+            new (&g.data[y * width + x]) T(value);
+    }
+}
+
+template <typename Grid>
+const void* data(const Grid& g) { return g.data(); }
+
+template <typename T>
+const void* data(const vector_grid<T>& g) { return g.data.data(); }
+
+} //array2d_bench
+
+#endif //ARRAY2D_BENCH_GRIDS_H
@@ -0,0 +1,122 @@
+/*
+ assign_test.cpp - Assignment, assign(), copy_from() and swap(), and when each
+                  reuses the grid's allocation.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#include "test.hpp"
+
+#include "../array2d.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+
+typedef array2d::array2d<int> grid;
+
+ARRAY2D_TEST(copy_assignment_reuses_the_allocation)
+{
+    grid a(8, 8, 0);
+    const int* data = a.data();
+    grid b(4, 6);
+    array2d_test::fill_numbered(b);
+    a = b;
+    CHECK(a.width() == 4 && a.height() == 6 && a.data() == data);
+    CHECK(array2d_test::is_numbered(a));
+
+    //too small, so it reallocates
+    grid big(20, 20);
+    array2d_test::fill_numbered(big);
+    a = big;
+    CHECK(a.width() == 20 && array2d_test::is_numbered(a));
+
+    const grid& same = a;
+    a = same;
+    CHECK(array2d_test::is_numbered(a));
+
+    array2d::array2d<std::string> s(3, 3, std::string("old"));
+    const array2d::array2d<std::string> t(2, 2, std::string("new"));
+    s = t;
+    CHECK(s.width() == 2 && std::count(s.begin(), s.end(), "new") == 4);
+}
+
+ARRAY2D_TEST(move_assignment_takes_the_allocation)
+{
+    grid a(3, 3, 1);
+    grid b(5, 2, 2);
+    const int* data = b.data();
+    a = std::move(b);
+    CHECK(a.width() == 5 && a.height() == 2 && a.data() == data && a(4, 1) == 2);
+    CHECK(b.width() == 0 && b.height() == 0);
+}
+
+ARRAY2D_TEST(assign_fills)
+{
+    grid a(10, 10, 0);
+    const int* data = a.data();
+    a.assign(5, 7, 3);
+    CHECK(a.width() == 5 && a.height() == 7 && a.data() == data);
+    CHECK(std::count(a.begin(), a.end(), 3) == 35);
+}
+
+ARRAY2D_TEST(copy_from_any_grid)
+{
+    //a padded grid, so runs are copied one at a time
+    array2d::array2d<int, std::allocator<int>, 64> padded(9, 5);
+    array2d_test::fill_numbered(padded);
+    grid a(20, 20, 0);
+    const int* data = a.data();
+    a.copy_from(padded);
+    CHECK(a.width() == 9 && a.height() == 5 && a.data() == data);
+    CHECK(array2d_test::is_numbered(a));
+
+    //a view of part of a grid
+    grid b(1, 1, 0);
+    b.copy_from(array2d::array2d_view<int>(a).subview(2, 1, 4, 3));
+    CHECK(b.width() == 4 && b(0, 0) == array2d_test::numbered_value(2, 1));
+
+    //another layout
+    array2d::array2d<int, std::allocator<int>, alignof(int), array2d::column_major> c(6, 6);
+    c.copy_from(padded);
+    CHECK(c.width() == 9 && array2d_test::is_numbered(c));
+
+    a.copy_from(a);
+    CHECK(array2d_test::is_numbered(a));
+}
+
+ARRAY2D_TEST(swap_exchanges_everything)
+{
+    grid a(2, 3, 1);
+    grid b(4, 1, 2);
+    const int* da = a.data();
+    const int* db = b.data();
+    swap(a, b);
+    CHECK(a.width() == 4 && a.data() == db && a(3, 0) == 2);
+    CHECK(b.height() == 3 && b.data() == da && b(1, 2) == 1);
+    a.swap(b);
+    CHECK(a.data() == da && b.data() == db);
+}
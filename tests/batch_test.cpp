@@ -0,0 +1,201 @@
+/*
+ batch_test.cpp - Batches of grids in both layouts, the batch algorithms and
+                  the generic algorithms on the strided views of members.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#include "test.hpp"
+
+#include "../array2d_batch.hpp"
+#include "../array2d_reduce.hpp"
+#include "../array2d_stencil.hpp"
+
+#include <cstddef>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+
+const std::size_t width = 7;
+const std::size_t height = 5;
+const std::size_t count = 4;
+
+float value(std::size_t i, std::size_t x, std::size_t y)
+{ return static_cast<float>(i * 100 + y * 10 + x); }
+
+template <typename I>
+array2d::array2d_batch<float, I> numbered()
+{
+    array2d::array2d_batch<float, I> a(width, height, count, 0.0f);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        for (std::size_t y = 0; y < height; ++y)
+        {
+            for (std::size_t x = 0; x < width; ++x)
+                a[i](x, y) = value(i, x, y);
+        }
+    }
+    return a;
+}
+
+template <typename I>
+void check_batch_algorithms()
+{
+    array2d::thread_pool pool(3);
+    const array2d::array2d_batch<float, I> a = numbered<I>();
+
+    bool indexed = true;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        for (std::size_t y = 0; y < height; ++y)
+        {
+            for (std::size_t x = 0; x < width; ++x)
+                indexed = indexed && a(i, x, y) == value(i, x, y);
+        }
+    }
+    CHECK(indexed);
+
+    //the three ways through a member visit the same elements
+    const typename array2d::array2d_batch<float, I>::const_member_type m = a[2];
+    float by_element = 0;
+    for (typename array2d::array2d_batch<float, I>::const_member_type::const_iterator it = m.begin();
+         it != m.end(); ++it)
+        by_element += *it;
+    float by_column = 0;
+    for (std::size_t x = 0; x < width; ++x)
+        by_column += std::accumulate(m.column_begin(x), m.column_end(x), 0.0f);
+    CHECK(by_element == by_column);
+
+    array2d::array2d_batch<float, I> doubled(width, height, count);
+    array2d::batch_transform(a, doubled, [](float v) { return v * 2; }, array2d::chunking(), pool);
+    CHECK(doubled(3, 6, 4) == 2 * value(3, 6, 4));
+
+    std::vector<float> sums(count);
+    array2d::batch_reduce(a, sums.begin(), array2d::plus_op(), array2d::chunking(), pool);
+    bool summed = true;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        float sum = 0;
+        for (std::size_t y = 0; y < height; ++y)
+        {
+            for (std::size_t x = 0; x < width; ++x)
+                sum += value(i, x, y);
+        }
+        summed = summed && sums[i] == sum;
+    }
+    CHECK(summed);
+
+    array2d::array2d_batch<float, I> t(height, width, count);
+    array2d::batch_transpose(a, t, array2d::chunking(), pool);
+    bool transposed = true;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        for (std::size_t y = 0; y < height; ++y)
+        {
+            for (std::size_t x = 0; x < width; ++x)
+                transposed = transposed && t(i, y, x) == a(i, x, y);
+        }
+    }
+    CHECK(transposed);
+    CHECK_THROWS(array2d::batch_transpose(a, doubled, array2d::chunking(), pool),
+                 std::invalid_argument);
+}
+
+} //namespace
+
+ARRAY2D_TEST(grid_major_batches)
+{
+    check_batch_algorithms<array2d::batch_grid_major>();
+}
+
+ARRAY2D_TEST(interleaved_batches)
+{
+    check_batch_algorithms<array2d::batch_interleaved>();
+}
+
+ARRAY2D_TEST(reductions_of_interleaved_members)
+{
+    array2d::thread_pool pool(3);
+    const array2d::array2d_batch<float, array2d::batch_interleaved> a =
+        numbered<array2d::batch_interleaved>();
+    const array2d::array2d_strided_view<const float> m = a[1];
+
+    std::vector<float> rows(height);
+    std::vector<float> columns(width);
+    array2d::reduce_rows(m, rows.begin(), array2d::plus_op(), array2d::chunking(), pool);
+    array2d::reduce_columns(m, columns.begin(), array2d::plus_op(), array2d::chunking(), pool);
+    CHECK(rows[3] == value(1, 0, 3) * width + 21);
+    CHECK(columns[6] == value(1, 6, 0) * height + 100);
+    CHECK(array2d::reduce_all(m, array2d::plus_op(), array2d::chunking(), pool) ==
+          std::accumulate(rows.begin(), rows.end(), 0.0f));
+
+    const std::pair<std::size_t, std::size_t> hi = array2d::argmax(m);
+    CHECK(hi.first == width - 1 && hi.second == height - 1);
+}
+
+ARRAY2D_TEST(transposes_between_members_and_grids)
+{
+    array2d::array2d_batch<float, array2d::batch_interleaved> a =
+        numbered<array2d::batch_interleaved>();
+
+    array2d::array2d<float> t(height, width);
+    array2d::transpose(a[2], array2d::array2d_view<float>(t));
+    array2d::array2d_batch<float, array2d::batch_interleaved> back(width, height, count, 0.0f);
+    array2d::transpose(array2d::array2d_view<float>(t), back[0]);
+    array2d::array2d_batch<float, array2d::batch_interleaved> across(height, width, count, 0.0f);
+    array2d::transpose(a[3], across[1]);
+
+    bool same = true;
+    for (std::size_t y = 0; y < height; ++y)
+    {
+        for (std::size_t x = 0; x < width; ++x)
+        {
+            same = same && t(y, x) == value(2, x, y) && back(0, x, y) == value(2, x, y) &&
+                   across(1, y, x) == value(3, x, y);
+        }
+    }
+    CHECK(same);
+    CHECK(back(1, 3, 3) == 0.0f);
+}
+
+ARRAY2D_TEST(convolve_an_interleaved_member)
+{
+    const array2d::array2d_batch<float, array2d::batch_interleaved> a =
+        numbered<array2d::batch_interleaved>();
+    array2d::array2d_batch<float, array2d::batch_interleaved> b(width, height, count, -1.0f);
+    const array2d::static_array2d<float, 3, 3> identity{ { 0, 0, 0, 0, 1, 0, 0, 0, 0 } };
+
+    array2d::array2d_strided_view<float> dst = b[1];
+    array2d::convolve(a[1], dst, identity, array2d::clamp_boundary());
+    bool same = true;
+    for (std::size_t y = 0; y < height; ++y)
+    {
+        for (std::size_t x = 0; x < width; ++x)
+            same = same && b(1, x, y) == value(1, x, y) && b(0, x, y) == -1.0f;
+    }
+    CHECK(same);
+}
@@ -0,0 +1,134 @@
+/*
+ checked_test.cpp - The checks ARRAY2D_CHECKED compiles in, turned into
+                    exceptions so that each failure can be seen.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+
+//thrown in place of aborting, with the message the check gave
+struct check_failure : std::logic_error
+{
+    explicit check_failure(const char* what) : std::logic_error(what) { }
+};
+
+} //namespace
+
+#define ARRAY2D_CHECK_FAILED(what) throw check_failure(what)
+
+#include "test.hpp"
+
+#include "../array2d.hpp"
+#include "../array2d_batch.hpp"
+
+#include <cstddef>
+#include <vector>
+
+namespace
+{
+
+//the message of the check failure expr causes, or an empty string
+#define CHECK_FAILURE(expr)                                                     \
+    [&]() -> std::string                                                        \
+    {                                                                           \
+        try                                                                     \
+        {                                                                       \
+            expr;                                                               \
+        }                                                                       \
+        catch (const check_failure& e)                                          \
+        {                                                                       \
+            return e.what();                                                    \
+        }                                                                       \
+        return std::string();                                                   \
+    }()
+
+typedef array2d::array2d<int> grid;
+
+} //namespace
+
+ARRAY2D_TEST(coordinates_are_checked)
+{
+    grid a(4, 3, 0);
+    CHECK(CHECK_FAILURE(a.index(3, 2)).empty());
+    CHECK(CHECK_FAILURE(a.index(4, 0)) == "coordinates out of range");
+    CHECK(CHECK_FAILURE(a(0, 3)) == "coordinates out of range");
+    CHECK(CHECK_FAILURE(a.row_begin(3)) == "row out of range");
+    CHECK(CHECK_FAILURE(a.column_begin(4)) == "column out of range");
+
+    const grid& ca = a;
+    CHECK(CHECK_FAILURE(ca(5, 5)) == "coordinates out of range");
+
+    array2d::array2d_view<int> v(a);
+    CHECK(CHECK_FAILURE(v(4, 2)) == "coordinates out of range");
+}
+
+ARRAY2D_TEST(iterators_stay_in_range)
+{
+    grid a(4, 3, 0);
+    grid::row_iterator it = a.row_begin(1);
+    CHECK(CHECK_FAILURE(it += 4).empty());
+    CHECK(CHECK_FAILURE(*it) == "dereferenced an iterator outside its range");
+    CHECK(CHECK_FAILURE(++it) == "moved an iterator outside its range");
+    CHECK(CHECK_FAILURE(a.row_begin(0) - a.row_begin(1)) ==
+          "compared iterators of different rows or columns");
+}
+
+ARRAY2D_TEST(iterators_belong_to_their_grid)
+{
+    grid a(4, 3, 0);
+    grid b(4, 3, 0);
+    CHECK(CHECK_FAILURE(a.begin() == b.begin()) == "compared iterators of different grids");
+    CHECK(CHECK_FAILURE(a.begin() == a.end()).empty());
+
+    grid::iterator none;
+    CHECK(CHECK_FAILURE(*none) == "used an iterator that doesn't belong to a grid");
+}
+
+ARRAY2D_TEST(iterators_are_invalidated)
+{
+    grid a(4, 3, 0);
+    grid::iterator it = a.begin();
+    a.resize(8, 8);
+    CHECK(CHECK_FAILURE(*it) ==
+          "used an iterator after its grid was reallocated, resized, moved or assigned");
+
+    grid::column_iterator column = a.column_begin(0);
+    a = grid(2, 2, 1);
+    CHECK(CHECK_FAILURE(++column) ==
+          "used an iterator after its grid was reallocated, resized, moved or assigned");
+}
+
+ARRAY2D_TEST(batches_are_checked)
+{
+    array2d::array2d_batch<float, array2d::batch_interleaved> b(3, 2, 5, 0.0f);
+    CHECK(CHECK_FAILURE(b[5]) == "grid out of range");
+    CHECK(CHECK_FAILURE(b(4, 3, 1)) == "coordinates out of range");
+    CHECK(CHECK_FAILURE(b[1](3, 0)) == "coordinates out of range");
+    CHECK(CHECK_FAILURE(b(4, 2, 1)).empty());
+}
@@ -0,0 +1,153 @@
+/*
+ construct_test.cpp - The ways of initializing a grid's elements, resizing and
+                     reshaping.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#include "test.hpp"
+
+#include "../array2d.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+
+//a type that isn't trivially default constructible, so that resizing can't
+//leave its new elements as they were
+struct counted
+{
+    static int live;
+
+    int v;
+
+    counted() : v(-1) { ++live; }
+    counted(int n) : v(n) { ++live; }
+    counted(const counted& o) : v(o.v) { ++live; }
+    counted& operator=(const counted&) = default;
+    ~counted() { --live; }
+};
+
+int counted::live = 0;
+
+} //namespace
+
+ARRAY2D_TEST(construction_policies)
+{
+    array2d::array2d<int> u(4, 3, array2d::uninitialized);
+    CHECK(u.width() == 4 && u.height() == 3);
+
+    const array2d::array2d<int> z(4, 3, array2d::value_initialized);
+    CHECK(std::count(z.begin(), z.end(), 0) == 12);
+
+    const array2d::array2d<std::string> s(2, 5, std::string("x"));
+    CHECK(std::count(s.begin(), s.end(), "x") == 10);
+
+    const array2d::array2d<int> g(7, 6, [](std::size_t x, std::size_t y) {
+        return array2d_test::numbered_value(x, y);
+    });
+    CHECK(array2d_test::is_numbered(g));
+
+    //the generator is also used for padded and column_major grids
+    const array2d::array2d<int, std::allocator<int>, 64> padded(7, 6,
+        [](std::size_t x, std::size_t y) { return array2d_test::numbered_value(x, y); });
+    CHECK(array2d_test::is_numbered(padded));
+    const array2d::array2d<int, std::allocator<int>, alignof(int), array2d::column_major>
+        columns(7, 6, [](std::size_t x, std::size_t y) {
+            return array2d_test::numbered_value(x, y);
+        });
+    CHECK(array2d_test::is_numbered(columns));
+}
+
+ARRAY2D_TEST(resize_keeps_the_overlap)
+{
+    array2d::array2d<int> a(6, 5);
+    array2d_test::fill_numbered(a);
+
+    a.resize(4, 3);
+    CHECK(a.width() == 4 && a.height() == 3);
+    CHECK(array2d_test::is_numbered(a));
+
+    a.resize(9, 4);
+    CHECK(a.width() == 9 && a.height() == 4);
+    bool kept = true;
+    for (std::size_t y = 0; y < 3; ++y)
+    {
+        for (std::size_t x = 0; x < 4; ++x)
+            kept = kept && a(x, y) == array2d_test::numbered_value(x, y);
+    }
+    CHECK(kept);
+
+    array2d::array2d<int, std::allocator<int>, alignof(int), array2d::tiled<4> > t(6, 5);
+    array2d_test::fill_numbered(t);
+    t.resize(3, 7);
+    CHECK(t(2, 4) == array2d_test::numbered_value(2, 4));
+}
+
+ARRAY2D_TEST(resize_default_initializes_new_elements)
+{
+    {
+        array2d::array2d<counted> a(3, 3, counted(5));
+        a.resize(5, 4);
+        CHECK(a(2, 2).v == 5);
+        CHECK(a(3, 0).v == -1 && a(0, 3).v == -1 && a(4, 3).v == -1);
+        a.resize(2, 2);
+        CHECK(a(1, 1).v == 5);
+    }
+    CHECK(counted::live == 0);
+}
+
+ARRAY2D_TEST(reshape_keeps_the_element_order)
+{
+    array2d::array2d<int> a(6, 4);
+    array2d_test::fill_numbered(a);
+    const array2d::array2d<int> before(a);
+    a.reshape(8, 3);
+    CHECK(a.width() == 8 && a.height() == 3);
+    CHECK(std::equal(a.begin(), a.end(), before.begin()));
+
+    //padded rows can't be reinterpreted, so the elements move
+    array2d::array2d<int, std::allocator<int>, 32> p(6, 4);
+    array2d_test::fill_numbered(p);
+    p.reshape(3, 8);
+    CHECK(p(0, 1) == array2d_test::numbered_value(3, 0));
+    CHECK(p(2, 7) == array2d_test::numbered_value(5, 3));
+}
+
+ARRAY2D_TEST(reshape_to_another_size_throws)
+{
+    array2d::array2d<int> a(6, 4);
+    array2d_test::fill_numbered(a);
+    CHECK_THROWS(a.reshape(5, 5), std::invalid_argument);
+    CHECK_THROWS(a.reshape(6, 5), std::invalid_argument);
+    CHECK(a.width() == 6 && a.height() == 4 && array2d_test::is_numbered(a));
+
+    array2d::array2d<int, std::allocator<int>, 32> p(6, 4);
+    CHECK_THROWS(p.reshape(25, 1), std::invalid_argument);
+}
@@ -0,0 +1,118 @@
+/*
+ cow_test.cpp - Copy on write grids and the snapshots that keep what they saw.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#include "test.hpp"
+
+#include "../array2d_cow.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+typedef array2d::cow_array2d<array2d::array2d<int> > cow;
+
+ARRAY2D_TEST(snapshots_keep_what_they_saw)
+{
+    cow a(6, 4, 0);
+    CHECK(!a.shared());
+    const int* data = a.read().data();
+
+    //writing with nothing shared doesn't copy
+    a.write()(1, 1) = 5;
+    CHECK(a.read().data() == data);
+
+    const cow::snapshot_type s = a.snapshot();
+    CHECK(a.shared() && s.width() == 6 && s.height() == 4);
+    CHECK(s.grid().data() == data);
+
+    a.write()(1, 1) = 6;
+    CHECK(a.read().data() != data && !a.shared());
+    CHECK(s(1, 1) == 5 && a(1, 1) == 6);
+    CHECK(std::count(s.begin(), s.end(), 0) == 23);
+
+    //a second write goes straight to the copy
+    const int* copy = a.read().data();
+    a.write()(2, 2) = 7;
+    CHECK(a.read().data() == copy);
+}
+
+ARRAY2D_TEST(copies_share_until_written)
+{
+    cow a(3, 3, 1);
+    cow b(a);
+    CHECK(a.shared() && b.shared() && a.read().data() == b.read().data());
+    b.write()(0, 0) = 2;
+    CHECK(a(0, 0) == 1 && b(0, 0) == 2);
+    CHECK(!a.shared() && !b.shared());
+
+    a = b;
+    CHECK(a(0, 0) == 2 && a.shared());
+    swap(a, b);
+    CHECK(array2d::array2d_width(a) == 3);
+
+    cow::snapshot_type empty;
+    CHECK(empty.empty() && empty.width() == 0);
+    empty = a.snapshot();
+    CHECK(!empty.empty() && empty(0, 0) == 2);
+}
+
+ARRAY2D_TEST(snapshots_read_on_other_threads)
+{
+    //a writer publishes a snapshot per frame while a reader checks that each
+    //one it sees holds a single frame number throughout
+    cow a(64, 64, 0);
+    std::vector<cow::snapshot_type> frames(50);
+    std::atomic<std::size_t> published(0);
+    std::atomic<bool> consistent(true);
+
+    std::thread reader([&] {
+        std::size_t seen = 0;
+        while (seen < frames.size())
+        {
+            const std::size_t n = published.load(std::memory_order_acquire);
+            for (; seen < n; ++seen)
+            {
+                const cow::snapshot_type s = frames[seen];
+                const int first = s(0, 0);
+                if (first != static_cast<int>(seen) ||
+                    std::count(s.begin(), s.end(), first) != 64 * 64)
+                    consistent = false;
+            }
+        }
+    });
+    for (std::size_t f = 0; f < frames.size(); ++f)
+    {
+        array2d::array2d<int>& g = a.write();
+        std::fill(g.begin(), g.end(), static_cast<int>(f));
+        frames[f] = a.snapshot();
+        published.store(f + 1, std::memory_order_release);
+    }
+    reader.join();
+    CHECK(consistent);
+}
@@ -0,0 +1,213 @@
+/*
+ expr_test.cpp - Elementwise expressions: results, broadcasting, size
+                 checks and operands that alias the destination.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#include "test.hpp"
+
+#include "../array2d_expr.hpp"
+
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+
+typedef array2d::array2d<float> grid;
+
+//a grid whose elements all differ, so misplaced reads show
+grid numbered(std::size_t width, std::size_t height)
+{
+    grid a(width, height);
+    array2d_test::fill_numbered(a);
+    return a;
+}
+
+} //namespace
+
+//widths around the vector width, so both the vector body and the tail run
+ARRAY2D_TEST(arithmetic_matches_a_loop)
+{
+    for (std::size_t width = 1; width < 40; width += 3)
+    {
+        const grid a = numbered(width, 5);
+        grid b(width, 5, 2.0f);
+        grid c = a * b + 1.0f - a / 4.0f;
+        bool same = true;
+        for (std::size_t y = 0; y < 5; ++y)
+        {
+            for (std::size_t x = 0; x < width; ++x)
+                same = same && c(x, y) == a(x, y) * 2.0f + 1.0f - a(x, y) / 4.0f;
+        }
+        CHECK(same);
+    }
+}
+
+ARRAY2D_TEST(mixed_types_use_the_common_type)
+{
+    array2d::array2d<int> a(3, 2, 7);
+    array2d::array2d<double> b(3, 2, 0.5);
+    array2d::array2d<double> c = a * b;
+    CHECK(c(2, 1) == 3.5);
+
+    array2d::array2d<bool> less = a < 8;
+    CHECK(less(0, 0));
+    CHECK(all(a == 7));
+    CHECK(!any(a > 7));
+}
+
+ARRAY2D_TEST(unary_functions)
+{
+    grid a(9, 3, -4.0f);
+    grid b = sqrt(abs(a));
+    CHECK(all(b == 2.0f));
+    b = -b;
+    CHECK(all(b == -2.0f));
+    b = array2d::min(a, b) + array2d::max(a, 0.0f);
+    CHECK(all(b == -4.0f));
+}
+
+ARRAY2D_TEST(rows_and_columns_broadcast)
+{
+    const grid a = numbered(17, 4);
+    std::vector<float> row(17);
+    std::vector<float> column(4);
+    for (std::size_t x = 0; x < row.size(); ++x)
+        row[x] = static_cast<float>(x);
+    for (std::size_t y = 0; y < column.size(); ++y)
+        column[y] = static_cast<float>(y * 100);
+
+    grid c = a - array2d::broadcast_row(row) - array2d::broadcast_column(column);
+    CHECK(all(c == 0.0f));
+}
+
+ARRAY2D_TEST(compound_assignment)
+{
+    grid a = numbered(10, 3);
+    const grid b = numbered(10, 3);
+    a += b;
+    a *= 0.5f;
+    CHECK(all(a == b));
+}
+
+ARRAY2D_TEST(static_grids_and_views)
+{
+    array2d::static_array2d<double, 3, 2> s{};
+    s = s + 1.5;
+    CHECK(s(2, 1) == 1.5);
+
+    grid a = numbered(8, 8);
+    array2d::array2d_view<float> inner = array2d::array2d_view<float>(a).subview(2, 2, 4, 4);
+    evaluate(inner, inner * 0.0f);
+    CHECK(a(1, 1) == 101.0f);
+    CHECK(a(2, 2) == 0.0f);
+    CHECK(a(5, 5) == 0.0f);
+    CHECK(a(6, 6) == 606.0f);
+}
+
+ARRAY2D_TEST(mismatched_sizes_throw)
+{
+    const grid a(64, 64, 1.0f);
+    const grid b(2, 2, 1.0f);
+    grid c(64, 64);
+    CHECK_THROWS(c = a + b, std::invalid_argument);
+    CHECK_THROWS(c = a * grid(64, 63), std::invalid_argument);
+
+    grid small(2, 2);
+    CHECK_THROWS(evaluate(small, a * 2.0f), std::invalid_argument);
+    CHECK_THROWS(small += a, std::invalid_argument);
+
+    std::vector<float> short_row(3);
+    CHECK_THROWS(c = a + array2d::broadcast_row(short_row), std::invalid_argument);
+    std::vector<float> short_column(63);
+    CHECK_THROWS(c = a + array2d::broadcast_column(short_column), std::invalid_argument);
+
+    //a grid of another size is replaced, not checked
+    c = b * 3.0f;
+    CHECK(c.width() == 2 && c.height() == 2 && c(1, 1) == 3.0f);
+}
+
+ARRAY2D_TEST(transposed_view_of_the_destination)
+{
+    grid c = numbered(4, 4);
+    c = array2d::array2d_view<float, array2d::column_major>(c.data(), 4, 4, c.pitch()) + 0.0f;
+    bool transposed = true;
+    for (std::size_t y = 0; y < 4; ++y)
+    {
+        for (std::size_t x = 0; x < 4; ++x)
+            transposed = transposed && c(x, y) == static_cast<float>(x * 100 + y);
+    }
+    CHECK(transposed);
+}
+
+ARRAY2D_TEST(shifted_view_of_the_destination)
+{
+    array2d::array2d<int> a(6, 1);
+    for (int x = 0; x < 6; ++x)
+        a(x, 0) = x;
+    evaluate(array2d::array2d_view<int>(a.data() + 1, 5, 1, 6),
+             array2d::array2d_view<int>(a.data(), 5, 1, 6) + 10);
+    CHECK(a(0, 0) == 0);
+    CHECK(a(1, 0) == 10);
+    CHECK(a(5, 0) == 14);
+}
+
+ARRAY2D_TEST(broadcast_row_of_the_destination)
+{
+    grid a = numbered(5, 3);
+    a = a - array2d::broadcast_row(a.data(), 5);
+    CHECK(a(4, 0) == 0.0f);
+    CHECK(a(4, 2) == 200.0f);
+}
+
+ARRAY2D_TEST(destination_as_its_own_operand)
+{
+    grid a = numbered(19, 3);
+    const grid b = numbered(19, 3);
+    a = a * 2.0f + a;
+    CHECK(all(a == b * 3.0f));
+}
+
+ARRAY2D_TEST(broadcast_into_a_sized_grid)
+{
+    const std::vector<float> row = { 1, 2, 3 };
+    grid a(3, 4, 0.0f);
+    const float* data = a.data();
+    a = array2d::broadcast_row(row) * 2.0f;
+    CHECK(a.width() == 3 && a.height() == 4 && a.data() == data);
+    CHECK(a(2, 0) == 6.0f && a(2, 3) == 6.0f);
+
+    const std::vector<float> column = { 1, 2, 3, 4 };
+    a = array2d::broadcast_column(column) + 1.0f;
+    CHECK(a.width() == 3 && a.height() == 4);
+    CHECK(a(0, 3) == 5.0f && a(2, 3) == 5.0f);
+
+    //a length that isn't broadcast still resizes the grid
+    const std::vector<float> wide(7, 1.0f);
+    a = array2d::broadcast_row(wide) * 1.0f;
+    CHECK(a.width() == 7 && a.height() == 4 && a(6, 3) == 1.0f);
+}
@@ -0,0 +1,142 @@
+/*
+ file_test.cpp - Roundtrips through array2d files written whole, a row at a
+                 time and through a mapping, and the checksum each leaves
+                 behind.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#include "test.hpp"
+
+#include "../array2d_file.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using array2d_test::scratch_file;
+
+ARRAY2D_TEST(write_and_read)
+{
+    scratch_file f("write_and_read");
+    array2d::array2d<double> a(37, 11);
+    array2d_test::fill_numbered(a);
+    array2d::write_array2d(f.path, a);
+
+    const array2d::array2d_file_header header = array2d::read_array2d_header(f.path);
+    CHECK(header.width == 37 && header.height == 11);
+
+    const array2d::array2d<double> b = array2d::read_array2d<double>(f.path);
+    CHECK(b.width() == 37 && b.height() == 11);
+    CHECK(array2d_test::is_numbered(b));
+    CHECK_THROWS(array2d::read_array2d<float>(f.path), std::runtime_error);
+}
+
+ARRAY2D_TEST(writer_rows)
+{
+    scratch_file f("writer_rows");
+    {
+        array2d::array2d_writer<std::int16_t> writer(f.path, 9, 16);
+        std::vector<std::int16_t> row(9);
+        for (std::size_t y = 0; y < 5; ++y)
+        {
+            for (std::size_t x = 0; x < row.size(); ++x)
+                row[x] = static_cast<std::int16_t>(array2d_test::numbered_value(x, y));
+            writer.write_row(row.begin());
+        }
+        CHECK(writer.height() == 5);
+        CHECK(writer.pitch() == 16);
+    }
+    const array2d::array2d<std::int16_t> a = array2d::read_array2d<std::int16_t>(f.path);
+    CHECK(a.width() == 9 && a.height() == 5);
+    CHECK(array2d_test::is_numbered(a));
+}
+
+ARRAY2D_TEST(corrupt_data_fails_the_checksum)
+{
+    scratch_file f("corrupt_data");
+    array2d::write_array2d(f.path, array2d::array2d<float>(8, 8, 1.0f));
+    {
+        std::fstream out(f.path.c_str(), std::ios::binary | std::ios::in | std::ios::out);
+        out.seekp(static_cast<std::streamoff>(array2d::array2d_file_data_offset + 12));
+        out.put(0x55);
+    }
+    CHECK_THROWS(array2d::read_array2d<float>(f.path), std::runtime_error);
+}
+
+ARRAY2D_TEST(mapped_grids_store_the_checksum_when_closed)
+{
+    scratch_file f("mapped");
+    {
+        array2d::mapped_array2d<float> m = array2d::mapped_array2d<float>::create(f.path, 33, 17);
+        array2d_test::fill_numbered(m);
+    }
+    {
+        const array2d::mapped_array2d<const float> m(f.path);
+        CHECK(m.verify());
+        CHECK(array2d_test::is_numbered(m));
+    }
+
+    //written after a sync, then closed without one
+    {
+        array2d::mapped_array2d<float> m(f.path);
+        m.sync();
+        m(4, 4) = -1.0f;
+    }
+    const array2d::array2d<float> a = array2d::read_array2d<float>(f.path);
+    CHECK(a(4, 4) == -1.0f);
+    CHECK(a(5, 4) == static_cast<float>(array2d_test::numbered_value(5, 4)));
+}
+
+ARRAY2D_TEST(mapped_grids_not_written_are_not_synced)
+{
+    scratch_file f("mapped_unwritten");
+    array2d::write_array2d(f.path, array2d::array2d<float>(8, 8, 1.0f));
+    {
+        std::fstream out(f.path.c_str(), std::ios::binary | std::ios::in | std::ios::out);
+        out.seekp(static_cast<std::streamoff>(array2d::array2d_file_data_offset + 12));
+        out.put(0x55);
+    }
+
+    //closing without writing leaves the corruption detectable
+    {
+        array2d::mapped_array2d<float> m(f.path);
+        CHECK(!m.verify());
+    }
+    CHECK_THROWS(array2d::read_array2d<float>(f.path), std::runtime_error);
+
+    //a view taken before a sync can still be written after it
+    {
+        array2d::mapped_array2d<float> m(f.path);
+        const array2d::array2d_view<float> v = m.view();
+        m.sync();
+        v(3, 3) = 2.0f;
+    }
+    const array2d::array2d<float> a = array2d::read_array2d<float>(f.path);
+    CHECK(a(3, 3) == 2.0f);
+}
@@ -0,0 +1,112 @@
+/*
+ fixed_test.cpp - Fixed size grids built and multiplied at compile time, and
+                 the unrolled kernels against the general ones.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#include "test.hpp"
+
+#include "../array2d_fixed.hpp"
+#include "../array2d_stencil.hpp"
+
+#include <cstddef>
+
+namespace
+{
+
+struct numbered
+{
+    constexpr int operator()(std::size_t x, std::size_t y) const
+    { return static_cast<int>(y * 10 + x); }
+};
+
+struct identity
+{
+    constexpr int operator()(std::size_t x, std::size_t y) const { return x == y ? 1 : 0; }
+};
+
+//both are constant expressions, which the static_asserts below rely on
+constexpr array2d::static_array2d<int, 3, 2> a =
+    array2d::make_static_array2d<int, 3, 2>(numbered());
+constexpr array2d::static_array2d<int, 3, 3> i3 =
+    array2d::make_static_array2d<int, 3, 3>(identity());
+
+static_assert(a(0, 0) == 0 && a(2, 0) == 2 && a(1, 1) == 11, "generated elements");
+static_assert(array2d::multiply(a, i3)(2, 1) == 12, "product with the identity");
+static_assert(array2d::static_array2d<int, 3, 2>::pitch == 3, "row_major pitch");
+
+} //namespace
+
+ARRAY2D_TEST(generated_layouts)
+{
+    const array2d::static_array2d<int, 3, 2, array2d::column_major> c =
+        array2d::make_static_array2d<int, 3, 2, array2d::column_major>(numbered());
+    bool same = true;
+    for (std::size_t y = 0; y < 2; ++y)
+    {
+        for (std::size_t x = 0; x < 3; ++x)
+            same = same && c(x, y) == a(x, y);
+    }
+    CHECK(same);
+    CHECK(c.data()[1] == 10);
+}
+
+ARRAY2D_TEST(multiply_matches_a_loop)
+{
+    const array2d::static_array2d<int, 4, 3> l =
+        array2d::make_static_array2d<int, 4, 3>(numbered());
+    const array2d::static_array2d<double, 2, 4> r{ { 1, -2, 0.5, 3, -1, 0, 2, 2 } };
+    const array2d::static_array2d<double, 2, 3> p = array2d::multiply(l, r);
+    bool same = true;
+    for (std::size_t y = 0; y < 3; ++y)
+    {
+        for (std::size_t x = 0; x < 2; ++x)
+        {
+            double sum = 0;
+            for (std::size_t k = 0; k < 4; ++k)
+                sum += l(k, y) * r(x, k);
+            same = same && p(x, y) == sum;
+        }
+    }
+    CHECK(same);
+}
+
+ARRAY2D_TEST(convolve_matches_the_stencil_engine)
+{
+    const array2d::static_array2d<float, 8, 5> src =
+        array2d::make_static_array2d<float, 8, 5>(numbered());
+    const array2d::static_array2d<float, 3, 3> k{ { 1, 2, 1, 0, -1, 0, 3, 0, 1 } };
+    const array2d::static_array2d<float, 8, 5> fixed = array2d::convolve(src, k);
+
+    array2d::static_array2d<float, 8, 5> general;
+    array2d::convolve(src, general, k, array2d::clamp_boundary());
+    bool same = true;
+    for (std::size_t y = 0; y < 5; ++y)
+    {
+        for (std::size_t x = 0; x < 8; ++x)
+            same = same && fixed(x, y) == general(x, y);
+    }
+    CHECK(same);
+}
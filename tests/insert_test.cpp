@@ -0,0 +1,151 @@
+/*
+ insert_test.cpp - Growing and shrinking grids a row or column at a time, in
+                  each layout, against a grid built directly.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#include "test.hpp"
+
+#include "../array2d.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+template <typename Grid>
+bool same(const Grid& a, const std::vector<std::vector<int> >& rows)
+{
+    if (a.height() != rows.size())
+        return false;
+    for (std::size_t y = 0; y < rows.size(); ++y)
+    {
+        if (a.width() != rows[y].size())
+            return false;
+        for (std::size_t x = 0; x < rows[y].size(); ++x)
+        {
+            if (a(x, y) != rows[y][x])
+                return false;
+        }
+    }
+    return true;
+}
+
+//the same edits applied to a grid and to a vector of rows
+template <typename Layout, std::size_t RowAlign>
+void check_edits()
+{
+    typedef array2d::array2d<int, std::allocator<int>, RowAlign, Layout> grid;
+    grid a(4, 3);
+    array2d_test::fill_numbered(a);
+    std::vector<std::vector<int> > rows(3, std::vector<int>(4));
+    for (std::size_t y = 0; y < 3; ++y)
+    {
+        for (std::size_t x = 0; x < 4; ++x)
+            rows[y][x] = array2d_test::numbered_value(x, y);
+    }
+
+    const std::vector<int> row = { -1, -2, -3, -4 };
+    a.push_row(row.begin());
+    rows.push_back(row);
+    CHECK(same(a, rows));
+
+    a.insert_row(1, 9);
+    rows.insert(rows.begin() + 1, std::vector<int>(4, 9));
+    CHECK(same(a, rows));
+
+    const std::vector<int> column = { 5, 6, 7, 8, 9 };
+    a.insert_column(0, column.begin());
+    for (std::size_t y = 0; y < rows.size(); ++y)
+        rows[y].insert(rows[y].begin(), column[y]);
+    CHECK(same(a, rows));
+
+    a.insert_column(5, 0);
+    for (std::size_t y = 0; y < rows.size(); ++y)
+        rows[y].push_back(0);
+    CHECK(same(a, rows));
+
+    a.erase_row(2);
+    rows.erase(rows.begin() + 2);
+    CHECK(same(a, rows));
+
+    a.erase_column(1);
+    for (std::size_t y = 0; y < rows.size(); ++y)
+        rows[y].erase(rows[y].begin() + 1);
+    CHECK(same(a, rows));
+
+    a.pop_row();
+    rows.pop_back();
+    CHECK(same(a, rows));
+
+    a.push_row();
+    rows.push_back(std::vector<int>(5, 0));
+    CHECK(same(a, rows));
+}
+
+} //namespace
+
+ARRAY2D_TEST(row_major_edits)
+{
+    check_edits<array2d::row_major, alignof(int)>();
+    check_edits<array2d::row_major, 32>();
+}
+
+ARRAY2D_TEST(column_major_edits)
+{
+    check_edits<array2d::column_major, alignof(int)>();
+}
+
+ARRAY2D_TEST(tiled_edits)
+{
+    check_edits<array2d::tiled<2>, alignof(int)>();
+}
+
+ARRAY2D_TEST(reserve_keeps_appends_in_place)
+{
+    array2d::array2d<int> a(8, 1, 0);
+    a.reserve(8, 100);
+    CHECK(a.capacity() >= 800);
+    const int* data = a.data();
+    for (int i = 0; i < 99; ++i)
+        a.push_row(i);
+    CHECK(a.height() == 100 && a.data() == data);
+    CHECK(a(7, 99) == 98);
+
+    //growing without a reserve reallocates geometrically
+    array2d::array2d<std::string> s(2, 0);
+    std::size_t reallocations = 0;
+    for (int i = 0; i < 1000; ++i)
+    {
+        const std::size_t capacity = s.capacity();
+        s.push_row(std::string(1, 'a'));
+        reallocations += s.capacity() != capacity;
+    }
+    CHECK(reallocations < 20);
+    CHECK(s.height() == 1000 && s(1, 999) == "a");
+}
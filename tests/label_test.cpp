@@ -0,0 +1,201 @@
+/*
+ label_test.cpp - Connected component labeling and flood fill against a
+                  breadth first search.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#include "test.hpp"
+
+#include "../array2d_label.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+typedef array2d::array2d<std::uint8_t> mask;
+typedef array2d::array2d<std::uint32_t> labels;
+
+//Labels the nonzero elements of m by searching out from each unlabeled one in
+//row order, so components are numbered in order of their first element, the
+//same order label_components uses.
+std::vector<array2d::component_stats> search(const mask& m, labels& out,
+                                             array2d::connectivity conn)
+{
+    const long width = static_cast<long>(m.width());
+    const long height = static_cast<long>(m.height());
+    std::vector<array2d::component_stats> stats;
+    std::fill(out.begin(), out.end(), 0u);
+    for (long y = 0; y < height; ++y)
+    {
+        for (long x = 0; x < width; ++x)
+        {
+            if (m(x, y) == 0 || out(x, y) != 0)
+                continue;
+
+            const std::uint32_t label = static_cast<std::uint32_t>(stats.size() + 1);
+            array2d::component_stats s;
+            std::deque<std::pair<long, long>> queue(1, std::make_pair(x, y));
+            out(x, y) = label;
+            while (!queue.empty())
+            {
+                const long px = queue.front().first;
+                const long py = queue.front().second;
+                queue.pop_front();
+                s.add_run(px, px, py);
+                for (long dy = -1; dy <= 1; ++dy)
+                {
+                    for (long dx = -1; dx <= 1; ++dx)
+                    {
+                        const long nx = px + dx;
+                        const long ny = py + dy;
+                        if ((dx == 0 && dy == 0) || (conn == array2d::connect_4 && dx != 0 && dy != 0) ||
+                            nx < 0 || ny < 0 || nx >= width || ny >= height)
+                            continue;
+                        if (m(nx, ny) != 0 && out(nx, ny) == 0)
+                        {
+                            out(nx, ny) = label;
+                            queue.push_back(std::make_pair(nx, ny));
+                        }
+                    }
+                }
+            }
+            stats.push_back(s);
+        }
+    }
+    return stats;
+}
+
+bool same_stats(const array2d::component_stats& a, const array2d::component_stats& b)
+{
+    return a.area == b.area && a.min_x == b.min_x && a.min_y == b.min_y &&
+           a.max_x == b.max_x && a.max_y == b.max_y;
+}
+
+} //namespace
+
+//random masks from sparse to dense, in bands of several sizes
+ARRAY2D_TEST(label_components_matches_a_search)
+{
+    array2d::thread_pool pool(3);
+    std::mt19937 rng(1);
+    for (int trial = 0; trial < 200; ++trial)
+    {
+        const std::size_t width = rng() % 40 + 1;
+        const std::size_t height = rng() % 40 + 1;
+        const unsigned density = rng() % 100;
+        mask m(width, height);
+        for (std::size_t y = 0; y < height; ++y)
+        {
+            for (std::size_t x = 0; x < width; ++x)
+                m(x, y) = rng() % 100 < density;
+        }
+
+        const array2d::connectivity conns[] = { array2d::connect_4, array2d::connect_8 };
+        for (int c = 0; c < 2; ++c)
+        {
+            labels expected(width, height);
+            const std::vector<array2d::component_stats> expected_stats =
+                search(m, expected, conns[c]);
+
+            labels got(width, height);
+            const array2d::chunking chunks(trial % 2 ? array2d::chunking::static_chunks
+                                                     : array2d::chunking::dynamic_chunks,
+                                           rng() % 5);
+            const std::vector<array2d::component_stats> stats =
+                array2d::label_components(m, got, conns[c], chunks, pool);
+
+            bool same = stats.size() == expected_stats.size() &&
+                        std::equal(got.begin(), got.end(), expected.begin());
+            for (std::size_t i = 0; same && i < stats.size(); ++i)
+                same = same_stats(stats[i], expected_stats[i]);
+            CHECK(same);
+        }
+    }
+}
+
+ARRAY2D_TEST(label_components_mismatched_dimensions_throw)
+{
+    mask m(4, 4);
+    labels out(4, 3);
+    CHECK_THROWS(array2d::label_components(m, out), std::invalid_argument);
+}
+
+ARRAY2D_TEST(flood_fill_fills_the_searched_region)
+{
+    std::mt19937 rng(2);
+    for (int trial = 0; trial < 100; ++trial)
+    {
+        const std::size_t width = rng() % 30 + 1;
+        const std::size_t height = rng() % 30 + 1;
+        mask m(width, height);
+        for (std::size_t y = 0; y < height; ++y)
+        {
+            for (std::size_t x = 0; x < width; ++x)
+                m(x, y) = rng() % 2;
+        }
+        const std::size_t sx = rng() % width;
+        const std::size_t sy = rng() % height;
+        if (m(sx, sy) == 0)
+            continue;
+
+        const array2d::connectivity conn = trial % 2 ? array2d::connect_4 : array2d::connect_8;
+        labels expected(width, height);
+        const std::vector<array2d::component_stats> expected_stats = search(m, expected, conn);
+        const std::uint32_t label = expected(sx, sy);
+
+        mask filled = m;
+        const array2d::component_stats s = array2d::flood_fill(filled, sx, sy, 7, conn);
+        bool same = same_stats(s, expected_stats[label - 1]);
+        for (std::size_t y = 0; y < height; ++y)
+        {
+            for (std::size_t x = 0; x < width; ++x)
+                same = same && (filled(x, y) == 7) == (expected(x, y) == label);
+        }
+        CHECK(same);
+
+        //filling with the value already there changes nothing but still measures
+        mask unchanged = m;
+        const array2d::component_stats u = array2d::flood_fill(unchanged, sx, sy, 1, conn);
+        CHECK(same_stats(u, expected_stats[label - 1]));
+        CHECK(std::equal(unchanged.begin(), unchanged.end(), m.begin()));
+    }
+}
+
+ARRAY2D_TEST(flood_fill_large_regions)
+{
+    mask m(2000, 2000, 1);
+    const array2d::component_stats s = array2d::flood_fill(m, 0, 0, 2);
+    CHECK(s.area == 2000u * 2000u);
+    CHECK(m(1999, 1999) == 2);
+    CHECK_THROWS(array2d::flood_fill(m, 2000, 0, 3), std::out_of_range);
+}
@@ -0,0 +1,148 @@
+/*
+ layout_test.cpp - Column major, tiled and Z-order storage, and the tiles of
+                  each.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#include "test.hpp"
+
+#include "../array2d.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+namespace
+{
+
+template <typename Layout>
+using grid = array2d::array2d<int, std::allocator<int>, alignof(int), Layout>;
+
+//every element is reached once by the iterators and once through the tiles,
+//and the tiles cover the grid without overlapping
+template <typename Layout>
+void check_layout(std::size_t width, std::size_t height)
+{
+    grid<Layout> a(width, height, 0);
+    array2d_test::fill_numbered(a);
+    CHECK(array2d_test::is_numbered(a));
+
+    std::vector<int> by_iterator(a.begin(), a.end());
+    CHECK(by_iterator.size() == width * height);
+    std::sort(by_iterator.begin(), by_iterator.end());
+    CHECK(std::adjacent_find(by_iterator.begin(), by_iterator.end()) == by_iterator.end());
+
+    bool rows = true;
+    for (std::size_t y = 0; y < height; ++y)
+    {
+        std::size_t x = 0;
+        for (typename grid<Layout>::const_row_iterator it = a.row_begin(y); it != a.row_end(y);
+             ++it, ++x)
+            rows = rows && *it == array2d_test::numbered_value(x, y);
+        rows = rows && x == width;
+    }
+    CHECK(rows);
+
+    bool columns = true;
+    for (std::size_t x = 0; x < width; ++x)
+    {
+        std::size_t y = 0;
+        for (typename grid<Layout>::const_column_iterator it = a.column_begin(x);
+             it != a.column_end(x); ++it, ++y)
+            columns = columns && *it == array2d_test::numbered_value(x, y);
+        columns = columns && y == height;
+    }
+    CHECK(columns);
+
+    std::size_t covered = 0;
+    bool tiles = true;
+    CHECK(static_cast<std::size_t>(a.tile_end() - a.tile_begin()) == a.tile_count());
+    for (typename grid<Layout>::tile_iterator it = a.tile_begin(); it != a.tile_end(); ++it)
+    {
+        const array2d::array2d_tile<int, Layout> t = *it;
+        for (std::size_t y = 0; y < t.height(); ++y)
+        {
+            for (std::size_t x = 0; x < t.width(); ++x)
+            {
+                tiles = tiles && &t(x, y) == &a(t.x() + x, t.y() + y) &&
+                        &t(x, y) >= t.begin() && &t(x, y) < t.end();
+            }
+        }
+        covered += t.width() * t.height();
+    }
+    CHECK(tiles);
+    CHECK(covered == width * height);
+}
+
+} //namespace
+
+ARRAY2D_TEST(row_major)
+{
+    check_layout<array2d::row_major>(13, 7);
+}
+
+ARRAY2D_TEST(column_major)
+{
+    check_layout<array2d::column_major>(13, 7);
+    grid<array2d::column_major> a(5, 4, 0);
+    CHECK(a.pitch() == 4);
+    CHECK(&a(1, 0) == &a(0, 3) + 1);
+}
+
+ARRAY2D_TEST(tiled)
+{
+    check_layout<array2d::tiled<4> >(13, 7);
+    check_layout<array2d::tiled<8, 2> >(16, 5);
+    grid<array2d::tiled<4> > a(13, 7, 0);
+    CHECK(a.tile_count() == 8);
+    CHECK(&a(3, 3) == &a(0, 0) + 15 && &a(4, 0) == &a(0, 0) + 16);
+}
+
+ARRAY2D_TEST(morton)
+{
+    check_layout<array2d::morton>(13, 7);
+    check_layout<array2d::morton>(8, 8);
+    grid<array2d::morton> a(8, 8, 0);
+    CHECK(&a(1, 1) == &a(0, 0) + 3 && &a(2, 0) == &a(0, 0) + 4);
+}
+
+ARRAY2D_TEST(static_grids)
+{
+    typedef array2d::static_array2d<int, 3, 2, array2d::column_major> columns;
+    columns a{ { 0, 100, 1, 101, 2, 102 } };
+    CHECK(columns::pitch == 2);
+    CHECK(a(2, 1) == array2d_test::numbered_value(2, 1));
+    CHECK(std::accumulate(a.begin(), a.end(), 0) == 306);
+    const int row[] = { 100, 101, 102 };
+    CHECK(std::equal(a.row_begin(1), a.row_end(1), row));
+
+    array2d::static_array2d<int, 8, 4, array2d::tiled<4> > t;
+    t.fill(0);
+    t(5, 2) = 1;
+    CHECK(t.tile_count() == 2);
+    CHECK((*(t.tile_begin() + 1))(1, 2) == 1);
+}
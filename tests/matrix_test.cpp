@@ -0,0 +1,171 @@
+/*
+ matrix_test.cpp - Matrix products and matrix-vector products against naive
+                   loops, over sizes that exercise the packed kernel's edges.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#include "test.hpp"
+
+#include "../array2d_matrix.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+
+//c(x, y) is the sum of a(i, y) * b(x, i), in double
+template <typename A, typename B>
+array2d::array2d<double> naive_multiply(const A& a, const B& b)
+{
+    array2d::array2d<double> c(b.width(), a.height(), 0.0);
+    for (std::size_t y = 0; y < a.height(); ++y)
+    {
+        for (std::size_t x = 0; x < b.width(); ++x)
+        {
+            double sum = 0;
+            for (std::size_t i = 0; i < a.width(); ++i)
+                sum += static_cast<double>(a(i, y)) * static_cast<double>(b(x, i));
+            c(x, y) = sum;
+        }
+    }
+    return c;
+}
+
+template <typename C>
+bool same_product(const C& c, const array2d::array2d<double>& expected, double tolerance)
+{
+    for (std::size_t y = 0; y < c.height(); ++y)
+    {
+        for (std::size_t x = 0; x < c.width(); ++x)
+        {
+            if (!array2d_test::near(static_cast<double>(c(x, y)), expected(x, y), tolerance))
+                return false;
+        }
+    }
+    return true;
+}
+
+//M, K and N, from the unpacked small path to several blocks of the packed one
+const std::size_t shapes[][3] = {
+    { 1, 1, 1 }, { 3, 5, 7 }, { 32, 32, 32 }, { 33, 17, 65 }, { 100, 300, 45 },
+    { 257, 129, 70 }, { 64, 600, 300 }, { 7, 1000, 3 }
+};
+
+} //namespace
+
+ARRAY2D_TEST(multiply_matches_a_naive_product)
+{
+    array2d::thread_pool pool(3);
+    unsigned seed = 1;
+    for (std::size_t s = 0; s < sizeof(shapes) / sizeof(shapes[0]); ++s)
+    {
+        const std::size_t m = shapes[s][0], k = shapes[s][1], n = shapes[s][2];
+
+        array2d::array2d<float> af(k, m), bf(n, k), cf(n, m);
+        array2d_test::fill_random(af, seed++);
+        array2d_test::fill_random(bf, seed++);
+        array2d::multiply_into(af, bf, cf, array2d::chunking(), pool);
+        CHECK(same_product(cf, naive_multiply(af, bf), 1e-4));
+
+        array2d::array2d<double> ad(k, m), bd(n, k);
+        array2d_test::fill_random(ad, seed++);
+        array2d_test::fill_random(bd, seed++);
+        CHECK(same_product(array2d::multiply(ad, bd, array2d::chunking(), pool),
+                           naive_multiply(ad, bd), 1e-12));
+    }
+}
+
+ARRAY2D_TEST(multiply_other_layouts_and_types)
+{
+    typedef array2d::array2d<double, std::allocator<double>, 64, array2d::column_major> column_grid;
+    column_grid a(70, 90), b(50, 70), c(50, 90);
+    array2d_test::fill_random(a, 2);
+    array2d_test::fill_random(b, 3);
+    array2d::multiply_into(a, b, c);
+    CHECK(same_product(c, naive_multiply(a, b), 1e-12));
+
+    array2d::array2d<int> ai(40, 40, 2), bi(40, 40, 3), ci(40, 40);
+    array2d::multiply_into(ai, bi, ci);
+    CHECK(ci(0, 0) == 240 && ci(39, 39) == 240);
+}
+
+ARRAY2D_TEST(multiply_an_empty_inner_dimension)
+{
+    array2d::array2d<float> a(0, 4), b(6, 0), c(6, 4, 5.0f);
+    array2d::multiply_into(a, b, c);
+    CHECK(c(0, 0) == 0.0f && c(5, 3) == 0.0f);
+}
+
+ARRAY2D_TEST(multiply_mismatched_dimensions_throw)
+{
+    array2d::array2d<float> a(3, 4), b(5, 2), c(5, 4);
+    CHECK_THROWS(array2d::multiply_into(a, b, c), std::invalid_argument);
+    array2d::array2d<float> b3(5, 3), wrong(4, 4);
+    CHECK_THROWS(array2d::multiply_into(a, b3, wrong), std::invalid_argument);
+}
+
+ARRAY2D_TEST(multiply_vector_matches_a_naive_product)
+{
+    array2d::thread_pool pool(2);
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<double> d(-1.0, 1.0);
+    const std::size_t sizes[][2] = { { 1, 1 }, { 3, 9 }, { 17, 31 }, { 256, 100 }, { 1001, 7 } };
+    for (std::size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+    {
+        const std::size_t width = sizes[s][0], height = sizes[s][1];
+        array2d::array2d<double> a(width, height);
+        array2d::array2d<double, std::allocator<double>, 64, array2d::column_major>
+            at(width, height);
+        array2d_test::fill_random(a, static_cast<unsigned>(s));
+        for (std::size_t y = 0; y < height; ++y)
+        {
+            for (std::size_t x = 0; x < width; ++x)
+                at(x, y) = a(x, y);
+        }
+        std::vector<double> v(width);
+        for (std::size_t i = 0; i < width; ++i)
+            v[i] = d(rng);
+
+        const std::vector<double> rows = array2d::multiply_vector(a, v, array2d::chunking(), pool);
+        const std::vector<double> columns = array2d::multiply_vector(at, v, array2d::chunking(), pool);
+        bool same = rows.size() == height && columns.size() == height;
+        for (std::size_t y = 0; same && y < height; ++y)
+        {
+            double sum = 0;
+            for (std::size_t x = 0; x < width; ++x)
+                sum += a(x, y) * v[x];
+            same = array2d_test::near(rows[y], sum, 1e-12) &&
+                   array2d_test::near(columns[y], sum, 1e-12);
+        }
+        CHECK(same);
+    }
+
+    array2d::array2d<float> a(4, 3);
+    CHECK_THROWS(array2d::multiply_vector(a, std::vector<float>(5)), std::invalid_argument);
+}
@@ -0,0 +1,126 @@
+/*
+ numa_test.cpp - The NUMA placing allocator under each policy, and first
+                touch bands that stay on the threads they were dealt to.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#include "test.hpp"
+
+#include "../array2d_numa.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+namespace
+{
+
+const array2d::numa_policy policies[] = {
+    array2d::numa_local, array2d::numa_interleave, array2d::numa_bands
+};
+
+bool aligned(const void* p, std::size_t alignment)
+{ return reinterpret_cast<std::uintptr_t>(p) % alignment == 0; }
+
+} //namespace
+
+ARRAY2D_TEST(nodes)
+{
+    const std::vector<int>& nodes = array2d::numa_nodes();
+    CHECK(!nodes.empty());
+    CHECK(std::is_sorted(nodes.begin(), nodes.end()));
+    CHECK(array2d::numa_node_count() == nodes.size());
+}
+
+ARRAY2D_TEST(allocations_of_every_size_and_policy)
+{
+    for (std::size_t p = 0; p < 3; ++p)
+    {
+        for (int huge = 0; huge < 2; ++huge)
+        {
+            array2d::numa_allocator<double> alloc(policies[p], huge != 0);
+            CHECK(alloc.policy() == policies[p] && alloc.huge_pages() == (huge != 0));
+            CHECK(array2d::numa_allocator<char>(alloc) == alloc);
+
+            const std::size_t sizes[] = { 1, 1000, (1 << 20) / sizeof(double),
+                                          (3 << 20) / sizeof(double) + 7 };
+            for (std::size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+            {
+                double* d = alloc.allocate(sizes[s]);
+                std::fill(d, d + sizes[s], 1.0);
+                CHECK(d[sizes[s] - 1] == 1.0);
+#ifdef __linux__
+                if (sizes[s] * sizeof(double) >= alloc.threshold)
+                {
+                    const std::size_t page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+                    CHECK(aligned(d, huge ? alloc.huge_page_size : page));
+                }
+#endif
+                alloc.deallocate(d, sizes[s]);
+            }
+        }
+    }
+    CHECK(array2d::numa_allocator<int>(array2d::numa_bands) !=
+          array2d::numa_allocator<int>(array2d::numa_local));
+}
+
+ARRAY2D_TEST(first_touch_fills_the_grid)
+{
+    typedef array2d::array2d<float, array2d::numa_allocator<float>, 64> grid;
+    array2d::thread_pool pool(3);
+    grid a(700, 500, array2d::uninitialized, array2d::numa_allocator<float>(array2d::numa_local));
+    array2d::first_touch(a, 2.0f, array2d::chunking(array2d::chunking::pinned_chunks), pool);
+    CHECK(std::count(a.begin(), a.end(), 2.0f) == 700 * 500);
+}
+
+ARRAY2D_TEST(pinned_bands_run_on_the_same_threads)
+{
+    //each row remembers the thread that touched it, and a second loop with the
+    //same chunking must find itself on that thread, however busy the pool is
+    array2d::thread_pool pool(3);
+    const std::size_t rows = 1000;
+    std::vector<std::thread::id> owner(rows);
+    const array2d::chunking pinned(array2d::chunking::pinned_chunks);
+    bool same = true;
+    for (int pass = 0; pass < 20; ++pass)
+    {
+        std::vector<std::thread::id> seen(rows);
+        pool.parallel_for(rows, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t y = begin; y < end; ++y)
+                seen[y] = std::this_thread::get_id();
+        }, pinned);
+        if (pass == 0)
+            owner = seen;
+        else
+            same = same && seen == owner;
+    }
+    CHECK(same);
+}
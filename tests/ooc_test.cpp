@@ -0,0 +1,70 @@
+/*
+ ooc_test.cpp - Out of core grids written through a small tile cache, reopened,
+                and the checksum left behind by syncing and closing.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#include "test.hpp"
+
+#include "../array2d_ooc.hpp"
+
+#include <cstdint>
+
+using array2d_test::scratch_file;
+
+ARRAY2D_TEST(out_of_core_roundtrip)
+{
+    scratch_file f("out_of_core");
+    const array2d::ooc_array2d_options options(3, 1);
+    {
+        array2d::ooc_array2d<std::int32_t, 8> o(f.path, 45, 30, options);
+        array2d_test::fill_numbered(o);
+        CHECK(o.cached_tiles() <= 3);
+        CHECK(o.stats().evictions != 0);
+    }
+
+    //the destructor stored the checksum, so syncing again doesn't change it
+    const std::uint64_t checksum = array2d::read_array2d_header(f.path).checksum;
+    {
+        array2d::ooc_array2d<std::int32_t, 8> o(f.path, options);
+        const array2d::ooc_array2d<std::int32_t, 8>& co = o;
+        CHECK(o.width() == 45 && o.height() == 30);
+        CHECK(array2d_test::is_numbered(co));
+        o.sync();
+    }
+    CHECK(array2d::read_array2d_header(f.path).checksum == checksum);
+
+    //a write and no sync leaves the next open with a different checksum
+    {
+        array2d::ooc_array2d<std::int32_t, 8> o(f.path, options);
+        o(44, 29) = 0;
+    }
+    CHECK(array2d::read_array2d_header(f.path).checksum != checksum);
+    {
+        const array2d::ooc_array2d<std::int32_t, 8> o(f.path, options);
+        CHECK(o(44, 29) == 0);
+        CHECK(o(43, 29) == array2d_test::numbered_value(43, 29));
+    }
+}
@@ -0,0 +1,161 @@
+/*
+ parallel_test.cpp - Parallel loops cover their ranges exactly once in every
+                    chunking mode, and pass exceptions back to the caller.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#include "test.hpp"
+
+#include "../array2d_parallel.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+
+const array2d::chunking::mode_type modes[] = {
+    array2d::chunking::static_chunks, array2d::chunking::dynamic_chunks,
+    array2d::chunking::pinned_chunks
+};
+
+//whether every item of a loop over count items was visited once, and every
+//subrange but the last started and ended on a multiple of multiple
+bool covers(array2d::thread_pool& pool, std::size_t count, array2d::chunking c,
+            std::size_t multiple)
+{
+    std::unique_ptr<std::atomic<int>[]> visits(new std::atomic<int>[count]);
+    for (std::size_t i = 0; i < count; ++i)
+        visits[i] = 0;
+    std::atomic<bool> aligned(true);
+    pool.parallel_for(count,
+                      [&](std::size_t begin, std::size_t end)
+                      {
+                          if (begin % multiple != 0 || (end != count && end % multiple != 0))
+                              aligned = false;
+                          for (std::size_t i = begin; i < end; ++i)
+                              ++visits[i];
+                      },
+                      c, multiple);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        if (visits[i] != 1)
+            return false;
+    }
+    return aligned;
+}
+
+} //namespace
+
+ARRAY2D_TEST(parallel_for_covers_the_range)
+{
+    array2d::thread_pool pool(3);
+    array2d::thread_pool alone(0);
+    CHECK(pool.concurrency() == 4 && alone.concurrency() == 1);
+    const std::size_t counts[] = { 0, 1, 7, 64, 1000, 4099 };
+    for (std::size_t m = 0; m < 3; ++m)
+    {
+        for (std::size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); ++i)
+        {
+            CHECK(covers(pool, counts[i], array2d::chunking(modes[m]), 1));
+            CHECK(covers(pool, counts[i], array2d::chunking(modes[m], 5), 8));
+            CHECK(covers(alone, counts[i], array2d::chunking(modes[m]), 4));
+        }
+    }
+}
+
+ARRAY2D_TEST(nested_loops)
+{
+    array2d::thread_pool pool(3);
+    std::atomic<std::size_t> total(0);
+    pool.parallel_for(8, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            pool.parallel_for(100, [&](std::size_t b, std::size_t e) { total += e - b; });
+        }
+    });
+    CHECK(total == 800);
+}
+
+ARRAY2D_TEST(exceptions_reach_the_caller)
+{
+    array2d::thread_pool pool(3);
+    for (std::size_t m = 0; m < 3; ++m)
+    {
+        std::atomic<std::size_t> done(0);
+        CHECK_THROWS(pool.parallel_for(1000,
+                                       [&](std::size_t begin, std::size_t end)
+                                       {
+                                           if (begin <= 500 && 500 < end)
+                                               throw std::runtime_error("500");
+                                           done += end - begin;
+                                       },
+                                       array2d::chunking(modes[m], 10)),
+                     std::runtime_error);
+        CHECK(done < 1000);
+    }
+
+    //the pool is still usable
+    CHECK(covers(pool, 100, array2d::chunking(), 1));
+}
+
+ARRAY2D_TEST(rows_tiles_and_transform)
+{
+    array2d::thread_pool pool(3);
+    array2d::array2d<int> a(37, 29, 0);
+
+    array2d::parallel_for_rows(a, [&](std::size_t y) {
+        for (std::size_t x = 0; x < a.width(); ++x)
+            a(x, y) += array2d_test::numbered_value(x, y);
+    }, array2d::chunking(), pool);
+    CHECK(array2d_test::is_numbered(a));
+
+    array2d::array2d<int> b(37, 29, 0);
+    array2d::parallel_for_tiles(b, 8, 5, [&](std::size_t x0, std::size_t y0, std::size_t w,
+                                             std::size_t h) {
+        for (std::size_t y = y0; y < y0 + h; ++y)
+        {
+            for (std::size_t x = x0; x < x0 + w; ++x)
+                b(x, y) += array2d_test::numbered_value(x, y);
+        }
+    }, array2d::chunking(array2d::chunking::static_chunks), pool);
+    CHECK(array2d_test::is_numbered(b));
+
+    array2d::array2d<double, std::allocator<double>, 64, array2d::column_major> c(37, 29);
+    array2d::parallel_transform(a, c, [](int v) { return v * 0.5; }, array2d::chunking(), pool);
+    bool halved = true;
+    for (std::size_t y = 0; y < c.height(); ++y)
+    {
+        for (std::size_t x = 0; x < c.width(); ++x)
+            halved = halved && c(x, y) == array2d_test::numbered_value(x, y) * 0.5;
+    }
+    CHECK(halved);
+
+    array2d::parallel_transform(a, a, [](int v) { return -v; }, array2d::chunking(), pool);
+    CHECK(a(36, 28) == -array2d_test::numbered_value(36, 28));
+}
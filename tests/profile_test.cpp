@@ -0,0 +1,150 @@
+/*
+ profile_test.cpp - What a profiled grid counts for each kind of access, and
+                   the report it writes.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#include "test.hpp"
+
+#include "../array2d_profile.hpp"
+#include "../array2d_ring.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <utility>
+
+typedef array2d::profiled_array2d<array2d::array2d<float> > profiled;
+
+ARRAY2D_TEST(index_calls_and_strides)
+{
+    profiled a(16, 8, 1.0f);
+    float sum = 0;
+    for (std::size_t y = 0; y < a.height(); ++y)
+    {
+        for (std::size_t x = 0; x < a.width(); ++x)
+            sum += a(x, y);
+    }
+    CHECK(sum == 128);
+    CHECK(a.counts().index_calls == 128);
+    //consecutive elements are always one apart, even from row to row
+    CHECK(a.counts().index_strides[array2d::array2d_stride_bin(1)] == 127);
+
+    a.reset_counts();
+    for (std::size_t x = 0; x < a.width(); ++x)
+        a.index(x, 0) = a.index(x, 7);
+    CHECK(a.counts().index_calls == 32);
+    //every access is seven rows, 111 to 113 elements, from the one before
+    CHECK(a.counts().index_strides[array2d::array2d_stride_bin(112)] == 31);
+    CHECK(array2d::array2d_stride_bin(0) == 0 && array2d::array2d_stride_bin(3) == 2);
+}
+
+ARRAY2D_TEST(iterator_steps)
+{
+    profiled a(16, 8, 1.0f);
+    const profiled& ca = a;
+    CHECK(std::accumulate(ca.begin(), ca.end(), 0.0f) == 128);
+    CHECK(a.counts().grid_steps == 128);
+
+    std::fill(a.row_begin(2), a.row_end(2), 2.0f);
+    CHECK(a.counts().row_steps == 16);
+
+    float column = 0;
+    for (std::size_t x = 0; x < a.width(); ++x)
+        column += std::accumulate(ca.column_begin(x), ca.column_end(x), 0.0f);
+    CHECK(column == 144);
+    CHECK(a.counts().column_steps == 128);
+    CHECK(a.counts().index_calls == 0);
+
+    a.emplace(3, 3, 4.0f);
+    CHECK(a.counts().emplaces == 1 && a.grid()(3, 3) == 4.0f);
+}
+
+ARRAY2D_TEST(copies_and_moves)
+{
+    profiled a(4, 4, 0.0f);
+    profiled b(a);
+    profiled c(std::move(b));
+    c = a;
+    CHECK(a.counts().copies == 2);
+    CHECK(b.counts().moves == 1);
+    CHECK(c.counts().copies == 0 && c.width() == 4);
+}
+
+ARRAY2D_TEST(reports)
+{
+    profiled a(64, 32, 1.0f);
+    const profiled& ca = a;
+    float sum = 0;
+    for (std::size_t x = 0; x < a.width(); ++x)
+        sum += std::accumulate(ca.column_begin(x), ca.column_end(x), 0.0f);
+    CHECK(sum == 64 * 32);
+
+    std::ostringstream os;
+    a.report(os, "frame");
+    const std::string report = os.str();
+    CHECK(report.find("array2d profile frame (64x32)") == 0);
+    CHECK(report.find("column steps   2048 (stride 64)") != std::string::npos);
+    CHECK(report.find("transposing the grid would make them unit stride") != std::string::npos);
+    CHECK(report.find("index strides") == std::string::npos);
+}
+
+ARRAY2D_TEST(reports_a_single_index_call)
+{
+    profiled a(8, 8, 1.0f);
+    a(3, 3) = 2.0f;
+    std::ostringstream os;
+    a.report(os, "one");
+    const std::string report = os.str();
+    CHECK(report.find("index calls    1") != std::string::npos);
+    CHECK(report.find("index strides") == std::string::npos);
+
+    a(4, 3) = 2.0f;
+    std::ostringstream again;
+    a.report(again, "two");
+    CHECK(again.str().find("index strides  1:1") != std::string::npos);
+}
+
+ARRAY2D_TEST(perf_regions_always_count)
+{
+    profiled a(8, 8, 1.0f);
+    {
+        const std::unique_ptr<array2d::array2d_perf_region> region = a.perf_region();
+        volatile float sum = 0;
+        for (std::size_t y = 0; y < a.height(); ++y)
+            sum = sum + a(0, y);
+    }
+    //wherever the hardware counters can't be opened, the region is still counted
+    CHECK(a.counts().perf_regions + a.counts().perf_unavailable == 1);
+}
+
+ARRAY2D_TEST(other_grids)
+{
+    array2d::profiled_array2d<array2d::ring_array2d<int> > r(5, 3, 2);
+    CHECK(r(4, 2) == 2 && r.counts().index_calls == 1);
+    CHECK(array2d::array2d_width(r) == 5 && array2d::array2d_height(r) == 3);
+}
@@ -0,0 +1,173 @@
+/*
+ reduce_test.cpp - Row, column and whole grid reductions, argmin/argmax and
+                   the 2D inclusive scan, against plain loops.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#include "test.hpp"
+
+#include "../array2d_reduce.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+
+//integer valued elements, so every order of summation gives the same result
+template <typename Grid>
+void check_sums(const Grid& a, array2d::thread_pool& pool)
+{
+    typedef typename Grid::value_type T;
+    const std::size_t width = a.width();
+    const std::size_t height = a.height();
+
+    std::vector<T> rows(height);
+    std::vector<T> columns(width);
+    array2d::reduce_rows(a, rows.begin(), array2d::plus_op(), array2d::chunking(), pool);
+    array2d::reduce_columns(a, columns.begin(), array2d::plus_op(), array2d::chunking(), pool);
+
+    T total = T();
+    bool rows_ok = true;
+    for (std::size_t y = 0; y < height; ++y)
+    {
+        T sum = T();
+        for (std::size_t x = 0; x < width; ++x)
+            sum += a(x, y);
+        rows_ok = rows_ok && rows[y] == sum;
+        total += sum;
+    }
+    bool columns_ok = true;
+    for (std::size_t x = 0; x < width; ++x)
+    {
+        T sum = T();
+        for (std::size_t y = 0; y < height; ++y)
+            sum += a(x, y);
+        columns_ok = columns_ok && columns[x] == sum;
+    }
+    CHECK(rows_ok);
+    CHECK(columns_ok);
+    CHECK(array2d::reduce_all(a, array2d::plus_op(), array2d::chunking(), pool) == total);
+}
+
+} //namespace
+
+ARRAY2D_TEST(sums_of_row_and_column_major_grids)
+{
+    array2d::thread_pool pool(3);
+    const std::size_t sizes[][2] = { { 1, 1 }, { 3, 70 }, { 70, 3 }, { 37, 41 }, { 256, 9 } };
+    for (std::size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+    {
+        array2d::array2d<float> f(sizes[i][0], sizes[i][1]);
+        array2d_test::fill_random(f, static_cast<unsigned>(i));
+        check_sums(f, pool);
+
+        array2d::array2d<double, std::allocator<double>, 64, array2d::column_major>
+            d(sizes[i][0], sizes[i][1]);
+        array2d_test::fill_random(d, static_cast<unsigned>(i + 10));
+        check_sums(d, pool);
+
+        array2d::array2d<std::int32_t> n(sizes[i][0], sizes[i][1]);
+        array2d_test::fill_random(n, static_cast<unsigned>(i + 20));
+        check_sums(n, pool);
+    }
+}
+
+ARRAY2D_TEST(min_and_max)
+{
+    array2d::array2d<float> a(33, 7, 1.0f);
+    a(30, 2) = -5.0f;
+    a(4, 6) = 9.0f;
+    CHECK(array2d::reduce_all(a, array2d::min_op()) == -5.0f);
+    CHECK(array2d::reduce_all(a, array2d::max_op()) == 9.0f);
+
+    std::vector<float> columns(33);
+    array2d::reduce_columns(a, columns.begin(), array2d::max_op());
+    CHECK(columns[4] == 9.0f);
+    CHECK(columns[5] == 1.0f);
+}
+
+ARRAY2D_TEST(empty_grids)
+{
+    array2d::array2d<float> a(0, 3);
+    std::vector<float> rows(3, 7.0f);
+    array2d::reduce_rows(a, rows.begin());
+    CHECK(rows[0] == 0.0f && rows[2] == 0.0f);
+    CHECK(array2d::reduce_all(a) == 0.0f);
+    CHECK_THROWS(array2d::argmin(a), std::invalid_argument);
+}
+
+ARRAY2D_TEST(argmin_and_argmax_find_the_first)
+{
+    array2d::array2d<int> a(50, 20, 3);
+    a(40, 5) = -1;
+    a(10, 9) = -1;
+    a(49, 19) = 8;
+    a(0, 19) = 8;
+    const std::pair<std::size_t, std::size_t> lo = array2d::argmin(a);
+    const std::pair<std::size_t, std::size_t> hi = array2d::argmax(a);
+    CHECK(lo.first == 40 && lo.second == 5);
+    CHECK(hi.first == 0 && hi.second == 19);
+}
+
+ARRAY2D_TEST(inclusive_scan_is_an_integral_image)
+{
+    array2d::thread_pool pool(2);
+    array2d::array2d<std::uint8_t> a(45, 31);
+    std::mt19937 rng(3);
+    for (std::size_t y = 0; y < a.height(); ++y)
+    {
+        for (std::size_t x = 0; x < a.width(); ++x)
+            a(x, y) = static_cast<std::uint8_t>(rng() % 256);
+    }
+
+    array2d::array2d<std::uint32_t> s(45, 31);
+    array2d::inclusive_scan_2d(a, s, array2d::plus_op(), array2d::chunking(), pool);
+
+    bool same = true;
+    for (std::size_t y = 0; y < a.height(); ++y)
+    {
+        for (std::size_t x = 0; x < a.width(); ++x)
+        {
+            std::uint32_t sum = 0;
+            for (std::size_t j = 0; j <= y; ++j)
+            {
+                for (std::size_t i = 0; i <= x; ++i)
+                    sum += a(i, j);
+            }
+            same = same && s(x, y) == sum;
+        }
+    }
+    CHECK(same);
+
+    //in place
+    array2d::array2d<double> d(5, 4, 1.0);
+    array2d::inclusive_scan_2d(d, d);
+    CHECK(d(4, 3) == 20.0);
+    CHECK(d(1, 2) == 6.0);
+}
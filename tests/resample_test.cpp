@@ -0,0 +1,278 @@
+/*
+ resample_test.cpp - Element type conversion and resizing, against the
+                     definitions written out as plain loops.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#include "test.hpp"
+
+#include "../array2d_resample.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+
+typedef array2d::array2d<std::uint8_t> byte_grid;
+typedef array2d::array2d<float> float_grid;
+
+byte_grid random_bytes(std::size_t width, std::size_t height, std::mt19937& rng)
+{
+    byte_grid a(width, height);
+    for (std::size_t y = 0; y < height; ++y)
+    {
+        for (std::size_t x = 0; x < width; ++x)
+            a(x, y) = static_cast<std::uint8_t>(rng() % 256);
+    }
+    return a;
+}
+
+//float to uint8_t, rounding half up and saturating, NaN is 0
+std::uint8_t to_byte(float v)
+{
+    if (!(v > 0))
+        return 0;
+    if (v >= 255)
+        return 255;
+    return static_cast<std::uint8_t>(std::floor(v + 0.5f));
+}
+
+//element i of a line resized from in to out elements, blending the two
+//source elements nearest its center
+double bilinear(const float* line, std::size_t in, std::size_t out, std::size_t i)
+{
+    double s = (static_cast<double>(i) + 0.5) * static_cast<double>(in) / static_cast<double>(out) - 0.5;
+    s = std::min(std::max(s, 0.0), static_cast<double>(in - 1));
+    const std::size_t a = std::min(static_cast<std::size_t>(s), in > 1 ? in - 2 : 0);
+    const double t = s - static_cast<double>(a);
+    return in == 1 ? line[0] : line[a] * (1 - t) + line[a + 1] * t;
+}
+
+//the mean of the source elements destination element i covers
+double area(const float* line, std::size_t in, std::size_t out, std::size_t i)
+{
+    const double scale = static_cast<double>(in) / static_cast<double>(out);
+    const double lo = static_cast<double>(i) * scale;
+    const double hi = lo + scale;
+    double sum = 0;
+    for (std::size_t k = 0; k < in; ++k)
+    {
+        const double cover = std::min(hi, static_cast<double>(k + 1)) -
+                             std::max(lo, static_cast<double>(k));
+        if (cover > 0)
+            sum += line[k] * cover;
+    }
+    return sum / scale;
+}
+
+//resizes a along x, then along y, with one of the line functions above
+template <typename Line>
+array2d::array2d<double> separable(const float_grid& a, std::size_t width, std::size_t height,
+                                   Line line)
+{
+    array2d::array2d<float> across(width, a.height());
+    for (std::size_t y = 0; y < a.height(); ++y)
+    {
+        for (std::size_t x = 0; x < width; ++x)
+            across(x, y) = static_cast<float>(line(&a(0, y), a.width(), width, x));
+    }
+    array2d::array2d<double> res(width, height);
+    std::vector<float> column(a.height());
+    for (std::size_t x = 0; x < width; ++x)
+    {
+        for (std::size_t y = 0; y < a.height(); ++y)
+            column[y] = across(x, y);
+        for (std::size_t y = 0; y < height; ++y)
+            res(x, y) = line(column.data(), a.height(), height, y);
+    }
+    return res;
+}
+
+template <typename Grid>
+bool close_to(const Grid& a, const array2d::array2d<double>& expected, double tolerance)
+{
+    for (std::size_t y = 0; y < a.height(); ++y)
+    {
+        for (std::size_t x = 0; x < a.width(); ++x)
+        {
+            if (std::fabs(static_cast<double>(a(x, y)) - expected(x, y)) > tolerance)
+                return false;
+        }
+    }
+    return true;
+}
+
+} //namespace
+
+ARRAY2D_TEST(convert_normalizes_and_back)
+{
+    std::mt19937 rng(1);
+    for (std::size_t width = 1; width < 80; width += 7)
+    {
+        const byte_grid a = random_bytes(width, 5, rng);
+        const float_grid f = array2d::convert<float>(a, 1.0 / 255);
+        byte_grid b(width, 5);
+        array2d::convert_into(f, b, 255.0);
+        bool normalized = true;
+        bool same = true;
+        for (std::size_t y = 0; y < 5; ++y)
+        {
+            for (std::size_t x = 0; x < width; ++x)
+            {
+                normalized = normalized && std::fabs(f(x, y) - a(x, y) / 255.0f) < 1e-6f;
+                same = same && b(x, y) == a(x, y);
+            }
+        }
+        CHECK(normalized);
+        CHECK(same);
+    }
+}
+
+ARRAY2D_TEST(convert_saturates_and_rounds)
+{
+    float_grid f(37, 3);
+    std::mt19937 rng(2);
+    for (std::size_t y = 0; y < f.height(); ++y)
+    {
+        for (std::size_t x = 0; x < f.width(); ++x)
+            f(x, y) = static_cast<float>(rng() % 1000) * 0.5f - 200.0f;
+    }
+    f(0, 0) = std::numeric_limits<float>::quiet_NaN();
+    f(1, 0) = 2.5f;
+    f(2, 0) = 1e9f;
+    byte_grid b(37, 3);
+    array2d::convert_into(f, b);
+    bool same = true;
+    for (std::size_t y = 0; y < f.height(); ++y)
+    {
+        for (std::size_t x = 0; x < f.width(); ++x)
+            same = same && b(x, y) == to_byte(f(x, y));
+    }
+    CHECK(same);
+    CHECK(b(1, 0) == 3);
+    CHECK(b(2, 0) == 255);
+
+    array2d::array2d<int> n(37, 3);
+    array2d::convert_into(f, n, 2.0, 1.0);
+    CHECK(n(1, 0) == 6);
+}
+
+ARRAY2D_TEST(convert_mismatched_dimensions_throw)
+{
+    byte_grid a(4, 4);
+    float_grid f(4, 5);
+    CHECK_THROWS(array2d::convert_into(a, f), std::invalid_argument);
+}
+
+ARRAY2D_TEST(resize_nearest_picks_the_covering_element)
+{
+    std::mt19937 rng(3);
+    const byte_grid a = random_bytes(13, 7, rng);
+    const byte_grid r = array2d::resize(a, 29, 4, array2d::resize_nearest);
+    bool same = true;
+    for (std::size_t y = 0; y < 4; ++y)
+    {
+        for (std::size_t x = 0; x < 29; ++x)
+            same = same && r(x, y) == a((2 * x + 1) * 13 / 58, (2 * y + 1) * 7 / 8);
+    }
+    CHECK(same);
+}
+
+ARRAY2D_TEST(resize_matches_separable_references)
+{
+    array2d::thread_pool pool(3);
+    std::mt19937 rng(4);
+    const std::size_t sizes[][4] = {
+        { 1, 1, 5, 3 }, { 16, 16, 8, 8 }, { 17, 9, 40, 20 }, { 64, 48, 21, 13 }, { 3, 50, 7, 2 }
+    };
+    for (std::size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+    {
+        const std::size_t width = sizes[s][2], height = sizes[s][3];
+        const float_grid a = array2d::convert<float>(random_bytes(sizes[s][0], sizes[s][1], rng));
+
+        float_grid r(width, height);
+        array2d::resize_into(a, r, array2d::resize_bilinear, array2d::chunking(), pool);
+        CHECK(close_to(r, separable(a, width, height, bilinear), 1e-3));
+
+        //area averages when shrinking and is bilinear when enlarging
+        array2d::resize_into(a, r, array2d::resize_area, array2d::chunking(), pool);
+        const bool shrink_x = a.width() > width;
+        const bool shrink_y = a.height() > height;
+        if (shrink_x && shrink_y)
+            CHECK(close_to(r, separable(a, width, height, area), 1e-3));
+        else if (!shrink_x && !shrink_y)
+            CHECK(close_to(r, separable(a, width, height, bilinear), 1e-3));
+
+        //a column_major destination of another element type gives the same values
+        array2d::array2d<double, std::allocator<double>, 64, array2d::column_major>
+            d(width, height);
+        array2d::resize_into(a, d, array2d::resize_bilinear, array2d::chunking(), pool);
+        CHECK(close_to(d, separable(a, width, height, bilinear), 1e-3));
+    }
+}
+
+ARRAY2D_TEST(resize_keeps_constants_and_same_sizes)
+{
+    std::mt19937 rng(5);
+    const byte_grid a = random_bytes(23, 11, rng);
+    const byte_grid bilinear_copy = array2d::resize(a, 23, 11, array2d::resize_bilinear);
+    const byte_grid area_copy = array2d::resize(a, 23, 11, array2d::resize_area);
+    CHECK(std::equal(a.begin(), a.end(), bilinear_copy.begin()));
+    CHECK(std::equal(a.begin(), a.end(), area_copy.begin()));
+
+    const float_grid k(31, 17, 3.25f);
+    for (int mode = array2d::resize_nearest; mode <= array2d::resize_area; ++mode)
+    {
+        const float_grid r = array2d::resize(k, 9, 40, static_cast<array2d::resize_mode>(mode));
+        bool constant = true;
+        for (std::size_t y = 0; y < r.height(); ++y)
+        {
+            for (std::size_t x = 0; x < r.width(); ++x)
+                constant = constant && std::fabs(r(x, y) - 3.25f) < 1e-4f;
+        }
+        CHECK(constant);
+    }
+}
+
+ARRAY2D_TEST(resize_area_halving_is_the_mean)
+{
+    float_grid a(4, 2);
+    for (std::size_t y = 0; y < 2; ++y)
+    {
+        for (std::size_t x = 0; x < 4; ++x)
+            a(x, y) = static_cast<float>(y * 4 + x + 1);
+    }
+    const float_grid r = array2d::resize(a, 2, 1, array2d::resize_area);
+    CHECK(r(0, 0) == 3.5f);
+    CHECK(r(1, 0) == 5.5f);
+}
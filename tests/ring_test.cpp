@@ -0,0 +1,128 @@
+/*
+ ring_test.cpp - A ring of rows used as a sliding window, against the rows it
+                should hold.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#include "test.hpp"
+
+#include "../array2d_ring.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+namespace
+{
+
+typedef array2d::ring_array2d<int> ring;
+
+//row r of the window, filled with r * 100 + x
+std::vector<int> row(std::size_t r, std::size_t width)
+{
+    std::vector<int> v(width);
+    for (std::size_t x = 0; x < width; ++x)
+        v[x] = array2d_test::numbered_value(x, r);
+    return v;
+}
+
+//whether a holds rows first to first + a.height() - 1, oldest first
+bool holds(const ring& a, std::size_t first)
+{
+    for (std::size_t y = 0; y < a.height(); ++y)
+    {
+        const std::vector<int> expected = row(first + y, a.width());
+        if (!std::equal(a.row_begin(y), a.row_end(y), expected.begin()))
+            return false;
+        for (std::size_t x = 0; x < a.width(); ++x)
+        {
+            if (a(x, y) != expected[x])
+                return false;
+        }
+    }
+    return true;
+}
+
+} //namespace
+
+ARRAY2D_TEST(rolling_a_window)
+{
+    ring a(6, 0);
+    a.reserve(4);
+    CHECK(a.capacity() >= 4 && a.height() == 0);
+    for (std::size_t r = 0; r < 4; ++r)
+        a.push_row(row(r, 6).begin());
+    CHECK(holds(a, 0));
+
+    //rolling never reallocates, however far the window moves
+    const std::size_t capacity = a.capacity();
+    for (std::size_t r = 4; r < 50; ++r)
+    {
+        a.roll(row(r, 6).begin());
+        CHECK(a.height() == 4);
+    }
+    CHECK(a.capacity() == capacity);
+    CHECK(holds(a, 46));
+
+    std::vector<int> column;
+    std::copy(a.column_begin(2), a.column_end(2), std::back_inserter(column));
+    CHECK(column.size() == 4 && column[0] == array2d_test::numbered_value(2, 46));
+    CHECK(std::distance(a.begin(), a.end()) == 24);
+    CHECK(*a.begin() == array2d_test::numbered_value(0, 46));
+}
+
+ARRAY2D_TEST(pushing_and_popping)
+{
+    ring a(3, 2, 0);
+    CHECK(a.full());
+    a.push_row(7);
+    CHECK(a.height() == 3 && a.capacity() >= 3 && a(2, 2) == 7);
+
+    a.pop_front_row();
+    CHECK(a.height() == 2 && a(0, 0) == 0 && a(0, 1) == 7);
+    a.pop_row();
+    CHECK(a.height() == 1);
+
+    //a wrapped ring keeps its order when it grows
+    ring b(2, 0);
+    b.reserve(3);
+    for (std::size_t r = 0; r < 3; ++r)
+        b.push_row(row(r, 2).begin());
+    b.roll(row(3, 2).begin());
+    b.roll(row(4, 2).begin());
+    b.push_row(row(5, 2).begin());
+    b.push_row(row(6, 2).begin());
+    CHECK(b.height() == 5 && holds(b, 2));
+
+    array2d::array2d<int> copy(2, 5);
+    b.copy_to(copy);
+    CHECK(copy(1, 4) == array2d_test::numbered_value(1, 6));
+
+    b.clear();
+    CHECK(b.height() == 0);
+    b.roll(1);
+    CHECK(b.height() == 1 && b(1, 0) == 1);
+}
@@ -0,0 +1,108 @@
+/*
+ soa_test.cpp - Grids of records kept one plane per field, reached by plane,
+               by field and by cell.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#include "test.hpp"
+
+#include "../array2d_soa.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <tuple>
+#include <type_traits>
+
+typedef array2d::soa_array2d<float, std::int32_t, std::uint8_t> particles;
+
+ARRAY2D_TEST(planes_hold_one_field_each)
+{
+    particles a(9, 4, std::make_tuple(1.5f, 2, std::uint8_t(3)));
+    CHECK(a.width() == 9 && a.height() == 4 && particles::fields == 3);
+
+    const particles::plane_type<1> ids = a.plane<1>();
+    CHECK(ids.width() == 9 && ids.height() == 4);
+    CHECK(std::accumulate(ids.begin(), ids.end(), 0) == 72);
+
+    //writes to one plane leave the others alone
+    array2d_test::fill_numbered(ids);
+    CHECK(a.get<1>(5, 3) == array2d_test::numbered_value(5, 3));
+    CHECK(a.get<0>(5, 3) == 1.5f && a.get<2>(5, 3) == 3);
+
+    const particles& ca = a;
+    const particles::const_plane_type<0> xs = ca.plane<0>();
+    CHECK(std::count(xs.begin(), xs.end(), 1.5f) == 36);
+}
+
+ARRAY2D_TEST(cells_reach_every_field)
+{
+    particles a(5, 5, std::make_tuple(0.0f, 0, std::uint8_t(0)));
+    a(2, 3) = std::make_tuple(4.0f, -7, std::uint8_t(200));
+    CHECK(a.get<0>(2, 3) == 4.0f && a.get<1>(2, 3) == -7 && a.get<2>(2, 3) == 200);
+
+    const particles::value_type v = a(2, 3);
+    CHECK(std::get<1>(v) == -7);
+    CHECK(array2d::get<2>(a(2, 3)) == 200);
+
+    //assignment copies the fields, not the reference
+    a(0, 0) = a(2, 3);
+    a.get<1>(2, 3) = 1;
+    CHECK(a.get<1>(0, 0) == -7 && a.get<0>(0, 0) == 4.0f);
+
+    //fields of a cell are written in place
+    array2d::get<0>(a(1, 1)) += 2.5f;
+    CHECK(a.get<0>(1, 1) == 2.5f);
+
+    const particles& ca = a;
+    const particles::const_reference r = ca(2, 3);
+    const particles::const_reference converted = a(2, 3);
+    CHECK(array2d::get<1>(r) == 1 && array2d::get<1>(converted) == 1);
+}
+
+ARRAY2D_TEST(const_cells_assign_to_mutable_ones)
+{
+    particles a(4, 4, std::make_tuple(0.0f, 0, std::uint8_t(0)));
+    a(2, 3) = std::make_tuple(6.0f, 9, std::uint8_t(12));
+    const particles& ca = a;
+    a(0, 0) = ca(2, 3);
+    CHECK(a.get<0>(0, 0) == 6.0f && a.get<1>(0, 0) == 9 && a.get<2>(0, 0) == 12);
+
+    //a const cell doesn't convert to a mutable one
+    CHECK(!(std::is_convertible<particles::const_reference, particles::reference>::value));
+    CHECK((std::is_convertible<particles::reference, particles::const_reference>::value));
+}
+
+ARRAY2D_TEST(fill_and_swap)
+{
+    particles a(3, 2);
+    a.fill(std::make_tuple(1.0f, 1, std::uint8_t(1)));
+    particles b(6, 1, std::make_tuple(2.0f, 2, std::uint8_t(2)));
+    swap(a, b);
+    CHECK(a.width() == 6 && a.height() == 1 && a.get<1>(5, 0) == 2);
+    CHECK(b.width() == 3 && b.height() == 2 && b.get<2>(2, 1) == 1);
+    CHECK(array2d::array2d_width(b) == 3 && array2d::array2d_height(b) == 2);
+}
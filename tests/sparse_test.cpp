@@ -0,0 +1,184 @@
+/*
+ sparse_test.cpp - Block sparse and run length encoded grids against the dense
+                  grids they were made from.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#include "test.hpp"
+
+#include "../array2d_sparse.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+typedef array2d::array2d<int> grid;
+
+//mostly 0, with a few scattered elements and one solid patch
+grid mostly_default(std::size_t width, std::size_t height, unsigned seed)
+{
+    grid a(width, height, 0);
+    std::mt19937 rng(seed);
+    for (std::size_t i = 0; i < width * height / 20; ++i)
+        a(rng() % width, rng() % height) = static_cast<int>(rng() % 9) + 1;
+    for (std::size_t y = height / 3; y < height / 2; ++y)
+    {
+        for (std::size_t x = width / 4; x < width / 2; ++x)
+            a(x, y) = 7;
+    }
+    return a;
+}
+
+template <typename Sparse>
+bool same_elements(const Sparse& s, const grid& a)
+{
+    if (s.width() != a.width() || s.height() != a.height())
+        return false;
+    for (std::size_t y = 0; y < a.height(); ++y)
+    {
+        for (std::size_t x = 0; x < a.width(); ++x)
+        {
+            if (s(x, y) != a(x, y))
+                return false;
+        }
+    }
+    const grid dense = s.to_array2d();
+    return std::equal(s.begin(), s.end(), a.begin()) &&
+           std::equal(dense.begin(), dense.end(), a.begin()) &&
+           std::equal(s.row_begin(1), s.row_end(1), a.row_begin(1)) &&
+           std::equal(s.column_begin(2), s.column_end(2), a.column_begin(2));
+}
+
+//whether the cells are exactly the elements of a that aren't 0
+template <typename Sparse>
+bool cells_are_the_rest(const Sparse& s, const grid& a)
+{
+    std::size_t cells = 0;
+    for (typename Sparse::cell_iterator it = s.cells_begin(); it != s.cells_end(); ++it)
+    {
+        const array2d::array2d_cell<int> c = *it;
+        if (c.value == 0 || a(c.x, c.y) != c.value)
+            return false;
+        ++cells;
+    }
+    return cells == static_cast<std::size_t>(a.end() - a.begin() -
+                                             std::count(a.begin(), a.end(), 0));
+}
+
+} //namespace
+
+ARRAY2D_TEST(sparse_grids_match_the_dense_grid)
+{
+    const grid a = mostly_default(70, 45, 1);
+    const array2d::sparse_array2d<int, 8> s(a);
+    CHECK(same_elements(s, a));
+    CHECK(cells_are_the_rest(s, a));
+    CHECK(s.block_count() <= 9 * 6);
+
+    const array2d::sparse_array2d<int, 8> empty(70, 45);
+    CHECK(empty.block_count() == 0 && empty(69, 44) == 0);
+}
+
+ARRAY2D_TEST(sparse_writes_and_pruning)
+{
+    grid a(40, 20, 0);
+    array2d::sparse_array2d<int, 4, 2> s(40, 20);
+
+    //reading and setting the default stores nothing
+    const array2d::sparse_array2d<int, 4, 2>& cs = s;
+    CHECK(cs(5, 5) == 0);
+    s.set(5, 5, 0);
+    CHECK(s.block_count() == 0);
+
+    s.set(39, 19, 3);
+    s(0, 0) = 4;
+    s.index(13, 7) = 5;
+    a(39, 19) = 3;
+    a(0, 0) = 4;
+    a(13, 7) = 5;
+    CHECK(s.block_count() == 3);
+    CHECK(same_elements(s, a));
+
+    s.set(13, 7, 0);
+    a(13, 7) = 0;
+    s.prune();
+    CHECK(s.block_count() == 2);
+    CHECK(same_elements(s, a));
+    CHECK(cells_are_the_rest(s, a));
+
+    s.clear();
+    CHECK(s.block_count() == 0 && s(39, 19) == 0);
+}
+
+ARRAY2D_TEST(run_length_grids_match_the_dense_grid)
+{
+    const grid a = mostly_default(70, 45, 2);
+    const array2d::rle_array2d<int> r(a);
+    CHECK(same_elements(r, a));
+    CHECK(cells_are_the_rest(r, a));
+
+    //runs cover the elements that aren't 0, and equal neighbors share a run
+    bool runs = true;
+    std::size_t count = 0;
+    for (std::size_t y = 0; y < a.height(); ++y)
+    {
+        std::size_t end = 0;
+        typedef array2d::rle_array2d<int>::run_iterator run_iterator;
+        for (run_iterator it = r.runs_begin(y); it != r.runs_end(y); ++it)
+        {
+            runs = runs && it->x >= end && it->value != 0 &&
+                   !(it->x == end && end != 0 && a(end - 1, y) == it->value);
+            for (std::size_t x = it->x; x < it->x + it->length; ++x)
+                runs = runs && a(x, y) == it->value;
+            end = it->x + it->length;
+            ++count;
+        }
+    }
+    CHECK(runs);
+    CHECK(count == r.run_count());
+    CHECK(r.run_count() < 70 * 45 / 10);
+}
+
+ARRAY2D_TEST(run_length_rows_are_replaced)
+{
+    grid a = mostly_default(30, 10, 3);
+    array2d::rle_array2d<int> r(a);
+    std::vector<int> row(30, 0);
+    for (std::size_t x = 10; x < 20; ++x)
+        row[x] = 2;
+    r.set_row(4, row.begin());
+    std::copy(row.begin(), row.end(), a.row_begin(4));
+    CHECK(same_elements(r, a));
+    CHECK(r.runs_end(4) - r.runs_begin(4) == 1);
+
+    //a default of something other than 0
+    const grid ones(6, 3, 1);
+    const array2d::rle_array2d<int> d(ones, 1);
+    CHECK(d.run_count() == 0 && d(5, 2) == 1);
+}
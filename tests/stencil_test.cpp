@@ -0,0 +1,205 @@
+/*
+ stencil_test.cpp - Convolution with each boundary policy against a naive sum,
+                   separability, general stencils and saturating casts.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#include "test.hpp"
+
+#include "../array2d_stencil.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace
+{
+
+typedef array2d::array2d<float> grid;
+
+//the definition of convolve(), one element at a time
+template <typename Kernel, typename Boundary>
+grid naive_convolve(const grid& a, const Kernel& k, const Boundary& b)
+{
+    const std::ptrdiff_t width = static_cast<std::ptrdiff_t>(a.width());
+    const std::ptrdiff_t height = static_cast<std::ptrdiff_t>(a.height());
+    const std::ptrdiff_t kw = static_cast<std::ptrdiff_t>(array2d::array2d_width(k));
+    const std::ptrdiff_t kh = static_cast<std::ptrdiff_t>(array2d::array2d_height(k));
+    grid res(a.width(), a.height());
+    for (std::ptrdiff_t y = 0; y < height; ++y)
+    {
+        for (std::ptrdiff_t x = 0; x < width; ++x)
+        {
+            float sum = 0;
+            for (std::ptrdiff_t j = 0; j < kh; ++j)
+            {
+                for (std::ptrdiff_t i = 0; i < kw; ++i)
+                {
+                    const std::ptrdiff_t sx = b.index(x + i - kw / 2, width);
+                    const std::ptrdiff_t sy = b.index(y + j - kh / 2, height);
+                    const float v = sx < 0 || sy < 0 ? b.template fill<float>() : a(sx, sy);
+                    sum += k(i, j) * v;
+                }
+            }
+            res(x, y) = sum;
+        }
+    }
+    return res;
+}
+
+template <typename Kernel, typename Boundary>
+bool convolves(const grid& a, const Kernel& k, const Boundary& b)
+{
+    array2d::thread_pool pool(3);
+    grid res(a.width(), a.height());
+    array2d::convolve(a, res, k, b, array2d::chunking(), pool);
+    const grid expected = naive_convolve(a, k, b);
+    for (std::size_t y = 0; y < a.height(); ++y)
+    {
+        for (std::size_t x = 0; x < a.width(); ++x)
+        {
+            if (res(x, y) != expected(x, y))
+                return false;
+        }
+    }
+    return true;
+}
+
+template <typename Boundary>
+void check_boundary(const Boundary& b)
+{
+    //whole number weights and elements keep every sum exact
+    const array2d::static_array2d<float, 3, 3> separable{ { 1, 2, 1, 2, 4, 2, 1, 2, 1 } };
+    const array2d::static_array2d<float, 3, 3> general{ { 0, 1, 0, 1, -4, 1, 0, 2, 0 } };
+    array2d::array2d<float> wide(5, 3);
+    array2d_test::fill_random(wide, 9, -3, 3);
+
+    const std::size_t sizes[][2] = { { 1, 1 }, { 2, 3 }, { 17, 9 }, { 64, 40 } };
+    for (std::size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+    {
+        grid a(sizes[s][0], sizes[s][1]);
+        array2d_test::fill_random(a, static_cast<unsigned>(s));
+        CHECK(convolves(a, separable, b));
+        CHECK(convolves(a, general, b));
+        CHECK(convolves(a, wide, b));
+    }
+}
+
+} //namespace
+
+ARRAY2D_TEST(clamp)
+{
+    check_boundary(array2d::clamp_boundary());
+}
+
+ARRAY2D_TEST(wrap)
+{
+    check_boundary(array2d::wrap_boundary());
+}
+
+ARRAY2D_TEST(mirror)
+{
+    check_boundary(array2d::mirror_boundary());
+}
+
+ARRAY2D_TEST(constant)
+{
+    check_boundary(array2d::constant_boundary<float>(3.0f));
+}
+
+ARRAY2D_TEST(separability)
+{
+    const array2d::static_array2d<float, 3, 3> box{ { 1, 1, 1, 1, 1, 1, 1, 1, 1 } };
+    const array2d::static_array2d<int, 3, 2> product{ { 2, 4, 6, -1, -2, -3 } };
+    const array2d::static_array2d<float, 3, 3> laplacian{ { 0, 1, 0, 1, -4, 1, 0, 1, 0 } };
+    CHECK(array2d::is_separable(box));
+    CHECK(array2d::is_separable(product));
+    CHECK(!array2d::is_separable(laplacian));
+}
+
+ARRAY2D_TEST(bytes_saturate)
+{
+    array2d::array2d<std::uint8_t> a(6, 4, 200);
+    array2d::array2d<std::uint8_t> res(6, 4);
+    const array2d::static_array2d<int, 3, 1> doubling{ { 1, 0, 1 } };
+    array2d::convolve(a, res, doubling);
+    CHECK(res(0, 0) == 255 && res(5, 3) == 255);
+
+    CHECK(array2d::saturate_cast<std::uint8_t>(-3) == 0);
+    CHECK(array2d::saturate_cast<std::uint8_t>(300) == 255);
+    CHECK(array2d::saturate_cast<std::uint8_t>(2.5f) == 3);
+    CHECK(array2d::saturate_cast<std::int8_t>(-1000.0) == -128);
+    CHECK(array2d::saturate_cast<int>(std::numeric_limits<float>::quiet_NaN()) == 0);
+    CHECK(array2d::saturate_cast<float>(7) == 7.0f);
+}
+
+ARRAY2D_TEST(general_stencils)
+{
+    //the largest element of each 3 by 3 neighborhood
+    grid a(23, 11);
+    array2d_test::fill_random(a, 4);
+    grid res(23, 11);
+    array2d::apply_stencil(a, res, 1, 1, [](const array2d::stencil_window<float>& w) {
+        float m = w.center();
+        for (std::ptrdiff_t dy = -1; dy <= 1; ++dy)
+        {
+            for (std::ptrdiff_t dx = -1; dx <= 1; ++dx)
+                m = w(dx, dy) > m ? w(dx, dy) : m;
+        }
+        return m;
+    }, array2d::constant_boundary<float>(-1000.0f));
+
+    bool same = true;
+    for (std::size_t y = 0; y < a.height(); ++y)
+    {
+        for (std::size_t x = 0; x < a.width(); ++x)
+        {
+            float m = a(x, y);
+            for (std::size_t j = (y == 0 ? 0 : y - 1); j <= y + 1 && j < a.height(); ++j)
+            {
+                for (std::size_t i = (x == 0 ? 0 : x - 1); i <= x + 1 && i < a.width(); ++i)
+                    m = a(i, j) > m ? a(i, j) : m;
+            }
+            same = same && res(x, y) == m;
+        }
+    }
+    CHECK(same);
+}
+
+ARRAY2D_TEST(iterated_stencils)
+{
+    //each step adds the left neighbor, wrapping, so after n steps of a row
+    //starting 1, 0, 0, ... element x holds n choose x
+    typedef array2d::array2d<int> int_grid;
+    int_grid a(8, 1, 0);
+    a(0, 0) = 1;
+    array2d::stencil_iterate(a, 5, [](const int_grid& src, int_grid& dst) {
+        array2d::apply_stencil(src, dst, 1, 0, [](const array2d::stencil_window<int>& w) {
+            return w(-1, 0) + w.center();
+        }, array2d::wrap_boundary());
+    });
+    CHECK(a(0, 0) == 1 && a(1, 0) == 5 && a(2, 0) == 10 && a(3, 0) == 10 && a(5, 0) == 1);
+    CHECK(a(6, 0) == 0);
+}
@@ -0,0 +1,137 @@
+/*
+ storage_test.cpp - Allocators, row alignment and the padding between rows.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#include "test.hpp"
+
+#include "../array2d.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <numeric>
+
+namespace
+{
+
+//counts the bytes it has outstanding in a counter shared by its copies
+template <typename T>
+struct counting_allocator
+{
+    typedef T value_type;
+
+    std::ptrdiff_t* outstanding;
+
+    explicit counting_allocator(std::ptrdiff_t* n) : outstanding(n) { }
+    template <typename U>
+    counting_allocator(const counting_allocator<U>& o) : outstanding(o.outstanding) { }
+
+    T* allocate(std::size_t n)
+    {
+        *outstanding += static_cast<std::ptrdiff_t>(n * sizeof(T));
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* p, std::size_t n)
+    {
+        *outstanding -= static_cast<std::ptrdiff_t>(n * sizeof(T));
+        std::allocator<T>().deallocate(p, n);
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const counting_allocator<T>& a, const counting_allocator<U>& b)
+{ return a.outstanding == b.outstanding; }
+
+template <typename T, typename U>
+bool operator!=(const counting_allocator<T>& a, const counting_allocator<U>& b)
+{ return !(a == b); }
+
+bool aligned(const void* p, std::size_t alignment)
+{ return reinterpret_cast<std::uintptr_t>(p) % alignment == 0; }
+
+} //namespace
+
+ARRAY2D_TEST(rows_are_packed_by_default)
+{
+    array2d::array2d<float> a(5, 3, 1.0f);
+    CHECK(a.pitch() == 5);
+    CHECK(&a(0, 1) == &a(4, 0) + 1);
+}
+
+ARRAY2D_TEST(aligned_rows_are_padded)
+{
+    array2d::array2d<float, std::allocator<float>, 64> a(5, 3, 1.0f);
+    CHECK(a.pitch() == 16);
+    bool rows_aligned = true;
+    for (std::size_t y = 0; y < a.height(); ++y)
+        rows_aligned = rows_aligned && aligned(&a(0, y), 64);
+    CHECK(rows_aligned);
+
+    //24 byte elements need a pitch that spans a whole number of 64 byte blocks
+    struct triple { double v[3]; };
+    array2d::array2d<triple, std::allocator<triple>, 64> t(3, 2);
+    CHECK(t.pitch() * sizeof(triple) % 64 == 0);
+    CHECK(aligned(&t(0, 1), 64));
+}
+
+ARRAY2D_TEST(iteration_skips_the_padding)
+{
+    array2d::array2d<int, std::allocator<int>, 32> a(3, 4, 0);
+    int n = 0;
+    for (std::size_t y = 0; y < a.height(); ++y)
+    {
+        for (std::size_t x = 0; x < a.width(); ++x)
+            a(x, y) = ++n;
+    }
+    CHECK(std::distance(a.begin(), a.end()) == 12);
+    CHECK(std::accumulate(a.begin(), a.end(), 0) == 78);
+    CHECK(*(a.begin() + 3) == 4);
+    CHECK(*(a.end() - 1) == 12);
+    CHECK(a.end() - a.begin() == 12);
+
+    const array2d::array2d<int, std::allocator<int>, 32> b(a);
+    CHECK(std::equal(a.begin(), a.end(), b.begin()));
+    CHECK(std::equal(b.row_begin(2), b.row_end(2), a.row_begin(2)));
+}
+
+ARRAY2D_TEST(storage_comes_from_the_allocator)
+{
+    std::ptrdiff_t outstanding = 0;
+    {
+        typedef counting_allocator<double> alloc;
+        array2d::array2d<double, alloc, 64> a(7, 5, 2.0, alloc(&outstanding));
+        CHECK(outstanding >= static_cast<std::ptrdiff_t>(a.pitch() * 5 * sizeof(double)));
+        CHECK(aligned(a.data(), 64));
+        CHECK(a.get_allocator() == alloc(&outstanding));
+
+        array2d::array2d<double, alloc, 64> b(a);
+        CHECK(b.get_allocator() == a.get_allocator());
+        CHECK(b(6, 4) == 2.0);
+    }
+    CHECK(outstanding == 0);
+}
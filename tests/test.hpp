@@ -0,0 +1,213 @@
+/*
+ test.hpp - A small test harness: tests register themselves by name, checks
+            report the failed expression and carry on.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#ifndef ARRAY2D_TEST_H
+#define ARRAY2D_TEST_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace array2d_test
+{
+
+struct test_case
+{
+    const char* name;
+    void (*run)();
+};
+
+inline std::vector<test_case>& tests()
+{
+    static std::vector<test_case> t;
+    return t;
+}
+
+//failed checks in the test that is running
+inline int& failures()
+{
+    static int n = 0;
+    return n;
+}
+
+struct registrar
+{
+    registrar(const char* name, void (*run)())
+    {
+        test_case t = { name, run };
+        tests().push_back(t);
+    }
+};
+
+inline void fail(const char* file, int line, const std::string& what)
+{
+    std::printf("%s:%d: failed: %s\n", file, line, what.c_str());
+    ++failures();
+}
+
+inline bool near(double a, double b, double tolerance)
+{ return std::fabs(a - b) <= tolerance * std::max(1.0, std::fabs(b)); }
+
+//Fills a with whole numbers in [lo, hi] drawn from a generator seeded with
+//seed. Whole numbers keep sums and products of a few thousand elements exact
+//in float and double, so results summed in another order still compare equal.
+template <typename Grid>
+void fill_random(Grid& a, unsigned seed, int lo = -50, int hi = 50)
+{
+    typedef typename Grid::value_type T;
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> d(lo, hi);
+    for (std::size_t y = 0; y < a.height(); ++y)
+    {
+        for (std::size_t x = 0; x < a.width(); ++x)
+            a(x, y) = static_cast<T>(d(rng));
+    }
+}
+
+//the value fill_numbered() gives element (x, y), which differs for every
+//element of a grid up to 100 wide, so misplaced reads show
+inline int numbered_value(std::size_t x, std::size_t y)
+{ return static_cast<int>(y * 100 + x); }
+
+template <typename Grid>
+void fill_numbered(Grid& a)
+{
+    typedef typename Grid::value_type T;
+    for (std::size_t y = 0; y < a.height(); ++y)
+    {
+        for (std::size_t x = 0; x < a.width(); ++x)
+            a(x, y) = static_cast<T>(numbered_value(x, y));
+    }
+}
+
+//whether every element of a is what fill_numbered() gives it
+template <typename Grid>
+bool is_numbered(const Grid& a)
+{
+    typedef typename Grid::value_type T;
+    for (std::size_t y = 0; y < a.height(); ++y)
+    {
+        for (std::size_t x = 0; x < a.width(); ++x)
+        {
+            if (!(a(x, y) == static_cast<T>(numbered_value(x, y))))
+                return false;
+        }
+    }
+    return true;
+}
+
+#ifdef ARRAY2D_TEST_DIR
+//a file in the build directory named for the test, removed when done
+struct scratch_file
+{
+    std::string path;
+
+    explicit scratch_file(const char* name)
+        : path(std::string(ARRAY2D_TEST_DIR) + "/" + name + ".a2d") { }
+    ~scratch_file() { std::remove(path.c_str()); }
+};
+#endif
+
+//Runs the tests named on the command line, or every test, and returns 1 if
+//any check failed or a test threw.
+inline int main(int argc, char** argv)
+{
+    int failed = 0;
+    int run = 0;
+    for (std::size_t i = 0; i < tests().size(); ++i)
+    {
+        const test_case& t = tests()[i];
+        bool wanted = argc < 2;
+        for (int j = 1; j < argc; ++j)
+            wanted = wanted || std::strcmp(argv[j], t.name) == 0;
+        if (!wanted)
+            continue;
+
+        ++run;
+        failures() = 0;
+        std::printf("[ RUN      ] %s\n", t.name);
+        try
+        {
+            t.run();
+        }
+        catch (const std::exception& e)
+        {
+            std::printf("threw: %s\n", e.what());
+            ++failures();
+        }
+        catch (...)
+        {
+            std::printf("threw an unknown exception\n");
+            ++failures();
+        }
+        std::printf(failures() == 0 ? "[       OK ] %s\n" : "[  FAILED  ] %s\n", t.name);
+        if (failures() != 0)
+            ++failed;
+    }
+    std::printf("%d of %d tests passed\n", run - failed, run);
+    return failed == 0 ? 0 : 1;
+}
+
+} //array2d_test
+
+#define ARRAY2D_TEST(name)                                                      \
+    static void name();                                                         \
+    static array2d_test::registrar name##_registrar(#name, &name);              \
+    static void name()
+
+#define CHECK(cond)                                                             \
+    ((cond) ? (void)0 : array2d_test::fail(__FILE__, __LINE__, #cond))
+
+#define CHECK_NEAR(a, b, tolerance)                                             \
+    (array2d_test::near((a), (b), (tolerance)) ? (void)0 :                      \
+     array2d_test::fail(__FILE__, __LINE__, #a " near " #b))
+
+//expr must throw an exception of type E
+#define CHECK_THROWS(expr, E)                                                   \
+    do                                                                          \
+    {                                                                           \
+        bool threw = false;                                                     \
+        try                                                                     \
+        {                                                                       \
+            expr;                                                               \
+        }                                                                       \
+        catch (const E&)                                                        \
+        {                                                                       \
+            threw = true;                                                       \
+        }                                                                       \
+        if (!threw)                                                             \
+            array2d_test::fail(__FILE__, __LINE__, #expr " throws " #E);        \
+    } while (false)
+
+#endif //ARRAY2D_TEST_H
@@ -0,0 +1,182 @@
+/*
+ transpose_test.cpp - Transposes, rotations and flips of each element size with
+                     a vectorized kernel, against their definitions.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#include "test.hpp"
+
+#include "../array2d_transpose.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace
+{
+
+//16 bytes, which has a kernel of its own
+struct quad
+{
+    std::int32_t v[4];
+
+    quad() = default;
+    explicit quad(int n) : v{ n, -n, n, -n } { }
+    bool operator==(const quad& o) const
+    { return v[0] == o.v[0] && v[1] == o.v[1] && v[2] == o.v[2] && v[3] == o.v[3]; }
+};
+
+template <typename T>
+using grid = array2d::array2d<T, std::allocator<T>, 32>;
+
+template <typename T>
+grid<T> numbered(std::size_t width, std::size_t height)
+{
+    grid<T> a(width, height);
+    for (std::size_t y = 0; y < height; ++y)
+    {
+        for (std::size_t x = 0; x < width; ++x)
+            a(x, y) = T(static_cast<int>((y * width + x) % 127));
+    }
+    return a;
+}
+
+//whether every dst(x, y) is the element of src at the coordinates source(x, y)
+//points to
+template <typename T, typename F>
+bool matches(const grid<T>& src, const grid<T>& dst, F source)
+{
+    for (std::size_t y = 0; y < dst.height(); ++y)
+    {
+        for (std::size_t x = 0; x < dst.width(); ++x)
+        {
+            const std::size_t* s = source(x, y);
+            if (!(dst(x, y) == src(s[0], s[1])))
+                return false;
+        }
+    }
+    return true;
+}
+
+template <typename T>
+void check_operations()
+{
+    //sizes below, at and past a block, and several blocks with ragged edges
+    const std::size_t sizes[][2] = { { 1, 1 }, { 3, 5 }, { 16, 16 }, { 17, 9 }, { 70, 33 } };
+    for (std::size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+    {
+        const std::size_t w = sizes[s][0], h = sizes[s][1];
+        const grid<T> a = numbered<T>(w, h);
+        std::size_t p[2];
+
+        CHECK(matches(a, array2d::transpose(a),
+                      [&](std::size_t x, std::size_t y) { p[0] = y; p[1] = x; return p; }));
+        CHECK(matches(a, array2d::rotate90(a),
+                      [&](std::size_t x, std::size_t y) { p[0] = y; p[1] = h - 1 - x; return p; }));
+        CHECK(matches(a, array2d::rotate270(a),
+                      [&](std::size_t x, std::size_t y) { p[0] = w - 1 - y; p[1] = x; return p; }));
+        CHECK(matches(a, array2d::rotate180(a), [&](std::size_t x, std::size_t y) {
+            p[0] = w - 1 - x; p[1] = h - 1 - y; return p;
+        }));
+        CHECK(matches(a, array2d::flip_horizontal(a),
+                      [&](std::size_t x, std::size_t y) { p[0] = w - 1 - x; p[1] = y; return p; }));
+        CHECK(matches(a, array2d::flip_vertical(a),
+                      [&](std::size_t x, std::size_t y) { p[0] = x; p[1] = h - 1 - y; return p; }));
+
+        grid<T> b(a);
+        array2d::flip_horizontal_in_place(array2d::array2d_view<T>(b));
+        CHECK(matches(a, b,
+                      [&](std::size_t x, std::size_t y) { p[0] = w - 1 - x; p[1] = y; return p; }));
+        b = a;
+        array2d::flip_vertical_in_place(array2d::array2d_view<T>(b));
+        CHECK(matches(a, b,
+                      [&](std::size_t x, std::size_t y) { p[0] = x; p[1] = h - 1 - y; return p; }));
+        b = a;
+        array2d::rotate180_in_place(array2d::array2d_view<T>(b));
+        CHECK(matches(a, b, [&](std::size_t x, std::size_t y) {
+            p[0] = w - 1 - x; p[1] = h - 1 - y; return p;
+        }));
+
+        grid<T> square = numbered<T>(w, w);
+        const grid<T> before(square);
+        array2d::transpose_in_place(array2d::array2d_view<T>(square));
+        CHECK(matches(before, square,
+                      [&](std::size_t x, std::size_t y) { p[0] = y; p[1] = x; return p; }));
+    }
+}
+
+} //namespace
+
+ARRAY2D_TEST(one_byte_elements)
+{
+    check_operations<std::uint8_t>();
+}
+
+ARRAY2D_TEST(two_byte_elements)
+{
+    check_operations<std::uint16_t>();
+}
+
+ARRAY2D_TEST(four_byte_elements)
+{
+    check_operations<float>();
+}
+
+ARRAY2D_TEST(eight_byte_elements)
+{
+    check_operations<double>();
+}
+
+ARRAY2D_TEST(sixteen_byte_elements)
+{
+    check_operations<quad>();
+}
+
+ARRAY2D_TEST(views_of_part_of_a_grid)
+{
+    const grid<int> a = numbered<int>(20, 12);
+    grid<int> t(5, 7, 0);
+    const array2d::array2d_view<const int> region =
+        array2d::array2d_view<const int>(a).subview(3, 2, 7, 5);
+    array2d::transpose(region, array2d::array2d_view<int>(t));
+    bool same = true;
+    for (std::size_t y = 0; y < 7; ++y)
+    {
+        for (std::size_t x = 0; x < 5; ++x)
+            same = same && t(x, y) == a(y + 3, x + 2);
+    }
+    CHECK(same);
+}
+
+ARRAY2D_TEST(static_grids)
+{
+    const array2d::static_array2d<int, 3, 2> a{ { 1, 2, 3, 4, 5, 6 } };
+    const array2d::static_array2d<int, 2, 3> t = array2d::transpose(a);
+    CHECK(t(0, 0) == 1 && t(1, 0) == 4 && t(0, 2) == 3 && t(1, 2) == 6);
+    const array2d::static_array2d<int, 2, 3> r = array2d::rotate90(a);
+    CHECK(r(0, 0) == 4 && r(1, 0) == 1 && r(0, 2) == 6);
+    const array2d::static_array2d<int, 3, 2> f = array2d::flip_vertical(a);
+    CHECK(f(0, 0) == 4 && f(2, 1) == 3);
+}
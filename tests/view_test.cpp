@@ -0,0 +1,125 @@
+/*
+ view_test.cpp - Views of grids and external buffers, subviews and transposed
+                views.
+
+ Copyright (c) 2013, Kipp Hickman
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+  * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+  * Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.\
+*/
+
+#include "test.hpp"
+
+#include "../array2d.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+typedef array2d::array2d<int> grid;
+
+ARRAY2D_TEST(views_share_the_grid)
+{
+    grid a(6, 4);
+    array2d_test::fill_numbered(a);
+    const array2d::array2d_view<int> v(a);
+    CHECK(v.width() == 6 && v.height() == 4 && v.pitch() == a.pitch());
+    CHECK(array2d_test::is_numbered(v));
+
+    v(2, 3) = -1;
+    CHECK(a(2, 3) == -1);
+
+    const grid& ca = a;
+    const array2d::const_array2d_view<int> cv(ca);
+    const array2d::const_array2d_view<int> converted(v);
+    CHECK(cv.data() == converted.data());
+    CHECK(std::equal(cv.begin(), cv.end(), a.begin()));
+}
+
+ARRAY2D_TEST(views_of_external_buffers)
+{
+    //rows of 3 in a buffer with a pitch of 5
+    std::vector<int> buffer(5 * 4, 0);
+    for (std::size_t i = 0; i < buffer.size(); ++i)
+        buffer[i] = static_cast<int>(i);
+    const array2d::array2d_view<int> v(buffer.data(), 3, 4, 5);
+    CHECK(v(2, 1) == 7);
+    CHECK(std::distance(v.begin(), v.end()) == 12);
+    CHECK(*(v.row_begin(3) + 1) == 16);
+    CHECK(std::count(v.column_begin(0), v.column_end(0), 10) == 1);
+
+    const array2d::array2d_view<int> packed(buffer.data(), 4, 5);
+    CHECK(packed.pitch() == 4 && packed(0, 1) == 4);
+}
+
+ARRAY2D_TEST(subviews)
+{
+    grid a(10, 8);
+    array2d_test::fill_numbered(a);
+    const array2d::array2d_view<int> v = array2d::array2d_view<int>(a).subview(3, 2, 4, 5);
+    CHECK(v.width() == 4 && v.height() == 5);
+    bool same = true;
+    for (std::size_t y = 0; y < v.height(); ++y)
+    {
+        for (std::size_t x = 0; x < v.width(); ++x)
+            same = same && v(x, y) == array2d_test::numbered_value(x + 3, y + 2);
+    }
+    CHECK(same);
+
+    std::fill(v.begin(), v.end(), 0);
+    CHECK(a(3, 2) == 0 && a(6, 6) == 0);
+    CHECK(a(2, 2) == array2d_test::numbered_value(2, 2));
+    CHECK(a(7, 6) == array2d_test::numbered_value(7, 6));
+    CHECK(a(3, 7) == array2d_test::numbered_value(3, 7));
+
+    const array2d::array2d_view<int> inner = v.subview(1, 1, 2, 2);
+    CHECK(&inner(0, 0) == &a(4, 3));
+}
+
+ARRAY2D_TEST(transposed_views)
+{
+    grid a(5, 3);
+    array2d_test::fill_numbered(a);
+    const array2d::array2d_view<int, array2d::column_major> t =
+        array2d::array2d_view<int>(a).transpose();
+    CHECK(t.width() == 3 && t.height() == 5);
+    bool same = true;
+    for (std::size_t y = 0; y < t.height(); ++y)
+    {
+        for (std::size_t x = 0; x < t.width(); ++x)
+            same = same && &t(x, y) == &a(y, x);
+    }
+    CHECK(same);
+    CHECK(std::equal(t.column_begin(1), t.column_end(1), a.row_begin(1)));
+    CHECK(std::equal(t.row_begin(1), t.row_end(1), a.column_begin(1)));
+    CHECK(&t.transpose()(4, 2) == &a(4, 2));
+}
+
+ARRAY2D_TEST(at_checks_the_coordinates)
+{
+    grid a(4, 3, 7);
+    array2d::array2d_view<int> v(a);
+    CHECK(v.at(3, 2) == 7);
+    CHECK_THROWS(v.at(4, 0), std::out_of_range);
+    CHECK_THROWS(v.at(0, 3), std::out_of_range);
+    CHECK_THROWS(v.subview(1, 1, 2, 2).at(2, 0), std::out_of_range);
+}